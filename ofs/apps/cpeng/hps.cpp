@@ -23,11 +23,13 @@
 // CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <thread>
 #include "afu_test.h"
 #include "ofs_cpeng.h"
+#include "ofs_cpeng_async.h"
 
 #define CACHELINE_SZ 64u
 
@@ -97,7 +99,6 @@ public:
       return 0;
     }
 
-    // Read file into shared buffer
     std::ifstream inp(filename_, std::ios::binary | std::ios::ate);
     size_t sz = inp.tellg();
     inp.seekg(0, std::ios::beg);
@@ -106,18 +107,28 @@ public:
     auto buffer = shared_buffer::allocate(afu->handle(), padded_sz);
     auto ptr = reinterpret_cast<char*>(const_cast<uint8_t*>(buffer->c_type()));
     memset(ptr, 0, padded_sz);
-    if (!inp.read(ptr, sz)){
-      log_->error("error reading file: {}", filename_);
-      return 2;
-    }
     log_->info("opened file {} with size {}", filename_, sz);
 
-    // Call cpeng driver copy_buffer
+    // The file is read into the shared buffer one chunk ahead of the
+    // copy engine so that reading chunk N+1 overlaps the DMA of chunk N.
+    prefetch_ctx ctx{ &inp, ptr, sz, this };
+    ofs_cpeng_copy copy;
+    auto start = std::chrono::high_resolution_clock::now();
     auto copy_status =
-      ofs_cpeng_copy_image(&cpeng,
-          buffer->io_address(), destination_offset_, padded_sz, chunk_, timeout_usec_);
+      ofs_cpeng_copy_image_async(&copy, &cpeng,
+          buffer->io_address(), destination_offset_, padded_sz, chunk_,
+          timeout_usec_, prefetch, nullptr, &ctx);
+    if (!copy_status) {
+      copy_status = ofs_cpeng_copy_wait(&copy);
+    }
+    auto elapsed = std::chrono::duration_cast<usec>(
+      std::chrono::high_resolution_clock::now() - start).count();
+    if (!copy_status && elapsed) {
+      log_->info("copied {} bytes in {} usec ({:.2f} MB/s)",
+                 padded_sz, elapsed, double(padded_sz) / elapsed);
+    }
     if (copy_status) {
-      log_->error("Erro calling ofs_cpeng_copy_image");
+      log_->error("Error calling ofs_cpeng_copy_image_async");
       if (ofs_cpeng_dma_status_error(&cpeng)) {
         uint64_t axist_cpl = ofs_cpeng_ce_axist_cpl_sts(&cpeng);
         uint64_t acelite_bresp = ofs_cpeng_ce_acelite_bresp_sts(&cpeng);
@@ -145,6 +156,28 @@ public:
 
 
 private:
+  struct prefetch_ctx {
+    std::ifstream *inp;
+    char *buffer;
+    size_t file_size;
+    cpeng *self;
+  };
+
+  static int prefetch(void *context, uint32_t ptr, uint32_t size)
+  {
+    auto ctx = reinterpret_cast<prefetch_ctx*>(context);
+    // the tail of the buffer past the end of the file is already zeroed
+    if (ptr >= ctx->file_size) {
+      return 0;
+    }
+    size_t len = std::min(static_cast<size_t>(size), ctx->file_size - ptr);
+    if (!ctx->inp->read(ctx->buffer + ptr, len)) {
+      ctx->self->log_->error("error reading file: {}", ctx->self->filename_);
+      return 1;
+    }
+    return 0;
+  }
+
   void wait_for_verify(ofs_cpeng *cpeng)
   {
       // wait for both kernel and ssbl verify
@@ -25,3 +25,142 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include "ofs_cpeng.h"
+#include "ofs_cpeng_async.h"
+
+static void *ofs_cpeng_copy_thread(void *arg)
+{
+  ofs_cpeng_copy *copy = (ofs_cpeng_copy *)arg;
+  uint32_t chunk = copy->chunk ? copy->chunk : copy->size;
+  uint32_t nchunks = chunk ? (copy->size + chunk - 1) / chunk : 0;
+  uint64_t local_timeout = nchunks ? copy->timeout_usec / nchunks : 0;
+  uint32_t ptr = 0;
+  uint32_t len = copy->size < chunk ? copy->size : chunk;
+  int status = 0;
+
+  if (!local_timeout)
+    local_timeout = 1;
+
+  if (copy->prefetch && len &&
+      copy->prefetch(copy->context, 0, len)) {
+    OFS_ERR("prefetch of first chunk failed");
+    status = 1;
+    goto out;
+  }
+
+  while (ptr < copy->size) {
+    uint32_t next = ptr + len;
+    uint32_t next_len = copy->size - next < chunk ? copy->size - next : chunk;
+
+    ofs_cpeng_start_chunk(copy->drv, copy->iova + ptr,
+                          copy->offset + ptr, len);
+
+    // fill the next chunk while the engine works on this one
+    if (copy->prefetch && next < copy->size &&
+        copy->prefetch(copy->context, next, next_len)) {
+      OFS_ERR("prefetch of chunk at 0x%x failed", next);
+      ofs_cpeng_wait_chunk(copy->drv, local_timeout);
+      status = 1;
+      goto out;
+    }
+
+    if (ofs_cpeng_wait_chunk(copy->drv, local_timeout)) {
+      status = 1;
+      goto out;
+    }
+
+    ptr = next;
+    len = next_len;
+  }
+
+  if (copy->chunk)
+    ofs_cpeng_image_complete(copy->drv);
+
+out:
+  if (copy->callback)
+    copy->callback(copy->context, status);
+
+  // done is only read under the lock, so the caller can't free copy
+  // before this unlock, the thread's last use of it
+  pthread_mutex_lock(&copy->lock);
+  copy->status = status;
+  copy->done = 1;
+  pthread_cond_broadcast(&copy->cond);
+  pthread_mutex_unlock(&copy->lock);
+  return NULL;
+}
+
+int ofs_cpeng_copy_image_async(ofs_cpeng_copy *copy, ofs_cpeng *drv,
+                               uint64_t iova, uint64_t offset,
+                               uint32_t size, uint32_t chunk,
+                               uint64_t timeout_usec,
+                               ofs_cpeng_prefetch_fn prefetch,
+                               ofs_cpeng_copy_cb callback,
+                               void *context)
+{
+  pthread_attr_t attr;
+  int res;
+
+  if (!copy || !drv) {
+    OFS_ERR("invalid copy or driver");
+    return 1;
+  }
+
+  copy->drv = drv;
+  copy->iova = iova;
+  copy->offset = offset;
+  copy->size = size;
+  copy->chunk = chunk;
+  copy->timeout_usec = timeout_usec;
+  copy->prefetch = prefetch;
+  copy->callback = callback;
+  copy->context = context;
+  copy->done = 0;
+  copy->status = 0;
+
+  res = pthread_attr_init(&attr);
+  if (res) {
+    OFS_ERR("pthread_attr_init failed: %d", res);
+    return 1;
+  }
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  pthread_mutex_init(&copy->lock, NULL);
+  pthread_cond_init(&copy->cond, NULL);
+
+  // detached, so that a caller relying on the callback alone doesn't
+  // leave a thread behind
+  res = pthread_create(&copy->thread, &attr, ofs_cpeng_copy_thread, copy);
+  pthread_attr_destroy(&attr);
+  if (res) {
+    OFS_ERR("pthread_create failed: %d", res);
+    pthread_cond_destroy(&copy->cond);
+    pthread_mutex_destroy(&copy->lock);
+    return 1;
+  }
+  return 0;
+}
+
+int ofs_cpeng_copy_done(ofs_cpeng_copy *copy)
+{
+  int done;
+
+  pthread_mutex_lock(&copy->lock);
+  done = copy->done;
+  pthread_mutex_unlock(&copy->lock);
+  return done;
+}
+
+int ofs_cpeng_copy_wait(ofs_cpeng_copy *copy)
+{
+  int status;
+
+  pthread_mutex_lock(&copy->lock);
+  while (!copy->done)
+    pthread_cond_wait(&copy->cond, &copy->lock);
+  status = copy->status;
+  pthread_mutex_unlock(&copy->lock);
+
+  pthread_cond_destroy(&copy->cond);
+  pthread_mutex_destroy(&copy->lock);
+  return status;
+}
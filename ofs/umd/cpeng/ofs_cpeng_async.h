@@ -0,0 +1,98 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __ofs_cpeng_async__
+#define __ofs_cpeng_async__
+#include <pthread.h>
+#include "ofs_cpeng.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Called on the worker thread once the whole image has been copied (or
+ * the copy failed), before the copy is marked done. status is 0 on
+ * success. It must not free or reuse the copy, nor wait for it.
+ */
+typedef void (*ofs_cpeng_copy_cb)(void *context, int status);
+
+/*
+ * Called to populate [ptr, ptr+size) of the source buffer before that
+ * chunk is handed to the copy engine. The prefetch for chunk N+1 runs
+ * while chunk N is in flight. Return non-zero to abort the copy.
+ */
+typedef int (*ofs_cpeng_prefetch_fn)(void *context, uint32_t ptr, uint32_t size);
+
+typedef struct _ofs_cpeng_copy {
+  ofs_cpeng *drv;
+  uint64_t iova;
+  uint64_t offset;
+  uint32_t size;
+  uint32_t chunk;
+  uint64_t timeout_usec;
+  ofs_cpeng_prefetch_fn prefetch;
+  ofs_cpeng_copy_cb callback;
+  void *context;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int done;
+  int status;
+} ofs_cpeng_copy;
+
+/*
+ * Start copying size bytes at iova into HPS memory at offset on a
+ * detached worker thread. chunk of 0 copies the image in one transfer.
+ * prefetch and callback may be NULL. The copy structure is owned by the
+ * caller and must stay valid until ofs_cpeng_copy_done is non-zero or
+ * ofs_cpeng_copy_wait returns. Calling ofs_cpeng_copy_wait is optional.
+ * Returns 0 if the copy was started.
+ */
+int ofs_cpeng_copy_image_async(ofs_cpeng_copy *copy, ofs_cpeng *drv,
+                               uint64_t iova, uint64_t offset,
+                               uint32_t size, uint32_t chunk,
+                               uint64_t timeout_usec,
+                               ofs_cpeng_prefetch_fn prefetch,
+                               ofs_cpeng_copy_cb callback,
+                               void *context);
+
+/*
+ * Non-zero once the copy has finished, successfully or not.
+ */
+int ofs_cpeng_copy_done(ofs_cpeng_copy *copy);
+
+/*
+ * Block until the copy finishes and return its status. Call it at most
+ * once per copy.
+ */
+int ofs_cpeng_copy_wait(ofs_cpeng_copy *copy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ofs_cpeng_async__
@@ -27,6 +27,7 @@
 #define OFS_PRIMITIVES_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <time.h>
 
 #define SEC2NSEC 1000000000
@@ -86,6 +87,78 @@
         _status;                                                            \
 })                                                                          \
 
+/*
+ * Adaptive variants of OFS_WAIT_FOR_EQ/NE. Instead of a fixed sleep
+ * period, the wait spins with a pause instruction, then sleeps with an
+ * exponentially growing period (see struct ofs_wait_policy). Every wait
+ * is recorded in the libofs wait-time histogram.
+ */
+#define OFS_WAIT_FOR_EQ_ADAPTIVE(_bit, _value, _timeout_usec)              \
+({                                                                          \
+	int _status = 0;                                                    \
+	struct ofs_wait_state _ws;                                          \
+	ofs_wait_begin(&_ws);                                               \
+	while(_bit != _value) {                                             \
+		if (ofs_wait_step(&_ws, _timeout_usec)) {                   \
+			_status = 1;                                        \
+			break;                                              \
+		}                                                           \
+	}                                                                   \
+	ofs_wait_end(&_ws, _status);                                        \
+	_status;                                                            \
+})                                                                          \
+
+#define OFS_WAIT_FOR_NE_ADAPTIVE(_bit, _value, _timeout_usec)              \
+({                                                                          \
+	int _status = 0;                                                    \
+	struct ofs_wait_state _ws;                                          \
+	ofs_wait_begin(&_ws);                                               \
+	while(_bit == _value) {                                             \
+		if (ofs_wait_step(&_ws, _timeout_usec)) {                   \
+			_status = 1;                                        \
+			break;                                              \
+		}                                                           \
+	}                                                                   \
+	ofs_wait_end(&_ws, _status);                                        \
+	_status;                                                            \
+})                                                                          \
+
+/* bucket i counts waits shorter than 2^i usec, the last bucket the rest */
+#define OFS_WAIT_HIST_BUCKETS 24
+
+/**
+ * Tuning for the adaptive wait engine
+ */
+struct ofs_wait_policy {
+	uint32_t spin_iters;       /**< pause-spins before the first sleep */
+	uint32_t backoff_min_usec; /**< length of the first sleep */
+	uint32_t backoff_max_usec; /**< sleeps double up to this length */
+};
+
+/**
+ * Wait-time statistics collected by the adaptive wait engine
+ */
+struct ofs_wait_stats {
+	uint64_t waits;      /**< number of completed waits */
+	uint64_t timeouts;   /**< waits that timed out */
+	uint64_t spin_only;  /**< waits satisfied without sleeping */
+	uint64_t total_nsec; /**< sum of all wait times */
+	uint64_t max_nsec;   /**< longest wait */
+	uint64_t hist[OFS_WAIT_HIST_BUCKETS];
+};
+
+/**
+ * Per-wait state used by the adaptive wait macros
+ */
+struct ofs_wait_state {
+	struct ofs_wait_policy policy; /**< copied by ofs_wait_begin */
+	struct timespec begin;
+	uint64_t elapsed_nsec;
+	uint32_t iter;
+	uint32_t sleep_usec;
+	int slept;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -197,6 +270,58 @@ inline int ofs_wait_for_eq64(uint64_t *var, uint64_t value,
 	return 0;
 }
 
+/**
+ *  Start an adaptive wait
+ *
+ *  @param[out] ws Wait state to initialize
+ */
+void ofs_wait_begin(struct ofs_wait_state *ws);
+
+/**
+ *  Back off once while the awaited condition is still false
+ *
+ *  Spins with a pause instruction for the first policy.spin_iters steps,
+ *  then sleeps for a period that doubles from policy.backoff_min_usec up
+ *  to policy.backoff_max_usec.
+ *
+ *  @param[in] ws           Wait state from ofs_wait_begin
+ *  @param[in] timeout_usec Timeout value in usec
+ *  @returns 1 if the wait has timed out, 0 otherwise
+ */
+int ofs_wait_step(struct ofs_wait_state *ws, uint64_t timeout_usec);
+
+/**
+ *  Finish an adaptive wait and record it in the wait statistics
+ *
+ *  @param[in] ws     Wait state from ofs_wait_begin
+ *  @param[in] status 0 if the condition was met, 1 on timeout
+ */
+void ofs_wait_end(struct ofs_wait_state *ws, int status);
+
+/**
+ *  Get/set the policy used by subsequent adaptive waits
+ */
+void ofs_wait_get_policy(struct ofs_wait_policy *policy);
+void ofs_wait_set_policy(const struct ofs_wait_policy *policy);
+
+/**
+ *  Get a copy of the process-wide adaptive wait statistics
+ */
+void ofs_wait_get_stats(struct ofs_wait_stats *stats);
+
+/**
+ *  Clear the process-wide adaptive wait statistics
+ */
+void ofs_wait_reset_stats(void);
+
+/**
+ *  Print the adaptive wait statistics and histogram to fp
+ *
+ *  The statistics are also printed to stderr at exit when the
+ *  LIBOFS_WAIT_STATS environment variable is set.
+ */
+void ofs_wait_dump_stats(FILE *fp);
+
 #ifdef __cplusplus
 }
 #endif
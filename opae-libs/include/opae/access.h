@@ -58,6 +58,12 @@ extern "C" {
  *                          when all associated handles have been closed
  *                          (either explicitly with fpgaClose() or by process
  *                          termination).
+ *                        * FPGA_OPEN_UNLOCKED_MMIO requests that MMIO
+ *                          accessors (fpgaReadMMIO32/64, fpgaWriteMMIO32/64)
+ *                          not serialize on the handle lock. The caller
+ *                          guarantees that the handle is not closed while
+ *                          MMIO is in progress. Ignored by plugins that
+ *                          do not support it.
  * @returns             FPGA_OK on success. FPGA_NOT_FOUND if the resource for
  *                      'token' could not be found. FPGA_INVALID_PARAM if
  *                      'token' does not refer to a resource that can be
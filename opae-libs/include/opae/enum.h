@@ -68,6 +68,11 @@ extern "C" {
  * memory after use by calling fpgaDestroyToken() for each of the returned
  * tokens.
  *
+ * @note When more than one plugin is loaded, setting the environment variable
+ * `LIBOPAE_PARALLEL_ENUM` to 1 before fpgaInitialize() runs lets each plugin
+ * enumerate on its own thread. The results are merged in plugin order, so the
+ * tokens returned are the same as with sequential enumeration.
+ *
  * @param[in] filters      Array of `fpga_properties` objects describing the
  *                         properties of the objects that should be returned. A
  *                         resource is considered matching if its properties
@@ -153,6 +153,108 @@ fpga_result fpgaUnregisterEvent(fpga_handle handle,
 					     fpga_event_type event_type,
 					     fpga_event_handle event_handle);
 
+/**
+ * Event loop handle
+ *
+ * An event loop owns an epoll set and a pool of threads that dispatch
+ * callbacks for the event handles added to it.
+ */
+typedef struct _fpga_event_loop *fpga_event_loop;
+
+/**
+ * Event loop callback
+ *
+ * Called from one of the loop's threads when `eh` signals. `count` is the
+ * number of times the event fired since the previous callback for `eh`;
+ * values above 1 mean several interrupts were coalesced into one dispatch.
+ * A callback for a given event handle never runs concurrently with itself.
+ */
+typedef void (*fpga_event_callback)(fpga_event_handle eh, uint64_t count,
+				    void *context);
+
+/**
+ * Event loop statistics
+ */
+struct fpga_event_loop_stats {
+	uint64_t wakeups;    /**< epoll_wait() calls that returned events */
+	uint64_t dispatches; /**< callbacks invoked */
+	uint64_t interrupts; /**< events counted by the event handles */
+	uint64_t coalesced;  /**< interrupts folded into an earlier dispatch */
+	uint64_t max_batch;  /**< most event handles ready on one wakeup */
+};
+
+/**
+ * Create an event loop
+ *
+ * @param[in]  num_threads Number of dispatch threads. 0 selects one.
+ * @param[out] loop        Pointer to the new event loop.
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if `loop` is NULL.
+ * FPGA_NO_MEMORY on allocation failure. FPGA_EXCEPTION if the epoll set
+ * or the threads can't be created.
+ */
+fpga_result fpgaCreateEventLoop(uint32_t num_threads, fpga_event_loop *loop);
+
+/**
+ * Stop and destroy an event loop
+ *
+ * Waits for callbacks in progress to finish. Event handles that are still
+ * in the loop are removed, but not destroyed or unregistered. Must not be
+ * called from one of the loop's callbacks.
+ *
+ * @param[in] loop Pointer to the event loop to destroy.
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if `loop` is NULL.
+ * FPGA_BUSY if called from one of the loop's own dispatch threads; the
+ * loop is left running.
+ */
+fpga_result fpgaDestroyEventLoop(fpga_event_loop *loop);
+
+/**
+ * Add an event handle to an event loop
+ *
+ * The event must already be registered with fpgaRegisterEvent(). From now
+ * on the loop consumes the handle's events; the application must not read
+ * the handle's OS object itself.
+ *
+ * @param[in] loop     Event loop.
+ * @param[in] eh       Registered event handle.
+ * @param[in] callback Function called when `eh` signals.
+ * @param[in] context  Passed to `callback`.
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if a parameter is NULL
+ * or `eh` has no OS object. FPGA_BUSY if `eh` is already in the loop.
+ * FPGA_EXCEPTION if `eh` can't be added to the epoll set.
+ */
+fpga_result fpgaEventLoopAdd(fpga_event_loop loop, fpga_event_handle eh,
+			     fpga_event_callback callback, void *context);
+
+/**
+ * Remove an event handle from an event loop
+ *
+ * When called from a thread other than the one running the callback for
+ * `eh`, waits for that callback to return. May be called from the
+ * callback of `eh` itself.
+ *
+ * @param[in] loop Event loop.
+ * @param[in] eh   Event handle previously added with fpgaEventLoopAdd().
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if `loop` is NULL or `eh`
+ * is not in the loop.
+ */
+fpga_result fpgaEventLoopRemove(fpga_event_loop loop, fpga_event_handle eh);
+
+/**
+ * Get event loop statistics
+ *
+ * @param[in]  loop  Event loop.
+ * @param[out] stats Statistics since the loop was created.
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if a parameter is NULL.
+ */
+fpga_result fpgaEventLoopGetStats(fpga_event_loop loop,
+				  struct fpga_event_loop_stats *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -52,6 +52,7 @@
 #include <opae/sysobject.h>
 #include <opae/userclk.h>
 #include <opae/metrics.h>
+#include <opae/trace.h>
 
 #endif // __FPGA_FPGA_H__
 
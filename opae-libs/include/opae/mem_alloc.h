@@ -34,22 +34,57 @@
 * logic that ensures that a unique address with the appropriate size is
 * returned for each allocation request, and that an allocation can be freed,
 * ie released back to the available pool of logical address space for future
-* allocations. The memory backing the allocator's internal data structures
-* is managed by malloc()/free().
+* allocations.
+*
+* Free blocks are kept in address order and are also indexed by size, in
+* power-of-two size classes, so that allocation (best fit) and free are
+* O(log n) in the number of blocks. The block descriptors are carved from
+* slabs that are obtained with malloc() and released by mem_alloc_destroy().
 */
 
 #include <stdint.h>
 
+/**
+ * Index node
+ *
+ * Intrusive AVL tree node, embedded in struct mem_link.
+ */
+struct mem_tree {
+	struct mem_tree *left;
+	struct mem_tree *right;
+	int height;
+};
+
+/**
+ * Block descriptor
+ *
+ * Describes one free or allocated block. Free blocks are linked in
+ * ascending address order on mem_alloc::free; allocated blocks are
+ * linked on mem_alloc::allocated.
+ */
 struct mem_link {
 	uint64_t address;
 	uint64_t size;
 	struct mem_link *prev;
 	struct mem_link *next;
+	struct mem_tree by_address;	/**< Free or allocated address index. */
+	struct mem_tree by_size;	/**< Free size-class index. */
 };
 
+/** Number of free-block size classes: class n holds sizes [2^n, 2^(n+1)). */
+#define MEM_ALLOC_CLASSES 64
+
+struct mem_slab;
+
 struct mem_alloc {
 	struct mem_link free;
 	struct mem_link allocated;
+	struct mem_tree *free_by_address;
+	struct mem_tree *allocated_by_address;
+	struct mem_tree *free_by_size[MEM_ALLOC_CLASSES];
+	uint64_t class_mask;		/**< Bit n set when class n is non-empty. */
+	struct mem_slab *slabs;		/**< Storage for block descriptors. */
+	struct mem_link *spare;		/**< Unused block descriptors. */
 };
 
 #ifdef __cplusplus
@@ -107,6 +142,11 @@ int mem_alloc_add_free(struct mem_alloc *m,
  * Retrieve an available memory address for a free block
  * that is at least size bytes.
  *
+ * The smallest free block that can hold size bytes is chosen. When
+ * that block has room for it, the returned address is aligned to the
+ * largest power of two that divides size (at most 1GB), so that eg
+ * 2MB-multiple requests receive 2MB-aligned addresses.
+ *
  * @param[in, out] m       The memory allocator object.
  * @param[out]     address The retrieved address for the allocation.
  * @param[in]      size    The request size in bytes.
@@ -132,6 +132,37 @@ fpga_result fpgaGetMetricsThresholdInfo(fpga_handle handle,
 				struct metric_threshold *metric_thresholds,
 				uint32_t *num_thresholds);
 
+/**
+ * Read every metric of a resource in a single sweep
+ *
+ * All power, thermal and AFU counter values are read together into
+ * `metrics`, which is indexed by metric number: metrics[i] holds metric
+ * i as reported by fpgaGetMetricsInfo(). BMC sensors are read with one
+ * BMC transaction per sweep, and max10 sensor files are kept open by
+ * the handle between sweeps.
+ *
+ * The handle keeps the last sweep. If it was taken no more than
+ * `max_age_usec` microseconds ago, it is returned without touching the
+ * hardware; a `max_age_usec` of 0 always reads fresh values.
+ *
+ * @param[in] handle Handle to previously opened fpga resource
+ * @param[in] max_age_usec Oldest acceptable snapshot age, in microseconds
+ * @param[out] metrics Array of metric structs, allocated by the caller
+ * @param[inout] num_metrics Size of the metrics array on input. On
+ * output, the number of entries written.
+ * @param[out] timestamp_usec CLOCK_MONOTONIC time of the sweep, in
+ * microseconds. May be NULL.
+ *
+ * @returns FPGA_OK on success. FPGA_NOT_FOUND if no metric value could
+ * be read.
+ *
+ */
+fpga_result fpgaGetMetricsSnapshot(fpga_handle handle,
+				uint64_t max_age_usec,
+				fpga_metric *metrics,
+				uint64_t *num_metrics,
+				uint64_t *timestamp_usec);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
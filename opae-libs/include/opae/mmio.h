@@ -138,6 +138,59 @@ fpga_result fpgaWriteMMIO512(fpga_handle handle,
 			    uint32_t mmio_num, uint64_t offset,
 			    const void *value);
 
+/**
+ * Write a batch of values to MMIO space
+ *
+ * This function performs ops[0] through ops[num_ops-1] in order, each as a
+ * single 32 or 64 bit write (as given by the op's width) of the op's value
+ * to the op's offset. Every op is validated before any is performed: if
+ * any op has an invalid width or a misaligned or out-of-bounds offset,
+ * FPGA_INVALID_PARAM is returned and no op is performed.
+ *
+ * @note When the plugin serving handle has no batch entry point, the
+ * ops are issued one at a time and the region bounds are only checked
+ * per op. An out-of-bounds op then stops processing after the ops
+ * before it have been performed.
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[in]  mmio_num Number of MMIO space to access
+ * @param[in]  ops      Array of num_ops operations to perform
+ * @param[in]  num_ops  Number of elements in ops
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid, including any op with a width other than 4 or 8,
+ * or with a misaligned or out-of-bounds offset. FPGA_EXCEPTION if an
+ * internal exception occurred while trying to access the handle.
+ */
+fpga_result fpgaWriteMMIOBatch(fpga_handle handle,
+			       uint32_t mmio_num,
+			       const fpga_mmio_op *ops,
+			       uint32_t num_ops);
+
+/**
+ * Read a batch of values from MMIO space
+ *
+ * This function performs ops[0] through ops[num_ops-1] in order, each as a
+ * single 32 or 64 bit read (as given by the op's width) from the op's
+ * offset, storing the result in the op's value field. Every op is
+ * validated before any is performed: if any op has an invalid width or a
+ * misaligned or out-of-bounds offset, FPGA_INVALID_PARAM is returned and
+ * no op is performed. See fpgaWriteMMIOBatch() for plugins without a
+ * batch entry point.
+ *
+ * @param[in]     handle   Handle to previously opened accelerator resource
+ * @param[in]     mmio_num Number of MMIO space to access
+ * @param[in,out] ops      Array of num_ops operations to perform
+ * @param[in]     num_ops  Number of elements in ops
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid, including any op with a width other than 4 or 8,
+ * or with a misaligned or out-of-bounds offset. FPGA_EXCEPTION if an
+ * internal exception occurred while trying to access the handle.
+ */
+fpga_result fpgaReadMMIOBatch(fpga_handle handle,
+			      uint32_t mmio_num,
+			      fpga_mmio_op *ops,
+			      uint32_t num_ops);
+
 /**
  * Map MMIO space
  *
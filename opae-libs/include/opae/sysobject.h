@@ -235,6 +235,26 @@ fpga_result fpgaObjectRead64(fpga_object obj, uint64_t *value, int flags);
  */
 fpga_result fpgaObjectWrite64(fpga_object obj, uint64_t value, int flags);
 
+/**
+ * @brief Refresh the buffered copy of an FPGA object.
+ *
+ * For an attribute object this is the same as reading it with
+ * FPGA_OBJECT_SYNC. For a container object created with
+ * FPGA_OBJECT_RECURSE_ONE or FPGA_OBJECT_RECURSE_ALL, every readable
+ * attribute beneath it is refreshed in one pass, so that subsequent
+ * reads of its subobjects (see fpgaObjectGetObjectAt()) need not sync.
+ *
+ * Objects that have been synced keep their underlying file open until
+ * they are destroyed.
+ *
+ * @param[in] obj An fpga_object instance.
+ *
+ * @return FPGA_OK on success. FPGA_INVALID_PARAM if obj is invalid.
+ * FPGA_EXCEPTION if an attribute could not be read; the remaining
+ * attributes are still refreshed.
+ */
+fpga_result fpgaObjectSync(fpga_object obj);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -0,0 +1,122 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @file trace.h
+ * @brief Opt-in tracing of API calls into the plugins
+ *
+ * When tracing is enabled, every call that the API shell forwards to a
+ * plugin is timed and recorded in a per-thread, per-plugin latency
+ * histogram. Histograms are log-linear (HDR-style): each power of two
+ * is split into eight sub-buckets, so reported percentiles are within
+ * about 6% of the true value across the whole range.
+ *
+ * Tracing is off by default. It is enabled either by calling
+ * fpgaTraceEnable() or by setting LIBOPAE_TRACE=1 in the environment.
+ * When LIBOPAE_TRACE_FILE is also set, the collected data is written
+ * there as JSON when the library is unloaded.
+ *
+ * The recorded latency covers the plugin call only. Time spent in the
+ * API shell itself is the difference between what the application
+ * measures around an fpga* call and what is reported here.
+ */
+
+#ifndef __FPGA_TRACE_H__
+#define __FPGA_TRACE_H__
+
+#include <stdio.h>
+#include <opae/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Latency summary for one API, as returned by fpgaTraceGetStats(). */
+struct fpga_trace_stats {
+	uint64_t count;     /**< Number of calls recorded */
+	uint64_t errors;    /**< Calls that returned other than FPGA_OK */
+	uint64_t min_nsec;  /**< Fastest call */
+	uint64_t max_nsec;  /**< Slowest call */
+	uint64_t mean_nsec; /**< Average call */
+	uint64_t p50_nsec;  /**< Median */
+	uint64_t p90_nsec;  /**< 90th percentile */
+	uint64_t p99_nsec;  /**< 99th percentile */
+	uint64_t p999_nsec; /**< 99.9th percentile */
+};
+
+/**
+ * Turn API tracing on or off
+ *
+ * Data recorded so far is kept when tracing is turned off.
+ *
+ * @param[in] enable true to start recording, false to stop.
+ * @returns FPGA_OK
+ */
+fpga_result fpgaTraceEnable(bool enable);
+
+/**
+ * Discard all recorded trace data
+ *
+ * @returns FPGA_OK
+ */
+fpga_result fpgaTraceReset(void);
+
+/**
+ * Retrieve the latency summary for one API
+ *
+ * Data from all threads is merged. Calls that are in flight while the
+ * summary is computed may or may not be included.
+ *
+ * @param[in] plugin Plugin library name as given in the plugin
+ * configuration (eg "libxfpga.so"), or NULL to merge all plugins.
+ * @param[in] api Name of the API, eg "fpgaReadMMIO64".
+ * @param[out] stats Receives the summary.
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if api or stats is
+ * NULL. FPGA_NOT_FOUND if the plugin or API is unknown, or no calls
+ * were recorded for it.
+ */
+fpga_result fpgaTraceGetStats(const char *plugin, const char *api,
+			      struct fpga_trace_stats *stats);
+
+/**
+ * Write all recorded trace data as JSON
+ *
+ * The output is an object keyed by plugin, then by API name. Each API
+ * carries the fields of struct fpga_trace_stats along with the non-empty
+ * histogram buckets as [lower_bound_nsec, count] pairs.
+ *
+ * @param[in] fp Stream to write to.
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if fp is NULL.
+ * FPGA_NO_MEMORY if the JSON document could not be built.
+ * FPGA_EXCEPTION if writing to fp fails.
+ */
+fpga_result fpgaTraceDump(FILE *fp);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __FPGA_TRACE_H__
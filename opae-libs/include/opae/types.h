@@ -188,6 +188,17 @@ struct fpga_error_info {
  */
 typedef void *fpga_object;
 
+/** MMIO batch operation
+ *
+ * One register access within a call to fpgaReadMMIOBatch() or
+ * fpgaWriteMMIOBatch().
+ */
+typedef struct fpga_mmio_op {
+	uint64_t offset;  /**< Byte offset into MMIO space */
+	uint64_t value;   /**< Value to write, or value read */
+	uint32_t width;   /**< Access width in bytes (4 or 8) */
+} fpga_mmio_op;
+
 /** FPGA Metric string size
  *
  *
@@ -132,7 +132,9 @@ enum fpga_buffer_flags {
  */
 enum fpga_open_flags {
 	/** Open FPGA resource for shared access */
-	FPGA_OPEN_SHARED = (1u << 0)
+	FPGA_OPEN_SHARED = (1u << 0),
+	/** Perform MMIO on the handle without taking the handle lock */
+	FPGA_OPEN_UNLOCKED_MMIO = (1u << 1)
 };
 
 /**
@@ -133,15 +133,104 @@ struct opae_vfio_buffer {
 	uint8_t *buffer_ptr;		/**< Buffer virtual address. */
 	size_t buffer_size;		/**< Buffer size. */
 	uint64_t buffer_iova;		/**< Buffer IOVA address. */
+	size_t buffer_requested;	/**< Size asked for by the caller. */
+	uint64_t buffer_page_size;	/**< Size of the backing pages. */
+	int buffer_numa_node;		/**< NUMA node it was placed on, or -1. */
+	uint32_t buffer_flags;		/**< Access and placement flags it was allocated with. */
 	struct opae_vfio_buffer *next;	/**< Pointer to next in list. */
 };
 
+/**
+ * Fail rather than fall back to smaller pages
+ *
+ * Flag for opae_vfio_buffer_allocate_ex().
+ */
+#define OPAE_VFIO_BUF_NO_FALLBACK (1u << 0)
+
+/**
+ * Prefer, rather than require, the given NUMA node
+ *
+ * Flag for opae_vfio_buffer_allocate_ex().
+ */
+#define OPAE_VFIO_BUF_NUMA_PREFERRED (1u << 1)
+
+/**
+ * Grant the device read access only
+ *
+ * Flag for opae_vfio_buffer_allocate_ex().
+ */
+#define OPAE_VFIO_BUF_READ_ONLY (1u << 2)
+
+/**
+ * DMA buffer footprint
+ *
+ * Compares the memory asked for by live DMA buffers with the memory
+ * actually pinned for them. See opae_vfio_buffer_footprint().
+ */
+struct opae_vfio_buffer_footprint {
+	uint64_t buffers;		/**< Live allocated buffers. */
+	uint64_t requested_bytes;	/**< Bytes asked for by live buffers. */
+	uint64_t mapped_bytes;		/**< Bytes pinned for live buffers. */
+	uint64_t huge_1g_bytes;		/**< Of mapped_bytes, in 1GB pages. */
+	uint64_t huge_2m_bytes;		/**< Of mapped_bytes, in 2MB pages. */
+	uint64_t small_bytes;		/**< Of mapped_bytes, in base pages. */
+	uint64_t cached_bytes;		/**< Bytes pinned by the buffer cache. */
+	uint64_t fallbacks;		/**< Allocations placed in smaller pages than chosen. */
+};
+
+/**
+ * Number of DMA buffer cache size classes
+ *
+ * Size class n holds buffers of more than 2^(n+11) and at most
+ * 2^(n+12) bytes, so class 0 holds 4KB buffers and class 9 holds
+ * 2MB buffers.
+ */
+#define OPAE_VFIO_CACHE_CLASSES 40
+
+/**
+ * DMA buffer cache statistics
+ *
+ * Counters describing the activity of the DMA buffer cache.
+ * See opae_vfio_buffer_cache_stats().
+ */
+struct opae_vfio_buffer_cache_stats {
+	uint64_t hits;		/**< Allocations served from the cache. */
+	uint64_t misses;	/**< Allocations that had to map a new buffer. */
+	uint64_t recycled;	/**< Frees that returned a buffer to the cache. */
+	uint64_t released;	/**< Frees that unmapped because of a high-water mark. */
+	uint64_t trimmed;	/**< Buffers unmapped by opae_vfio_buffer_cache_trim(). */
+	uint64_t cached_buffers;	/**< Buffers currently held by the cache. */
+	uint64_t cached_bytes;		/**< Bytes currently held by the cache. */
+	uint64_t peak_cached_bytes;	/**< Largest value of cached_bytes. */
+};
+
+/**
+ * DMA buffer cache
+ *
+ * When enabled, freed DMA buffers stay mapped and pinned on a free list
+ * for their size class and are handed back out by later allocations of
+ * that class without any system calls.
+ * See opae_vfio_buffer_cache_enable().
+ */
+struct opae_vfio_buffer_cache {
+	int enabled;					/**< Non-zero when caching. */
+	uint32_t max_per_class;				/**< High-water mark, buffers per class. */
+	uint64_t max_bytes;				/**< High-water mark, total bytes. */
+	uint32_t class_count[OPAE_VFIO_CACHE_CLASSES];	/**< Buffers cached per class. */
+	struct opae_vfio_buffer *free_list[OPAE_VFIO_CACHE_CLASSES];	/**< Cached buffers per class. */
+	struct opae_vfio_buffer_cache_stats stats;	/**< Cache counters. */
+};
+
 /**
  * OPAE VFIO device abstraction
  *
  * This structure is used to interact with the OPAE VFIO API. It tracks
  * data related to the VFIO container, group, and device. A mutex is
  * provided for thread safety.
+ *
+ * A device opened with opae_vfio_open_shared() does not own a container.
+ * Its cont_owner points at the device whose container, IOVA space, DMA
+ * buffers and buffer cache it uses.
  */
 struct opae_vfio {
 	pthread_mutex_t lock;				/**< For thread safety. */
@@ -153,6 +242,12 @@ struct opae_vfio {
 	struct opae_vfio_group group;			/**< The VFIO device group. */
 	struct opae_vfio_device device;			/**< The VFIO device. */
 	struct opae_vfio_buffer *cont_buffers;		/**< List of allocated DMA buffers. */
+	struct opae_vfio_buffer_cache cache;		/**< Cache of freed DMA buffers. */
+	struct opae_vfio_buffer *cont_user_buffers;	/**< List of caller-owned DMA mappings. */
+	uint64_t cont_fallbacks;			/**< See opae_vfio_buffer_footprint. */
+	struct opae_vfio *cont_owner;			/**< Container owner, NULL if this device. */
+	uint32_t cont_users;				/**< Devices sharing this container. */
+	int cont_close_pending;				/**< Owner closed while shared. */
 };
 
 #ifdef __cplusplus
@@ -221,6 +316,67 @@ int opae_vfio_secure_open(struct opae_vfio *v,
 			  const char *pciaddr,
 			  const char *token);
 
+/**
+ * Open a VFIO device into the container of another
+ *
+ * Opens the PCIe device corresponding to the address given in pciaddr
+ * and attaches its VFIO group to the container of owner, which must
+ * have been opened with opae_vfio_open or opae_vfio_secure_open.
+ * The two devices then share one IOVA space: a buffer allocated by
+ * opae_vfio_buffer_allocate on either of them is mapped once, pinned
+ * once, and its IOVA is valid for DMA from every device in the
+ * container. The buffer list and buffer cache are likewise shared.
+ * MMIO regions and interrupts remain per device.
+ *
+ * Sharing a container with a device that is already open into it is
+ * the same as sharing with that device's owner.
+ *
+ * When no buffer has yet been allocated, the container's IOVA ranges
+ * are rediscovered after the group is attached, so that the ranges
+ * reserved by every member device are excluded. Attach all devices
+ * before allocating buffers.
+ *
+ * Every device opened into a container must be closed with
+ * opae_vfio_close. Closing a member does not free the shared buffers.
+ * The owner may be closed first: its release is then deferred until
+ * the last member is closed, so the owner's storage must stay valid
+ * until then. No device can be opened into a container whose owner
+ * is closing.
+ *
+ * @param[out] v       Storage for the device info. May be stack-resident.
+ * @param[in]  owner   An open device whose container is to be shared.
+ * @param[in]  pciaddr The PCIe address of the requested device.
+ * @param[in]  token   Optional GUID representing the VF token. Pass
+ *                     NULL when the device does not require one.
+ * @returns Non-zero on error. Zero on success.
+ *
+ * Example
+ * @code{.c}
+ * opae_vfio card0;
+ * opae_vfio card1;
+ * size_t sz = 2 * 1024 * 1024;
+ * uint8_t *buf = NULL;
+ * uint64_t iova = 0;
+ *
+ * if (opae_vfio_open(&card0, "0000:3b:00.0")) {
+ *   // handle error
+ * } else if (opae_vfio_open_shared(&card1, &card0, "0000:af:00.0", NULL)) {
+ *   // handle error
+ * } else {
+ *   if (!opae_vfio_buffer_allocate(&card0, &sz, &buf, &iova)) {
+ *     // card0 writes to iova, then card1 reads from iova.
+ *     opae_vfio_buffer_free(&card1, buf);
+ *   }
+ *   opae_vfio_close(&card1);
+ * }
+ * opae_vfio_close(&card0);
+ * @endcode
+ */
+int opae_vfio_open_shared(struct opae_vfio *v,
+			  struct opae_vfio *owner,
+			  const char *pciaddr,
+			  const char *token);
+
 /**
  * Query device MMIO region
  *
@@ -264,13 +420,21 @@ int opae_vfio_region_get(struct opae_vfio *v,
  * Allocate, map, and retrieve info for a system buffer capable of
  * DMA. Saves an entry in the v->cont_buffers list. If the buffer
  * is not explicitly freed by opae_vfio_buffer_free, it will be
- * freed during opae_vfio_close.
- *
- * mmap is used for the allocation. If the size is greater than 2MB,
- * then the allocation request is fulfilled by a 1GB huge page. Else,
- * if the size is greater than 4096, then the request is fulfilled by
- * a 2MB huge page. Else, the request is fulfilled by the non-huge
- * page pool.
+ * freed during opae_vfio_close. When v shares a container, the
+ * entry is saved in the list of the container owner and the IOVA
+ * is valid on every device in the container.
+ *
+ * mmap is used for the allocation. If the size is at least 1GB and
+ * no more than an eighth of the rounded-up mapping would be padding,
+ * then the request is fulfilled by 1GB huge pages. Else, if the size
+ * is greater than 4096, then the request is fulfilled by as many 2MB
+ * huge pages as it needs, mapped at one contiguous IOVA range. Else,
+ * the request is fulfilled by the non-huge page pool.
+ *
+ * When no huge page of the chosen size is free, the request falls
+ * back to 2MB pages and then to base pages that are eligible for
+ * transparent huge pages. See opae_vfio_buffer_allocate_ex for
+ * control over the fallback and NUMA placement.
  *
  * @note Allocations from the huge page pool require that huge pages
  * be configured on the system. Huge pages may be configured on the
@@ -287,9 +451,9 @@ int opae_vfio_region_get(struct opae_vfio *v,
  * boot command: intel_iommu=on
  *
  * @param[in, out] v    The open OPAE VFIO device.
- * @param[in, out] size A pointer to the requested size. The size
- *                      may be rounded to the next page size prior
- *                      to return from the function.
+ * @param[in, out] size A pointer to the requested size. On return,
+ *                      the size actually mapped, a multiple of the
+ *                      backing page size.
  * @param[out]     buf  Optional pointer to receive the virtual address
  *                      for the buffer. Pass NULL to ignore.
  * @param[out]     iova Optional pointer to receive the IOVA address
@@ -332,6 +496,68 @@ int opae_vfio_buffer_allocate(struct opae_vfio *v,
 			      uint8_t **buf,
 			      uint64_t *iova);
 
+/**
+ * Allocate and map system buffer, with placement control
+ *
+ * As opae_vfio_buffer_allocate, with the page fallback, device access
+ * and NUMA placement of the buffer given by flags and numa_node.
+ *
+ * A read-only request is served from the buffer cache only by a
+ * read-only buffer, and any other request only by a writable one.
+ * A request for a NUMA node is served from the buffer cache only by
+ * a buffer placed on that node, and a required node only by a buffer
+ * that was required on it. Without OPAE_VFIO_BUF_NO_FALLBACK a cached
+ * buffer may be backed by smaller pages than a new one would be.
+ *
+ * @param[in, out] v         The open OPAE VFIO device.
+ * @param[in, out] size      A pointer to the requested size. On return,
+ *                           the size actually mapped.
+ * @param[out]     buf       Optional pointer to receive the virtual
+ *                           address for the buffer. Pass NULL to ignore.
+ * @param[out]     iova      Optional pointer to receive the IOVA address
+ *                           for the buffer. Pass NULL to ignore.
+ * @param[in]      flags     Zero or more of OPAE_VFIO_BUF_NO_FALLBACK,
+ *                           OPAE_VFIO_BUF_NUMA_PREFERRED and
+ *                           OPAE_VFIO_BUF_READ_ONLY.
+ * @param[in]      numa_node The NUMA node for the buffer's memory, or
+ *                           -1 to use the policy of the calling thread.
+ * @returns Non-zero on error. Zero on success.
+ *
+ * Example
+ * @code{.c}
+ * size_t sz = 3 * 1024 * 1024;
+ * uint8_t *virt = NULL;
+ * uint64_t iova = 0;
+ *
+ * // Two 2MB pages from node 1, or fail.
+ * if (opae_vfio_buffer_allocate_ex(&v, &sz, &virt, &iova,
+ *                                  OPAE_VFIO_BUF_NO_FALLBACK, 1)) {
+ *   // handle allocation error
+ * }
+ * @endcode
+ */
+int opae_vfio_buffer_allocate_ex(struct opae_vfio *v,
+				 size_t *size,
+				 uint8_t **buf,
+				 uint64_t *iova,
+				 uint32_t flags,
+				 int numa_node);
+
+/**
+ * Report the DMA buffer footprint
+ *
+ * Retrieves the memory requested by and pinned for the live buffers
+ * from opae_vfio_buffer_allocate and opae_vfio_buffer_allocate_ex,
+ * by backing page size. Buffers mapped by opae_vfio_buffer_map are
+ * owned by the caller and are not counted.
+ *
+ * @param[in]  v  The open OPAE VFIO device.
+ * @param[out] fp Receives the footprint.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_footprint(struct opae_vfio *v,
+			       struct opae_vfio_buffer_footprint *fp);
+
 /**
  * Unmap and free a system buffer
  *
@@ -367,6 +593,144 @@ int opae_vfio_buffer_allocate(struct opae_vfio *v,
 int opae_vfio_buffer_free(struct opae_vfio *v,
 			  uint8_t *buf);
 
+/**
+ * Map a caller-owned system buffer for DMA
+ *
+ * Pins the memory at buf and maps it into the IOVA space of the
+ * device, without copying it. The memory stays owned by the caller:
+ * it must remain valid until opae_vfio_buffer_unmap is called, and
+ * it is never passed to munmap by this library. The same memory may
+ * be mapped more than once; each mapping has its own IOVA and is
+ * unmapped separately. Saves an entry in
+ * the v->cont_user_buffers list. Mappings that are not explicitly
+ * unmapped are unmapped during opae_vfio_close.
+ *
+ * @param[in, out] v     The open OPAE VFIO device.
+ * @param[in]      buf   Page-aligned virtual address of the buffer.
+ * @param[in]      size  Size of the buffer, a non-zero multiple of
+ *                       the page size.
+ * @param[in]      flags Access granted to the device: a combination
+ *                       of VFIO_DMA_MAP_FLAG_READ and
+ *                       VFIO_DMA_MAP_FLAG_WRITE. Zero grants both.
+ *                       Read-only memory, such as a file mapped with
+ *                       PROT_READ, must be mapped with
+ *                       VFIO_DMA_MAP_FLAG_READ alone.
+ * @param[out]     iova  Optional pointer to receive the IOVA address
+ *                       for the buffer. Pass NULL to ignore.
+ * @returns Non-zero on error. Zero on success.
+ *
+ * Example
+ * @code{.c}
+ * size_t sz = 16 * 4096;
+ * uint8_t *ring = aligned_alloc(4096, sz);
+ * uint64_t ring_iova = 0;
+ *
+ * if (opae_vfio_buffer_map(&v, ring, sz, 0, &ring_iova)) {
+ *   // handle map error
+ * } else {
+ *   // the device may now DMA to and from ring_iova
+ *
+ *   opae_vfio_buffer_unmap(&v, ring, ring_iova);
+ * }
+ * free(ring);
+ * @endcode
+ */
+int opae_vfio_buffer_map(struct opae_vfio *v,
+			 uint8_t *buf,
+			 size_t size,
+			 uint32_t flags,
+			 uint64_t *iova);
+
+/**
+ * Unmap a caller-owned system buffer
+ *
+ * The mapping of buf at iova must have been made by a previous call
+ * to opae_vfio_buffer_map. That DMA mapping is removed; any other
+ * mapping of the same memory, and the memory itself, are left
+ * untouched.
+ *
+ * @param[in, out] v    The open OPAE VFIO device.
+ * @param[in]      buf  The virtual address passed to
+ *                      opae_vfio_buffer_map.
+ * @param[in]      iova The IOVA returned by opae_vfio_buffer_map.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_unmap(struct opae_vfio *v,
+			   uint8_t *buf,
+			   uint64_t iova);
+
+/**
+ * Enable the DMA buffer cache
+ *
+ * After this call, opae_vfio_buffer_free keeps the freed buffer mapped
+ * and pinned on the free list for its size class, and
+ * opae_vfio_buffer_allocate serves requests from that list before
+ * mapping a new buffer. A buffer from the cache may be larger than
+ * the rounded request, by less than a factor of two; size receives
+ * its actual size. The contents of a recycled buffer are not cleared.
+ *
+ * A freed buffer is unmapped instead of cached when its class already
+ * holds max_per_class buffers or when caching it would push the total
+ * above max_bytes. Calling this function on an enabled cache updates
+ * the high-water marks, trimming the cache if it now exceeds them.
+ *
+ * @param[in, out] v             The open OPAE VFIO device.
+ * @param[in]      max_per_class The maximum number of buffers cached
+ *                               per size class.
+ * @param[in]      max_bytes     The maximum number of bytes cached.
+ * @returns Non-zero on error. Zero on success.
+ *
+ * Example
+ * @code{.c}
+ * opae_vfio v;
+ *
+ * if (opae_vfio_open(&v, "0000:00:00.0")) {
+ *   // handle error
+ * } else {
+ *   // keep up to 16 buffers per size class, and no more than 64MB
+ *   opae_vfio_buffer_cache_enable(&v, 16, 64 * 1024 * 1024);
+ * }
+ * @endcode
+ */
+int opae_vfio_buffer_cache_enable(struct opae_vfio *v,
+				  uint32_t max_per_class,
+				  uint64_t max_bytes);
+
+/**
+ * Disable the DMA buffer cache
+ *
+ * Unmaps and frees every cached buffer. Later calls to
+ * opae_vfio_buffer_free unmap immediately. The statistics are kept.
+ *
+ * @param[in, out] v The open OPAE VFIO device.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_cache_disable(struct opae_vfio *v);
+
+/**
+ * Shrink the DMA buffer cache
+ *
+ * Unmaps and frees cached buffers, largest size class first, until
+ * the cache holds no more than max_bytes.
+ *
+ * @param[in, out] v         The open OPAE VFIO device.
+ * @param[in]      max_bytes The number of cached bytes to keep.
+ *                           Pass 0 to empty the cache.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_cache_trim(struct opae_vfio *v,
+				uint64_t max_bytes);
+
+/**
+ * Retrieve DMA buffer cache statistics
+ *
+ * @param[in]  v     The open OPAE VFIO device.
+ * @param[out] stats Receives a snapshot of the cache counters.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_cache_stats(struct opae_vfio *v,
+				 struct opae_vfio_buffer_cache_stats *stats);
+
 /**
  * Enable an IRQ
  *
@@ -432,6 +796,13 @@ int opae_vfio_irq_disable(struct opae_vfio *v,
  * buffer allocations that have not be explicitly freed by
  * opae_vfio_buffer_free.
  *
+ * A device opened with opae_vfio_open_shared releases only its own
+ * group and device; the shared buffers belong to the owner. Closing
+ * an owner that still has devices open into its container defers
+ * its release, including its buffers, until the last of those
+ * devices is closed. The caller must not use the owner after
+ * opae_vfio_close, but must keep its storage valid until then.
+ *
  * @param[in] v Storage for the device info. May be stack-resident.
  *
  * Example
@@ -28,3 +28,193 @@
 #endif // HAVE_CONFIG_H
 
 #include <ofs/ofs_primitives.h>
+
+#include <stdlib.h>
+#include <string.h>
+#ifndef __USE_GNU
+#define __USE_GNU
+#endif // __USE_GNU
+#include <pthread.h>
+
+// emit external definitions of the inline helpers
+extern int ofs_diff_timespec(struct timespec *result,
+			     struct timespec *lhs, struct timespec *rhs);
+extern int ofs_wait_for_eq32(uint32_t *var, uint32_t value,
+			     uint64_t timeout_usec, uint32_t sleep_usec);
+extern int ofs_wait_for_eq64(uint64_t *var, uint64_t value,
+			     uint64_t timeout_usec, uint32_t sleep_usec);
+
+#define OFS_WAIT_DEFAULT_SPIN_ITERS 256
+#define OFS_WAIT_DEFAULT_BACKOFF_MIN_USEC 1
+#define OFS_WAIT_DEFAULT_BACKOFF_MAX_USEC 64
+
+static struct ofs_wait_policy wait_policy = {
+	.spin_iters = OFS_WAIT_DEFAULT_SPIN_ITERS,
+	.backoff_min_usec = OFS_WAIT_DEFAULT_BACKOFF_MIN_USEC,
+	.backoff_max_usec = OFS_WAIT_DEFAULT_BACKOFF_MAX_USEC
+};
+static pthread_mutex_t wait_policy_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct ofs_wait_stats wait_stats;
+
+static inline void ofs_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield" ::: "memory");
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+void ofs_wait_begin(struct ofs_wait_state *ws)
+{
+	// a wait runs to completion under the policy in force when it began
+	pthread_mutex_lock(&wait_policy_lock);
+	ws->policy = wait_policy;
+	pthread_mutex_unlock(&wait_policy_lock);
+
+	clock_gettime(CLOCK_MONOTONIC, &ws->begin);
+	ws->elapsed_nsec = 0;
+	ws->iter = 0;
+	ws->sleep_usec = ws->policy.backoff_min_usec;
+	ws->slept = 0;
+}
+
+int ofs_wait_step(struct ofs_wait_state *ws, uint64_t timeout_usec)
+{
+	struct timespec now, delta;
+
+	if (ws->iter < ws->policy.spin_iters) {
+		ofs_cpu_relax();
+		// reading the clock on every pause would dominate the spin
+		if (++ws->iter & 0xf)
+			return 0;
+	} else {
+		OFS_TIMESPEC_USEC(ts, ws->sleep_usec);
+		nanosleep(&ts, NULL);
+		ws->slept = 1;
+		if (ws->sleep_usec < ws->policy.backoff_max_usec) {
+			ws->sleep_usec = ws->sleep_usec ? ws->sleep_usec << 1 : 1;
+			if (ws->sleep_usec > ws->policy.backoff_max_usec)
+				ws->sleep_usec = ws->policy.backoff_max_usec;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ofs_diff_timespec(&delta, &now, &ws->begin);
+	ws->elapsed_nsec = delta.tv_nsec + delta.tv_sec*SEC2NSEC;
+	return ws->elapsed_nsec > timeout_usec*USEC2NSEC;
+}
+
+void ofs_wait_end(struct ofs_wait_state *ws, int status)
+{
+	struct timespec now, delta;
+	uint64_t usec;
+	uint64_t max;
+	int bucket = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ofs_diff_timespec(&delta, &now, &ws->begin);
+	ws->elapsed_nsec = delta.tv_nsec + delta.tv_sec*SEC2NSEC;
+
+	usec = ws->elapsed_nsec / USEC2NSEC;
+	while (usec && bucket < OFS_WAIT_HIST_BUCKETS - 1) {
+		usec >>= 1;
+		++bucket;
+	}
+
+	__atomic_add_fetch(&wait_stats.waits, 1, __ATOMIC_RELAXED);
+	if (status)
+		__atomic_add_fetch(&wait_stats.timeouts, 1, __ATOMIC_RELAXED);
+	if (!ws->slept)
+		__atomic_add_fetch(&wait_stats.spin_only, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&wait_stats.total_nsec, ws->elapsed_nsec,
+			   __ATOMIC_RELAXED);
+	__atomic_add_fetch(&wait_stats.hist[bucket], 1, __ATOMIC_RELAXED);
+
+	max = __atomic_load_n(&wait_stats.max_nsec, __ATOMIC_RELAXED);
+	while (ws->elapsed_nsec > max &&
+	       !__atomic_compare_exchange_n(&wait_stats.max_nsec, &max,
+					    ws->elapsed_nsec, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+void ofs_wait_get_policy(struct ofs_wait_policy *policy)
+{
+	pthread_mutex_lock(&wait_policy_lock);
+	*policy = wait_policy;
+	pthread_mutex_unlock(&wait_policy_lock);
+}
+
+void ofs_wait_set_policy(const struct ofs_wait_policy *policy)
+{
+	pthread_mutex_lock(&wait_policy_lock);
+	wait_policy = *policy;
+	if (!wait_policy.backoff_min_usec)
+		wait_policy.backoff_min_usec = 1;
+	if (wait_policy.backoff_max_usec < wait_policy.backoff_min_usec)
+		wait_policy.backoff_max_usec = wait_policy.backoff_min_usec;
+	pthread_mutex_unlock(&wait_policy_lock);
+}
+
+void ofs_wait_get_stats(struct ofs_wait_stats *stats)
+{
+	int i;
+
+	stats->waits = __atomic_load_n(&wait_stats.waits, __ATOMIC_RELAXED);
+	stats->timeouts = __atomic_load_n(&wait_stats.timeouts, __ATOMIC_RELAXED);
+	stats->spin_only = __atomic_load_n(&wait_stats.spin_only, __ATOMIC_RELAXED);
+	stats->total_nsec = __atomic_load_n(&wait_stats.total_nsec, __ATOMIC_RELAXED);
+	stats->max_nsec = __atomic_load_n(&wait_stats.max_nsec, __ATOMIC_RELAXED);
+	for (i = 0 ; i < OFS_WAIT_HIST_BUCKETS ; ++i)
+		stats->hist[i] = __atomic_load_n(&wait_stats.hist[i],
+						 __ATOMIC_RELAXED);
+}
+
+void ofs_wait_reset_stats(void)
+{
+	int i;
+
+	__atomic_store_n(&wait_stats.waits, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&wait_stats.timeouts, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&wait_stats.spin_only, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&wait_stats.total_nsec, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&wait_stats.max_nsec, 0, __ATOMIC_RELAXED);
+	for (i = 0 ; i < OFS_WAIT_HIST_BUCKETS ; ++i)
+		__atomic_store_n(&wait_stats.hist[i], 0, __ATOMIC_RELAXED);
+}
+
+void ofs_wait_dump_stats(FILE *fp)
+{
+	struct ofs_wait_stats stats;
+	int i;
+
+	ofs_wait_get_stats(&stats);
+
+	fprintf(fp, "libofs adaptive waits: %lu (timeouts: %lu, spin only: %lu)\n",
+		stats.waits, stats.timeouts, stats.spin_only);
+	if (!stats.waits)
+		return;
+	fprintf(fp, "  mean: %.3f usec  max: %.3f usec\n",
+		(double)stats.total_nsec / stats.waits * NSEC2USEC,
+		stats.max_nsec * NSEC2USEC);
+	for (i = 0 ; i < OFS_WAIT_HIST_BUCKETS ; ++i) {
+		if (!stats.hist[i])
+			continue;
+		if (i == OFS_WAIT_HIST_BUCKETS - 1)
+			fprintf(fp, "  >= %8lu usec: %lu\n",
+				1UL << (i - 1), stats.hist[i]);
+		else
+			fprintf(fp, "  <  %8lu usec: %lu\n",
+				1UL << i, stats.hist[i]);
+	}
+}
+
+__attribute__((destructor)) static void ofs_wait_release(void)
+{
+	if (getenv("LIBOFS_WAIT_STATS"))
+		ofs_wait_dump_stats(stderr);
+}
@@ -39,6 +39,7 @@ typedef struct _opae_api_adapter_table {
 
 	struct _opae_api_adapter_table *next;
 	opae_plugin plugin;
+	uint32_t trace_id; // slot in the API trace tables
 
 	fpga_result (*fpgaOpen)(fpga_token token, fpga_handle *handle,
 				int flags);
@@ -71,6 +72,13 @@ typedef struct _opae_api_adapter_table {
 	fpga_result (*fpgaWriteMMIO512)(fpga_handle handle, uint32_t mmio_num,
 				       uint64_t offset, void *value);
 
+	fpga_result (*fpgaWriteMMIOBatch)(fpga_handle handle, uint32_t mmio_num,
+					  const fpga_mmio_op *ops,
+					  uint32_t num_ops);
+
+	fpga_result (*fpgaReadMMIOBatch)(fpga_handle handle, uint32_t mmio_num,
+					 fpga_mmio_op *ops, uint32_t num_ops);
+
 	fpga_result (*fpgaMapMMIO)(fpga_handle handle, uint32_t mmio_num,
 				   uint64_t **mmio_ptr);
 
@@ -187,6 +195,8 @@ typedef struct _opae_api_adapter_table {
 	fpga_result (*fpgaObjectWrite64)(fpga_object obj, uint64_t value,
 					 int flags);
 
+	fpga_result (*fpgaObjectSync)(fpga_object obj);
+
 	fpga_result (*fpgaSetUserClock)(fpga_handle handle, uint64_t high_clk,
 					uint64_t low_clk, int flags);
 
@@ -213,6 +223,12 @@ typedef struct _opae_api_adapter_table {
 		metric_threshold *metric_thresholds,
 		uint32_t *num_thresholds);
 
+	fpga_result(*fpgaGetMetricsSnapshot)(fpga_handle handle,
+					uint64_t max_age_usec,
+					fpga_metric *metrics,
+					uint64_t *num_metrics,
+					uint64_t *timestamp_usec);
+
 	// configuration functions
 	int (*initialize)(void);
 	int (*finalize)(void);
@@ -40,6 +40,7 @@
 #include "pluginmgr.h"
 #include "opae_int.h"
 #include "props.h"
+#include "api_trace.h"
 
 
 STATIC pthread_mutex_t token_list_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
@@ -106,8 +107,8 @@ fpga_result opae_downref_wrapped_token(opae_wrapped_token *wt)
 		wt->magic = 0;
 
 		if (wt->adapter_table->fpgaDestroyToken)
-			fres = wt->adapter_table->fpgaDestroyToken(
-					&wt->opae_token);
+			fres = OPAE_TRACE_CALL(wt->adapter_table, fpgaDestroyToken,
+				&wt->opae_token);
 		else
 			fres = FPGA_NOT_SUPPORTED;
 
@@ -227,16 +228,32 @@ opae_allocate_wrapped_object(fpga_object opae_object,
 	return wobj;
 }
 
+// Set from LIBOPAE_PARALLEL_ENUM when the plugins are loaded.
+// Accessed atomically: it may be re-read while another thread enumerates.
+STATIC bool opae_parallel_enum;
+
+STATIC void opae_read_enum_env(void)
+{
+	const char *s = getenv("LIBOPAE_PARALLEL_ENUM");
+
+	__atomic_store_n(&opae_parallel_enum, s && strcmp(s, "0"),
+			 __ATOMIC_RELAXED);
+}
+
 fpga_result __OPAE_API__ fpgaInitialize(const char *config_file)
 {
+	opae_read_enum_env();
+
 	return opae_plugin_mgr_initialize(config_file) ? FPGA_EXCEPTION
 						       : FPGA_OK;
 }
 
 fpga_result __OPAE_API__ fpgaFinalize(void)
 {
-	return opae_plugin_mgr_finalize_all() ? FPGA_EXCEPTION
-					      : FPGA_OK;
+	fpga_result res = opae_plugin_mgr_finalize_all() ? FPGA_EXCEPTION
+							 : FPGA_OK;
+	opae_log_flush();
+	return res;
 }
 
 fpga_result __OPAE_API__ fpgaOpen(fpga_token token, fpga_handle *handle,
@@ -257,8 +274,9 @@ fpga_result __OPAE_API__ fpgaOpen(fpga_token token, fpga_handle *handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaClose,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_token->adapter_table->fpgaOpen(wrapped_token->opae_token,
-						     &opae_handle, flags);
+	res = OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaOpen,
+		wrapped_token->opae_token,
+		&opae_handle, flags);
 
 	ASSERT_RESULT(res);
 
@@ -268,7 +286,8 @@ fpga_result __OPAE_API__ fpgaOpen(fpga_token token, fpga_handle *handle,
 	if (!wrapped_handle) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		cres = wrapped_token->adapter_table->fpgaClose(opae_handle);
+		cres = OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaClose,
+			opae_handle);
 	}
 
 	*handle = wrapped_handle;
@@ -286,7 +305,7 @@ fpga_result __OPAE_API__ fpgaClose(fpga_handle handle)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaClose,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_handle->adapter_table->fpgaClose(
+	res = OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaClose,
 		wrapped_handle->opae_handle);
 
 	opae_destroy_wrapped_handle(wrapped_handle);
@@ -303,7 +322,7 @@ fpga_result __OPAE_API__ fpgaReset(fpga_handle handle)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReset,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReset(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaReset,
 		wrapped_handle->opae_handle);
 }
 
@@ -332,8 +351,8 @@ opae_get_parent_token(opae_wrapped_token *child)
 	if (!parent_props)
 		goto out_destroy_child_props;
 
-	res = child->adapter_table->fpgaUpdateProperties(
-			child->opae_token, child_props);
+	res = OPAE_TRACE_CALL(child->adapter_table, fpgaUpdateProperties,
+		child->opae_token, child_props);
 	if (res != FPGA_OK)
 		goto out_destroy_props;
 
@@ -359,8 +378,8 @@ opae_get_parent_token(opae_wrapped_token *child)
 		if (!p->adapter_table->fpgaUpdateProperties)
 			continue;
 
-		res = p->adapter_table->fpgaUpdateProperties(
-				p->opae_token, parent_props);
+		res = OPAE_TRACE_CALL(p->adapter_table, fpgaUpdateProperties,
+			p->opae_token, parent_props);
 		if (res != FPGA_OK)
 			goto out_unlock;
 
@@ -412,7 +431,7 @@ fpga_result __OPAE_API__ fpgaGetPropertiesFromHandle(fpga_handle handle,
 		wrapped_handle->adapter_table->fpgaGetPropertiesFromHandle,
 		FPGA_NOT_SUPPORTED);
 
-	res = wrapped_handle->adapter_table->fpgaGetPropertiesFromHandle(
+	res = OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetPropertiesFromHandle,
 		wrapped_handle->opae_handle, prop);
 
 	ASSERT_RESULT(res);
@@ -462,7 +481,7 @@ fpga_result __OPAE_API__ fpgaGetProperties(fpga_token token,
 			wrapped_token->adapter_table->fpgaGetProperties,
 			FPGA_NOT_SUPPORTED);
 
-		res = wrapped_token->adapter_table->fpgaGetProperties(
+		res = OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaGetProperties,
 			wrapped_token->opae_token, prop);
 
 		ASSERT_RESULT(res);
@@ -512,7 +531,7 @@ fpga_result __OPAE_API__ fpgaUpdateProperties(fpga_token token,
 		p->parent = NULL;
 	}
 
-	res = wrapped_token->adapter_table->fpgaUpdateProperties(
+	res = OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaUpdateProperties,
 		wrapped_token->opae_token, prop);
 
 	if (res != FPGA_OK) {
@@ -541,7 +560,7 @@ fpga_result __OPAE_API__ fpgaWriteMMIO64(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaWriteMMIO64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaWriteMMIO64(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaWriteMMIO64,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -555,7 +574,7 @@ fpga_result __OPAE_API__ fpgaReadMMIO64(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReadMMIO64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReadMMIO64(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaReadMMIO64,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -569,7 +588,7 @@ fpga_result __OPAE_API__ fpgaWriteMMIO32(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaWriteMMIO32,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaWriteMMIO32(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaWriteMMIO32,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -583,7 +602,7 @@ fpga_result __OPAE_API__ fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReadMMIO32,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReadMMIO32(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaReadMMIO32,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -597,10 +616,101 @@ fpga_result __OPAE_API__ fpgaWriteMMIO512(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaWriteMMIO512,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaWriteMMIO512(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaWriteMMIO512,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
+fpga_result __OPAE_API__ fpgaWriteMMIOBatch(fpga_handle handle,
+	uint32_t mmio_num, const fpga_mmio_op *ops, uint32_t num_ops)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+	opae_api_adapter_table *adapter;
+	fpga_result res = FPGA_OK;
+	uint32_t i;
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(ops);
+
+	adapter = wrapped_handle->adapter_table;
+
+	if (adapter->fpgaWriteMMIOBatch)
+		return OPAE_TRACE_CALL(adapter, fpgaWriteMMIOBatch,
+			wrapped_handle->opae_handle,
+			mmio_num, ops, num_ops);
+
+	// The plugin has no batch entry point: issue the ops one at a time.
+	ASSERT_NOT_NULL_RESULT(adapter->fpgaWriteMMIO32, FPGA_NOT_SUPPORTED);
+	ASSERT_NOT_NULL_RESULT(adapter->fpgaWriteMMIO64, FPGA_NOT_SUPPORTED);
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		if (!opae_mmio_op_valid(&ops[i], UINT64_MAX)) {
+			OPAE_ERR("invalid MMIO op %u", i);
+			return FPGA_INVALID_PARAM;
+		}
+	}
+
+	for (i = 0 ; (i < num_ops) && (res == FPGA_OK) ; ++i) {
+		if (ops[i].width == sizeof(uint32_t))
+			res = OPAE_TRACE_CALL(adapter, fpgaWriteMMIO32,
+				wrapped_handle->opae_handle, mmio_num,
+				ops[i].offset, (uint32_t)ops[i].value);
+		else
+			res = OPAE_TRACE_CALL(adapter, fpgaWriteMMIO64,
+				wrapped_handle->opae_handle, mmio_num,
+				ops[i].offset, ops[i].value);
+	}
+
+	return res;
+}
+
+fpga_result __OPAE_API__ fpgaReadMMIOBatch(fpga_handle handle,
+	uint32_t mmio_num, fpga_mmio_op *ops, uint32_t num_ops)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+	opae_api_adapter_table *adapter;
+	fpga_result res = FPGA_OK;
+	uint32_t value32 = 0;
+	uint32_t i;
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(ops);
+
+	adapter = wrapped_handle->adapter_table;
+
+	if (adapter->fpgaReadMMIOBatch)
+		return OPAE_TRACE_CALL(adapter, fpgaReadMMIOBatch,
+			wrapped_handle->opae_handle,
+			mmio_num, ops, num_ops);
+
+	// The plugin has no batch entry point: issue the ops one at a time.
+	ASSERT_NOT_NULL_RESULT(adapter->fpgaReadMMIO32, FPGA_NOT_SUPPORTED);
+	ASSERT_NOT_NULL_RESULT(adapter->fpgaReadMMIO64, FPGA_NOT_SUPPORTED);
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		if (!opae_mmio_op_valid(&ops[i], UINT64_MAX)) {
+			OPAE_ERR("invalid MMIO op %u", i);
+			return FPGA_INVALID_PARAM;
+		}
+	}
+
+	for (i = 0 ; (i < num_ops) && (res == FPGA_OK) ; ++i) {
+		if (ops[i].width == sizeof(uint32_t)) {
+			res = OPAE_TRACE_CALL(adapter, fpgaReadMMIO32,
+				wrapped_handle->opae_handle, mmio_num,
+				ops[i].offset, &value32);
+			ops[i].value = value32;
+		} else {
+			res = OPAE_TRACE_CALL(adapter, fpgaReadMMIO64,
+				wrapped_handle->opae_handle, mmio_num,
+				ops[i].offset, &ops[i].value);
+		}
+	}
+
+	return res;
+}
+
 fpga_result __OPAE_API__ fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
 			uint64_t **mmio_ptr)
 {
@@ -611,7 +721,7 @@ fpga_result __OPAE_API__ fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaMapMMIO,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaMapMMIO(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaMapMMIO,
 		wrapped_handle->opae_handle, mmio_num, mmio_ptr);
 }
 
@@ -624,7 +734,7 @@ fpga_result __OPAE_API__ fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaUnmapMMIO,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaUnmapMMIO(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaUnmapMMIO,
 		wrapped_handle->opae_handle, mmio_num);
 }
 
@@ -661,9 +771,10 @@ static int opae_enumerate(const opae_api_adapter_table *adapter, void *context)
 		return OPAE_ENUM_CONTINUE;
 	}
 
-	res = adapter->fpgaEnumerate(ctx->filters, ctx->num_filters,
-				     ctx->adapter_tokens, space_remaining,
-				     &num_matches);
+	res = OPAE_TRACE_CALL(adapter, fpgaEnumerate,
+		ctx->filters, ctx->num_filters,
+		ctx->adapter_tokens, space_remaining,
+		&num_matches);
 
 	if (res != FPGA_OK) {
 		OPAE_ERR("fpgaEnumerate() failed for \"%s\"",
@@ -702,6 +813,164 @@ static int opae_enumerate(const opae_api_adapter_table *adapter, void *context)
 		       : OPAE_ENUM_CONTINUE;
 }
 
+typedef struct _opae_adapter_enumeration {
+	const opae_api_adapter_table *adapter;
+	fpga_token *adapter_tokens;
+	uint32_t num_matches;
+	fpga_result res;
+} opae_adapter_enumeration;
+
+typedef struct _opae_parallel_enumeration_context {
+	const fpga_properties *filters;
+	uint32_t num_filters;
+	uint32_t max_tokens;
+	opae_adapter_enumeration *results;
+} opae_parallel_enumeration_context;
+
+static void opae_enumerate_adapter(const opae_api_adapter_table *adapter,
+				   uint32_t index, void *context)
+{
+	opae_parallel_enumeration_context *ctx =
+		(opae_parallel_enumeration_context *)context;
+	opae_adapter_enumeration *r = &ctx->results[index];
+
+	r->adapter = adapter;
+
+	if (!adapter->fpgaEnumerate) {
+		r->res = FPGA_NOT_SUPPORTED;
+		return;
+	}
+
+	r->res = OPAE_TRACE_CALL(adapter, fpgaEnumerate,
+		ctx->filters, ctx->num_filters,
+		r->adapter_tokens, ctx->max_tokens,
+		&r->num_matches);
+}
+
+static void opae_discard_adapter_tokens(opae_adapter_enumeration *r,
+					uint32_t first, uint32_t last)
+{
+	for ( ; first < last; ++first) {
+		if (r->adapter->fpgaDestroyToken)
+			OPAE_TRACE_CALL(r->adapter, fpgaDestroyToken,
+				&r->adapter_tokens[first]);
+	}
+}
+
+// Run every adapter's fpgaEnumerate() concurrently, each into its own
+// token array, then merge the results in adapter list order. Merging
+// reproduces opae_enumerate(): once the caller's token array is full,
+// later adapters are neither counted nor report errors, and their
+// tokens are destroyed.
+STATIC fpga_result opae_enumerate_parallel(opae_enumeration_context *ctx)
+{
+	opae_parallel_enumeration_context pctx;
+	uint32_t count;
+	uint32_t i;
+	int visited;
+	bool stop = false;
+
+	// No room for tokens: the sequential walk stops immediately.
+	if (ctx->wrapped_tokens && !ctx->max_wrapped_tokens)
+		return FPGA_NOT_SUPPORTED;
+
+	count = (uint32_t)opae_plugin_mgr_adapter_count();
+	if (count < 2)
+		return FPGA_NOT_SUPPORTED;
+
+	pctx.filters = ctx->filters;
+	pctx.num_filters = ctx->num_filters;
+	pctx.max_tokens = ctx->max_wrapped_tokens;
+	pctx.results = (opae_adapter_enumeration *)calloc(count,
+			sizeof(opae_adapter_enumeration));
+	if (!pctx.results)
+		return FPGA_NO_MEMORY;
+
+	if (ctx->wrapped_tokens && ctx->max_wrapped_tokens) {
+		fpga_token *adapter_tokens = (fpga_token *)calloc(
+			(size_t)count * ctx->max_wrapped_tokens,
+			sizeof(fpga_token));
+
+		if (!adapter_tokens) {
+			free(pctx.results);
+			return FPGA_NO_MEMORY;
+		}
+
+		for (i = 0; i < count; ++i)
+			pctx.results[i].adapter_tokens =
+				adapter_tokens + (size_t)i * ctx->max_wrapped_tokens;
+	}
+
+	visited = opae_plugin_mgr_parallel_for_each_adapter(
+			opae_enumerate_adapter, &pctx, count);
+	if (visited < 0) {
+		if (pctx.results[0].adapter_tokens)
+			free(pctx.results[0].adapter_tokens);
+		free(pctx.results);
+		return FPGA_EXCEPTION;
+	}
+
+	for (i = 0; i < (uint32_t)visited; ++i) {
+		opae_adapter_enumeration *r = &pctx.results[i];
+		uint32_t returned = 0;
+		uint32_t space_remaining;
+		uint32_t j = 0;
+
+		if (r->res == FPGA_OK && r->adapter_tokens)
+			returned = r->num_matches < pctx.max_tokens ?
+				r->num_matches : pctx.max_tokens;
+
+		space_remaining = ctx->max_wrapped_tokens -
+				  ctx->num_wrapped_tokens;
+
+		if (ctx->wrapped_tokens && !space_remaining)
+			stop = true;
+
+		if (stop) {
+			opae_discard_adapter_tokens(r, 0, returned);
+			continue;
+		}
+
+		if (!r->adapter->fpgaEnumerate) {
+			OPAE_MSG("NULL fpgaEnumerate in adapter \"%s\"",
+				 r->adapter->plugin.path);
+			continue;
+		}
+
+		if (r->res != FPGA_OK) {
+			OPAE_ERR("fpgaEnumerate() failed for \"%s\"",
+				 r->adapter->plugin.path);
+			++ctx->errors;
+			continue;
+		}
+
+		*ctx->num_matches += r->num_matches;
+
+		if (space_remaining > returned)
+			space_remaining = returned;
+
+		for (j = 0; j < space_remaining; ++j) {
+			opae_wrapped_token *wt = opae_allocate_wrapped_token(
+				r->adapter_tokens[j], r->adapter);
+			if (!wt) {
+				++ctx->errors;
+				stop = true;
+				break;
+			}
+
+			ctx->wrapped_tokens[ctx->num_wrapped_tokens++] = wt;
+		}
+
+		opae_discard_adapter_tokens(r, j, returned);
+	}
+
+	if (pctx.results[0].adapter_tokens)
+		free(pctx.results[0].adapter_tokens);
+	free(pctx.results);
+
+	return FPGA_OK;
+}
+
 fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 	uint32_t num_filters, fpga_token *tokens, uint32_t max_tokens,
 	uint32_t *num_matches)
@@ -739,6 +1008,11 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 
 	*num_matches = 0;
 
+	// Unless the plugins were loaded already, this is where
+	// they are loaded and initialized.
+	if (opae_plugin_mgr_initialize_once() >= 0)
+		opae_read_enum_env();
+
 	enum_context.filters = filters;
 	enum_context.num_filters = num_filters;
 	enum_context.wrapped_tokens = tokens;
@@ -813,7 +1087,9 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 	}
 
 	// perform the enumeration.
-	opae_plugin_mgr_for_each_adapter(opae_enumerate, &enum_context);
+	if (!__atomic_load_n(&opae_parallel_enum, __ATOMIC_RELAXED) ||
+	    opae_enumerate_parallel(&enum_context) != FPGA_OK)
+		opae_plugin_mgr_for_each_adapter(opae_enumerate, &enum_context);
 
 	res = (enum_context.errors > 0) ? FPGA_EXCEPTION : FPGA_OK;
 
@@ -857,7 +1133,7 @@ fpga_result __OPAE_API__ fpgaCloneToken(fpga_token src, fpga_token *dst)
 		wrapped_src_token->adapter_table->fpgaDestroyToken,
 		FPGA_NOT_SUPPORTED);
 
-	res = wrapped_src_token->adapter_table->fpgaCloneToken(
+	res = OPAE_TRACE_CALL(wrapped_src_token->adapter_table, fpgaCloneToken,
 		wrapped_src_token->opae_token, &cloned_token);
 
 	ASSERT_RESULT(res);
@@ -868,7 +1144,7 @@ fpga_result __OPAE_API__ fpgaCloneToken(fpga_token src, fpga_token *dst)
 	if (!wrapped_dst_token) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_src_token->adapter_table->fpgaDestroyToken(
+		dres = OPAE_TRACE_CALL(wrapped_src_token->adapter_table, fpgaDestroyToken,
 			&cloned_token);
 	}
 
@@ -940,7 +1216,7 @@ fpga_result __OPAE_API__ fpgaPrepareBuffer(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaPrepareBuffer,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaPrepareBuffer(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaPrepareBuffer,
 		wrapped_handle->opae_handle, len, buf_addr, wsid, flags);
 }
 
@@ -953,7 +1229,7 @@ fpga_result __OPAE_API__ fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReleaseBuffer,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReleaseBuffer(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaReleaseBuffer,
 		wrapped_handle->opae_handle, wsid);
 }
 
@@ -968,7 +1244,7 @@ fpga_result __OPAE_API__ fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetIOAddress,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetIOAddress(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetIOAddress,
 		wrapped_handle->opae_handle, wsid, ioaddr);
 }
 
@@ -1020,7 +1296,7 @@ fpga_result __OPAE_API__ fpgaReadError(fpga_token token,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaReadError,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaReadError(
+	return OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaReadError,
 		wrapped_token->opae_token, error_num, value);
 }
 
@@ -1032,7 +1308,7 @@ fpga_result __OPAE_API__ fpgaClearError(fpga_token token, uint32_t error_num)
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaClearError,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaClearError(
+	return OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaClearError,
 		wrapped_token->opae_token, error_num);
 }
 
@@ -1044,7 +1320,7 @@ fpga_result __OPAE_API__ fpgaClearAllErrors(fpga_token token)
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaClearAllErrors,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaClearAllErrors(
+	return OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaClearAllErrors,
 		wrapped_token->opae_token);
 }
 
@@ -1058,7 +1334,7 @@ fpga_result __OPAE_API__ fpgaGetErrorInfo(fpga_token token, uint32_t error_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaGetErrorInfo,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaGetErrorInfo(
+	return OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaGetErrorInfo,
 		wrapped_token->opae_token, error_num, error_info);
 }
 
@@ -1138,9 +1414,8 @@ fpga_result __OPAE_API__ fpgaDestroyEventHandle(fpga_event_handle *event_handle)
 			return FPGA_INVALID_PARAM;
 		}
 
-		res = wrapped_event_handle->adapter_table
-			      ->fpgaDestroyEventHandle(
-				      &wrapped_event_handle->opae_event_handle);
+		res = OPAE_TRACE_CALL(wrapped_event_handle->adapter_table, fpgaDestroyEventHandle,
+			&wrapped_event_handle->opae_event_handle);
 	}
 
 	opae_mutex_unlock(ires, &wrapped_event_handle->lock);
@@ -1184,9 +1459,8 @@ fpga_result __OPAE_API__ fpgaGetOSObjectFromEventHandle(
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_event_handle->adapter_table
-		      ->fpgaGetOSObjectFromEventHandle(
-			      wrapped_event_handle->opae_event_handle, fd);
+	res = OPAE_TRACE_CALL(wrapped_event_handle->adapter_table, fpgaGetOSObjectFromEventHandle,
+		wrapped_event_handle->opae_event_handle, fd);
 
 	opae_mutex_unlock(ires, &wrapped_event_handle->lock);
 
@@ -1220,7 +1494,7 @@ fpga_result __OPAE_API__ fpgaRegisterEvent(fpga_handle handle,
 			return FPGA_NOT_SUPPORTED;
 		}
 
-		res = wrapped_handle->adapter_table->fpgaCreateEventHandle(
+		res = OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaCreateEventHandle,
 			&wrapped_event_handle->opae_event_handle);
 
 		if (res != FPGA_OK) {
@@ -1253,7 +1527,7 @@ fpga_result __OPAE_API__ fpgaRegisterEvent(fpga_handle handle,
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_event_handle->adapter_table->fpgaRegisterEvent(
+	res = OPAE_TRACE_CALL(wrapped_event_handle->adapter_table, fpgaRegisterEvent,
 		wrapped_handle->opae_handle, event_type,
 		wrapped_event_handle->opae_event_handle, flags);
 
@@ -1297,7 +1571,7 @@ fpga_result __OPAE_API__ fpgaUnregisterEvent(fpga_handle handle,
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_event_handle->adapter_table->fpgaUnregisterEvent(
+	res = OPAE_TRACE_CALL(wrapped_event_handle->adapter_table, fpgaUnregisterEvent,
 		wrapped_handle->opae_handle, event_type,
 		wrapped_event_handle->opae_event_handle);
 
@@ -1317,7 +1591,7 @@ fpga_result __OPAE_API__ fpgaAssignPortToInterface(fpga_handle fpga,
 		wrapped_handle->adapter_table->fpgaAssignPortToInterface,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaAssignPortToInterface(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaAssignPortToInterface,
 		wrapped_handle->opae_handle, interface_num, slot_num, flags);
 }
 
@@ -1335,7 +1609,7 @@ fpga_result __OPAE_API__ fpgaAssignToInterface(fpga_handle fpga,
 		wrapped_handle->adapter_table->fpgaAssignToInterface,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaAssignToInterface(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaAssignToInterface,
 		wrapped_handle->opae_handle, wrapped_token->opae_token,
 		host_interface, flags);
 }
@@ -1354,7 +1628,7 @@ fpga_result __OPAE_API__ fpgaReleaseFromInterface(fpga_handle fpga,
 		wrapped_handle->adapter_table->fpgaReleaseFromInterface,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReleaseFromInterface(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaReleaseFromInterface,
 		wrapped_handle->opae_handle, wrapped_token->opae_token);
 }
 
@@ -1371,7 +1645,7 @@ fpga_result __OPAE_API__ fpgaReconfigureSlot(fpga_handle fpga, uint32_t slot,
 		wrapped_handle->adapter_table->fpgaReconfigureSlot,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReconfigureSlot(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaReconfigureSlot,
 		wrapped_handle->opae_handle, slot, bitstream, bitstream_len,
 		flags);
 }
@@ -1393,7 +1667,7 @@ fpga_result __OPAE_API__ fpgaTokenGetObject(fpga_token token, const char *name,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_token->adapter_table->fpgaTokenGetObject(
+	res = OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaTokenGetObject,
 		wrapped_token->opae_token, name, &obj, flags);
 
 	ASSERT_RESULT(res);
@@ -1404,7 +1678,8 @@ fpga_result __OPAE_API__ fpgaTokenGetObject(fpga_token token, const char *name,
 	if (!wrapped_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_token->adapter_table->fpgaDestroyObject(&obj);
+		dres = OPAE_TRACE_CALL(wrapped_token->adapter_table, fpgaDestroyObject,
+			&obj);
 	}
 
 	*object = wrapped_object;
@@ -1431,7 +1706,7 @@ fpga_result __OPAE_API__ fpgaHandleGetObject(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_handle->adapter_table->fpgaHandleGetObject(
+	res = OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaHandleGetObject,
 		wrapped_handle->opae_handle, name, &obj, flags);
 
 	ASSERT_RESULT(res);
@@ -1442,7 +1717,8 @@ fpga_result __OPAE_API__ fpgaHandleGetObject(fpga_handle handle,
 	if (!wrapped_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_handle->adapter_table->fpgaDestroyObject(&obj);
+		dres = OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaDestroyObject,
+			&obj);
 	}
 
 	*object = wrapped_object;
@@ -1468,7 +1744,7 @@ fpga_result __OPAE_API__ fpgaObjectGetObjectAt(fpga_object parent,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_object->adapter_table->fpgaObjectGetObjectAt(
+	res = OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectGetObjectAt,
 		wrapped_object->opae_object, index, &obj);
 
 	ASSERT_RESULT(res);
@@ -1479,7 +1755,8 @@ fpga_result __OPAE_API__ fpgaObjectGetObjectAt(fpga_object parent,
 	if (!wrapped_child_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_object->adapter_table->fpgaDestroyObject(&obj);
+		dres = OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaDestroyObject,
+			&obj);
 	}
 
 	*object = wrapped_child_object;
@@ -1507,7 +1784,7 @@ fpga_result __OPAE_API__ fpgaObjectGetObject(fpga_object parent,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_object->adapter_table->fpgaObjectGetObject(
+	res = OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectGetObject,
 		wrapped_object->opae_object, name, &obj, flags);
 
 	ASSERT_RESULT(res);
@@ -1518,7 +1795,8 @@ fpga_result __OPAE_API__ fpgaObjectGetObject(fpga_object parent,
 	if (!wrapped_child_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_object->adapter_table->fpgaDestroyObject(&obj);
+		dres = OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaDestroyObject,
+			&obj);
 	}
 
 	*object = wrapped_child_object;
@@ -1539,7 +1817,7 @@ fpga_result __OPAE_API__ fpgaDestroyObject(fpga_object *obj)
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_object->adapter_table->fpgaDestroyObject(
+	res = OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaDestroyObject,
 		&wrapped_object->opae_object);
 
 	opae_destroy_wrapped_object(wrapped_object);
@@ -1557,7 +1835,7 @@ fpga_result __OPAE_API__ fpgaObjectRead(fpga_object obj, uint8_t *buffer,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectRead,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectRead(
+	return OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectRead,
 		wrapped_object->opae_object, buffer, offset, len, flags);
 }
 
@@ -1571,7 +1849,7 @@ fpga_result __OPAE_API__ fpgaObjectGetSize(fpga_object obj, uint64_t *value,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectGetSize,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectGetSize(
+	return OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectGetSize,
 		wrapped_object->opae_object, value, flags);
 }
 
@@ -1585,7 +1863,7 @@ fpga_result __OPAE_API__ fpgaObjectGetType(fpga_object obj,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectGetType,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectGetType(
+	return OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectGetType,
 		wrapped_object->opae_object, type);
 }
 
@@ -1599,7 +1877,7 @@ fpga_result __OPAE_API__ fpgaObjectRead64(fpga_object obj, uint64_t *value,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectRead64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectRead64(
+	return OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectRead64,
 		wrapped_object->opae_object, value, flags);
 }
 
@@ -1612,10 +1890,22 @@ fpga_result __OPAE_API__ fpgaObjectWrite64(fpga_object obj, uint64_t value,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectWrite64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectWrite64(
+	return OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectWrite64,
 		wrapped_object->opae_object, value, flags);
 }
 
+fpga_result __OPAE_API__ fpgaObjectSync(fpga_object obj)
+{
+	opae_wrapped_object *wrapped_object = opae_validate_wrapped_object(obj);
+
+	ASSERT_NOT_NULL(wrapped_object);
+	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectSync,
+			       FPGA_NOT_SUPPORTED);
+
+	return OPAE_TRACE_CALL(wrapped_object->adapter_table, fpgaObjectSync,
+		wrapped_object->opae_object);
+}
+
 fpga_result __OPAE_API__ fpgaSetUserClock(fpga_handle handle,
 	uint64_t high_clk, uint64_t low_clk, int flags)
 {
@@ -1626,7 +1916,7 @@ fpga_result __OPAE_API__ fpgaSetUserClock(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaSetUserClock,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaSetUserClock(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaSetUserClock,
 		wrapped_handle->opae_handle, high_clk, low_clk, flags);
 }
 
@@ -1642,7 +1932,7 @@ fpga_result __OPAE_API__ fpgaGetUserClock(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetUserClock,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetUserClock(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetUserClock,
 		wrapped_handle->opae_handle, high_clk, low_clk, flags);
 }
 
@@ -1658,7 +1948,7 @@ fpga_result __OPAE_API__ fpgaGetNumMetrics(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetNumMetrics,
 			     FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetNumMetrics(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetNumMetrics,
 		wrapped_handle->opae_handle, num_metrics);
 }
 
@@ -1675,7 +1965,7 @@ fpga_result __OPAE_API__ fpgaGetMetricsInfo(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsInfo,
 			    FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsInfo(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetMetricsInfo,
 		wrapped_handle->opae_handle, metric_info, num_metrics);
 }
 
@@ -1694,7 +1984,7 @@ fpga_result __OPAE_API__ fpgaGetMetricsByIndex(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsByIndex,
 			   FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsByIndex(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetMetricsByIndex,
 		wrapped_handle->opae_handle, metric_num, num_metric_indexes, metrics);
 }
 
@@ -1713,7 +2003,7 @@ fpga_result __OPAE_API__ fpgaGetMetricsByName(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsByName,
 			   FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsByName(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetMetricsByName,
 		wrapped_handle->opae_handle, metrics_names, num_metric_names, metrics);
 }
 
@@ -1730,6 +2020,27 @@ fpga_result __OPAE_API__ fpgaGetMetricsThresholdInfo(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsThresholdInfo,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsThresholdInfo(
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetMetricsThresholdInfo,
 		wrapped_handle->opae_handle, metric_thresholds, num_thresholds);
 }
+
+fpga_result __OPAE_API__ fpgaGetMetricsSnapshot(fpga_handle handle,
+				uint64_t max_age_usec,
+				fpga_metric *metrics,
+				uint64_t *num_metrics,
+				uint64_t *timestamp_usec)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(metrics);
+	ASSERT_NOT_NULL(num_metrics);
+
+	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsSnapshot,
+			   FPGA_NOT_SUPPORTED);
+
+	return OPAE_TRACE_CALL(wrapped_handle->adapter_table, fpgaGetMetricsSnapshot,
+		wrapped_handle->opae_handle, max_age_usec, metrics,
+		num_metrics, timestamp_usec);
+}
@@ -0,0 +1,556 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <libgen.h>
+
+#include <json-c/json.h>
+
+#include <opae/trace.h>
+#include "opae_int.h"
+#include "api_trace.h"
+
+/*
+ * Log-linear histogram: values below 2^SUB_BITS get a bucket each, then
+ * every power of two is split into 2^SUB_BITS equal sub-buckets. Values
+ * at or beyond 2^(MAX_MSB+1) ns (over an hour) land in the last one.
+ */
+#define TRACE_SUB_BITS    3
+#define TRACE_SUB_BUCKETS (1 << TRACE_SUB_BITS)
+#define TRACE_MAX_MSB     41
+#define TRACE_BUCKETS \
+	((TRACE_MAX_MSB - TRACE_SUB_BITS + 2) * TRACE_SUB_BUCKETS)
+
+typedef struct _trace_hist {
+	uint32_t epoch;
+	uint64_t count;
+	uint64_t errors;
+	uint64_t total_nsec;
+	uint64_t min_nsec;
+	uint64_t max_nsec;
+	uint64_t buckets[TRACE_BUCKETS];
+} trace_hist;
+
+/*
+ * One per thread that has made a traced call. Only the owning thread
+ * writes to its histograms, so recording needs no locks or atomic
+ * read-modify-write. Blocks are never freed while the library is
+ * loaded: when a thread exits, its block is handed to the next thread
+ * that needs one, data included.
+ */
+typedef struct _trace_thread {
+	struct _trace_thread *next;
+	int in_use;
+	trace_hist *hist[OPAE_TRACE_MAX_PLUGINS][OPAE_TRACE_NUM_APIS];
+} trace_thread;
+
+int opae_trace_on;
+
+// fpgaTraceReset() bumps the epoch; writers clear stale histograms
+// themselves the next time they record, readers skip them.
+STATIC uint32_t trace_epoch = 1;
+
+STATIC trace_thread *trace_threads;
+STATIC __thread trace_thread *trace_self;
+STATIC pthread_key_t trace_key;
+STATIC pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+
+STATIC pthread_mutex_t trace_plugins_lock =
+	PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+STATIC char *trace_plugins[OPAE_TRACE_MAX_PLUGINS];
+STATIC uint32_t trace_num_plugins;
+
+STATIC const char *trace_file;
+
+#define OPAE_TRACE_NAME(__fn) #__fn,
+STATIC const char * const trace_api_names[OPAE_TRACE_NUM_APIS] = {
+	OPAE_TRACE_APIS(OPAE_TRACE_NAME)
+};
+#undef OPAE_TRACE_NAME
+
+#define TRACE_LOAD(__p)       __atomic_load_n(__p, __ATOMIC_RELAXED)
+#define TRACE_STORE(__p, __v) __atomic_store_n(__p, __v, __ATOMIC_RELAXED)
+
+STATIC uint32_t trace_bucket(uint64_t nsec)
+{
+	uint32_t msb;
+
+	if (nsec < TRACE_SUB_BUCKETS)
+		return (uint32_t)nsec;
+
+	msb = 63 - __builtin_clzll(nsec);
+	if (msb > TRACE_MAX_MSB)
+		return TRACE_BUCKETS - 1;
+
+	return (msb - TRACE_SUB_BITS + 1) * TRACE_SUB_BUCKETS +
+	       ((nsec >> (msb - TRACE_SUB_BITS)) & (TRACE_SUB_BUCKETS - 1));
+}
+
+STATIC uint64_t trace_bucket_low(uint32_t bucket)
+{
+	uint32_t msb;
+
+	if (bucket < TRACE_SUB_BUCKETS)
+		return bucket;
+
+	msb = bucket / TRACE_SUB_BUCKETS + TRACE_SUB_BITS - 1;
+	return (uint64_t)(TRACE_SUB_BUCKETS + bucket % TRACE_SUB_BUCKETS) <<
+	       (msb - TRACE_SUB_BITS);
+}
+
+STATIC uint64_t trace_bucket_width(uint32_t bucket)
+{
+	if (bucket < TRACE_SUB_BUCKETS)
+		return 1;
+	return 1ULL << (bucket / TRACE_SUB_BUCKETS - 1);
+}
+
+STATIC void trace_thread_exit(void *arg)
+{
+	trace_thread *t = (trace_thread *)arg;
+	__atomic_store_n(&t->in_use, 0, __ATOMIC_RELEASE);
+}
+
+STATIC void trace_key_init(void)
+{
+	pthread_key_create(&trace_key, trace_thread_exit);
+}
+
+STATIC trace_thread *trace_attach(void)
+{
+	trace_thread *t;
+	int expected;
+
+	pthread_once(&trace_once, trace_key_init);
+
+	for (t = __atomic_load_n(&trace_threads, __ATOMIC_ACQUIRE);
+	     t; t = t->next) {
+		expected = 0;
+		if (__atomic_compare_exchange_n(&t->in_use, &expected, 1, false,
+						__ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			goto out_attach;
+	}
+
+	t = calloc(1, sizeof(trace_thread));
+	if (!t)
+		return NULL;
+
+	t->in_use = 1;
+	t->next = __atomic_load_n(&trace_threads, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&trace_threads, &t->next, t, true,
+					    __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED))
+		/* t->next was refreshed, retry */;
+
+out_attach:
+	pthread_setspecific(trace_key, t);
+	trace_self = t;
+	return t;
+}
+
+STATIC void trace_hist_clear(trace_hist *h, uint32_t epoch)
+{
+	uint32_t i;
+
+	TRACE_STORE(&h->count, 0);
+	TRACE_STORE(&h->errors, 0);
+	TRACE_STORE(&h->total_nsec, 0);
+	TRACE_STORE(&h->min_nsec, UINT64_MAX);
+	TRACE_STORE(&h->max_nsec, 0);
+	for (i = 0 ; i < TRACE_BUCKETS ; ++i)
+		TRACE_STORE(&h->buckets[i], 0);
+
+	__atomic_store_n(&h->epoch, epoch, __ATOMIC_RELEASE);
+}
+
+void opae_trace_record(uint32_t plugin, enum opae_trace_api api,
+		       uint64_t begin_nsec, fpga_result res)
+{
+	uint64_t nsec = opae_trace_clock() - begin_nsec;
+	uint32_t epoch = TRACE_LOAD(&trace_epoch);
+	trace_thread *t = trace_self;
+	trace_hist *h;
+	uint32_t b;
+
+	if (!t) {
+		t = trace_attach();
+		if (!t)
+			return;
+	}
+
+	if (plugin >= OPAE_TRACE_MAX_PLUGINS)
+		plugin = OPAE_TRACE_MAX_PLUGINS - 1;
+
+	h = t->hist[plugin][api];
+	if (!h) {
+		h = malloc(sizeof(trace_hist));
+		if (!h)
+			return;
+		trace_hist_clear(h, epoch);
+		__atomic_store_n(&t->hist[plugin][api], h, __ATOMIC_RELEASE);
+	} else if (h->epoch != epoch) {
+		trace_hist_clear(h, epoch);
+	}
+
+	b = trace_bucket(nsec);
+
+	TRACE_STORE(&h->count, h->count + 1);
+	if (res != FPGA_OK)
+		TRACE_STORE(&h->errors, h->errors + 1);
+	TRACE_STORE(&h->total_nsec, h->total_nsec + nsec);
+	if (nsec < h->min_nsec)
+		TRACE_STORE(&h->min_nsec, nsec);
+	if (nsec > h->max_nsec)
+		TRACE_STORE(&h->max_nsec, nsec);
+	TRACE_STORE(&h->buckets[b], h->buckets[b] + 1);
+}
+
+uint32_t opae_trace_plugin_id(const char *path)
+{
+	char *copy;
+	char *name;
+	uint32_t i;
+	int res;
+
+	copy = strdup(path ? path : "unknown");
+	if (!copy)
+		return OPAE_TRACE_MAX_PLUGINS - 1;
+
+	name = basename(copy);
+
+	opae_mutex_lock(res, &trace_plugins_lock);
+
+	for (i = 0 ; i < trace_num_plugins ; ++i) {
+		if (!strcmp(trace_plugins[i], name))
+			goto out_unlock;
+	}
+
+	if (trace_num_plugins == OPAE_TRACE_MAX_PLUGINS) {
+		OPAE_MSG("API trace: \"%s\" shares slot with \"%s\"",
+			 name, trace_plugins[OPAE_TRACE_MAX_PLUGINS - 1]);
+		i = OPAE_TRACE_MAX_PLUGINS - 1;
+		goto out_unlock;
+	}
+
+	trace_plugins[i] = strdup(name);
+	if (trace_plugins[i])
+		++trace_num_plugins;
+	else
+		i = OPAE_TRACE_MAX_PLUGINS - 1;
+
+out_unlock:
+	opae_mutex_unlock(res, &trace_plugins_lock);
+	free(copy);
+	return i;
+}
+
+// Accumulate the current-epoch data for one plugin/api from all threads.
+STATIC void trace_merge(uint32_t plugin, uint32_t api, trace_hist *sum)
+{
+	uint32_t epoch = TRACE_LOAD(&trace_epoch);
+	trace_thread *t;
+	trace_hist *h;
+	uint64_t v;
+	uint32_t i;
+
+	for (t = __atomic_load_n(&trace_threads, __ATOMIC_ACQUIRE);
+	     t; t = t->next) {
+		h = __atomic_load_n(&t->hist[plugin][api], __ATOMIC_ACQUIRE);
+		if (!h || __atomic_load_n(&h->epoch, __ATOMIC_ACQUIRE) != epoch)
+			continue;
+
+		sum->count += TRACE_LOAD(&h->count);
+		sum->errors += TRACE_LOAD(&h->errors);
+		sum->total_nsec += TRACE_LOAD(&h->total_nsec);
+
+		v = TRACE_LOAD(&h->min_nsec);
+		if (v < sum->min_nsec)
+			sum->min_nsec = v;
+		v = TRACE_LOAD(&h->max_nsec);
+		if (v > sum->max_nsec)
+			sum->max_nsec = v;
+
+		for (i = 0 ; i < TRACE_BUCKETS ; ++i)
+			sum->buckets[i] += TRACE_LOAD(&h->buckets[i]);
+	}
+}
+
+STATIC uint64_t trace_percentile(const trace_hist *h, uint64_t bucket_total,
+				 uint32_t per_mille)
+{
+	uint64_t target;
+	uint64_t seen = 0;
+	uint64_t v;
+	uint32_t i;
+
+	target = (bucket_total * per_mille + 999) / 1000;
+	if (!target)
+		target = 1;
+
+	for (i = 0 ; i < TRACE_BUCKETS ; ++i) {
+		seen += h->buckets[i];
+		if (seen >= target)
+			break;
+	}
+
+	if (i == TRACE_BUCKETS)
+		return h->max_nsec;
+
+	// Report the middle of the bucket, kept within the observed range.
+	v = trace_bucket_low(i) + trace_bucket_width(i) / 2;
+	if (v < h->min_nsec)
+		v = h->min_nsec;
+	if (v > h->max_nsec)
+		v = h->max_nsec;
+	return v;
+}
+
+STATIC void trace_summarize(const trace_hist *h, struct fpga_trace_stats *stats)
+{
+	uint64_t bucket_total = 0;
+	uint32_t i;
+
+	// The buckets may be a few calls ahead of count when a
+	// record is in flight, so rank against their own total.
+	for (i = 0 ; i < TRACE_BUCKETS ; ++i)
+		bucket_total += h->buckets[i];
+
+	stats->count = h->count;
+	stats->errors = h->errors;
+	stats->min_nsec = h->count ? h->min_nsec : 0;
+	stats->max_nsec = h->max_nsec;
+	stats->mean_nsec = h->count ? h->total_nsec / h->count : 0;
+	stats->p50_nsec = trace_percentile(h, bucket_total, 500);
+	stats->p90_nsec = trace_percentile(h, bucket_total, 900);
+	stats->p99_nsec = trace_percentile(h, bucket_total, 990);
+	stats->p999_nsec = trace_percentile(h, bucket_total, 999);
+}
+
+STATIC trace_hist *trace_hist_alloc(void)
+{
+	trace_hist *h = calloc(1, sizeof(trace_hist));
+	if (h)
+		h->min_nsec = UINT64_MAX;
+	return h;
+}
+
+fpga_result __OPAE_API__ fpgaTraceEnable(bool enable)
+{
+	TRACE_STORE(&opae_trace_on, enable ? 1 : 0);
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaTraceReset(void)
+{
+	__atomic_add_fetch(&trace_epoch, 1, __ATOMIC_RELAXED);
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaTraceGetStats(const char *plugin,
+					   const char *api,
+					   struct fpga_trace_stats *stats)
+{
+	uint32_t a;
+	uint32_t p;
+	uint32_t num_plugins;
+	trace_hist *sum;
+	fpga_result res = FPGA_NOT_FOUND;
+	int err;
+
+	ASSERT_NOT_NULL(api);
+	ASSERT_NOT_NULL(stats);
+
+	for (a = 0 ; a < OPAE_TRACE_NUM_APIS ; ++a) {
+		if (!strcmp(trace_api_names[a], api))
+			break;
+	}
+
+	if (a == OPAE_TRACE_NUM_APIS)
+		return FPGA_NOT_FOUND;
+
+	sum = trace_hist_alloc();
+	if (!sum) {
+		OPAE_ERR("malloc failed");
+		return FPGA_NO_MEMORY;
+	}
+
+	opae_mutex_lock(err, &trace_plugins_lock);
+	num_plugins = trace_num_plugins;
+
+	for (p = 0 ; p < num_plugins ; ++p) {
+		if (!plugin || !strcmp(trace_plugins[p], plugin))
+			trace_merge(p, a, sum);
+	}
+
+	opae_mutex_unlock(err, &trace_plugins_lock);
+
+	if (sum->count) {
+		trace_summarize(sum, stats);
+		res = FPGA_OK;
+	}
+
+	free(sum);
+	return res;
+}
+
+STATIC json_object *trace_api_to_json(const trace_hist *h)
+{
+	struct fpga_trace_stats stats;
+	json_object *j_api;
+	json_object *j_hist;
+	json_object *j_bucket;
+	uint32_t i;
+
+	trace_summarize(h, &stats);
+
+	j_api = json_object_new_object();
+	json_object_object_add(j_api, "count",
+			       json_object_new_int64(stats.count));
+	json_object_object_add(j_api, "errors",
+			       json_object_new_int64(stats.errors));
+	json_object_object_add(j_api, "min_nsec",
+			       json_object_new_int64(stats.min_nsec));
+	json_object_object_add(j_api, "max_nsec",
+			       json_object_new_int64(stats.max_nsec));
+	json_object_object_add(j_api, "mean_nsec",
+			       json_object_new_int64(stats.mean_nsec));
+	json_object_object_add(j_api, "p50_nsec",
+			       json_object_new_int64(stats.p50_nsec));
+	json_object_object_add(j_api, "p90_nsec",
+			       json_object_new_int64(stats.p90_nsec));
+	json_object_object_add(j_api, "p99_nsec",
+			       json_object_new_int64(stats.p99_nsec));
+	json_object_object_add(j_api, "p999_nsec",
+			       json_object_new_int64(stats.p999_nsec));
+
+	j_hist = json_object_new_array();
+	for (i = 0 ; i < TRACE_BUCKETS ; ++i) {
+		if (!h->buckets[i])
+			continue;
+		j_bucket = json_object_new_array();
+		json_object_array_add(j_bucket,
+			json_object_new_int64(trace_bucket_low(i)));
+		json_object_array_add(j_bucket,
+			json_object_new_int64(h->buckets[i]));
+		json_object_array_add(j_hist, j_bucket);
+	}
+	json_object_object_add(j_api, "histogram", j_hist);
+
+	return j_api;
+}
+
+fpga_result __OPAE_API__ fpgaTraceDump(FILE *fp)
+{
+	json_object *root;
+	json_object *j_plugin;
+	trace_hist *sum;
+	uint32_t p;
+	uint32_t a;
+	int err;
+	fpga_result res = FPGA_OK;
+
+	ASSERT_NOT_NULL(fp);
+
+	sum = malloc(sizeof(trace_hist));
+	root = json_object_new_object();
+	if (!sum || !root) {
+		OPAE_ERR("malloc failed");
+		res = FPGA_NO_MEMORY;
+		goto out_free;
+	}
+
+	opae_mutex_lock(err, &trace_plugins_lock);
+
+	for (p = 0 ; p < trace_num_plugins ; ++p) {
+		j_plugin = json_object_new_object();
+
+		for (a = 0 ; a < OPAE_TRACE_NUM_APIS ; ++a) {
+			memset(sum, 0, sizeof(trace_hist));
+			sum->min_nsec = UINT64_MAX;
+			trace_merge(p, a, sum);
+			if (sum->count)
+				json_object_object_add(j_plugin,
+						       trace_api_names[a],
+						       trace_api_to_json(sum));
+		}
+
+		json_object_object_add(root, trace_plugins[p], j_plugin);
+	}
+
+	opae_mutex_unlock(err, &trace_plugins_lock);
+
+	if (fprintf(fp, "%s\n",
+		    json_object_to_json_string_ext(root,
+					JSON_C_TO_STRING_PRETTY)) < 0) {
+		OPAE_ERR("failed to write trace data");
+		res = FPGA_EXCEPTION;
+	}
+	fflush(fp);
+
+out_free:
+	if (root)
+		json_object_put(root);
+	free(sum);
+	return res;
+}
+
+void opae_trace_init(void)
+{
+	char *s = getenv("LIBOPAE_TRACE");
+
+	if (s && atoi(s))
+		fpgaTraceEnable(true);
+
+	trace_file = getenv("LIBOPAE_TRACE_FILE");
+}
+
+void opae_trace_release(void)
+{
+	FILE *fp;
+
+	if (!trace_file)
+		return;
+
+	fp = fopen(trace_file, "w");
+	if (!fp) {
+		OPAE_ERR("could not open trace file %s: %s",
+			 trace_file, strerror(errno));
+		return;
+	}
+
+	fpgaTraceDump(fp);
+	fclose(fp);
+}
@@ -0,0 +1,159 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __OPAE_API_TRACE_H__
+#define __OPAE_API_TRACE_H__
+
+#include <stdint.h>
+#include <time.h>
+
+#include <opae/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+// Every adapter table entry that the API shell may forward to.
+#define OPAE_TRACE_APIS(X)                \
+	X(fpgaOpen)                       \
+	X(fpgaClose)                      \
+	X(fpgaReset)                      \
+	X(fpgaGetPropertiesFromHandle)    \
+	X(fpgaGetProperties)              \
+	X(fpgaUpdateProperties)           \
+	X(fpgaWriteMMIO64)                \
+	X(fpgaReadMMIO64)                 \
+	X(fpgaWriteMMIO32)                \
+	X(fpgaReadMMIO32)                 \
+	X(fpgaWriteMMIO512)               \
+	X(fpgaWriteMMIOBatch)             \
+	X(fpgaReadMMIOBatch)              \
+	X(fpgaMapMMIO)                    \
+	X(fpgaUnmapMMIO)                  \
+	X(fpgaEnumerate)                  \
+	X(fpgaCloneToken)                 \
+	X(fpgaDestroyToken)               \
+	X(fpgaGetNumUmsg)                 \
+	X(fpgaSetUmsgAttributes)          \
+	X(fpgaTriggerUmsg)                \
+	X(fpgaGetUmsgPtr)                 \
+	X(fpgaPrepareBuffer)              \
+	X(fpgaReleaseBuffer)              \
+	X(fpgaGetIOAddress)               \
+	X(fpgaReadError)                  \
+	X(fpgaClearError)                 \
+	X(fpgaClearAllErrors)             \
+	X(fpgaGetErrorInfo)               \
+	X(fpgaCreateEventHandle)          \
+	X(fpgaDestroyEventHandle)         \
+	X(fpgaGetOSObjectFromEventHandle) \
+	X(fpgaRegisterEvent)              \
+	X(fpgaUnregisterEvent)            \
+	X(fpgaAssignPortToInterface)      \
+	X(fpgaAssignToInterface)          \
+	X(fpgaReleaseFromInterface)       \
+	X(fpgaReconfigureSlot)            \
+	X(fpgaTokenGetObject)             \
+	X(fpgaHandleGetObject)            \
+	X(fpgaObjectGetObject)            \
+	X(fpgaObjectGetObjectAt)          \
+	X(fpgaDestroyObject)              \
+	X(fpgaObjectRead)                 \
+	X(fpgaObjectRead64)               \
+	X(fpgaObjectGetSize)              \
+	X(fpgaObjectGetType)              \
+	X(fpgaObjectWrite64)              \
+	X(fpgaObjectSync)                 \
+	X(fpgaSetUserClock)               \
+	X(fpgaGetUserClock)               \
+	X(fpgaGetNumMetrics)              \
+	X(fpgaGetMetricsInfo)             \
+	X(fpgaGetMetricsByIndex)          \
+	X(fpgaGetMetricsByName)           \
+	X(fpgaGetMetricsThresholdInfo)    \
+	X(fpgaGetMetricsSnapshot)
+
+#define OPAE_TRACE_ENUM(__fn) OPAE_TRACE_##__fn,
+enum opae_trace_api {
+	OPAE_TRACE_APIS(OPAE_TRACE_ENUM)
+	OPAE_TRACE_NUM_APIS
+};
+#undef OPAE_TRACE_ENUM
+
+// Plugins beyond this many share the last slot.
+#define OPAE_TRACE_MAX_PLUGINS 8
+
+extern int opae_trace_on;
+
+static inline int opae_trace_enabled(void)
+{
+	return __atomic_load_n(&opae_trace_on, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t opae_trace_clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void opae_trace_record(uint32_t plugin, enum opae_trace_api api,
+		       uint64_t begin_nsec, fpga_result res);
+
+// Map a plugin path to its slot in the trace tables.
+uint32_t opae_trace_plugin_id(const char *path);
+
+// Honor LIBOPAE_TRACE / LIBOPAE_TRACE_FILE.
+void opae_trace_init(void);
+
+// Write the JSON dump requested by LIBOPAE_TRACE_FILE, if any.
+void opae_trace_release(void);
+
+/*
+ * Forward __fn to the adapter table, timing the call when tracing is
+ * on. With tracing off, this costs one relaxed load and a well
+ * predicted branch.
+ */
+#define OPAE_TRACE_CALL(__adapter, __fn, ...)                             \
+({                                                                        \
+	fpga_result __trace_res;                                          \
+	if (__builtin_expect(opae_trace_enabled(), 0)) {                  \
+		uint64_t __trace_begin = opae_trace_clock();              \
+		__trace_res = (__adapter)->__fn(__VA_ARGS__);             \
+		opae_trace_record((__adapter)->trace_id,                  \
+				  OPAE_TRACE_##__fn,                      \
+				  __trace_begin, __trace_res);            \
+	} else {                                                          \
+		__trace_res = (__adapter)->__fn(__VA_ARGS__);             \
+	}                                                                 \
+	__trace_res;                                                      \
+})
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __OPAE_API_TRACE_H__
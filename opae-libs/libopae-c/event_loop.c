@@ -0,0 +1,452 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <opae/event.h>
+#include "opae_int.h"
+
+//                                  l p v e
+#define OPAE_EVENT_LOOP_MAGIC    0x6c707665
+
+#define EVENT_LOOP_MAX_EVENTS 8
+// epoll data for the loop's own wakeup eventfd
+#define EVENT_LOOP_WAKE_ID 0
+
+typedef struct _event_loop_reg {
+	fpga_event_handle eh;
+	int fd;
+	uint64_t id;
+	fpga_event_callback callback;
+	void *context;
+	bool busy;
+	bool removed;
+	pthread_t owner;
+	struct _event_loop_reg *next;
+} event_loop_reg;
+
+struct _fpga_event_loop {
+	uint32_t magic;
+	int epfd;
+	int wakefd;
+	bool stop;
+	uint32_t num_threads;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t idle;
+	uint64_t next_id;
+	event_loop_reg *regs;
+	struct fpga_event_loop_stats stats;
+};
+
+STATIC struct _fpga_event_loop *event_loop_validate(fpga_event_loop loop)
+{
+	if (!loop || loop->magic != OPAE_EVENT_LOOP_MAGIC)
+		return NULL;
+	return loop;
+}
+
+STATIC event_loop_reg *event_loop_find(struct _fpga_event_loop *loop,
+				       uint64_t id)
+{
+	event_loop_reg *r;
+	for (r = loop->regs ; r ; r = r->next)
+		if (r->id == id)
+			return r;
+	return NULL;
+}
+
+STATIC void event_loop_unlink(struct _fpga_event_loop *loop,
+			      event_loop_reg *reg)
+{
+	event_loop_reg **pp;
+	for (pp = &loop->regs ; *pp ; pp = &(*pp)->next) {
+		if (*pp == reg) {
+			*pp = reg->next;
+			break;
+		}
+	}
+}
+
+STATIC int event_loop_arm(struct _fpga_event_loop *loop,
+			  event_loop_reg *reg, int op)
+{
+	struct epoll_event ev;
+
+	// one-shot so that only one thread handles a given fd at a time
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.u64 = reg->id;
+	return epoll_ctl(loop->epfd, op, reg->fd, &ev);
+}
+
+STATIC void event_loop_dispatch(struct _fpga_event_loop *loop, uint64_t id)
+{
+	event_loop_reg *reg;
+	uint64_t count = 0;
+	int res;
+
+	opae_mutex_lock(res, &loop->lock);
+	reg = event_loop_find(loop, id);
+	if (!reg || reg->removed) {
+		opae_mutex_unlock(res, &loop->lock);
+		return;
+	}
+	reg->busy = true;
+	reg->owner = pthread_self();
+	opae_mutex_unlock(res, &loop->lock);
+
+	// eventfd counters accumulate until read, so count > 1
+	// means interrupts arrived while we weren't looking.
+	if (read(reg->fd, &count, sizeof(count)) != sizeof(count))
+		count = 0;
+
+	if (count) {
+		__atomic_add_fetch(&loop->stats.dispatches, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&loop->stats.interrupts, count,
+				   __ATOMIC_RELAXED);
+		__atomic_add_fetch(&loop->stats.coalesced, count - 1,
+				   __ATOMIC_RELAXED);
+		reg->callback(reg->eh, count, reg->context);
+	}
+
+	opae_mutex_lock(res, &loop->lock);
+	reg->busy = false;
+	if (reg->removed) {
+		event_loop_unlink(loop, reg);
+		free(reg);
+	} else if (event_loop_arm(loop, reg, EPOLL_CTL_MOD)) {
+		OPAE_ERR("failed to re-arm event fd %d: %s",
+			 reg->fd, strerror(errno));
+	}
+	pthread_cond_broadcast(&loop->idle);
+	opae_mutex_unlock(res, &loop->lock);
+}
+
+STATIC void *event_loop_thread(void *arg)
+{
+	struct _fpga_event_loop *loop = (struct _fpga_event_loop *)arg;
+	struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+	uint64_t max;
+	int n;
+	int i;
+
+	while (!__atomic_load_n(&loop->stop, __ATOMIC_ACQUIRE)) {
+		n = epoll_wait(loop->epfd, events, EVENT_LOOP_MAX_EVENTS, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			OPAE_ERR("epoll_wait failed: %s", strerror(errno));
+			break;
+		}
+
+		__atomic_add_fetch(&loop->stats.wakeups, 1, __ATOMIC_RELAXED);
+		max = __atomic_load_n(&loop->stats.max_batch, __ATOMIC_RELAXED);
+		while ((uint64_t)n > max &&
+		       !__atomic_compare_exchange_n(&loop->stats.max_batch,
+						    &max, n, true,
+						    __ATOMIC_RELAXED,
+						    __ATOMIC_RELAXED))
+			;
+
+		for (i = 0 ; i < n ; ++i) {
+			if (events[i].data.u64 == EVENT_LOOP_WAKE_ID)
+				continue;
+			event_loop_dispatch(loop, events[i].data.u64);
+		}
+	}
+
+	return NULL;
+}
+
+STATIC bool event_loop_on_thread(struct _fpga_event_loop *l)
+{
+	pthread_t self = pthread_self();
+	uint32_t i;
+
+	for (i = 0 ; i < l->num_threads ; ++i)
+		if (pthread_equal(l->threads[i], self))
+			return true;
+	return false;
+}
+
+STATIC void event_loop_teardown(struct _fpga_event_loop *l)
+{
+	event_loop_reg *reg;
+	uint64_t one = 1;
+	uint32_t i;
+
+	l->magic = 0;
+
+	__atomic_store_n(&l->stop, true, __ATOMIC_RELEASE);
+	if (write(l->wakefd, &one, sizeof(one)) != sizeof(one))
+		OPAE_ERR("failed to wake event loop: %s", strerror(errno));
+
+	for (i = 0 ; i < l->num_threads ; ++i)
+		pthread_join(l->threads[i], NULL);
+
+	while (l->regs) {
+		reg = l->regs;
+		l->regs = reg->next;
+		free(reg);
+	}
+
+	close(l->wakefd);
+	close(l->epfd);
+	pthread_cond_destroy(&l->idle);
+	pthread_mutex_destroy(&l->lock);
+	free(l->threads);
+	free(l);
+}
+
+fpga_result __OPAE_API__ fpgaCreateEventLoop(uint32_t num_threads,
+					     fpga_event_loop *loop)
+{
+	struct _fpga_event_loop *l;
+	struct epoll_event ev;
+	uint32_t i;
+	int res;
+
+	ASSERT_NOT_NULL(loop);
+
+	if (!num_threads)
+		num_threads = 1;
+
+	l = (struct _fpga_event_loop *)calloc(1, sizeof(*l));
+	if (!l) {
+		OPAE_ERR("out of memory");
+		return FPGA_NO_MEMORY;
+	}
+
+	l->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+	if (!l->threads) {
+		OPAE_ERR("out of memory");
+		free(l);
+		return FPGA_NO_MEMORY;
+	}
+
+	l->magic = OPAE_EVENT_LOOP_MAGIC;
+	l->next_id = EVENT_LOOP_WAKE_ID + 1;
+	pthread_mutex_init(&l->lock, NULL);
+	pthread_cond_init(&l->idle, NULL);
+
+	l->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (l->epfd < 0) {
+		OPAE_ERR("epoll_create1 failed: %s", strerror(errno));
+		goto out_free;
+	}
+
+	l->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (l->wakefd < 0) {
+		OPAE_ERR("eventfd failed: %s", strerror(errno));
+		goto out_close_ep;
+	}
+
+	// level-triggered and never read: once written, wakes every thread
+	ev.events = EPOLLIN;
+	ev.data.u64 = EVENT_LOOP_WAKE_ID;
+	if (epoll_ctl(l->epfd, EPOLL_CTL_ADD, l->wakefd, &ev)) {
+		OPAE_ERR("epoll_ctl failed: %s", strerror(errno));
+		goto out_close_wake;
+	}
+
+	for (i = 0 ; i < num_threads ; ++i) {
+		res = pthread_create(&l->threads[i], NULL, event_loop_thread, l);
+		if (res) {
+			OPAE_ERR("pthread_create failed: %s", strerror(res));
+			l->num_threads = i;
+			event_loop_teardown(l);
+			return FPGA_EXCEPTION;
+		}
+	}
+	l->num_threads = num_threads;
+
+	*loop = l;
+	return FPGA_OK;
+
+out_close_wake:
+	close(l->wakefd);
+out_close_ep:
+	close(l->epfd);
+out_free:
+	pthread_cond_destroy(&l->idle);
+	pthread_mutex_destroy(&l->lock);
+	free(l->threads);
+	free(l);
+	return FPGA_EXCEPTION;
+}
+
+fpga_result __OPAE_API__ fpgaDestroyEventLoop(fpga_event_loop *loop)
+{
+	struct _fpga_event_loop *l;
+
+	ASSERT_NOT_NULL(loop);
+
+	l = event_loop_validate(*loop);
+	ASSERT_NOT_NULL_MSG(l, "invalid event loop");
+
+	// a dispatch thread would end up joining itself
+	if (event_loop_on_thread(l)) {
+		OPAE_ERR("event loop destroyed from its own callback");
+		return FPGA_BUSY;
+	}
+
+	event_loop_teardown(l);
+
+	*loop = NULL;
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaEventLoopAdd(fpga_event_loop loop,
+					  fpga_event_handle eh,
+					  fpga_event_callback callback,
+					  void *context)
+{
+	struct _fpga_event_loop *l = event_loop_validate(loop);
+	event_loop_reg *reg;
+	fpga_result result;
+	int fd = -1;
+	int res;
+
+	ASSERT_NOT_NULL_MSG(l, "invalid event loop");
+	ASSERT_NOT_NULL(eh);
+	ASSERT_NOT_NULL(callback);
+
+	result = fpgaGetOSObjectFromEventHandle(eh, &fd);
+	if (result != FPGA_OK) {
+		OPAE_ERR("event handle has no OS object");
+		return result;
+	}
+
+	reg = (event_loop_reg *)calloc(1, sizeof(*reg));
+	if (!reg) {
+		OPAE_ERR("out of memory");
+		return FPGA_NO_MEMORY;
+	}
+
+	reg->eh = eh;
+	reg->fd = fd;
+	reg->callback = callback;
+	reg->context = context;
+
+	opae_mutex_lock(res, &l->lock);
+
+	for (event_loop_reg *r = l->regs ; r ; r = r->next) {
+		if (r->eh == eh && !r->removed) {
+			opae_mutex_unlock(res, &l->lock);
+			free(reg);
+			OPAE_ERR("event handle already in event loop");
+			return FPGA_BUSY;
+		}
+	}
+
+	reg->id = l->next_id++;
+	if (event_loop_arm(l, reg, EPOLL_CTL_ADD)) {
+		opae_mutex_unlock(res, &l->lock);
+		OPAE_ERR("epoll_ctl failed for fd %d: %s", fd, strerror(errno));
+		free(reg);
+		return FPGA_EXCEPTION;
+	}
+
+	reg->next = l->regs;
+	l->regs = reg;
+
+	opae_mutex_unlock(res, &l->lock);
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaEventLoopRemove(fpga_event_loop loop,
+					     fpga_event_handle eh)
+{
+	struct _fpga_event_loop *l = event_loop_validate(loop);
+	event_loop_reg *reg;
+	uint64_t id;
+	int res;
+
+	ASSERT_NOT_NULL_MSG(l, "invalid event loop");
+
+	opae_mutex_lock(res, &l->lock);
+
+	for (reg = l->regs ; reg ; reg = reg->next)
+		if (reg->eh == eh && !reg->removed)
+			break;
+
+	if (!reg) {
+		opae_mutex_unlock(res, &l->lock);
+		OPAE_ERR("event handle not in event loop");
+		return FPGA_INVALID_PARAM;
+	}
+
+	epoll_ctl(l->epfd, EPOLL_CTL_DEL, reg->fd, NULL);
+
+	if (!reg->busy) {
+		event_loop_unlink(l, reg);
+		free(reg);
+	} else {
+		// the dispatching thread frees it when the callback returns
+		reg->removed = true;
+		if (!pthread_equal(reg->owner, pthread_self())) {
+			id = reg->id;
+			while (event_loop_find(l, id))
+				pthread_cond_wait(&l->idle, &l->lock);
+		}
+	}
+
+	opae_mutex_unlock(res, &l->lock);
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaEventLoopGetStats(fpga_event_loop loop,
+					       struct fpga_event_loop_stats *stats)
+{
+	struct _fpga_event_loop *l = event_loop_validate(loop);
+
+	ASSERT_NOT_NULL_MSG(l, "invalid event loop");
+	ASSERT_NOT_NULL(stats);
+
+	stats->wakeups =
+		__atomic_load_n(&l->stats.wakeups, __ATOMIC_RELAXED);
+	stats->dispatches =
+		__atomic_load_n(&l->stats.dispatches, __ATOMIC_RELAXED);
+	stats->interrupts =
+		__atomic_load_n(&l->stats.interrupts, __ATOMIC_RELAXED);
+	stats->coalesced =
+		__atomic_load_n(&l->stats.coalesced, __ATOMIC_RELAXED);
+	stats->max_batch =
+		__atomic_load_n(&l->stats.max_batch, __ATOMIC_RELAXED);
+
+	return FPGA_OK;
+}
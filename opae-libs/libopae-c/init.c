@@ -33,8 +33,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <linux/limits.h>
 #include <pwd.h>
+#include <semaphore.h>
+#include <time.h>
 #include <unistd.h>
 #ifndef __USE_GNU
 #define __USE_GNU
@@ -45,6 +48,7 @@
 #include <opae/utils.h>
 #include "pluginmgr.h"
 #include "opae_int.h"
+#include "api_trace.h"
 
 /* global loglevel */
 static int g_loglevel = OPAE_DEFAULT_LOGLEVEL;
@@ -65,6 +69,355 @@ STATIC const char _ase_sys_cfg_files[SYS_CFG_PATHS][CFG_PATH_MAX] = {
 	{ "/etc/opae/opae_ase.cfg" },
 };
 
+/*
+ * Asynchronous logging (LIBOPAE_LOG_ASYNC=1)
+ *
+ * Each thread formats its messages into its own single-producer ring.
+ * A background thread drains all rings to the log file. Producers never
+ * block or write to the file: a message that finds its ring full is
+ * dropped and counted, and the count is reported by the next drain.
+ * Runs of identical messages from one thread are cut short after
+ * LIBOPAE_LOG_RATELIMIT copies; the drain thread reports how many were
+ * suppressed. A child process created by fork() has no drain thread,
+ * so it logs synchronously.
+ */
+#define OPAE_LOG_RING_SLOTS 256 /* power of 2 */
+#define OPAE_LOG_MSG_MAX 512
+#define OPAE_LOG_RATELIMIT_DEFAULT 10
+#define OPAE_LOG_DRAIN_IDLE_NSEC 1000000
+
+/*
+ * A ring's suppressed word packs the head index at which the current run
+ * was cut (high 32 bits), the run's log level (4 bits) and the number of
+ * copies suppressed so far (low 28 bits), so that a consumer taking it
+ * with one exchange can place the summary right after the last copy.
+ */
+#define OPAE_LOG_SUPPRESSED(__at, __level, __n) \
+	(((uint64_t)(__at) << 32) | ((uint64_t)((__level) & 0xf) << 28) | (__n))
+#define OPAE_LOG_SUPPRESSED_AT(__s) ((uint32_t)((__s) >> 32))
+#define OPAE_LOG_SUPPRESSED_LEVEL(__s) ((int)(((__s) >> 28) & 0xf))
+#define OPAE_LOG_SUPPRESSED_COUNT(__s) ((uint32_t)((__s) & 0x0fffffff))
+
+typedef struct _opae_log_record {
+	int loglevel;
+	char msg[OPAE_LOG_MSG_MAX];
+} opae_log_record;
+
+typedef struct _opae_log_ring {
+	uint32_t head; /* written by the producer */
+	uint32_t tail; /* written by the consumer */
+	uint32_t owned;
+	uint64_t dropped;
+	/* copies of the last message cut by the rate limit */
+	uint64_t suppressed;
+	/* suppressed as last seen by a consumer */
+	uint64_t suppressed_seen;
+	/* serializes consumers (drain thread, flush and stop) */
+	pthread_mutex_t lock;
+	struct _opae_log_ring *next;
+	opae_log_record slots[OPAE_LOG_RING_SLOTS];
+} opae_log_ring;
+
+STATIC bool g_log_async;
+STATIC uint32_t g_log_ratelimit = OPAE_LOG_RATELIMIT_DEFAULT;
+STATIC opae_log_ring *g_log_rings;
+STATIC bool g_log_drain_stop;
+STATIC bool g_log_drain_running;
+STATIC pthread_t g_log_drain_thread;
+STATIC pthread_once_t g_log_once = PTHREAD_ONCE_INIT;
+STATIC pthread_key_t g_log_ring_key;
+/* posted by producers whose ring is half full */
+STATIC sem_t g_log_drain_sem;
+
+static __thread opae_log_ring *t_log_ring;
+static __thread uint64_t t_log_last_hash;
+static __thread int t_log_last_level;
+static __thread uint32_t t_log_repeats;
+
+STATIC FILE *opae_log_stream(int loglevel)
+{
+	if (loglevel == OPAE_LOG_ERROR)
+		return stderr;
+	return g_logfile == NULL ? stdout : g_logfile;
+}
+
+STATIC void opae_log_print_suppressed(uint64_t suppressed)
+{
+	fprintf(opae_log_stream(OPAE_LOG_SUPPRESSED_LEVEL(suppressed)),
+		"libopae-c: last message repeated %u more times\n",
+		OPAE_LOG_SUPPRESSED_COUNT(suppressed));
+}
+
+// Returns the number of records written. A run that is still being
+// suppressed is summarized once it stops growing, or when forced.
+STATIC uint32_t opae_log_drain_ring(opae_log_ring *r, bool force)
+{
+	// Taken before head: every copy of a suppressed message was
+	// pushed before the count was raised.
+	uint64_t suppressed =
+		__atomic_load_n(&r->suppressed, __ATOMIC_ACQUIRE);
+	uint32_t head;
+	uint32_t tail = r->tail;
+	uint32_t count;
+	uint64_t dropped;
+	opae_log_record *rec;
+
+	if (suppressed && !force && suppressed != r->suppressed_seen) {
+		r->suppressed_seen = suppressed;
+		suppressed = 0;
+	} else if (suppressed) {
+		r->suppressed_seen = 0;
+		if (!__atomic_compare_exchange_n(&r->suppressed, &suppressed,
+						 0, false, __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED))
+			suppressed = 0; // grew or taken by the producer
+	}
+	head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	count = head - tail;
+
+	while (tail != head) {
+		if (suppressed && tail == OPAE_LOG_SUPPRESSED_AT(suppressed)) {
+			opae_log_print_suppressed(suppressed);
+			suppressed = 0;
+			++count;
+		}
+		rec = &r->slots[tail & (OPAE_LOG_RING_SLOTS - 1)];
+		fputs(rec->msg, opae_log_stream(rec->loglevel));
+		++tail;
+	}
+	__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+	if (suppressed) {
+		opae_log_print_suppressed(suppressed);
+		++count;
+	}
+
+	dropped = __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED);
+	if (dropped) {
+		fprintf(stderr, "libopae-c: %" PRIu64 " log messages dropped\n",
+			dropped);
+		++count;
+	}
+
+	return count;
+}
+
+STATIC uint32_t opae_log_drain_all(bool force)
+{
+	opae_log_ring *r;
+	uint32_t count = 0;
+
+	for (r = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE) ; r ; r = r->next) {
+		pthread_mutex_lock(&r->lock);
+		count += opae_log_drain_ring(r, force);
+		pthread_mutex_unlock(&r->lock);
+	}
+	if (count) {
+		fflush(opae_log_stream(OPAE_LOG_MESSAGE));
+		fflush(stderr);
+	}
+
+	return count;
+}
+
+STATIC void *opae_log_drain(void *arg)
+{
+	struct timespec deadline;
+	UNUSED_PARAM(arg);
+
+	while (!__atomic_load_n(&g_log_drain_stop, __ATOMIC_ACQUIRE)) {
+		if (opae_log_drain_all(false))
+			continue;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += OPAE_LOG_DRAIN_IDLE_NSEC;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_nsec -= 1000000000L;
+			++deadline.tv_sec;
+		}
+		sem_timedwait(&g_log_drain_sem, &deadline);
+	}
+	opae_log_drain_all(true);
+	return NULL;
+}
+
+STATIC void opae_log_ring_release(void *ring)
+{
+	// left in the list; the next new thread takes it over
+	__atomic_store_n(&((opae_log_ring *)ring)->owned, 0, __ATOMIC_RELEASE);
+}
+
+// The drain thread does not survive fork(). Log synchronously in the
+// child, discarding records that the parent will write out itself.
+STATIC void opae_log_atfork_child(void)
+{
+	opae_log_ring *r;
+
+	if (!g_log_drain_running)
+		return;
+
+	g_log_async = false;
+	g_log_drain_running = false;
+
+	for (r = g_log_rings ; r ; r = r->next) {
+		pthread_mutex_init(&r->lock, NULL);
+		r->tail = r->head;
+		r->suppressed = 0;
+		r->dropped = 0;
+	}
+	sem_init(&g_log_drain_sem, 0, 0);
+}
+
+STATIC void opae_log_once(void)
+{
+	pthread_key_create(&g_log_ring_key, opae_log_ring_release);
+	sem_init(&g_log_drain_sem, 0, 0);
+	pthread_atfork(NULL, NULL, opae_log_atfork_child);
+}
+
+STATIC void opae_log_start(void)
+{
+	pthread_once(&g_log_once, opae_log_once);
+	__atomic_store_n(&g_log_drain_stop, false, __ATOMIC_RELEASE);
+	if (pthread_create(&g_log_drain_thread, NULL, opae_log_drain, NULL)) {
+		fprintf(stderr, "libopae-c: failed to start log thread, "
+				"logging synchronously\n");
+		return;
+	}
+	__atomic_store_n(&g_log_drain_running, true, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_log_async, true, __ATOMIC_RELEASE);
+}
+
+STATIC opae_log_ring *opae_log_get_ring(void)
+{
+	opae_log_ring *r;
+	uint32_t unowned;
+
+	if (t_log_ring)
+		return t_log_ring;
+
+	for (r = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE) ; r ; r = r->next) {
+		unowned = 0;
+		if (__atomic_compare_exchange_n(&r->owned, &unowned, 1, false,
+						__ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			break;
+	}
+
+	if (!r) {
+		r = (opae_log_ring *)calloc(1, sizeof(*r));
+		if (!r)
+			return NULL;
+		r->owned = 1;
+		pthread_mutex_init(&r->lock, NULL);
+		r->next = __atomic_load_n(&g_log_rings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&g_log_rings, &r->next, r,
+						    true, __ATOMIC_RELEASE,
+						    __ATOMIC_RELAXED))
+			;
+	}
+
+	pthread_setspecific(g_log_ring_key, r);
+	t_log_ring = r;
+	return r;
+}
+
+STATIC void opae_log_push(opae_log_ring *r, int loglevel,
+			  const char *fmt, ...)
+{
+	uint32_t head = r->head;
+	uint32_t used = head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	opae_log_record *rec;
+	va_list argp;
+
+	if (used >= OPAE_LOG_RING_SLOTS) {
+		__atomic_add_fetch(&r->dropped, 1, __ATOMIC_RELAXED);
+		sem_post(&g_log_drain_sem);
+		return;
+	}
+
+	rec = &r->slots[head & (OPAE_LOG_RING_SLOTS - 1)];
+	rec->loglevel = loglevel;
+	va_start(argp, fmt);
+	vsnprintf(rec->msg, sizeof(rec->msg), fmt, argp);
+	va_end(argp);
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+
+	if (used == OPAE_LOG_RING_SLOTS / 2)
+		sem_post(&g_log_drain_sem);
+}
+
+STATIC void opae_vprint_async(int loglevel, const char *fmt, va_list argp)
+{
+	char msg[OPAE_LOG_MSG_MAX];
+	opae_log_ring *r;
+	uint64_t hash = 14695981039346656037ULL;
+	const char *p;
+
+	r = opae_log_get_ring();
+	if (!r) {
+		vfprintf(opae_log_stream(loglevel), fmt, argp);
+		return;
+	}
+
+	vsnprintf(msg, sizeof(msg), fmt, argp);
+
+	for (p = msg ; *p ; ++p)
+		hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+
+	if (g_log_ratelimit && hash == t_log_last_hash &&
+	    loglevel == t_log_last_level) {
+		if (++t_log_repeats >= g_log_ratelimit) {
+			// reported by the next drain of this ring
+			uint64_t old = __atomic_load_n(&r->suppressed,
+						       __ATOMIC_RELAXED);
+			uint64_t new;
+			do {
+				uint32_t n = OPAE_LOG_SUPPRESSED_COUNT(old);
+				if (n < 0x0fffffff)
+					++n;
+				new = OPAE_LOG_SUPPRESSED(r->head, loglevel, n);
+			} while (!__atomic_compare_exchange_n(&r->suppressed,
+							      &old, new, true,
+							      __ATOMIC_RELEASE,
+							      __ATOMIC_RELAXED));
+			return;
+		}
+	} else {
+		// A run cut since the last drain is summarized ahead
+		// of the message that ends it.
+		uint64_t suppressed = __atomic_exchange_n(&r->suppressed, 0,
+							  __ATOMIC_ACQUIRE);
+		if (suppressed)
+			opae_log_push(r, OPAE_LOG_SUPPRESSED_LEVEL(suppressed),
+				      "libopae-c: last message repeated %u more times\n",
+				      OPAE_LOG_SUPPRESSED_COUNT(suppressed));
+		t_log_last_hash = hash;
+		t_log_last_level = loglevel;
+		t_log_repeats = 0;
+	}
+
+	opae_log_push(r, loglevel, "%s", msg);
+}
+
+void opae_log_flush(void)
+{
+	if (__atomic_load_n(&g_log_drain_running, __ATOMIC_ACQUIRE))
+		opae_log_drain_all(true);
+}
+
+STATIC void opae_log_stop(void)
+{
+	if (!__atomic_load_n(&g_log_drain_running, __ATOMIC_ACQUIRE))
+		return;
+	__atomic_store_n(&g_log_async, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_log_drain_stop, true, __ATOMIC_RELEASE);
+	sem_post(&g_log_drain_sem);
+	pthread_join(g_log_drain_thread, NULL);
+	// catch anything pushed while the thread was exiting
+	opae_log_drain_all(true);
+	__atomic_store_n(&g_log_drain_running, false, __ATOMIC_RELEASE);
+}
+
 void opae_print(int loglevel, const char *fmt, ...)
 {
 	FILE *fp;
@@ -74,10 +427,14 @@ void opae_print(int loglevel, const char *fmt, ...)
 	if (loglevel > g_loglevel)
 		return;
 
-	if (loglevel == OPAE_LOG_ERROR)
-		fp = stderr;
-	else
-		fp = g_logfile == NULL ? stdout : g_logfile;
+	if (__atomic_load_n(&g_log_async, __ATOMIC_ACQUIRE)) {
+		va_start(argp, fmt);
+		opae_vprint_async(loglevel, fmt, argp);
+		va_end(argp);
+		return;
+	}
+
+	fp = opae_log_stream(loglevel);
 
 	va_start(argp, fmt);
 	err = pthread_mutex_lock(
@@ -197,6 +554,16 @@ __attribute__((constructor)) STATIC void opae_init(void)
 	if (g_logfile == NULL)
 		g_logfile = stdout;
 
+	s = getenv("LIBOPAE_LOG_RATELIMIT");
+	g_log_ratelimit = s ? (uint32_t)strtoul(s, NULL, 0) :
+			      OPAE_LOG_RATELIMIT_DEFAULT;
+
+	s = getenv("LIBOPAE_LOG_ASYNC");
+	if (s && atoi(s) && !g_log_drain_running)
+		opae_log_start();
+
+	opae_trace_init();
+
 	with_ase = getenv("WITH_ASE");
 	if (with_ase) {
 		cfg_path = find_ase_cfg();
@@ -212,10 +579,16 @@ __attribute__((constructor)) STATIC void opae_init(void)
 
 		free(cfg_path);
 	}
-	// If the environment hasn't requested explicit initialization,
-	// perform the initialization implicitly here.
-	else if (getenv("OPAE_EXPLICIT_INITIALIZE") == NULL)
+	// If the environment has requested explicit initialization,
+	// plugins are loaded by fpgaInitialize() only. OPAE_EAGER_INITIALIZE
+	// loads them here. Otherwise they're loaded by the first call that
+	// needs one.
+	else if (getenv("OPAE_EXPLICIT_INITIALIZE"))
+		opae_plugin_mgr_set_init_mode(OPAE_PLUGIN_MGR_INIT_EXPLICIT);
+	else if (getenv("OPAE_EAGER_INITIALIZE"))
 		fpgaInitialize(NULL);
+	else
+		opae_plugin_mgr_set_init_mode(OPAE_PLUGIN_MGR_INIT_LAZY);
 }
 
 __attribute__((destructor)) STATIC void opae_release(void)
@@ -226,6 +599,9 @@ __attribute__((destructor)) STATIC void opae_release(void)
 	if (res != FPGA_OK)
 		OPAE_ERR("fpgaFinalize: %s", fpgaErrStr(res));
 
+	opae_trace_release();
+	opae_log_stop();
+
 	if (g_logfile != NULL && g_logfile != stdout) {
 		fclose(g_logfile);
 	}
@@ -68,6 +68,19 @@
 
 #define UNUSED_PARAM(x) ((void)x)
 
+/*
+ * Check one fpgaReadMMIOBatch()/fpgaWriteMMIOBatch() op against an MMIO
+ * region of len bytes.
+ */
+static inline bool opae_mmio_op_valid(const fpga_mmio_op *op, uint64_t len)
+{
+	if (op->width != sizeof(uint32_t) && op->width != sizeof(uint64_t))
+		return false;
+	if (op->offset % op->width || len < op->width)
+		return false;
+	return op->offset <= len - op->width;
+}
+
 
 #define opae_mutex_lock(__res, __mtx_ptr)             \
 	({                                                \
@@ -92,6 +105,9 @@
 extern "C" {
 #endif // __cplusplus
 
+/* Write out messages queued by the async logger (LIBOPAE_LOG_ASYNC) */
+void opae_log_flush(void);
+
 #ifndef __OPAE_ADAPTER_H__
 typedef struct _opae_api_adapter_table opae_api_adapter_table;
 #endif // __OPAE_ADAPTER_H__
@@ -44,6 +44,7 @@
 
 #include "pluginmgr.h"
 #include "opae_int.h"
+#include "api_trace.h"
 
 #define OPAE_PLUGIN_CONFIGURE "opae_plugin_configure"
 typedef int (*opae_plugin_configure_t)(opae_api_adapter_table *, const char *);
@@ -52,34 +53,60 @@ typedef struct _platform_data {
 	uint16_t vendor_id;
 	uint16_t device_id;
 	const char *native_plugin;
+	uint32_t plugin_class;
 	uint32_t flags;
 #define OPAE_PLATFORM_DATA_DETECTED 0x00000001
 #define OPAE_PLATFORM_DATA_LOADED   0x00000002
 } platform_data;
 
+#define DFL  OPAE_PLUGIN_CLASS_DFL
+#define VFIO OPAE_PLUGIN_CLASS_VFIO
 static platform_data platform_data_table[] = {
-	{ 0x1c2c, 0x1000, "libxfpga.so", 0 },
-	{ 0x1c2c, 0x1001, "libxfpga.so", 0 },
-	{ 0x8086, 0xbcbd, "libxfpga.so", 0 },
-	{ 0x8086, 0xbcc0, "libxfpga.so", 0 },
-	{ 0x8086, 0xbcc1, "libxfpga.so", 0 },
-	{ 0x8086, 0x09c4, "libxfpga.so", 0 },
-	{ 0x8086, 0x09c5, "libxfpga.so", 0 },
-	{ 0x8086, 0x0b2b, "libxfpga.so", 0 },
-	{ 0x8086, 0x0b2c, "libxfpga.so", 0 },
-	{ 0x8086, 0x0b30, "libxfpga.so", 0 },
-	{ 0x8086, 0x0b31, "libxfpga.so", 0 },
-	{ 0x8086, 0xbcce, "libxfpga.so", 0 },
-	{ 0x8086, 0xbcce, "libopae-v.so", 0 },
-	{ 0x8086, 0xaf00, "libxfpga.so", 0 },
-	{ 0x8086, 0xaf00, "libopae-v.so", 0 },
-	{ 0x8086, 0xaf01, "libopae-v.so", 0 },
-	{      0,      0,          NULL, 0 },
+	{ 0x1c2c, 0x1000, "libxfpga.so",  DFL,  0 },
+	{ 0x1c2c, 0x1001, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0xbcbd, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0xbcc0, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0xbcc1, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0x09c4, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0x09c5, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0x0b2b, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0x0b2c, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0x0b30, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0x0b31, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0xbcce, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0xbcce, "libopae-v.so", VFIO, 0 },
+	{ 0x8086, 0xaf00, "libxfpga.so",  DFL,  0 },
+	{ 0x8086, 0xaf00, "libopae-v.so", VFIO, 0 },
+	{ 0x8086, 0xaf01, "libopae-v.so", VFIO, 0 },
+	{      0,      0,           NULL, 0,    0 },
 };
+#undef DFL
+#undef VFIO
+
+STATIC const struct {
+	const char *name;
+	uint32_t plugin_class;
+} plugin_class_names[] = {
+	{ "dfl",  OPAE_PLUGIN_CLASS_DFL  },
+	{ "vfio", OPAE_PLUGIN_CLASS_VFIO },
+	{ NULL,   0                      },
+};
+
+// Classes allowed by LIBOPAE_PLUGIN_CLASSES.
+STATIC uint32_t opae_plugin_mgr_classes = OPAE_PLUGIN_CLASS_ALL;
 
 static int initialized;
 static int finalizing;
 
+// Set once opae_plugin_mgr_initialize() has run, whatever the outcome,
+// so that on-demand loading is attempted only once per init/finalize.
+static int init_attempted;
+// Set by opae_plugin_mgr_finalize_all(): once the application has
+// finalized, plugins are loaded again only by an explicit initialize.
+static int finalized;
+// Read on every on-demand check; accessed atomically.
+STATIC int opae_plugin_mgr_init_mode = OPAE_PLUGIN_MGR_INIT_LAZY;
+
 STATIC opae_api_adapter_table *adapter_list = (void *)0;
 static pthread_mutex_t adapter_list_lock =
 	PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
@@ -326,6 +353,8 @@ int opae_plugin_mgr_finalize_all(void)
 
 	opae_plugin_mgr_reset_cfg();
 	initialized = 0;
+	__atomic_store_n(&init_attempted, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&finalized, 1, __ATOMIC_RELEASE);
 	finalizing = 0;
 	opae_mutex_unlock(res, &adapter_list_lock);
 
@@ -508,6 +537,7 @@ STATIC int opae_plugin_mgr_register_adapter(opae_api_adapter_table *adapter)
 	opae_api_adapter_table *aptr;
 
 	adapter->next = NULL;
+	adapter->trace_id = opae_trace_plugin_id(adapter->plugin.path);
 
 	if (!adapter_list) {
 		adapter_list = adapter;
@@ -523,14 +553,16 @@ STATIC int opae_plugin_mgr_register_adapter(opae_api_adapter_table *adapter)
 	return 0;
 }
 
-STATIC void opae_plugin_mgr_detect_platform(uint16_t vendor, uint16_t device)
+STATIC void opae_plugin_mgr_detect_platform(uint16_t vendor, uint16_t device,
+					    uint32_t plugin_class)
 {
 	int i;
 
 	for (i = 0 ; platform_data_table[i].native_plugin ; ++i) {
 
 		if (platform_data_table[i].vendor_id == vendor &&
-		    platform_data_table[i].device_id == device) {
+		    platform_data_table[i].device_id == device &&
+		    (platform_data_table[i].plugin_class & plugin_class)) {
 			OPAE_DBG("platform detected: vid=0x%04x did=0x%04x -> %s",
 					vendor, device,
 					platform_data_table[i].native_plugin);
@@ -541,6 +573,74 @@ STATIC void opae_plugin_mgr_detect_platform(uint16_t vendor, uint16_t device)
 	}
 }
 
+// The class of plugin that can drive the device, going by the
+// driver it is bound to.
+STATIC uint32_t opae_plugin_mgr_device_class(const char *device_dir)
+{
+	char link_path[PATH_MAX];
+	char driver[PATH_MAX];
+	char *name;
+	ssize_t len;
+
+	if (snprintf(link_path, sizeof(link_path),
+		     "%s/driver", device_dir) < 0)
+		return OPAE_PLUGIN_CLASS_DFL;
+
+	len = readlink(link_path, driver, sizeof(driver) - 1);
+	if (len < 0)
+		return OPAE_PLUGIN_CLASS_DFL;
+	driver[len] = '\0';
+
+	name = strrchr(driver, '/');
+	name = name ? name + 1 : driver;
+
+	return strcmp(name, "vfio-pci") ? OPAE_PLUGIN_CLASS_DFL :
+					  OPAE_PLUGIN_CLASS_VFIO;
+}
+
+STATIC uint32_t opae_plugin_mgr_plugin_class(const char *plugin)
+{
+	int i;
+
+	for (i = 0 ; platform_data_table[i].native_plugin ; ++i) {
+		if (!strcmp(plugin, platform_data_table[i].native_plugin))
+			return platform_data_table[i].plugin_class;
+	}
+
+	// Plugins we don't know of are always loaded.
+	return OPAE_PLUGIN_CLASS_ALL;
+}
+
+// Parse a comma separated list of class names, eg "vfio" or "dfl,vfio".
+STATIC uint32_t opae_plugin_mgr_parse_classes(const char *list)
+{
+	uint32_t classes = 0;
+	const char *p = list;
+	size_t len;
+	int i;
+
+	while (*p) {
+		len = strcspn(p, ",");
+
+		for (i = 0 ; plugin_class_names[i].name ; ++i) {
+			if (len == strlen(plugin_class_names[i].name) &&
+			    !strncmp(p, plugin_class_names[i].name, len))
+				break;
+		}
+
+		if (plugin_class_names[i].name)
+			classes |= plugin_class_names[i].plugin_class;
+		else
+			OPAE_ERR("unknown plugin class \"%.*s\"", (int)len, p);
+
+		p += len;
+		if (*p)
+			++p;
+	}
+
+	return classes;
+}
+
 STATIC int opae_plugin_mgr_detect_platforms(void)
 {
 	DIR *dir;
@@ -622,8 +722,20 @@ STATIC int opae_plugin_mgr_detect_platforms(void)
 
 		fclose(fp);
 
+		if (snprintf(file_path, sizeof(file_path),
+			     "%s/%s",
+			     base_dir,
+			     dirent->d_name) < 0) {
+			OPAE_ERR("snprintf buffer overflow");
+			++errors;
+			goto out_close;
+		}
+
 		// Detect platform for this (vendor, device).
-		opae_plugin_mgr_detect_platform((uint16_t) vendor, (uint16_t) device);
+		opae_plugin_mgr_detect_platform((uint16_t) vendor,
+			(uint16_t) device,
+			opae_plugin_mgr_device_class(file_path) &
+			opae_plugin_mgr_classes);
 	}
 
 out_close:
@@ -636,6 +748,12 @@ STATIC int opae_plugin_mgr_load_cfg_plugin(plugin_cfg *cfg)
 	int res = 0;
 	opae_api_adapter_table *adapter = NULL;
 
+	if (!(opae_plugin_mgr_plugin_class(cfg->plugin) &
+	      opae_plugin_mgr_classes)) {
+		OPAE_DBG("skipping \"%s\": class not enabled", cfg->name);
+		return 0;
+	}
+
 	if (cfg->enabled && cfg->cfg && cfg->cfg_size) {
 		adapter = opae_plugin_mgr_alloc_adapter(cfg->plugin);
 		if (!adapter) {
@@ -748,13 +866,21 @@ int opae_plugin_mgr_initialize(const char *cfg_file)
 	opae_plugin_mgr_plugin_count = 0;
 	char *found_cfg = NULL;
 	const char *use_cfg = NULL;
+	const char *classes;
 
 	opae_mutex_lock(res, &adapter_list_lock);
 
+	__atomic_store_n(&finalized, 0, __ATOMIC_RELEASE);
+
 	if (initialized) { // prevent multiple init.
 		opae_mutex_unlock(res, &adapter_list_lock);
 		return 0;
 	}
+
+	classes = getenv("LIBOPAE_PLUGIN_CLASSES");
+	opae_plugin_mgr_classes = classes ?
+		opae_plugin_mgr_parse_classes(classes) : OPAE_PLUGIN_CLASS_ALL;
+
 	found_cfg = find_cfg();
 	use_cfg = cfg_file ? cfg_file : found_cfg;
 	if (use_cfg) {
@@ -781,6 +907,37 @@ int opae_plugin_mgr_initialize(const char *cfg_file)
 		initialized = 1;
 
 out_unlock:
+	__atomic_store_n(&init_attempted, 1, __ATOMIC_RELEASE);
+	opae_mutex_unlock(res, &adapter_list_lock);
+
+	return errors;
+}
+
+void opae_plugin_mgr_set_init_mode(int mode)
+{
+	__atomic_store_n(&opae_plugin_mgr_init_mode, mode, __ATOMIC_RELEASE);
+}
+
+int opae_plugin_mgr_initialize_once(void)
+{
+	int res;
+	int errors = -1;
+
+	// Fast path: nothing to do once any initialization has run,
+	// or after the application has finalized.
+	if (__atomic_load_n(&init_attempted, __ATOMIC_ACQUIRE) ||
+	    __atomic_load_n(&finalized, __ATOMIC_ACQUIRE) ||
+	    __atomic_load_n(&opae_plugin_mgr_init_mode, __ATOMIC_ACQUIRE) !=
+		OPAE_PLUGIN_MGR_INIT_LAZY)
+		return -1;
+
+	opae_mutex_lock(res, &adapter_list_lock);
+
+	if (!init_attempted && !finalized) {
+		OPAE_DBG("loading plugins on first use");
+		errors = opae_plugin_mgr_initialize(NULL);
+	}
+
 	opae_mutex_unlock(res, &adapter_list_lock);
 
 	return errors;
@@ -798,6 +955,8 @@ int opae_plugin_mgr_for_each_adapter
 		return OPAE_ENUM_STOP;
 	}
 
+	opae_plugin_mgr_initialize_once();
+
 	opae_mutex_lock(res, &adapter_list_lock);
 
 	for (aptr = adapter_list; aptr; aptr = aptr->next) {
@@ -810,3 +969,101 @@ int opae_plugin_mgr_for_each_adapter
 
 	return cb_res;
 }
+
+int opae_plugin_mgr_adapter_count(void)
+{
+	int res;
+	int count = 0;
+	opae_api_adapter_table *aptr;
+
+	opae_plugin_mgr_initialize_once();
+
+	opae_mutex_lock(res, &adapter_list_lock);
+
+	for (aptr = adapter_list; aptr; aptr = aptr->next)
+		++count;
+
+	opae_mutex_unlock(res, &adapter_list_lock);
+
+	return count;
+}
+
+typedef struct _opae_adapter_job {
+	pthread_t thread;
+	bool started;
+	const opae_api_adapter_table *adapter;
+	uint32_t index;
+	void (*callback)(const opae_api_adapter_table *, uint32_t, void *);
+	void *context;
+} opae_adapter_job;
+
+STATIC void *opae_plugin_mgr_adapter_job(void *arg)
+{
+	opae_adapter_job *job = (opae_adapter_job *)arg;
+
+	job->callback(job->adapter, job->index, job->context);
+
+	return NULL;
+}
+
+int opae_plugin_mgr_parallel_for_each_adapter
+	(void (*callback)(const opae_api_adapter_table *, uint32_t, void *),
+	 void *context, uint32_t max_adapters)
+{
+	int res;
+	uint32_t count = 0;
+	uint32_t i;
+	opae_api_adapter_table *aptr;
+	opae_adapter_job *jobs;
+
+	if (!callback) {
+		OPAE_ERR("NULL callback passed to %s()", __func__);
+		return -1;
+	}
+
+	opae_plugin_mgr_initialize_once();
+
+	opae_mutex_lock(res, &adapter_list_lock);
+
+	for (aptr = adapter_list; aptr && count < max_adapters;
+	     aptr = aptr->next)
+		++count;
+
+	jobs = (opae_adapter_job *)calloc(count ? count : 1, sizeof(*jobs));
+	if (!jobs) {
+		OPAE_ERR("out of memory");
+		opae_mutex_unlock(res, &adapter_list_lock);
+		return -1;
+	}
+
+	for (i = 0, aptr = adapter_list; i < count; ++i, aptr = aptr->next) {
+		jobs[i].adapter = aptr;
+		jobs[i].index = i;
+		jobs[i].callback = callback;
+		jobs[i].context = context;
+	}
+
+	// The calling thread takes the last adapter. If a thread can't
+	// be created, that adapter runs here instead.
+	for (i = 0; i + 1 < count; ++i) {
+		if (!pthread_create(&jobs[i].thread, NULL,
+				    opae_plugin_mgr_adapter_job, &jobs[i]))
+			jobs[i].started = true;
+		else
+			opae_plugin_mgr_adapter_job(&jobs[i]);
+	}
+
+	if (count)
+		opae_plugin_mgr_adapter_job(&jobs[count - 1]);
+
+	for (i = 0; i < count; ++i) {
+		if (jobs[i].started)
+			pthread_join(jobs[i].thread, NULL);
+	}
+
+	opae_mutex_unlock(res, &adapter_list_lock);
+
+	free(jobs);
+
+	return (int)count;
+}
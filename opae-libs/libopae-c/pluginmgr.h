@@ -35,12 +35,44 @@ int opae_plugin_mgr_initialize(const char *cfg_file);
 // non-zero on failure.
 int opae_plugin_mgr_finalize_all(void);
 
+// How plugins get loaded when the application does not call
+// fpgaInitialize() itself.
+#define OPAE_PLUGIN_MGR_INIT_EXPLICIT 0 // only by fpgaInitialize()
+#define OPAE_PLUGIN_MGR_INIT_LAZY     1 // on first use (default)
+void opae_plugin_mgr_set_init_mode(int mode);
+
+// In lazy mode, run opae_plugin_mgr_initialize(NULL) unless it has
+// already run, or opae_plugin_mgr_finalize_all() has run since the last
+// explicit opae_plugin_mgr_initialize(). Safe to call from any thread;
+// cheap after the first call. Returns -1 when nothing was done,
+// otherwise the result of opae_plugin_mgr_initialize().
+int opae_plugin_mgr_initialize_once(void);
+
+// Device classes, named "dfl" and "vfio" in LIBOPAE_PLUGIN_CLASSES.
+// Only plugins of the listed classes are loaded.
+#define OPAE_PLUGIN_CLASS_DFL  0x00000001 // kernel FPGA driver
+#define OPAE_PLUGIN_CLASS_VFIO 0x00000002 // user-space driver on vfio-pci
+#define OPAE_PLUGIN_CLASS_ALL  0xffffffff
+
+// The adapter list walks below first call opae_plugin_mgr_initialize_once().
+
 // iteration stops if callback returns non-zero.
 #define OPAE_ENUM_STOP 1
 #define OPAE_ENUM_CONTINUE 0
 int opae_plugin_mgr_for_each_adapter(
 	int (*callback)(const opae_api_adapter_table *, void *), void *context);
 
+// number of loaded adapters.
+int opae_plugin_mgr_adapter_count(void);
+
+// callback is run concurrently for the first max_adapters adapters,
+// each on its own thread, and is passed the adapter's position in
+// the list. Returns once all callbacks have completed, with the
+// number of adapters visited, or -1 on failure.
+int opae_plugin_mgr_parallel_for_each_adapter(
+	void (*callback)(const opae_api_adapter_table *, uint32_t, void *),
+	void *context, uint32_t max_adapters);
+
 #define PLUGIN_SUPPORTED_DEVICES_MAX 256
 #define PLUGIN_NAME_MAX 64
 typedef struct _plugin_cfg {
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stddef.h>
 
 #include <opae/mem_alloc.h>
 
@@ -52,49 +53,222 @@
 fprintf(stderr, "%s:%u:%s() **ERROR** [%s] : " format, \
 	__SHORT_FILE__, __LINE__, __func__, strerror(errno), ##__VA_ARGS__)
 
+#define MEM_SLAB_LINKS 64
+#define MEM_ALLOC_MAX_ALIGN (1ULL << 30)
+
+struct mem_slab {
+	struct mem_slab *next;
+	struct mem_link links[MEM_SLAB_LINKS];
+};
+
+#define link_of(__t, __member) \
+	((struct mem_link *)((char *)(__t) - offsetof(struct mem_link, __member)))
+
+typedef int (*mem_tree_cmp)(const struct mem_tree *a,
+			    const struct mem_tree *b);
+
+static inline int tree_height(const struct mem_tree *t)
+{
+	return t ? t->height : 0;
+}
+
+static inline void tree_update(struct mem_tree *t)
+{
+	int lh = tree_height(t->left);
+	int rh = tree_height(t->right);
+
+	t->height = 1 + (lh > rh ? lh : rh);
+}
+
+static struct mem_tree *tree_rotate_left(struct mem_tree *t)
+{
+	struct mem_tree *r = t->right;
+
+	t->right = r->left;
+	tree_update(t);
+	r->left = t;
+	tree_update(r);
+	return r;
+}
+
+static struct mem_tree *tree_rotate_right(struct mem_tree *t)
+{
+	struct mem_tree *l = t->left;
+
+	t->left = l->right;
+	tree_update(t);
+	l->right = t;
+	tree_update(l);
+	return l;
+}
+
+STATIC struct mem_tree *mem_tree_balance(struct mem_tree *t)
+{
+	int lh = tree_height(t->left);
+	int rh = tree_height(t->right);
+
+	if (lh > rh + 1) {
+		if (tree_height(t->left->left) < tree_height(t->left->right))
+			t->left = tree_rotate_left(t->left);
+		return tree_rotate_right(t);
+	}
+
+	if (rh > lh + 1) {
+		if (tree_height(t->right->right) < tree_height(t->right->left))
+			t->right = tree_rotate_right(t->right);
+		return tree_rotate_left(t);
+	}
+
+	tree_update(t);
+	return t;
+}
+
+STATIC struct mem_tree *mem_tree_insert(struct mem_tree *root,
+					struct mem_tree *n,
+					mem_tree_cmp cmp)
+{
+	if (!root) {
+		n->left = n->right = NULL;
+		n->height = 1;
+		return n;
+	}
+
+	if (cmp(n, root) < 0)
+		root->left = mem_tree_insert(root->left, n, cmp);
+	else
+		root->right = mem_tree_insert(root->right, n, cmp);
+
+	return mem_tree_balance(root);
+}
+
+static struct mem_tree *tree_remove_min(struct mem_tree *t,
+					struct mem_tree **min)
+{
+	if (!t->left) {
+		*min = t;
+		return t->right;
+	}
+
+	t->left = tree_remove_min(t->left, min);
+	return mem_tree_balance(t);
+}
+
+STATIC struct mem_tree *mem_tree_remove(struct mem_tree *root,
+					struct mem_tree *n,
+					mem_tree_cmp cmp)
+{
+	struct mem_tree *min = NULL;
+	int c;
+
+	if (!root)
+		return NULL;
+
+	c = cmp(n, root);
+	if (c < 0) {
+		root->left = mem_tree_remove(root->left, n, cmp);
+	} else if (c > 0) {
+		root->right = mem_tree_remove(root->right, n, cmp);
+	} else {
+		// root == n
+		if (!n->left)
+			return n->right;
+		if (!n->right)
+			return n->left;
+
+		n->right = tree_remove_min(n->right, &min);
+		min->left = n->left;
+		min->right = n->right;
+		root = min;
+	}
+
+	return mem_tree_balance(root);
+}
+
+static int cmp_address(const struct mem_tree *a, const struct mem_tree *b)
+{
+	uint64_t x = link_of(a, by_address)->address;
+	uint64_t y = link_of(b, by_address)->address;
+
+	return (x > y) - (x < y);
+}
+
+// Free blocks are ordered by size, then by address, so that equal
+// sizes are handed out lowest address first.
+static int cmp_size(const struct mem_tree *a, const struct mem_tree *b)
+{
+	const struct mem_link *x = link_of(a, by_size);
+	const struct mem_link *y = link_of(b, by_size);
+
+	if (x->size != y->size)
+		return (x->size > y->size) - (x->size < y->size);
+	return (x->address > y->address) - (x->address < y->address);
+}
+
+static inline uint32_t size_class(uint64_t size)
+{
+	return size ? 63 - __builtin_clzll(size) : 0;
+}
+
 void mem_alloc_init(struct mem_alloc *m)
 {
-	m->free.address = 0;
-	m->free.size = 0;
+	memset(m, 0, sizeof(*m));
 	m->free.prev = &m->free;
 	m->free.next = &m->free;
-	m->allocated.address = 0;
-	m->allocated.size = 0;
 	m->allocated.prev = &m->allocated;
 	m->allocated.next = &m->allocated;
 }
 
 void mem_alloc_destroy(struct mem_alloc *m)
 {
-	struct mem_link *p;
-	struct mem_link *trash;
+	struct mem_slab *s;
+	struct mem_slab *trash;
 
-	for (p = m->free.next ; p != &m->free ; ) {
-		trash = p;
-		p = p->next;
-		free(trash);
-	}
-
-	for (p = m->allocated.next ; p != &m->allocated ; ) {
-		trash = p;
-		p = p->next;
+	for (s = m->slabs ; s ; ) {
+		trash = s;
+		s = s->next;
 		free(trash);
 	}
 
 	mem_alloc_init(m);
 }
 
-STATIC struct mem_link *mem_link_alloc(uint64_t address, uint64_t size)
+STATIC struct mem_link *mem_link_alloc(struct mem_alloc *m,
+				       uint64_t address,
+				       uint64_t size)
 {
-	struct mem_link *m;
-	m = malloc(sizeof(struct mem_link));
-	if (m) {
-		m->address = address;
-		m->size = size;
-		m->prev = m;
-		m->next = m;
+	struct mem_link *l;
+
+	if (!m->spare) {
+		struct mem_slab *s = malloc(sizeof(struct mem_slab));
+		int i;
+
+		if (!s)
+			return NULL;
+
+		s->next = m->slabs;
+		m->slabs = s;
+
+		for (i = MEM_SLAB_LINKS - 1 ; i >= 0 ; --i) {
+			s->links[i].next = m->spare;
+			m->spare = &s->links[i];
+		}
 	}
-	return m;
+
+	l = m->spare;
+	m->spare = l->next;
+
+	memset(l, 0, sizeof(*l));
+	l->address = address;
+	l->size = size;
+	l->prev = l;
+	l->next = l;
+	return l;
+}
+
+static inline void mem_link_release(struct mem_alloc *m, struct mem_link *l)
+{
+	l->next = m->spare;
+	m->spare = l;
 }
 
 static inline void link_before(struct mem_link *a, struct mem_link *b)
@@ -111,71 +285,155 @@ static inline void link_unlink(struct mem_link *x)
 	x->prev->next = x->next;
 }
 
-STATIC void mem_alloc_coalesce(struct mem_link *head,
+static void size_index_insert(struct mem_alloc *m, struct mem_link *l)
+{
+	uint32_t c = size_class(l->size);
+
+	m->free_by_size[c] = mem_tree_insert(m->free_by_size[c],
+					     &l->by_size, cmp_size);
+	m->class_mask |= 1ULL << c;
+}
+
+// Must be called before l->address or l->size change.
+static void size_index_remove(struct mem_alloc *m, struct mem_link *l)
+{
+	uint32_t c = size_class(l->size);
+
+	m->free_by_size[c] = mem_tree_remove(m->free_by_size[c],
+					     &l->by_size, cmp_size);
+	if (!m->free_by_size[c])
+		m->class_mask &= ~(1ULL << c);
+}
+
+static void free_index_insert(struct mem_alloc *m, struct mem_link *l)
+{
+	m->free_by_address = mem_tree_insert(m->free_by_address,
+					     &l->by_address, cmp_address);
+	size_index_insert(m, l);
+}
+
+static void free_index_remove(struct mem_alloc *m, struct mem_link *l)
+{
+	m->free_by_address = mem_tree_remove(m->free_by_address,
+					     &l->by_address, cmp_address);
+	size_index_remove(m, l);
+}
+
+// The free block with the highest address <= address, or NULL.
+static struct mem_link *free_find_le(struct mem_alloc *m, uint64_t address)
+{
+	struct mem_tree *t = m->free_by_address;
+	struct mem_link *best = NULL;
+
+	while (t) {
+		struct mem_link *l = link_of(t, by_address);
+
+		if (l->address <= address) {
+			best = l;
+			t = t->right;
+		} else {
+			t = t->left;
+		}
+	}
+
+	return best;
+}
+
+// The smallest free block of at least size bytes, or NULL.
+static struct mem_link *free_find_fit(struct mem_alloc *m, uint64_t size)
+{
+	uint32_t c = size_class(size);
+	struct mem_tree *t = m->free_by_size[c];
+	struct mem_link *best = NULL;
+	uint64_t larger;
+
+	while (t) {
+		struct mem_link *l = link_of(t, by_size);
+
+		if (l->size >= size) {
+			best = l;
+			t = t->left;
+		} else {
+			t = t->right;
+		}
+	}
+
+	if (best)
+		return best;
+
+	// Any block of a larger class fits: take the smallest one.
+	larger = (c == MEM_ALLOC_CLASSES - 1) ? 0 :
+		m->class_mask & ~((2ULL << c) - 1);
+	if (!larger)
+		return NULL;
+
+	t = m->free_by_size[__builtin_ctzll(larger)];
+	while (t->left)
+		t = t->left;
+	return link_of(t, by_size);
+}
+
+// l is on the free list but not yet indexed. Merge it with any
+// adjacent free neighbors, then index the result.
+STATIC void mem_alloc_coalesce(struct mem_alloc *m,
 			       struct mem_link *l)
 {
 	struct mem_link *prev = l->prev;
 	struct mem_link *next = l->next;
 
-	if (prev == head && next == head)
-		return;
+	if (prev != &m->free &&
+	    prev->address + prev->size == l->address) {
+		free_index_remove(m, prev);
+		l->address = prev->address;
+		l->size += prev->size;
+		link_unlink(prev);
+		mem_link_release(m, prev);
+	}
 
-	if (prev != head) {
-		if (prev->address + prev->size == l->address) {
-			l->address = prev->address;
-			l->size += prev->size;
-			link_unlink(prev);
-			free(prev);
-		}
+	if (next != &m->free &&
+	    l->address + l->size == next->address) {
+		free_index_remove(m, next);
+		l->size += next->size;
+		link_unlink(next);
+		mem_link_release(m, next);
 	}
 
-	next = l->next;
-	if (next != head) {
-		if (l->address + l->size == next->address) {
-			next->address = l->address;
-			next->size += l->size;
-			link_unlink(l);
-			free(l);
-		}
+	free_index_insert(m, l);
+}
+
+// Place the unlinked node on the free list and coalesce it.
+STATIC int mem_alloc_insert_free(struct mem_alloc *m,
+				 struct mem_link *node)
+{
+	struct mem_link *p = free_find_le(m, node->address);
+
+	if (p && p->address == node->address) {
+		ERR("double free detected 0x%lx\n", node->address);
+		return 2;
 	}
+
+	link_before(node, p ? p->next : m->free.next);
+	mem_alloc_coalesce(m, node);
+
+	return 0;
 }
 
 int mem_alloc_add_free(struct mem_alloc *m, uint64_t address, uint64_t size)
 {
 	struct mem_link *node;
-	struct mem_link *p;
+	int res;
 
-	node = mem_link_alloc(address, size);
+	node = mem_link_alloc(m, address, size);
 	if (!node) {
 		ERR("malloc() failed\n");
 		return 1;
 	}
 
-	for (p = m->free.next ; p != &m->free ; p = p->next) {
-		if (address < p->address) {
-			link_before(node, p);
-			mem_alloc_coalesce(&m->free, node);
-			return 0;
-		} else if (address == p->address) {
-			// double free
-			free(node);
-			ERR("double free detected 0x%lx\n", address);
-			return 2;
-		} else {
-			// address > p->address
-			break;
-		}
-
-	}
+	res = mem_alloc_insert_free(m, node);
+	if (res)
+		mem_link_release(m, node);
 
-	while ((address > p->address) && (p != &m->free)) {
-		p = p->next;
-	}
-
-	link_before(node, p);
-	mem_alloc_coalesce(&m->free, node);
-
-	return 0;
+	return res;
 }
 
 STATIC int mem_alloc_allocate_node(struct mem_alloc *m,
@@ -183,28 +441,66 @@ STATIC int mem_alloc_allocate_node(struct mem_alloc *m,
 				   uint64_t *address,
 				   uint64_t size)
 {
+	// The largest power of two dividing size, eg 2MB for 2MB multiples.
+	uint64_t align = size ? size & -size : 1;
+	uint64_t start;
+	uint64_t head;
+	uint64_t tail;
 	struct mem_link *p;
+	struct mem_link *t = NULL;
+
+	if (align > MEM_ALLOC_MAX_ALIGN)
+		align = MEM_ALLOC_MAX_ALIGN;
 
-	if (node->size == size) {
+	// Prefer a naturally-aligned address when the block has room.
+	start = (node->address + align - 1) & ~(align - 1);
+	if (start < node->address ||
+	    start - node->address > node->size - size)
+		start = node->address;
+
+	head = start - node->address;
+	tail = node->size - size - head;
+
+	if (!head && !tail) {
 		// If we have an exact fit, recycle the node struct.
+		free_index_remove(m, node);
 		link_unlink(node);
 		link_before(node, &m->allocated);
+		m->allocated_by_address =
+			mem_tree_insert(m->allocated_by_address,
+					&node->by_address, cmp_address);
 		*address = node->address;
 		return 0;
 	}
 
-	// node->size > size
-
-	p = mem_link_alloc(node->address, size);
-	if (!p) {
+	p = mem_link_alloc(m, start, size);
+	if (p && head && tail)
+		t = mem_link_alloc(m, start + size, tail);
+	if (!p || (head && tail && !t)) {
 		ERR("malloc() failed\n");
+		if (p)
+			mem_link_release(m, p);
 		return 1;
 	}
 
-	node->address += size;
-	node->size -= size;
+	// node keeps its place in address order, so only its size
+	// class entry needs updating.
+	size_index_remove(m, node);
+	if (head) {
+		node->size = head;
+		if (t)
+			link_before(t, node->next);
+	} else {
+		node->address += size;
+		node->size -= size;
+	}
+	size_index_insert(m, node);
+	if (t)
+		free_index_insert(m, t);
 
 	link_before(p, &m->allocated);
+	m->allocated_by_address = mem_tree_insert(m->allocated_by_address,
+						  &p->by_address, cmp_address);
 	*address = p->address;
 
 	return 0;
@@ -212,13 +508,10 @@ STATIC int mem_alloc_allocate_node(struct mem_alloc *m,
 
 int mem_alloc_get(struct mem_alloc *m, uint64_t *address, uint64_t size)
 {
-	struct mem_link *p;
+	struct mem_link *p = free_find_fit(m, size);
 
-	for (p = m->free.next ; p != &m->free ; p = p->next) {
-		if (size <= p->size) { // First fit.
-			return mem_alloc_allocate_node(m, p, address, size);
-		}
-	}
+	if (p)
+		return mem_alloc_allocate_node(m, p, address, size);
 
 	ERR("no free block of sufficient size found\n");
 	return 1; // Out of memory.
@@ -227,26 +520,33 @@ int mem_alloc_get(struct mem_alloc *m, uint64_t *address, uint64_t size)
 STATIC int mem_alloc_free_node(struct mem_alloc *m,
 			       struct mem_link *node)
 {
-	uint64_t address;
-	uint64_t size;
+	struct mem_link *p = free_find_le(m, node->address);
 
-	address = node->address;
-	size = node->size;
+	// Leave the allocator untouched if the block is already free.
+	if (p && p->address + p->size > node->address) {
+		ERR("double free detected 0x%lx\n", node->address);
+		return 2;
+	}
 
+	m->allocated_by_address = mem_tree_remove(m->allocated_by_address,
+						  &node->by_address,
+						  cmp_address);
 	link_unlink(node);
-	free(node);
 
-	return mem_alloc_add_free(m, address, size);
+	return mem_alloc_insert_free(m, node);
 }
 
 int mem_alloc_put(struct mem_alloc *m, uint64_t address)
 {
-	struct mem_link *p;
+	struct mem_tree *t = m->allocated_by_address;
 
-	for (p = m->allocated.next ; p != &m->allocated ; p = p->next) {
-		if (address == p->address) {
-			return mem_alloc_free_node(m, p);
-		}
+	while (t) {
+		struct mem_link *l = link_of(t, by_address);
+
+		if (address == l->address)
+			return mem_alloc_free_node(m, l);
+
+		t = (address < l->address) ? t->left : t->right;
 	}
 
 	ERR("attempt to free non-allocated 0x%lx\n", address);
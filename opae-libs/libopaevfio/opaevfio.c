@@ -39,6 +39,8 @@
 #include <sys/mman.h>
 #include <regex.h>
 #include <linux/pci_regs.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
 
 #include <opae/vfio.h>
 
@@ -468,13 +470,34 @@ STATIC void opae_vfio_destroy_iova_range(struct opae_vfio_iova_range *r)
 
 STATIC void
 opae_vfio_destroy_buffer(struct opae_vfio *, struct opae_vfio_buffer *);
+STATIC void
+opae_vfio_unmap_buffers(struct opae_vfio *, struct opae_vfio_buffer *, int);
+
+STATIC void opae_vfio_destroy_shared(struct opae_vfio *v);
 
 STATIC void opae_vfio_destroy(struct opae_vfio *v)
 {
+	uint32_t i;
+
+	if (v->cont_owner) {
+		opae_vfio_destroy_shared(v);
+		return;
+	}
+
 	// destroy buffers before we close any FDs
 	opae_vfio_destroy_buffer(v, v->cont_buffers);
 	v->cont_buffers = NULL;
 
+	opae_vfio_unmap_buffers(v, v->cont_user_buffers, 0);
+	v->cont_user_buffers = NULL;
+
+	for (i = 0 ; i < OPAE_VFIO_CACHE_CLASSES ; ++i) {
+		opae_vfio_destroy_buffer(v, v->cache.free_list[i]);
+		v->cache.free_list[i] = NULL;
+		v->cache.class_count[i] = 0;
+	}
+	v->cache.enabled = 0;
+
 	opae_vfio_device_destroy(&v->device);
 	opae_vfio_group_destroy(&v->group);
 	opae_vfio_destroy_iova_range(v->cont_ranges);
@@ -608,7 +631,8 @@ STATIC int opae_vfio_iova_reserve(struct opae_vfio *v,
 STATIC struct opae_vfio_buffer *
 opae_vfio_create_buffer(uint8_t *vaddr,
 			size_t size,
-			uint64_t iova)
+			uint64_t iova,
+			uint64_t page_size)
 {
 	struct opae_vfio_buffer *b;
 	b = malloc(sizeof(*b));
@@ -616,14 +640,22 @@ opae_vfio_create_buffer(uint8_t *vaddr,
 		b->buffer_ptr = vaddr;
 		b->buffer_size = size;
 		b->buffer_iova = iova;
+		b->buffer_requested = size;
+		b->buffer_page_size = page_size;
+		b->buffer_numa_node = -1;
+		b->buffer_flags = 0;
 		b->next = NULL;
 	}
 	return b;
 }
 
+// Undo the DMA mapping of each buffer in the list b, return its IOVA
+// space and free the list. The memory itself is only unmapped when
+// the library allocated it.
 STATIC void
-opae_vfio_destroy_buffer(struct opae_vfio *v,
-			 struct opae_vfio_buffer *b)
+opae_vfio_unmap_buffers(struct opae_vfio *v,
+			struct opae_vfio_buffer *b,
+			int owned)
 {
 	struct vfio_iommu_type1_dma_unmap dma_unmap;
 
@@ -640,7 +672,7 @@ opae_vfio_destroy_buffer(struct opae_vfio *v,
 			ERR("ioctl(%d, VFIO_IOMMU_UNMAP_DMA, &dma_unmap)\n",
 			    v->cont_fd);
 
-		if (munmap(trash->buffer_ptr, trash->buffer_size) < 0)
+		if (owned && munmap(trash->buffer_ptr, trash->buffer_size) < 0)
 			ERR("munmap(%p, %lu) failed\n",
 			    trash->buffer_ptr, trash->buffer_size);
 
@@ -652,6 +684,130 @@ opae_vfio_destroy_buffer(struct opae_vfio *v,
 	}
 }
 
+STATIC void
+opae_vfio_destroy_buffer(struct opae_vfio *v,
+			 struct opae_vfio_buffer *b)
+{
+	opae_vfio_unmap_buffers(v, b, 1);
+}
+
+STATIC uint32_t opae_vfio_cache_class(uint64_t size)
+{
+	uint32_t order;
+
+	if (size <= 4096)
+		return 0;
+
+	order = 64 - __builtin_clzll(size - 1);
+	if (order - 12 >= OPAE_VFIO_CACHE_CLASSES)
+		return OPAE_VFIO_CACHE_CLASSES - 1;
+	return order - 12;
+}
+
+// Whether cached buffer b satisfies the device access, page size and
+// placement of a request made with flags and numa_node.
+STATIC int opae_vfio_cache_match(struct opae_vfio_buffer *b,
+				 uint64_t page_size,
+				 uint32_t flags,
+				 int numa_node)
+{
+	if ((b->buffer_flags ^ flags) & OPAE_VFIO_BUF_READ_ONLY)
+		return 0;
+
+	if ((flags & OPAE_VFIO_BUF_NO_FALLBACK) &&
+	    (b->buffer_page_size < page_size))
+		return 0;
+
+	if (numa_node < 0)
+		return 1;
+
+	if (b->buffer_numa_node != numa_node)
+		return 0;
+
+	return (flags & OPAE_VFIO_BUF_NUMA_PREFERRED) ||
+	       !(b->buffer_flags & OPAE_VFIO_BUF_NUMA_PREFERRED);
+}
+
+// Remove and return a cached buffer of at least size bytes (size
+// already rounded to a multiple of page_size) that suits flags and
+// numa_node. Called with v->lock held.
+STATIC struct opae_vfio_buffer *
+opae_vfio_cache_take(struct opae_vfio *v, uint64_t size,
+		     uint64_t page_size, uint32_t flags, int numa_node)
+{
+	struct opae_vfio_buffer_cache *c = &v->cache;
+	uint32_t cls = opae_vfio_cache_class(size);
+	struct opae_vfio_buffer **link;
+
+	for (link = &c->free_list[cls] ; *link ; link = &(*link)->next) {
+		struct opae_vfio_buffer *b = *link;
+
+		if ((b->buffer_size >= size) &&
+		    opae_vfio_cache_match(b, page_size, flags, numa_node)) {
+			*link = b->next;
+			b->next = NULL;
+			--c->class_count[cls];
+			--c->stats.cached_buffers;
+			c->stats.cached_bytes -= b->buffer_size;
+			return b;
+		}
+	}
+
+	return NULL;
+}
+
+// Place b on its free list, unless that would exceed a high-water mark.
+// Returns non-zero if b was not cached. Called with v->lock held.
+STATIC int opae_vfio_cache_put(struct opae_vfio *v,
+			       struct opae_vfio_buffer *b)
+{
+	struct opae_vfio_buffer_cache *c = &v->cache;
+	uint32_t cls = opae_vfio_cache_class(b->buffer_size);
+
+	if (!c->enabled ||
+	    (c->class_count[cls] >= c->max_per_class) ||
+	    (c->stats.cached_bytes + b->buffer_size > c->max_bytes))
+		return 1;
+
+	b->next = c->free_list[cls];
+	c->free_list[cls] = b;
+	++c->class_count[cls];
+	++c->stats.cached_buffers;
+	c->stats.cached_bytes += b->buffer_size;
+	if (c->stats.cached_bytes > c->stats.peak_cached_bytes)
+		c->stats.peak_cached_bytes = c->stats.cached_bytes;
+
+	return 0;
+}
+
+// Unmap cached buffers, largest class first, until no class holds
+// more than max_per_class buffers and no more than max_bytes are
+// cached. Called with v->lock held.
+STATIC void opae_vfio_cache_shrink(struct opae_vfio *v,
+				   uint32_t max_per_class,
+				   uint64_t max_bytes)
+{
+	struct opae_vfio_buffer_cache *c = &v->cache;
+	uint32_t cls = OPAE_VFIO_CACHE_CLASSES;
+
+	while (cls--) {
+		while (c->free_list[cls] &&
+		       ((c->class_count[cls] > max_per_class) ||
+			(c->stats.cached_bytes > max_bytes))) {
+			struct opae_vfio_buffer *b = c->free_list[cls];
+
+			c->free_list[cls] = b->next;
+			b->next = NULL;
+			--c->class_count[cls];
+			--c->stats.cached_buffers;
+			c->stats.cached_bytes -= b->buffer_size;
+			++c->stats.trimmed;
+
+			opae_vfio_destroy_buffer(v, b);
+		}
+	}
+}
+
 #ifndef MAP_HUGETLB
 #define MAP_HUGETLB 0x40000
 #endif
@@ -672,104 +828,456 @@ opae_vfio_destroy_buffer(struct opae_vfio *v,
 #define FLAGS_1G (FLAGS_4K|MAP_1G_HUGEPAGE|MAP_HUGETLB)
 #endif
 
-int opae_vfio_buffer_allocate(struct opae_vfio *v,
-			      size_t *size,
-			      uint8_t **buf,
-			      uint64_t *iova)
+// Devices opened with opae_vfio_open_shared() keep their DMA state
+// in the container owner.
+static inline struct opae_vfio *opae_vfio_cont(struct opae_vfio *v)
+{
+	return v->cont_owner ? v->cont_owner : v;
+}
+
+#define SIZE_4K (4096UL)
+#define SIZE_2M (2UL * 1024 * 1024)
+#define SIZE_1G (1024UL * 1024 * 1024)
+#define ROUND_UP(N, M) (((N) + (M) - 1) & ~((uint64_t)(M) - 1))
+
+#define OPAE_VFIO_MAX_NUMA_NODES 1024
+#define BITS_PER_ULONG (8 * sizeof(unsigned long))
+
+STATIC int opae_vfio_mbind(uint8_t *vaddr, size_t size,
+			   uint32_t flags, int numa_node)
+{
+	unsigned long mask[OPAE_VFIO_MAX_NUMA_NODES / BITS_PER_ULONG];
+	int mode = (flags & OPAE_VFIO_BUF_NUMA_PREFERRED) ?
+		MPOL_PREFERRED : MPOL_BIND;
+
+	if (numa_node >= OPAE_VFIO_MAX_NUMA_NODES) {
+		ERR("invalid NUMA node %d\n", numa_node);
+		return 1;
+	}
+
+	memset(mask, 0, sizeof(mask));
+	mask[numa_node / BITS_PER_ULONG] |=
+		1UL << (numa_node % BITS_PER_ULONG);
+
+	// The kernel counts maxnode from one.
+	if (syscall(SYS_mbind, vaddr, size, mode, mask,
+		    OPAE_VFIO_MAX_NUMA_NODES + 1, 0)) {
+		ERR("mbind(%p, %lu, %d, node %d)\n",
+		    vaddr, size, mode, numa_node);
+		return 2;
+	}
+
+	return 0;
+}
+
+// The largest page size worth using for size bytes: 1GB pages only
+// when no more than an eighth of the mapping would be padding,
+// otherwise as many 2MB pages as needed.
+STATIC uint64_t opae_vfio_page_size_for(uint64_t size)
+{
+	if (size <= SIZE_4K)
+		return SIZE_4K;
+
+	if ((size >= SIZE_1G) &&
+	    (ROUND_UP(size, SIZE_1G) - size <= size / 8))
+		return SIZE_1G;
+
+	return SIZE_2M;
+}
+
+// Map size bytes (a multiple of page_size) backed by pages of
+// page_size. Base pages larger than one huge page are aligned to
+// 2MB and advised for transparent huge pages.
+STATIC uint8_t *opae_vfio_mmap(size_t size, uint64_t page_size)
+{
+	uint8_t *vaddr;
+	uint8_t *aligned;
+	size_t span;
+
+	if (page_size == SIZE_1G)
+		return mmap(ADDR, size, PROT_READ|PROT_WRITE,
+			    FLAGS_1G, 0, 0);
+
+	if (page_size == SIZE_2M)
+		return mmap(ADDR, size, PROT_READ|PROT_WRITE,
+			    FLAGS_2M, 0, 0);
+
+	if (size < SIZE_2M)
+		return mmap(ADDR, size, PROT_READ|PROT_WRITE,
+			    FLAGS_4K, 0, 0);
+
+	span = size + SIZE_2M;
+	vaddr = mmap(ADDR, span, PROT_READ|PROT_WRITE, FLAGS_4K, 0, 0);
+	if (vaddr == MAP_FAILED)
+		return vaddr;
+
+	aligned = (uint8_t *)ROUND_UP((uint64_t)vaddr, SIZE_2M);
+	if (aligned > vaddr)
+		munmap(vaddr, aligned - vaddr);
+	if (vaddr + span > aligned + size)
+		munmap(aligned + size, vaddr + span - (aligned + size));
+
+#ifdef MADV_HUGEPAGE
+	if (madvise(aligned, size, MADV_HUGEPAGE))
+		ERR("madvise(%p, %lu, MADV_HUGEPAGE)\n", aligned, size);
+#endif
+
+	return aligned;
+}
+
+// Map, place, pin and DMA-map one buffer of size bytes with pages of
+// page_size. Returns NULL on failure. Called with v->lock held.
+STATIC struct opae_vfio_buffer *
+opae_vfio_map_new_buffer(struct opae_vfio *v,
+			 size_t size,
+			 uint64_t page_size,
+			 uint32_t flags,
+			 int numa_node)
 {
-	int res = 0;
 	uint64_t ioaddr = 0;
+	uint64_t iova_size;
 	uint8_t *vaddr;
 	struct vfio_iommu_type1_dma_map dma_map;
 	struct vfio_iommu_type1_dma_unmap dma_unmap;
 	struct opae_vfio_buffer *node;
 
+	size = ROUND_UP(size, page_size);
+
+	vaddr = opae_vfio_mmap(size, page_size);
+	if (vaddr == MAP_FAILED)
+		return NULL;
+
+	// Pages are faulted in by VFIO_IOMMU_MAP_DMA, after the policy
+	// is in place.
+	if ((numa_node >= 0) &&
+	    opae_vfio_mbind(vaddr, size, flags, numa_node))
+		goto out_munmap;
+
+	iova_size = size;
+	if (opae_vfio_iova_reserve(v, &iova_size, &ioaddr))
+		goto out_munmap;
+
+	memset(&dma_map, 0, sizeof(dma_map));
+
+	dma_map.argsz = sizeof(dma_map);
+	dma_map.vaddr = (uint64_t) vaddr;
+	dma_map.size = size;
+	dma_map.iova = ioaddr;
+	dma_map.flags = VFIO_DMA_MAP_FLAG_READ;
+	if (!(flags & OPAE_VFIO_BUF_READ_ONLY))
+		dma_map.flags |= VFIO_DMA_MAP_FLAG_WRITE;
+
+	if (ioctl(v->cont_fd, VFIO_IOMMU_MAP_DMA, &dma_map) < 0) {
+		ERR("ioctl(%d, VFIO_IOMMU_MAP_DMA, &dma_map)\n",
+		    v->cont_fd);
+		goto out_iova_put;
+	}
+
+	node = opae_vfio_create_buffer(vaddr, size, ioaddr, page_size);
+	if (!node) {
+		ERR("malloc failed\n");
+		goto out_unmap_ioctl;
+	}
+
+	node->buffer_flags = flags & OPAE_VFIO_BUF_READ_ONLY;
+	if (numa_node >= 0) {
+		node->buffer_numa_node = numa_node;
+		node->buffer_flags |= flags & OPAE_VFIO_BUF_NUMA_PREFERRED;
+	}
+
+	return node;
+
+out_unmap_ioctl:
+	memset(&dma_unmap, 0, sizeof(dma_unmap));
+	dma_unmap.argsz = sizeof(dma_unmap);
+	dma_unmap.iova = ioaddr;
+	dma_unmap.size = size;
+	ioctl(v->cont_fd, VFIO_IOMMU_UNMAP_DMA, &dma_unmap);
+out_iova_put:
+	mem_alloc_put(&v->iova_alloc, ioaddr);
+out_munmap:
+	munmap(vaddr, size);
+	return NULL;
+}
+
+int opae_vfio_buffer_allocate_ex(struct opae_vfio *v,
+				 size_t *size,
+				 uint8_t **buf,
+				 uint64_t *iova,
+				 uint32_t flags,
+				 int numa_node)
+{
+	size_t requested;
+	uint64_t page_size;
+	uint64_t chosen;
+	struct opae_vfio_buffer *node;
+
 	if (!v || !size) {
 		ERR("NULL param\n");
 		return 1;
 	}
 
+	v = opae_vfio_cont(v);
+
 	if (!*size) {
 		ERR("size must be > 0\n");
 		return 2;
 	}
 
+	if (flags & ~(OPAE_VFIO_BUF_NO_FALLBACK |
+		      OPAE_VFIO_BUF_NUMA_PREFERRED |
+		      OPAE_VFIO_BUF_READ_ONLY)) {
+		ERR("invalid flags 0x%x\n", flags);
+		return 2;
+	}
+
+	requested = *size;
+
 	if (pthread_mutex_lock(&v->lock)) {
 		ERR("pthread_mutex_lock() failed\n");
 		return 3;
 	}
 
-	if (opae_vfio_iova_reserve(v, size, &ioaddr)) {
-		pthread_mutex_unlock(&v->lock);
-		return 4;
+	chosen = page_size = opae_vfio_page_size_for(requested);
+
+	if (v->cache.enabled) {
+		node = opae_vfio_cache_take(v, ROUND_UP(requested, page_size),
+					    page_size, flags, numa_node);
+		if (node) {
+			++v->cache.stats.hits;
+			goto out_track;
+		}
+		++v->cache.stats.misses;
 	}
 
-	if (*size > (2 * 1024 * 1024))
-		vaddr = mmap(ADDR, *size, PROT_READ|PROT_WRITE,
-			     FLAGS_1G, 0, 0);
-	else if (*size > 4096)
-		vaddr = mmap(ADDR, *size, PROT_READ|PROT_WRITE,
-			     FLAGS_2M, 0, 0);
-	else
-		vaddr = mmap(ADDR, *size, PROT_READ|PROT_WRITE,
-			     FLAGS_4K, 0, 0);
+	while (1) {
+		node = opae_vfio_map_new_buffer(v, requested, page_size,
+						flags, numa_node);
+		if (node)
+			break;
 
-	if (vaddr == MAP_FAILED) {
-		ERR("mmap() failed\n");
-		pthread_mutex_unlock(&v->lock);
-		return 5;
+		if ((flags & OPAE_VFIO_BUF_NO_FALLBACK) ||
+		    (page_size == SIZE_4K)) {
+			ERR("could not map %lu bytes\n", requested);
+			if (pthread_mutex_unlock(&v->lock))
+				ERR("pthread_mutex_unlock() failed\n");
+			return 5;
+		}
+
+		page_size = (page_size == SIZE_1G) ? SIZE_2M : SIZE_4K;
+	}
+
+	if (page_size != chosen)
+		++v->cont_fallbacks;
+
+out_track:
+	node->buffer_requested = requested;
+	node->next = v->cont_buffers;
+	v->cont_buffers = node;
+
+	*size = node->buffer_size;
+	if (buf)
+		*buf = node->buffer_ptr;
+	if (iova)
+		*iova = node->buffer_iova;
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
+int opae_vfio_buffer_allocate(struct opae_vfio *v,
+			      size_t *size,
+			      uint8_t **buf,
+			      uint64_t *iova)
+{
+	return opae_vfio_buffer_allocate_ex(v, size, buf, iova, 0, -1);
+}
+
+int opae_vfio_buffer_footprint(struct opae_vfio *v,
+			       struct opae_vfio_buffer_footprint *fp)
+{
+	struct opae_vfio_buffer *b;
+
+	if (!v || !fp) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	memset(fp, 0, sizeof(*fp));
+
+	for (b = v->cont_buffers ; b ; b = b->next) {
+		++fp->buffers;
+		fp->requested_bytes += b->buffer_requested;
+		fp->mapped_bytes += b->buffer_size;
+
+		if (b->buffer_page_size == SIZE_1G)
+			fp->huge_1g_bytes += b->buffer_size;
+		else if (b->buffer_page_size == SIZE_2M)
+			fp->huge_2m_bytes += b->buffer_size;
+		else
+			fp->small_bytes += b->buffer_size;
+	}
+
+	fp->cached_bytes = v->cache.stats.cached_bytes;
+	fp->fallbacks = v->cont_fallbacks;
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
+int opae_vfio_buffer_free(struct opae_vfio *v,
+			  uint8_t *buf)
+{
+	struct opae_vfio_buffer *b;
+	struct opae_vfio_buffer *prev = NULL;
+	int res = 0;
+
+	if (!v) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	for (b = v->cont_buffers ; b ; prev = b, b = b->next) {
+		if (b->buffer_ptr == buf) {
+			if (!prev) { // b == v->cont_buffers
+				v->cont_buffers = b->next;
+			} else {
+				prev->next = b->next;
+			}
+			b->next = NULL;
+			if (opae_vfio_cache_put(v, b)) {
+				if (v->cache.enabled)
+					++v->cache.stats.released;
+				opae_vfio_destroy_buffer(v, b);
+			} else {
+				++v->cache.stats.recycled;
+			}
+			goto out_unlock;
+		}
+	}
+
+	res = 3;
+
+out_unlock:
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return res;
+}
+
+int opae_vfio_buffer_map(struct opae_vfio *v,
+			 uint8_t *buf,
+			 size_t size,
+			 uint32_t flags,
+			 uint64_t *iova)
+{
+	uint64_t page_size;
+	uint64_t ioaddr = 0;
+	uint64_t sz = size;
+	struct vfio_iommu_type1_dma_map dma_map;
+	struct vfio_iommu_type1_dma_unmap dma_unmap;
+	struct opae_vfio_buffer *node;
+	int res = 0;
+
+	if (!v || !buf) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	page_size = sysconf(_SC_PAGE_SIZE);
+	if (((uint64_t)buf & (page_size - 1)) ||
+	    !size || (size & (page_size - 1))) {
+		ERR("buffer must be page-aligned and a non-zero "
+		    "multiple of the page size\n");
+		return 2;
+	}
+
+	if (flags & ~(VFIO_DMA_MAP_FLAG_READ|VFIO_DMA_MAP_FLAG_WRITE)) {
+		ERR("invalid flags 0x%x\n", flags);
+		return 2;
+	}
+
+	if (!flags)
+		flags = VFIO_DMA_MAP_FLAG_READ|VFIO_DMA_MAP_FLAG_WRITE;
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 3;
+	}
+
+	if (opae_vfio_iova_reserve(v, &sz, &ioaddr)) {
+		res = 4;
+		goto out_unlock;
 	}
 
 	memset(&dma_map, 0, sizeof(dma_map));
 
 	dma_map.argsz = sizeof(dma_map);
-	dma_map.vaddr = (uint64_t) vaddr;
-	dma_map.size = *size;
+	dma_map.vaddr = (uint64_t) buf;
+	dma_map.size = sz;
 	dma_map.iova = ioaddr;
-	dma_map.flags = VFIO_DMA_MAP_FLAG_READ|VFIO_DMA_MAP_FLAG_WRITE;
+	dma_map.flags = flags;
 
 	if (ioctl(v->cont_fd, VFIO_IOMMU_MAP_DMA, &dma_map) < 0) {
 		ERR("ioctl(%d, VFIO_IOMMU_MAP_DMA, &dma_map)\n",
 		    v->cont_fd);
 		res = 5;
-		goto out_munmap;
+		goto out_iova_put;
 	}
 
-	node = opae_vfio_create_buffer(vaddr, *size, ioaddr);
+	node = opae_vfio_create_buffer(buf, sz, ioaddr, page_size);
 	if (!node) {
 		ERR("malloc failed\n");
 		res = 6;
 		goto out_unmap_ioctl;
 	}
 
-	node->next = v->cont_buffers;
-	v->cont_buffers = node;
+	node->next = v->cont_user_buffers;
+	v->cont_user_buffers = node;
 
-	if (buf)
-		*buf = vaddr;
 	if (iova)
 		*iova = ioaddr;
 
-	if (pthread_mutex_unlock(&v->lock))
-		ERR("pthread_mutex_unlock() failed\n");
-
-	return 0;
+	goto out_unlock;
 
 out_unmap_ioctl:
 	memset(&dma_unmap, 0, sizeof(dma_unmap));
 	dma_unmap.argsz = sizeof(dma_unmap);
 	dma_unmap.iova = ioaddr;
-	dma_unmap.size = *size;
+	dma_unmap.size = sz;
 	ioctl(v->cont_fd, VFIO_IOMMU_UNMAP_DMA, &dma_unmap);
-out_munmap:
-	munmap(vaddr, *size);
+out_iova_put:
+	mem_alloc_put(&v->iova_alloc, ioaddr);
+out_unlock:
 	if (pthread_mutex_unlock(&v->lock))
 		ERR("pthread_mutex_unlock() failed\n");
+
 	return res;
 }
 
-int opae_vfio_buffer_free(struct opae_vfio *v,
-			  uint8_t *buf)
+int opae_vfio_buffer_unmap(struct opae_vfio *v,
+			   uint8_t *buf,
+			   uint64_t iova)
 {
 	struct opae_vfio_buffer *b;
 	struct opae_vfio_buffer *prev = NULL;
@@ -780,20 +1288,22 @@ int opae_vfio_buffer_free(struct opae_vfio *v,
 		return 1;
 	}
 
+	v = opae_vfio_cont(v);
+
 	if (pthread_mutex_lock(&v->lock)) {
 		ERR("pthread_mutex_lock() failed\n");
 		return 2;
 	}
 
-	for (b = v->cont_buffers ; b ; prev = b, b = b->next) {
-		if (b->buffer_ptr == buf) {
-			if (!prev) { // b == v->cont_buffers
-				v->cont_buffers = b->next;
+	for (b = v->cont_user_buffers ; b ; prev = b, b = b->next) {
+		if (b->buffer_ptr == buf && b->buffer_iova == iova) {
+			if (!prev) { // b == v->cont_user_buffers
+				v->cont_user_buffers = b->next;
 			} else {
 				prev->next = b->next;
 			}
 			b->next = NULL;
-			opae_vfio_destroy_buffer(v, b);
+			opae_vfio_unmap_buffers(v, b, 0);
 			goto out_unlock;
 		}
 	}
@@ -807,6 +1317,102 @@ out_unlock:
 	return res;
 }
 
+int opae_vfio_buffer_cache_enable(struct opae_vfio *v,
+				  uint32_t max_per_class,
+				  uint64_t max_bytes)
+{
+	if (!v) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	v->cache.max_per_class = max_per_class;
+	v->cache.max_bytes = max_bytes;
+	v->cache.enabled = 1;
+	opae_vfio_cache_shrink(v, max_per_class, max_bytes);
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
+int opae_vfio_buffer_cache_disable(struct opae_vfio *v)
+{
+	if (!v) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	v->cache.enabled = 0;
+	opae_vfio_cache_shrink(v, 0, 0);
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
+int opae_vfio_buffer_cache_trim(struct opae_vfio *v,
+				uint64_t max_bytes)
+{
+	if (!v) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	opae_vfio_cache_shrink(v, UINT32_MAX, max_bytes);
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
+int opae_vfio_buffer_cache_stats(struct opae_vfio *v,
+				 struct opae_vfio_buffer_cache_stats *stats)
+{
+	if (!v || !stats) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	v = opae_vfio_cont(v);
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	*stats = v->cache.stats;
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
 int opae_vfio_irq_enable(struct opae_vfio *v,
 			 uint32_t index,
 			 uint32_t subindex,
@@ -1122,6 +1728,177 @@ out_destroy_attr:
 	return res;
 }
 
+// Release a device opened into the container of another. Only the
+// device and group belong to v; the container, IOVA space and DMA
+// buffers belong to v->cont_owner. Called with v->lock held.
+STATIC void opae_vfio_destroy_shared(struct opae_vfio *v)
+{
+	struct opae_vfio *owner = v->cont_owner;
+
+	if (pthread_mutex_lock(&owner->lock))
+		ERR("pthread_mutex_lock() failed\n");
+
+	opae_vfio_device_destroy(&v->device);
+
+	// A device in the owner's own group shares the owner's group fd.
+	if (v->group.group_fd == owner->group.group_fd)
+		v->group.group_fd = -1;
+	opae_vfio_group_destroy(&v->group);
+
+	// The owner's close was deferred until its last member left.
+	if (!--owner->cont_users && owner->cont_close_pending)
+		opae_vfio_destroy(owner);
+	else if (pthread_mutex_unlock(&owner->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	v->cont_owner = NULL;
+
+	mem_alloc_destroy(&v->iova_alloc);
+
+	if (v->cont_device) {
+		free(v->cont_device);
+		v->cont_device = NULL;
+	}
+
+	if (v->cont_pciaddr) {
+		free(v->cont_pciaddr);
+		v->cont_pciaddr = NULL;
+	}
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	if (pthread_mutex_destroy(&v->lock))
+		ERR("pthread_mutex_destroy() failed\n");
+}
+
+// The IOVA ranges reported by the container are those usable by every
+// group attached to it. Before any buffer is mapped, rebuild the IOVA
+// allocator so that it honors a newly-attached group. Called with
+// v->lock held.
+STATIC void opae_vfio_iova_rediscover(struct opae_vfio *v)
+{
+	if (v->cont_buffers || v->cont_user_buffers ||
+	    v->cache.stats.cached_buffers)
+		return;
+
+	mem_alloc_destroy(&v->iova_alloc);
+	mem_alloc_init(&v->iova_alloc);
+
+	opae_vfio_destroy_iova_range(v->cont_ranges);
+	v->cont_ranges = opae_vfio_iova_discover(v);
+}
+
+STATIC int opae_vfio_init_shared(struct opae_vfio *v,
+				 struct opae_vfio *owner,
+				 const char *pciaddr,
+				 const char *token)
+{
+	int res = 0;
+	pthread_mutexattr_t mattr;
+	char *group_device;
+	int cont_fd;
+
+	memset(v, 0, sizeof(*v));
+	v->cont_fd = -1;
+	v->group.group_fd = -1;
+	v->device.device_fd = -1;
+
+	mem_alloc_init(&v->iova_alloc);
+
+	if (pthread_mutexattr_init(&mattr)) {
+		ERR("pthread_mutexattr_init()\n");
+		return 1;
+	}
+
+	if (pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE)) {
+		ERR("pthread_mutexattr_settype()\n");
+		res = 2;
+		goto out_destroy_attr;
+	}
+
+	if (pthread_mutex_init(&v->lock, &mattr)) {
+		ERR("pthread_mutex_init()\n");
+		res = 3;
+		goto out_destroy_attr;
+	}
+
+	if (pthread_mutex_lock(&owner->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		pthread_mutex_destroy(&v->lock);
+		res = 4;
+		goto out_destroy_attr;
+	}
+
+	if (owner->cont_close_pending) {
+		ERR("container owner is closing\n");
+		pthread_mutex_unlock(&owner->lock);
+		pthread_mutex_destroy(&v->lock);
+		res = 5;
+		goto out_destroy_attr;
+	}
+
+	v->cont_owner = owner;
+	++owner->cont_users;
+	v->cont_device = strdup(owner->cont_device);
+	v->cont_pciaddr = strdup(pciaddr);
+
+	group_device = opae_vfio_group_for(pciaddr);
+	if (group_device && owner->group.group_device &&
+	    !strcmp(group_device, owner->group.group_device)) {
+		// A group may only be opened and attached once.
+		v->group.group_device = group_device;
+		v->group.group_fd = owner->group.group_fd;
+	} else {
+		res = opae_vfio_group_init(&v->group, group_device);
+		if (res)
+			goto out_destroy_shared;
+
+		cont_fd = owner->cont_fd;
+		if (ioctl(v->group.group_fd,
+			  VFIO_GROUP_SET_CONTAINER, &cont_fd)) {
+			ERR("ioctl(%d, VFIO_GROUP_SET_CONTAINER, &cont_fd)\n",
+			    v->group.group_fd);
+			close(v->group.group_fd);
+			v->group.group_fd = -1;
+			res = 7;
+			goto out_destroy_shared;
+		}
+	}
+
+	res = opae_vfio_device_init(&v->device,
+				    v->group.group_fd,
+				    pciaddr,
+				    token);
+	if (res)
+		goto out_destroy_shared;
+
+	opae_vfio_iova_rediscover(owner);
+
+	if (pthread_mutex_unlock(&owner->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	if (pthread_mutexattr_destroy(&mattr)) {
+		ERR("pthread_mutexattr_destroy()\n");
+		return 9;
+	}
+
+	return 0;
+
+out_destroy_shared:
+	pthread_mutex_lock(&v->lock);
+	opae_vfio_destroy_shared(v);
+	pthread_mutex_unlock(&owner->lock);
+
+out_destroy_attr:
+	if (pthread_mutexattr_destroy(&mattr)) {
+		ERR("pthread_mutexattr_destroy()\n");
+		res = 10;
+	}
+
+	return res;
+}
+
 int opae_vfio_open(struct opae_vfio *v,
 		   const char *pciaddr)
 {
@@ -1139,19 +1916,12 @@ int opae_vfio_open(struct opae_vfio *v,
 			"[0-9a-fA-F]{4}-" \
 			"[0-9a-fA-F]{12}"
 
-int opae_vfio_secure_open(struct opae_vfio *v,
-			  const char *pciaddr,
-			  const char *token)
+STATIC int opae_vfio_secure_check(const char *token)
 {
 	int reg_res;
 	regex_t re;
 	regmatch_t matches[2];
 
-	if (!v || !pciaddr || !token) {
-		ERR("NULL param\n");
-		return 1;
-	}
-
 	memset(&matches, 0, sizeof(matches));
 	reg_res = regcomp(&re, GUID_RE_PATTERN, REG_EXTENDED);
 
@@ -1170,9 +1940,49 @@ int opae_vfio_secure_open(struct opae_vfio *v,
 	}
 
 	regfree(&re);
+	return 0;
+}
+
+int opae_vfio_secure_open(struct opae_vfio *v,
+			  const char *pciaddr,
+			  const char *token)
+{
+	int res;
+
+	if (!v || !pciaddr || !token) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	res = opae_vfio_secure_check(token);
+	if (res)
+		return res;
+
 	return opae_vfio_init(v, pciaddr, token);
 }
 
+int opae_vfio_open_shared(struct opae_vfio *v,
+			  struct opae_vfio *owner,
+			  const char *pciaddr,
+			  const char *token)
+{
+	if (!v || !owner || !pciaddr) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	if (v == owner) {
+		ERR("device cannot share its own container\n");
+		return 2;
+	}
+
+	if (token && opae_vfio_secure_check(token))
+		return 3;
+
+	return opae_vfio_init_shared(v, opae_vfio_cont(owner),
+				     pciaddr, token);
+}
+
 int opae_vfio_region_get(struct opae_vfio *v,
 			 uint32_t index,
 			 uint8_t **ptr,
@@ -1210,5 +2020,13 @@ void opae_vfio_close(struct opae_vfio *v)
 		return;
 	}
 
+	if (v->cont_users) {
+		// The last device to leave the container completes the close.
+		v->cont_close_pending = 1;
+		if (pthread_mutex_unlock(&v->lock))
+			ERR("pthread_mutex_unlock() failed\n");
+		return;
+	}
+
 	opae_vfio_destroy(v);
 }
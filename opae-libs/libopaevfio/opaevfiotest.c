@@ -29,6 +29,7 @@
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <poll.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <pthread.h>
 #include <opae/vfio.h>
@@ -91,6 +92,7 @@ void allocate_bufs(struct opae_vfio *v)
 	uint64_t iova_4k;
 	uint64_t iova_2m;
 	uint64_t iova_1g;
+	struct opae_vfio_buffer_footprint fp;
 
 	sz_4k = 4096;
 	buf_4k_virt = NULL;
@@ -119,6 +121,13 @@ void allocate_bufs(struct opae_vfio *v)
 		printf("whoops 1G!\n");
 	}
 
+	if (!opae_vfio_buffer_footprint(v, &fp)) {
+		printf("requested: %lu mapped: %lu (1G: %lu 2M: %lu 4K: %lu) "
+		       "fallbacks: %lu\n",
+		       fp.requested_bytes, fp.mapped_bytes, fp.huge_1g_bytes,
+		       fp.huge_2m_bytes, fp.small_bytes, fp.fallbacks);
+	}
+
 	if (opae_vfio_buffer_free(v, buf_2m_virt)) {
 		printf("whoops 2M free!\n");
 	}
@@ -130,6 +139,28 @@ void allocate_bufs(struct opae_vfio *v)
 	}
 }
 
+void map_user_buf(struct opae_vfio *v)
+{
+	size_t sz = 16 * 4096;
+	uint8_t *buf;
+	uint64_t iova = 0;
+
+	buf = mmap(NULL, sz, PROT_READ|PROT_WRITE,
+		   MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		printf("whoops mmap!\n");
+		return;
+	}
+
+	if (opae_vfio_buffer_map(v, buf, sz, 0, &iova)) {
+		printf("whoops map!\n");
+	} else if (opae_vfio_buffer_unmap(v, buf, iova)) {
+		printf("whoops unmap!\n");
+	}
+
+	munmap(buf, sz);
+}
+
 #define CSR_SRC_ADDR      (AFU_OFFSET + 0x0120)
 #define CSR_DST_ADDR      (AFU_OFFSET + 0x0128)
 #define CSR_CTL           (AFU_OFFSET + 0x0138)
@@ -140,7 +171,9 @@ void allocate_bufs(struct opae_vfio *v)
 
 #define DSM_STATUS_TEST_COMPLETE 0x40
 
-void nlb0(struct opae_vfio *v)
+// Run NLB0 on the AFU of dev, with DMA buffers allocated through mem.
+// dev and mem are the same device unless they share a container.
+void nlb0_shared(struct opae_vfio *dev, struct opae_vfio *mem)
 {
 	volatile uint8_t *afu = NULL;
 	volatile uint32_t *p32;
@@ -170,18 +203,18 @@ do {                                                   \
 	uint64_t dst_iova = 0;
 
 
-	if (opae_vfio_region_get(v, 2, (uint8_t **)&afu, NULL))
+	if (opae_vfio_region_get(dev, 2, (uint8_t **)&afu, NULL))
 		printf("whoops afu mmio\n");
 
-	if (opae_vfio_buffer_allocate(v, &size,
+	if (opae_vfio_buffer_allocate(mem, &size,
 				      &afu_dsm_virt, &afu_dsm_iova))
 		printf("whoops alloc afu dsm\n");
 
-	if (opae_vfio_buffer_allocate(v, &size,
+	if (opae_vfio_buffer_allocate(mem, &size,
 				      &src_virt, &src_iova))
 		printf("whoops alloc src buf\n");
 
-	if (opae_vfio_buffer_allocate(v, &size,
+	if (opae_vfio_buffer_allocate(mem, &size,
 				      &dst_virt, &dst_iova))
 		printf("whoops alloc dst buf\n");
 
@@ -211,14 +244,59 @@ do {                                                   \
 	else
 		printf("NLB0 OK\n");
 
-	if (opae_vfio_buffer_free(v, afu_dsm_virt))
+	if (opae_vfio_buffer_free(mem, afu_dsm_virt))
 		printf("whoops free afu dsm\n");
-	if (opae_vfio_buffer_free(v, src_virt))
+	if (opae_vfio_buffer_free(mem, src_virt))
 		printf("whoops free src\n");
-	if (opae_vfio_buffer_free(v, dst_virt))
+	if (opae_vfio_buffer_free(mem, dst_virt))
 		printf("whoops free dst\n");
 }
 
+void nlb0(struct opae_vfio *v)
+{
+	nlb0_shared(v, v);
+}
+
+// Open a second device into the container of v. Run NLB0 on each
+// device against buffers allocated through the other, so that every
+// IOVA is exercised on both. Then close v first: its release must
+// wait for the second device, which keeps using the shared buffers.
+int shared(struct opae_vfio *v, const char *pciaddr)
+{
+	struct opae_vfio w;
+	struct opae_vfio x;
+	size_t sz = 2 * 1024 * 1024;
+	uint8_t *buf = NULL;
+	uint64_t iova = 0;
+
+	if (opae_vfio_open_shared(&w, v, pciaddr, NULL)) {
+		printf("whoops open shared!\n");
+		opae_vfio_close(v);
+		return 1;
+	}
+
+	nlb0_shared(&w, v);
+	nlb0_shared(v, &w);
+
+	opae_vfio_close(v);
+
+	if (!opae_vfio_open_shared(&x, &w, pciaddr, NULL)) {
+		printf("whoops open shared after owner close!\n");
+		opae_vfio_close(&x);
+	}
+
+	if (opae_vfio_buffer_allocate(&w, &sz, &buf, &iova))
+		printf("whoops alloc after owner close!\n");
+	else if (opae_vfio_buffer_free(&w, buf))
+		printf("whoops free after owner close!\n");
+
+	nlb0_shared(&w, &w);
+
+	opae_vfio_close(&w);
+
+	return 0;
+}
+
 void irqinfo(struct opae_vfio *v)
 {
 	struct opae_vfio_device_irq *irq;
@@ -340,8 +418,14 @@ int main(int argc, char *argv[])
 	int res;
 
 	if (argc < 3) {
-		printf("usage: opaevfiotest 0000:00:00.0 <test>\n");
-		printf("\n\twhere <test> is one of { dfh, buf, nlb0, irqinfo, errinj }\n");
+		printf("usage: opaevfiotest 0000:00:00.0 <test> [0000:00:00.0]\n");
+		printf("\n\twhere <test> is one of { dfh, buf, map, nlb0, irqinfo, errinj, shared }\n");
+		printf("\tshared takes the address of a second device\n");
+		return 1;
+	}
+
+	if (!strcmp(argv[2], "shared") && argc < 4) {
+		printf("shared requires a second device\n");
 		return 1;
 	}
 
@@ -350,10 +434,16 @@ int main(int argc, char *argv[])
 		return res;
 	}
 
+	// shared closes v itself, ahead of the second device.
+	if (!strcmp(argv[2], "shared"))
+		return shared(&v, argv[3]);
+
 	if (!strcmp(argv[2], "dfh"))
 		print_dfhs(&v);
 	else if (!strcmp(argv[2], "buf"))
 		allocate_bufs(&v);
+	else if (!strcmp(argv[2], "map"))
+		map_user_buf(&v);
 	else if (!strcmp(argv[2], "nlb0"))
 		nlb0(&v);
 	else if (!strcmp(argv[2], "irqinfo"))
@@ -42,6 +42,7 @@
 #include <sys/stat.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #undef _GNU_SOURCE
 #include <opae/fpga.h>
@@ -51,9 +52,6 @@
 #include "dfl.h"
 
 #define BAR_MAX 6
-#define VFIO_TOKEN_MAGIC 0xEF1010FE
-#define VFIO_HANDLE_MAGIC ~VFIO_TOKEN_MAGIC
-#define VFIO_EVENT_HANDLE_MAGIC 0x5a6446a5
 
 #define FPGA_BBS_VER_MAJOR(i) (((i) >> 56) & 0xf)
 #define FPGA_BBS_VER_MINOR(i) (((i) >> 52) & 0xf)
@@ -78,19 +76,7 @@ const char *fme_drivers[] = {
 	0
 };
 
-typedef struct _vfio_buffer {
-	uint8_t *virtual;
-	uint64_t iova;
-	uint64_t wsid;
-	size_t size;
-	struct opae_vfio *vfio_device;
-	struct _vfio_buffer *next;
-} vfio_buffer;
-
-
-static pci_device_t *_pci_devices;
-static vfio_buffer *_vfio_buffers;
-static pthread_mutex_t _buffers_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+STATIC pci_device_t *_pci_devices;
 
 STATIC int read_pci_link(const char *addr, const char *link, char *value, size_t max)
 {
@@ -205,16 +191,142 @@ void free_device_list(void)
 	}
 }
 
-void free_buffer_list(void)
+STATIC int buffer_table_init(vfio_buffer_table *t)
+{
+	t->buckets = calloc(VFIO_BUFFER_BUCKETS_INIT, sizeof(vfio_buffer *));
+	if (!t->buckets) {
+		OPAE_ERR("Failed to allocate buffer table");
+		return 1;
+	}
+	if (pthread_rwlock_init(&t->lock, NULL)) {
+		OPAE_ERR("Failed to init buffer table lock");
+		free(t->buckets);
+		t->buckets = NULL;
+		return 1;
+	}
+	t->num_buckets = VFIO_BUFFER_BUCKETS_INIT;
+	t->count = 0;
+	t->next_wsid = 0;
+	return 0;
+}
+
+// Gives b back to v; FPGA_BUF_PREALLOCATED memory is only unmapped.
+STATIC int vfio_buffer_release(struct opae_vfio *v, vfio_buffer *b)
+{
+	if (b->flags & FPGA_BUF_PREALLOCATED)
+		return opae_vfio_buffer_unmap(v, b->virtual, b->iova);
+	return opae_vfio_buffer_free(v, b->virtual);
+}
+
+// Frees the table and, when v is given, the DMA buffers still in it.
+// The vfio device outlives the handle when it is shared, so buffers
+// the handle didn't release must be given back here.
+STATIC void buffer_table_destroy(vfio_buffer_table *t, struct opae_vfio *v)
+{
+	uint32_t i;
+
+	if (!t->buckets)
+		return;
+
+	for (i = 0 ; i < t->num_buckets ; ++i) {
+		vfio_buffer *b = t->buckets[i];
+
+		while (b) {
+			vfio_buffer *trash = b;
+
+			b = b->next;
+			if (v && vfio_buffer_release(v, trash))
+				OPAE_ERR("error freeing vfio buffer");
+			free(trash);
+		}
+	}
+
+	free(t->buckets);
+	t->buckets = NULL;
+	t->num_buckets = t->count = 0;
+	pthread_rwlock_destroy(&t->lock);
+}
+
+static inline vfio_buffer **buffer_table_bucket(vfio_buffer_table *t,
+						uint64_t wsid)
+{
+	return &t->buckets[wsid & (t->num_buckets - 1)];
+}
+
+// Called with the table write-locked.
+STATIC void buffer_table_grow(vfio_buffer_table *t)
+{
+	uint32_t num_buckets = t->num_buckets << 1;
+	vfio_buffer **buckets;
+	uint32_t i;
+
+	buckets = calloc(num_buckets, sizeof(vfio_buffer *));
+	if (!buckets) {
+		// Not fatal: the chains just get longer.
+		OPAE_MSG("Failed to grow buffer table");
+		return;
+	}
+
+	for (i = 0 ; i < t->num_buckets ; ++i) {
+		vfio_buffer *b = t->buckets[i];
+
+		while (b) {
+			vfio_buffer *next = b->next;
+			vfio_buffer **head =
+				&buckets[b->wsid & (num_buckets - 1)];
+
+			b->next = *head;
+			*head = b;
+			b = next;
+		}
+	}
+
+	free(t->buckets);
+	t->buckets = buckets;
+	t->num_buckets = num_buckets;
+}
+
+// Called with the table write-locked. Assigns b->wsid.
+STATIC void buffer_table_insert(vfio_buffer_table *t, vfio_buffer *b)
+{
+	vfio_buffer **head;
+
+	if (t->count >= t->num_buckets)
+		buffer_table_grow(t);
+
+	b->wsid = t->next_wsid++;
+	head = buffer_table_bucket(t, b->wsid);
+	b->next = *head;
+	*head = b;
+	++t->count;
+}
+
+// Called with the table locked (read or write).
+STATIC vfio_buffer *buffer_table_find(vfio_buffer_table *t, uint64_t wsid)
 {
-	vfio_buffer *ptr = _vfio_buffers;
-	vfio_buffer *tmp = NULL;
+	vfio_buffer *b = *buffer_table_bucket(t, wsid);
+
+	while (b && b->wsid != wsid)
+		b = b->next;
+	return b;
+}
 
-	while (ptr) {
-		tmp = ptr;
-		ptr = tmp->next;
-		free(tmp);
+// Called with the table write-locked.
+STATIC vfio_buffer *buffer_table_remove(vfio_buffer_table *t, uint64_t wsid)
+{
+	vfio_buffer **link = buffer_table_bucket(t, wsid);
+
+	while (*link) {
+		vfio_buffer *b = *link;
+
+		if (b->wsid == wsid) {
+			*link = b->next;
+			--t->count;
+			return b;
+		}
+		link = &b->next;
 	}
+	return NULL;
 }
 
 
@@ -457,6 +569,253 @@ out_destroy:
 	return NULL;
 }
 
+/*
+ * Opened pairs are cached on their pci_device_t and shared by
+ * enumeration and all handles to the device, so opening a device that
+ * was just enumerated, or opening it shared twice, reuses the container,
+ * group and BAR mappings. A pair no one uses is closed at once, since
+ * an open group keeps other processes from opening the device. When
+ * LIBOPAE_VFIO_IDLE_MSEC is set, such a pair is kept that many
+ * milliseconds before the reaper thread closes it.
+ */
+#define VFIO_PAIR_IDLE_MSEC_DEFAULT 0
+
+STATIC pthread_mutex_t _pair_lock = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t _pair_cond = PTHREAD_COND_INITIALIZER;
+STATIC pthread_t _pair_reaper;
+STATIC bool _pair_reaper_running;
+STATIC bool _pair_reaper_stop;
+STATIC uint64_t _pair_idle_msec = VFIO_PAIR_IDLE_MSEC_DEFAULT;
+
+static uint64_t pair_clock_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+STATIC void *pair_reaper(void *arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&_pair_lock);
+
+	while (!_pair_reaper_stop) {
+		uint64_t now = pair_clock_msec();
+		uint64_t next = UINT64_MAX;
+		pci_device_t *p;
+
+		for (p = _pci_devices ; p ; p = p->next) {
+			vfio_pair_t *pair = p->pair;
+			uint64_t expires;
+
+			if (!pair || pair->refcount)
+				continue;
+
+			expires = pair->idle_since_msec + _pair_idle_msec;
+			if (expires <= now) {
+				p->pair = NULL;
+				close_vfio_pair(&pair);
+			} else if (expires < next) {
+				next = expires;
+			}
+		}
+
+		if (next == UINT64_MAX) {
+			pthread_cond_wait(&_pair_cond, &_pair_lock);
+		} else {
+			struct timespec ts;
+			uint64_t nsec;
+
+			clock_gettime(CLOCK_REALTIME, &ts);
+			nsec = ts.tv_nsec + (next - now) * 1000000;
+			ts.tv_sec += nsec / 1000000000;
+			ts.tv_nsec = nsec % 1000000000;
+			pthread_cond_timedwait(&_pair_cond, &_pair_lock, &ts);
+		}
+	}
+
+	pthread_mutex_unlock(&_pair_lock);
+	return NULL;
+}
+
+void vfio_pair_cache_init(void)
+{
+	const char *s = getenv("LIBOPAE_VFIO_IDLE_MSEC");
+
+	_pair_idle_msec = s ? strtoull(s, NULL, 0) :
+			      VFIO_PAIR_IDLE_MSEC_DEFAULT;
+}
+
+// Close every cached pair. Pairs still held by a handle are detached
+// from their device and closed when the handle lets go.
+void vfio_pair_cache_release(void)
+{
+	pci_device_t *p;
+
+	pthread_mutex_lock(&_pair_lock);
+	_pair_reaper_stop = true;
+	pthread_cond_signal(&_pair_cond);
+	pthread_mutex_unlock(&_pair_lock);
+
+	if (_pair_reaper_running)
+		pthread_join(_pair_reaper, NULL);
+
+	pthread_mutex_lock(&_pair_lock);
+
+	for (p = _pci_devices ; p ; p = p->next) {
+		vfio_pair_t *pair = p->pair;
+
+		if (!pair)
+			continue;
+
+		p->pair = NULL;
+		if (pair->refcount)
+			pair->owner = NULL;
+		else
+			close_vfio_pair(&pair);
+	}
+
+	_pair_reaper_running = false;
+	_pair_reaper_stop = false;
+	pthread_mutex_unlock(&_pair_lock);
+}
+
+// Called with _pair_lock held.
+static vfio_pair_t *get_vfio_pair_locked(pci_device_t *p)
+{
+	vfio_pair_t *pair = p->pair;
+
+	if (!pair) {
+		pair = open_vfio_pair(p->addr);
+		if (pair) {
+			pair->owner = p;
+			p->pair = pair;
+		}
+	}
+
+	if (pair)
+		++pair->refcount;
+
+	return pair;
+}
+
+// Called with _pair_lock held.
+static void put_vfio_pair_locked(vfio_pair_t *ptr)
+{
+	if (--ptr->refcount)
+		return;
+
+	if (ptr->owner && _pair_idle_msec) {
+		ptr->idle_since_msec = pair_clock_msec();
+
+		if (_pair_reaper_running) {
+			pthread_cond_signal(&_pair_cond);
+			return;
+		}
+
+		if (!pthread_create(&_pair_reaper, NULL, pair_reaper, NULL)) {
+			_pair_reaper_running = true;
+			return;
+		}
+
+		OPAE_MSG("failed to start vfio pair reaper");
+	}
+
+	if (ptr->owner)
+		ptr->owner->pair = NULL;
+	close_vfio_pair(&ptr);
+}
+
+STATIC vfio_pair_t *get_vfio_pair(pci_device_t *p)
+{
+	vfio_pair_t *pair;
+
+	if (pthread_mutex_lock(&_pair_lock)) {
+		OPAE_ERR("failed to lock vfio pair cache");
+		return NULL;
+	}
+
+	pair = get_vfio_pair_locked(p);
+
+	pthread_mutex_unlock(&_pair_lock);
+	return pair;
+}
+
+STATIC void put_vfio_pair(vfio_pair_t **pair)
+{
+	vfio_pair_t *ptr = *pair;
+
+	*pair = NULL;
+
+	if (pthread_mutex_lock(&_pair_lock)) {
+		OPAE_ERR("failed to lock vfio pair cache");
+		return;
+	}
+
+	put_vfio_pair_locked(ptr);
+
+	pthread_mutex_unlock(&_pair_lock);
+}
+
+// Take the pair for a new handle. Walks don't count as users here: a
+// handle opened without FPGA_OPEN_SHARED excludes every other handle,
+// and is refused while any other handle is open.
+STATIC fpga_result get_handle_vfio_pair(pci_device_t *p, int flags,
+					vfio_pair_t **pair)
+{
+	fpga_result res = FPGA_OK;
+	vfio_pair_t *ptr;
+	bool shared = (flags & FPGA_OPEN_SHARED) != 0;
+
+	*pair = NULL;
+
+	if (pthread_mutex_lock(&_pair_lock)) {
+		OPAE_ERR("failed to lock vfio pair cache");
+		return FPGA_EXCEPTION;
+	}
+
+	ptr = p->pair;
+	if (ptr && ptr->handles && (ptr->exclusive || !shared)) {
+		OPAE_MSG("device %s is already open", p->addr);
+		res = FPGA_BUSY;
+		goto out_unlock;
+	}
+
+	ptr = get_vfio_pair_locked(p);
+	if (!ptr) {
+		res = FPGA_EXCEPTION;
+		goto out_unlock;
+	}
+
+	++ptr->handles;
+	ptr->exclusive = !shared;
+	*pair = ptr;
+
+out_unlock:
+	pthread_mutex_unlock(&_pair_lock);
+	return res;
+}
+
+STATIC void put_handle_vfio_pair(vfio_pair_t **pair)
+{
+	vfio_pair_t *ptr = *pair;
+
+	*pair = NULL;
+
+	if (pthread_mutex_lock(&_pair_lock)) {
+		OPAE_ERR("failed to lock vfio pair cache");
+		return;
+	}
+
+	if (!--ptr->handles)
+		ptr->exclusive = false;
+	put_vfio_pair_locked(ptr);
+
+	pthread_mutex_unlock(&_pair_lock);
+}
+
 static fpga_result vfio_reset(const pci_device_t *p, volatile uint8_t *port_base)
 {
 	ASSERT_NOT_NULL(p);
@@ -471,7 +830,7 @@ int vfio_walk(pci_device_t *p)
 
 	volatile uint8_t *mmio;
 	size_t size;
-	vfio_pair_t *pair = open_vfio_pair(p->addr);
+	vfio_pair_t *pair = get_vfio_pair(p);
 
 	if (!pair) {
 		OPAE_ERR("error opening vfio device: %s", p->addr);
@@ -538,7 +897,7 @@ int vfio_walk(pci_device_t *p)
 	}
 
 close:
-	close_vfio_pair(&pair);
+	put_vfio_pair(&pair);
 	return res;
 }
 
@@ -548,6 +907,7 @@ fpga_result vfio_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 	vfio_token *_token;
 	vfio_handle *_handle;
 	pthread_mutexattr_t mattr;
+	bool lock_init = false;
 
 	ASSERT_NOT_NULL(token);
 	ASSERT_NOT_NULL(handle);
@@ -559,12 +919,6 @@ fpga_result vfio_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 		return FPGA_EXCEPTION;
 	}
 
-	if (flags & FPGA_OPEN_SHARED) {
-		OPAE_MSG("shared mode ignored at this time");
-		//return FPGA_INVALID_PARAM;
-	}
-
-
 	_handle = malloc(sizeof(vfio_handle));
 	if (_handle == NULL) {
 		ERR("Failed to allocate memory for handle");
@@ -581,13 +935,26 @@ fpga_result vfio_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 		res = FPGA_EXCEPTION;
 		goto out_attr_destroy;
 	}
+	lock_init = true;
+
+	if (buffer_table_init(&_handle->buffers)) {
+		res = FPGA_NO_MEMORY;
+		goto out_attr_destroy;
+	}
 
 	_handle->magic = VFIO_HANDLE_MAGIC;
 	_handle->token = clone_token(_token);
-	_handle->vfio_pair = open_vfio_pair(_token->device->addr);
-	if (!_handle->vfio_pair) {
-		OPAE_ERR("error opening vfio device");
-		res = FPGA_EXCEPTION;
+	if (!_handle->token) {
+		OPAE_ERR("Failed to clone token");
+		res = FPGA_NO_MEMORY;
+		goto out_attr_destroy;
+	}
+
+	res = get_handle_vfio_pair(_token->device, flags,
+				   &_handle->vfio_pair);
+	if (res) {
+		if (res != FPGA_BUSY)
+			OPAE_ERR("error opening vfio device");
 		goto out_attr_destroy;
 	}
 	uint8_t *mmio = NULL;
@@ -609,6 +976,8 @@ fpga_result vfio_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 		_handle->flags |= OPAE_FLAG_HAS_AVX512;
 	}
 #endif
+	if (flags & FPGA_OPEN_UNLOCKED_MMIO)
+		_handle->flags |= OPAE_FLAG_UNLOCKED_MMIO;
 
 	*handle = _handle;
 	res = FPGA_OK;
@@ -616,8 +985,13 @@ out_attr_destroy:
 	pthread_mutexattr_destroy(&mattr);
 	if (res && _handle) {
 		if (_handle->vfio_pair) {
-			close_vfio_pair(&_handle->vfio_pair);
+			put_handle_vfio_pair(&_handle->vfio_pair);
 		}
+		buffer_table_destroy(&_handle->buffers, NULL);
+		if (_handle->token)
+			free(_handle->token);
+		if (lock_init && pthread_mutex_destroy(&_handle->lock))
+			OPAE_MSG("Failed to destroy handle mutex");
 		free(_handle);
 	}
 	return res;
@@ -635,7 +1009,8 @@ fpga_result vfio_fpgaClose(fpga_handle handle)
 	else
 		OPAE_MSG("invalid token in handle");
 
-	close_vfio_pair(&h->vfio_pair);
+	buffer_table_destroy(&h->buffers, h->vfio_pair->device);
+	put_handle_vfio_pair(&h->vfio_pair);
 	if (pthread_mutex_unlock(&h->lock) ||
 	    pthread_mutex_destroy(&h->lock)) {
 		OPAE_MSG("error unlocking/destroying handle mutex");
@@ -790,29 +1165,62 @@ static inline volatile uint8_t *get_user_offset(vfio_handle *h,
 	return h->mmio_base + user_mmio + offset;
 }
 
-
-fpga_result vfio_fpgaWriteMMIO64(fpga_handle handle,
-				 uint32_t mmio_num,
-				 uint64_t offset,
-				 uint64_t value)
+/*
+ * Validate the handle and mmio_num for an MMIO access, then take the
+ * handle lock unless the handle was opened with FPGA_OPEN_UNLOCKED_MMIO.
+ * A single aligned 32/64-bit volatile access is atomic with respect to
+ * other CPUs, so the lock buys nothing for those handles.
+ */
+static inline vfio_handle *mmio_check_and_lock(fpga_handle handle,
+					       uint32_t mmio_num,
+					       fpga_result *res)
 {
 	vfio_handle *h = handle_check(handle);
 
-	ASSERT_NOT_NULL(h);
+	if (!h) {
+		*res = FPGA_INVALID_PARAM;
+		return NULL;
+	}
 
 	vfio_token *t = h->token;
 
-	if (t->type == FPGA_DEVICE)
-		return FPGA_NOT_SUPPORTED;
-	if (mmio_num > t->user_mmio_count)
-		return FPGA_INVALID_PARAM;
-	if (pthread_mutex_lock(&h->lock)) {
+	if (t->type == FPGA_DEVICE) {
+		*res = FPGA_NOT_SUPPORTED;
+		return NULL;
+	}
+	if (mmio_num >= t->user_mmio_count) {
+		*res = FPGA_INVALID_PARAM;
+		return NULL;
+	}
+	if (!(h->flags & OPAE_FLAG_UNLOCKED_MMIO) &&
+	    pthread_mutex_lock(&h->lock)) {
 		OPAE_MSG("error locking handle mutex");
-		return FPGA_EXCEPTION;
+		*res = FPGA_EXCEPTION;
+		return NULL;
 	}
+	*res = FPGA_OK;
+	return h;
+}
+
+static inline void mmio_unlock(vfio_handle *h)
+{
+	if (!(h->flags & OPAE_FLAG_UNLOCKED_MMIO))
+		pthread_mutex_unlock(&h->lock);
+}
+
+fpga_result vfio_fpgaWriteMMIO64(fpga_handle handle,
+				 uint32_t mmio_num,
+				 uint64_t offset,
+				 uint64_t value)
+{
+	fpga_result res;
+	vfio_handle *h = mmio_check_and_lock(handle, mmio_num, &res);
+
+	if (!h)
+		return res;
 
 	*((volatile uint64_t *)get_user_offset(h, mmio_num, offset)) = value;
-	pthread_mutex_unlock(&h->lock);
+	mmio_unlock(h);
 	return FPGA_OK;
 }
 
@@ -821,23 +1229,14 @@ fpga_result vfio_fpgaReadMMIO64(fpga_handle handle,
 				uint64_t offset,
 				uint64_t *value)
 {
-	vfio_handle *h = handle_check(handle);
-
-	ASSERT_NOT_NULL(h);
-
-	vfio_token *t = h->token;
+	fpga_result res;
+	vfio_handle *h = mmio_check_and_lock(handle, mmio_num, &res);
 
-	if (t->type == FPGA_DEVICE)
-		return FPGA_NOT_SUPPORTED;
-	if (mmio_num > t->user_mmio_count)
-		return FPGA_INVALID_PARAM;
-	if (pthread_mutex_lock(&h->lock)) {
-		OPAE_MSG("error locking handle mutex");
-		return FPGA_EXCEPTION;
-	}
+	if (!h)
+		return res;
 
 	*value = *((volatile uint64_t *)get_user_offset(h, mmio_num, offset));
-	pthread_mutex_unlock(&h->lock);
+	mmio_unlock(h);
 	return FPGA_OK;
 }
 
@@ -846,23 +1245,14 @@ fpga_result vfio_fpgaWriteMMIO32(fpga_handle handle,
 				 uint64_t offset,
 				 uint32_t value)
 {
-	vfio_handle *h = handle_check(handle);
-
-	ASSERT_NOT_NULL(h);
-
-	vfio_token *t = h->token;
+	fpga_result res;
+	vfio_handle *h = mmio_check_and_lock(handle, mmio_num, &res);
 
-	if (t->type == FPGA_DEVICE)
-		return FPGA_NOT_SUPPORTED;
-	if (mmio_num > t->user_mmio_count)
-		return FPGA_INVALID_PARAM;
-	if (pthread_mutex_lock(&h->lock)) {
-		OPAE_MSG("error locking handle mutex");
-		return FPGA_EXCEPTION;
-	}
+	if (!h)
+		return res;
 
 	*((volatile uint32_t *)get_user_offset(h, mmio_num, offset)) = value;
-	pthread_mutex_unlock(&h->lock);
+	mmio_unlock(h);
 	return FPGA_OK;
 }
 
@@ -871,25 +1261,101 @@ fpga_result vfio_fpgaReadMMIO32(fpga_handle handle,
 				uint64_t offset,
 				uint32_t *value)
 {
-	vfio_handle *h = handle_check(handle);
+	fpga_result res;
+	vfio_handle *h = mmio_check_and_lock(handle, mmio_num, &res);
 
-	ASSERT_NOT_NULL(h);
+	if (!h)
+		return res;
 
-	vfio_token *t = h->token;
+	*value = *((volatile uint32_t *)get_user_offset(h, mmio_num, offset));
+	mmio_unlock(h);
+	return FPGA_OK;
+}
 
-	if (t->type == FPGA_DEVICE)
-		return FPGA_NOT_SUPPORTED;
-	if (mmio_num > t->user_mmio_count)
-		return FPGA_INVALID_PARAM;
-	if (pthread_mutex_lock(&h->lock)) {
-		OPAE_MSG("error locking handle mutex");
-		return FPGA_EXCEPTION;
+STATIC fpga_result mmio_ops_check(vfio_handle *h, uint32_t mmio_num,
+				  const fpga_mmio_op *ops, uint32_t num_ops)
+{
+	uint64_t user_mmio = h->token->user_mmio[mmio_num];
+	uint64_t len = h->mmio_size > user_mmio ? h->mmio_size - user_mmio : 0;
+	uint32_t i;
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		if (!opae_mmio_op_valid(&ops[i], len)) {
+			OPAE_MSG("invalid MMIO op %u", i);
+			return FPGA_INVALID_PARAM;
+		}
 	}
+	return FPGA_OK;
+}
 
-	*value = *((volatile uint32_t *)get_user_offset(h, mmio_num, offset));
-	pthread_mutex_unlock(&h->lock);
+fpga_result vfio_fpgaWriteMMIOBatch(fpga_handle handle,
+				    uint32_t mmio_num,
+				    const fpga_mmio_op *ops,
+				    uint32_t num_ops)
+{
+	fpga_result res;
+	volatile uint8_t *base;
+	uint32_t i;
 
-	return FPGA_OK;
+	ASSERT_NOT_NULL(ops);
+
+	vfio_handle *h = mmio_check_and_lock(handle, mmio_num, &res);
+
+	if (!h)
+		return res;
+
+	res = mmio_ops_check(h, mmio_num, ops, num_ops);
+	if (res)
+		goto out_unlock;
+
+	base = get_user_offset(h, mmio_num, 0);
+	for (i = 0 ; i < num_ops ; ++i) {
+		if (ops[i].width == sizeof(uint32_t))
+			*((volatile uint32_t *)(base + ops[i].offset)) =
+				(uint32_t)ops[i].value;
+		else
+			*((volatile uint64_t *)(base + ops[i].offset)) =
+				ops[i].value;
+	}
+
+out_unlock:
+	mmio_unlock(h);
+	return res;
+}
+
+fpga_result vfio_fpgaReadMMIOBatch(fpga_handle handle,
+				   uint32_t mmio_num,
+				   fpga_mmio_op *ops,
+				   uint32_t num_ops)
+{
+	fpga_result res;
+	volatile uint8_t *base;
+	uint32_t i;
+
+	ASSERT_NOT_NULL(ops);
+
+	vfio_handle *h = mmio_check_and_lock(handle, mmio_num, &res);
+
+	if (!h)
+		return res;
+
+	res = mmio_ops_check(h, mmio_num, ops, num_ops);
+	if (res)
+		goto out_unlock;
+
+	base = get_user_offset(h, mmio_num, 0);
+	for (i = 0 ; i < num_ops ; ++i) {
+		if (ops[i].width == sizeof(uint32_t))
+			ops[i].value =
+				*((volatile uint32_t *)(base + ops[i].offset));
+		else
+			ops[i].value =
+				*((volatile uint64_t *)(base + ops[i].offset));
+	}
+
+out_unlock:
+	mmio_unlock(h);
+	return res;
 }
 
 static inline void copy512(const void *src, void *dst)
@@ -1190,69 +1656,111 @@ fpga_result vfio_fpgaDestroyToken(fpga_token *token)
 	return FPGA_INVALID_PARAM;
 }
 
-#define HUGE_1G (1*1024*1024*1024)
-#define HUGE_2M (2*1024*1024)
-#define ROUND_UP(N, M) ((N + M) & ~(M-1))
-
 fpga_result vfio_fpgaPrepareBuffer(fpga_handle handle, uint64_t len,
 				   void **buf_addr, uint64_t *wsid,
 				   int flags)
 {
-	ASSERT_NOT_NULL(buf_addr);
 	ASSERT_NOT_NULL(wsid);
 	vfio_handle *h = handle_check(handle);
 
 	ASSERT_NOT_NULL(h);
 
-	(void)flags;
 	fpga_result res = FPGA_EXCEPTION;
 
 	struct opae_vfio *v = h->vfio_pair->device;
+	bool preallocated = (flags & FPGA_BUF_PREALLOCATED);
+	bool quiet = (flags & FPGA_BUF_QUIET);
 	uint8_t *virt = NULL;
 	uint64_t iova = 0;
-	size_t sz = len > HUGE_2M ? ROUND_UP(len, HUGE_1G) :
-		    len > 4096 ? ROUND_UP(len, HUGE_2M) : 4096;
-	if (opae_vfio_buffer_allocate(v, &sz, &virt, &iova)) {
-		OPAE_ERR("could not allocate buffer");
-		return FPGA_EXCEPTION;
+	size_t sz;
+
+	if (flags & (~(FPGA_BUF_PREALLOCATED | FPGA_BUF_QUIET |
+		       FPGA_BUF_READ_ONLY))) {
+		OPAE_MSG("Unrecognized flags");
+		return FPGA_INVALID_PARAM;
 	}
+
+	if (preallocated) {
+		uint64_t pg_size = (uint64_t)sysconf(_SC_PAGE_SIZE);
+
+		/* A special case: respond FPGA_OK when !buf_addr and !len
+		 * as an indication that FPGA_BUF_PREALLOCATED is supported
+		 * by the library. */
+		if (!buf_addr && !len)
+			return FPGA_OK;
+
+		if (!buf_addr || !*buf_addr) {
+			OPAE_MSG("Preallocated buffer address is NULL");
+			return FPGA_INVALID_PARAM;
+		}
+
+		if (!len || (len & (pg_size - 1)) ||
+		    ((uint64_t)*buf_addr & (pg_size - 1))) {
+			OPAE_MSG("Preallocated buffer must be page-aligned "
+				 "and a non-zero multiple of page size");
+			return FPGA_INVALID_PARAM;
+		}
+
+		virt = (uint8_t *)*buf_addr;
+		sz = len;
+		if (opae_vfio_buffer_map(v, virt, sz,
+				(flags & FPGA_BUF_READ_ONLY) ?
+					VFIO_DMA_MAP_FLAG_READ : 0,
+				&iova)) {
+			if (!quiet)
+				OPAE_ERR("could not map buffer");
+			return FPGA_INVALID_PARAM;
+		}
+	} else {
+		ASSERT_NOT_NULL(buf_addr);
+
+		// Prefer memory local to the device, but take any node
+		// rather than fail.
+		sz = len ? len : 4096;
+		if (opae_vfio_buffer_allocate_ex(v, &sz, &virt, &iova,
+				OPAE_VFIO_BUF_NUMA_PREFERRED |
+				((flags & FPGA_BUF_READ_ONLY) ?
+					OPAE_VFIO_BUF_READ_ONLY : 0),
+				(int)h->token->device->numa_node)) {
+			if (!quiet)
+				OPAE_ERR("could not allocate buffer");
+			return FPGA_EXCEPTION;
+		}
+		OPAE_DBG("buffer of %lu bytes pinned %lu bytes", len, sz);
+	}
+
 	vfio_buffer *buffer = (vfio_buffer *)malloc(sizeof(vfio_buffer));
 
 	if (!buffer) {
 		OPAE_ERR("error allocating buffer metadata");
-		if (opae_vfio_buffer_free(v, virt)) {
-			OPAE_ERR("error freeing vfio buffer");
-		}
 		res = FPGA_NO_MEMORY;
 		goto out_free;
 	}
 	memset(buffer, 0, sizeof(vfio_buffer));
-	buffer->vfio_device = v;
 	buffer->virtual = virt;
 	buffer->iova = iova;
 	buffer->size = sz;
-	if (pthread_mutex_lock(&_buffers_mutex)) {
-		OPAE_MSG("error locking buffer mutex");
+	buffer->flags = flags;
+	if (pthread_rwlock_wrlock(&h->buffers.lock)) {
+		OPAE_MSG("error locking buffer table");
 		res = FPGA_EXCEPTION;
 		goto out_free;
 	}
-	buffer->next = _vfio_buffers;
-	buffer->wsid = buffer->next ? buffer->next->wsid+1 : 0;
-	_vfio_buffers = buffer;
+	buffer_table_insert(&h->buffers, buffer);
 	*buf_addr = virt;
 	*wsid = buffer->wsid;
 	res = FPGA_OK;
-	if (pthread_mutex_unlock(&_buffers_mutex)) {
-		OPAE_MSG("error unlocking buffers");
-		res = FPGA_EXCEPTION;
+	if (pthread_rwlock_unlock(&h->buffers.lock)) {
+		OPAE_MSG("error unlocking buffer table");
 	}
 out_free:
 	if (res) {
-		if (buffer) {
-			free(buffer);
-			if (virt && opae_vfio_buffer_free(v, virt)) {
-				OPAE_ERR("error freeing vfio buffer");
-			}
+		free(buffer);
+		if (preallocated) {
+			if (opae_vfio_buffer_unmap(v, virt, iova))
+				OPAE_ERR("error unmapping vfio buffer");
+		} else if (opae_vfio_buffer_free(v, virt)) {
+			OPAE_ERR("error freeing vfio buffer");
 		}
 	}
 	return res;
@@ -1265,62 +1773,49 @@ fpga_result vfio_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 	ASSERT_NOT_NULL(h);
 
 	struct opae_vfio *v = h->vfio_pair->device;
+	vfio_buffer *buffer;
 
-	vfio_buffer *ptr = _vfio_buffers;
-	vfio_buffer *prev = NULL;
-
-	if (pthread_mutex_lock(&_buffers_mutex)) {
-		OPAE_MSG("error locking buffer mutex");
+	if (pthread_rwlock_wrlock(&h->buffers.lock)) {
+		OPAE_MSG("error locking buffer table");
 		return FPGA_EXCEPTION;
 	}
-	fpga_result res = FPGA_NOT_FOUND;
-
-	while (ptr) {
-		if (ptr->wsid == wsid) {
-			if (opae_vfio_buffer_free(v, ptr->virtual)) {
-				OPAE_ERR("error freeing vfio buffer");
-			}
-			if (prev) {
-				prev->next = ptr->next;
-			} else {
-				_vfio_buffers = ptr->next;
-			}
-			free(ptr);
-			res = FPGA_OK;
-			goto out_unlock;
-		}
-		prev = ptr;
-		ptr = ptr->next;
+	buffer = buffer_table_remove(&h->buffers, wsid);
+	if (pthread_rwlock_unlock(&h->buffers.lock)) {
+		OPAE_MSG("error unlocking buffer table");
 	}
-out_unlock:
-	if (pthread_mutex_unlock(&_buffers_mutex)) {
-		OPAE_MSG("error unlocking buffers mutex");
+
+	if (!buffer)
+		return FPGA_NOT_FOUND;
+
+	if (vfio_buffer_release(v, buffer)) {
+		OPAE_ERR("error freeing vfio buffer");
 	}
-	return res;
+	free(buffer);
+	return FPGA_OK;
 }
 
 fpga_result vfio_fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
 				  uint64_t *ioaddr)
 {
-	(void)handle;
-	if (pthread_mutex_lock(&_buffers_mutex)) {
-		OPAE_MSG("error locking buffer mutex");
+	ASSERT_NOT_NULL(ioaddr);
+	vfio_handle *h = handle_check(handle);
+
+	ASSERT_NOT_NULL(h);
+
+	fpga_result res = FPGA_NOT_FOUND;
+	vfio_buffer *buffer;
+
+	if (pthread_rwlock_rdlock(&h->buffers.lock)) {
+		OPAE_MSG("error locking buffer table");
 		return FPGA_EXCEPTION;
 	}
-	vfio_buffer *ptr = _vfio_buffers;
-	fpga_result res = FPGA_OK;
-
-	while (ptr) {
-		if (ptr->wsid == wsid) {
-			*ioaddr = ptr->iova;
-			goto out_unlock;
-		}
-		ptr = ptr->next;
+	buffer = buffer_table_find(&h->buffers, wsid);
+	if (buffer) {
+		*ioaddr = buffer->iova;
+		res = FPGA_OK;
 	}
-	res = FPGA_NOT_FOUND;
-out_unlock:
-	if (pthread_mutex_unlock(&_buffers_mutex)) {
-		OPAE_MSG("error unlocking buffers mutex");
+	if (pthread_rwlock_unlock(&h->buffers.lock)) {
+		OPAE_MSG("error unlocking buffer table");
 	}
 	return res;
 }
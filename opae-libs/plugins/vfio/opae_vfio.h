@@ -58,6 +58,10 @@
 
 #define GUIDSTR_MAX 36
 
+#define VFIO_TOKEN_MAGIC 0xEF1010FE
+#define VFIO_HANDLE_MAGIC ~VFIO_TOKEN_MAGIC
+#define VFIO_EVENT_HANDLE_MAGIC 0x5a6446a5
+
 #ifdef __GNUC__
 #define GCC_VERSION \
     (__GNUC__*10000 + __GNUC_MINOR__*100 + __GNUC_PATCHLEVEL__)
@@ -75,6 +79,7 @@ typedef union _bdf {
 	uint32_t bdf;
 } bdf_t;
 struct _vfio_token;
+struct _vfio_pair;
 
 #define PCIADDR_MAX 16
 typedef struct _pci_device {
@@ -84,6 +89,7 @@ typedef struct _pci_device {
 	uint32_t device;
 	uint32_t numa_node;
 	struct _vfio_token *tokens;
+	struct _vfio_pair *pair; // cached, see get_vfio_pair()
 	struct _pci_device *next;
 } pci_device_t;
 
@@ -117,8 +123,37 @@ typedef struct _vfio_pair {
 	fpga_guid secret;
 	struct opae_vfio *device;
 	struct opae_vfio *physfn;
+	pci_device_t *owner; // NULL once the device list is freed
+	uint32_t refcount; // handles and walks using the pair
+	uint32_t handles; // open handles, a subset of refcount
+	bool exclusive; // a handle was opened without FPGA_OPEN_SHARED
+	uint64_t idle_since_msec;
 } vfio_pair_t;
 
+typedef struct _vfio_buffer {
+	uint8_t *virtual;
+	uint64_t iova;
+	uint64_t wsid;
+	size_t size;
+	int flags;
+	struct _vfio_buffer *next;
+} vfio_buffer;
+
+/*
+ * Per-handle DMA buffer index, keyed by wsid. wsids are handed out
+ * from a counter that only ever increases, so a wsid is never reused
+ * for the lifetime of the handle, and consecutive wsids land in
+ * consecutive buckets. Readers (fpgaGetIOAddress) share the lock.
+ */
+#define VFIO_BUFFER_BUCKETS_INIT 64
+typedef struct _vfio_buffer_table {
+	pthread_rwlock_t lock;
+	vfio_buffer **buckets;
+	uint32_t num_buckets;
+	uint32_t count;
+	uint64_t next_wsid;
+} vfio_buffer_table;
+
 typedef struct _vfio_handle {
 	uint32_t magic;
 	struct _vfio_token *token;
@@ -128,7 +163,9 @@ typedef struct _vfio_handle {
 	size_t mmio_size;
 	pthread_mutex_t lock;
 #define OPAE_FLAG_HAS_AVX512 (1u << 0)
+#define OPAE_FLAG_UNLOCKED_MMIO (1u << 1)
 	uint32_t flags;
+	vfio_buffer_table buffers;
 } vfio_handle;
 
 typedef struct _vfio_event_handle {
@@ -142,7 +179,9 @@ int pci_discover(void);
 int features_discover(void);
 pci_device_t *get_pci_device(char addr[PCIADDR_MAX]);
 void free_device_list(void);
-void free_buffer_list(void);
+void vfio_pair_cache_init(void);
+void vfio_pair_cache_release(void);
 vfio_token *get_token(pci_device_t *p, uint32_t region, int type);
+vfio_handle *handle_check(fpga_handle handle);
 fpga_result get_guid(uint64_t *h, fpga_guid guid);
 #endif
@@ -41,7 +41,11 @@
 
 int __VFIO_API__ vfio_plugin_initialize(void)
 {
-	int res = pci_discover();
+	int res;
+
+	vfio_pair_cache_init();
+
+	res = pci_discover();
 
 	if (res) {
 		OPAE_ERR("error with pci_discover\n");
@@ -51,7 +55,7 @@ int __VFIO_API__ vfio_plugin_initialize(void)
 
 int __VFIO_API__ vfio_plugin_finalize(void)
 {
-	free_buffer_list();
+	vfio_pair_cache_release();
 	free_device_list();
 	return 0;
 }
@@ -82,6 +86,10 @@ int __VFIO_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaReadMMIO32");
 	adapter->fpgaWriteMMIO512 =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaWriteMMIO512");
+	adapter->fpgaWriteMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaWriteMMIOBatch");
+	adapter->fpgaReadMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaReadMMIOBatch");
 	adapter->fpgaMapMMIO =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaMapMMIO");
 	adapter->fpgaUnmapMMIO =
@@ -64,6 +64,7 @@ fpga_result __XFPGA_API__ xfpga_fpgaClose(fpga_handle handle)
 		return FPGA_INVALID_PARAM;
 	}
 
+	memset(_handle->mmio_cache, 0, sizeof(_handle->mmio_cache));
 	wsid_tracker_cleanup(_handle->wsid_root, NULL);
 	wsid_tracker_cleanup(_handle->mmio_root, unmap_mmio_region);
 	free_umsg_buffer(handle);
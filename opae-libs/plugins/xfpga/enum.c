@@ -36,12 +36,14 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "xfpga.h"
 #include "common_int.h"
 #include "error_int.h"
 #include "props.h"
 #include "opae_drv.h"
+#include "enum_cache.h"
 
 
 struct dev_list {
@@ -67,8 +69,16 @@ struct dev_list {
 	struct dev_list *next;
 	struct dev_list *parent;
 	struct dev_list *fme;
+
+	// Set once the node is synced; cloned into enumeration results.
+	struct _fpga_token *token;
 };
 
+// Synced device list, reused until enum_cache_generation() moves on.
+static pthread_mutex_t _enum_cache_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct dev_list _enum_cache_head;
+static uint64_t _enum_cache_list_gen;
+
 STATIC bool matches_filter(const struct dev_list *attr, const fpga_properties filter)
 {
 	struct _fpga_properties *_filter = (struct _fpga_properties *)filter;
@@ -685,15 +695,113 @@ struct _fpga_token *token_add(const char *sysfspath, const char *devpath)
 	return _tok;
 }
 
+STATIC void enum_cache_list_free(struct dev_list *head)
+{
+	struct dev_list *lptr;
+
+	for (lptr = head->next; NULL != lptr;) {
+		struct dev_list *trash = lptr;
+		lptr = lptr->next;
+		if (trash->token)
+			xfpga_fpgaDestroyToken((fpga_token *)&trash->token);
+		free(trash);
+	}
+
+	memset(head, 0, sizeof(*head));
+}
+
+/// Walk sysfs and sync every FME and port, building a prototype
+/// token for each one that is present.
+STATIC fpga_result enum_cache_list_fill(struct dev_list *head)
+{
+	struct dev_list *lptr;
+	fpga_result result;
+
+	result = enum_fpga_region_resources(head, true);
+	if (result != FPGA_OK)
+		return result;
+
+	for (lptr = head->next; NULL != lptr; lptr = lptr->next) {
+		// Skip the "container" device list nodes.
+		if (!lptr->devpath[0])
+			continue;
+
+		if (lptr->objtype == FPGA_DEVICE &&
+		    sync_fme(lptr) != FPGA_OK) {
+			continue;
+		} else if (lptr->objtype == FPGA_ACCELERATOR &&
+			   sync_afu(lptr) != FPGA_OK) {
+			continue;
+		}
+
+		lptr->token = token_add(lptr->sysfspath, lptr->devpath);
+		if (!lptr->token) {
+			OPAE_ERR("Failed to allocate memory for token");
+			return FPGA_NO_MEMORY;
+		}
+	}
+
+	return FPGA_OK;
+}
+
+/// Determine whether the sysfs directory of a cached node still exists.
+STATIC bool enum_cache_node_present(const struct dev_list *node)
+{
+	struct stat stats;
+
+	return !stat(node->sysfspath, &stats) && S_ISDIR(stats.st_mode);
+}
+
+/// Determine if filters match on AFU attributes that can change
+/// without a device event.
+STATIC bool filters_need_afu_sync(const fpga_properties *filters,
+				  uint32_t num_filters)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_filters; ++i) {
+		struct _fpga_properties *_filter =
+			(struct _fpga_properties *)filters[i];
+
+		if (FIELD_VALID(_filter, FPGA_PROPERTY_OBJTYPE) &&
+		    _filter->objtype != FPGA_ACCELERATOR)
+			continue;
+
+		if (FIELD_VALID(_filter, FPGA_PROPERTY_GUID) ||
+		    FIELD_VALID(_filter, FPGA_PROPERTY_ACCELERATOR_STATE) ||
+		    FIELD_VALID(_filter, FPGA_PROPERTY_NUM_MMIO) ||
+		    FIELD_VALID(_filter, FPGA_PROPERTY_NUM_INTERRUPTS))
+			return true;
+	}
+
+	return false;
+}
+
+void enum_cache_flush(void)
+{
+	if (pthread_mutex_lock(&_enum_cache_list_lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		return;
+	}
+
+	enum_cache_list_free(&_enum_cache_head);
+	_enum_cache_list_gen = 0;
+
+	pthread_mutex_unlock(&_enum_cache_list_lock);
+}
+
 fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 				       uint32_t num_filters, fpga_token *tokens,
 				       uint32_t max_tokens,
 				       uint32_t *num_matches)
 {
-	fpga_result result = FPGA_NOT_FOUND;
-
-	struct dev_list head;
+	fpga_result result = FPGA_OK;
 	struct dev_list *lptr;
+	uint64_t generation;
+	bool resync;
+	bool cached;
+	bool stale = false;
+	bool afu;
 
 	if (NULL == num_matches) {
 		OPAE_MSG("num_matches is NULL");
@@ -719,46 +827,67 @@ fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 
 	*num_matches = 0;
 
-	memset(&head, 0, sizeof(head));
+	if (pthread_mutex_lock(&_enum_cache_list_lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		return FPGA_EXCEPTION;
+	}
 
-	// enum FPGA regions & resources
-	result = enum_fpga_region_resources(&head,
-				include_afu(filters, num_filters));
+	generation = enum_cache_generation();
+	if (generation != _enum_cache_list_gen) {
+		enum_cache_list_free(&_enum_cache_head);
+		_enum_cache_list_gen = 0;
 
-	if (result != FPGA_OK) {
-		OPAE_MSG("No FPGA resources found");
-		return result;
+		result = enum_cache_list_fill(&_enum_cache_head);
+		if (result != FPGA_OK) {
+			OPAE_MSG("No FPGA resources found");
+			enum_cache_list_free(&_enum_cache_head);
+			goto out_unlock;
+		}
+
+		_enum_cache_list_gen = generation;
+		resync = false;
+		cached = false;
+	} else {
+		cached = true;
+		// Port state, MMIO/IRQ counts and the AFU ID change with
+		// open/close and PR, which don't raise device events.
+		resync = filters_need_afu_sync(filters, num_filters);
 	}
 
+	afu = include_afu(filters, num_filters);
+
 	/* create and populate token data structures */
-	for (lptr = head.next; NULL != lptr; lptr = lptr->next) {
-		// Skip the "container" device list nodes.
-		if (!lptr->devpath[0])
+	for (lptr = _enum_cache_head.next; NULL != lptr; lptr = lptr->next) {
+		if (!lptr->token)
 			continue;
 
-		if (lptr->objtype == FPGA_DEVICE &&
-		    sync_fme(lptr) != FPGA_OK) {
+		if (!afu && lptr->objtype == FPGA_ACCELERATOR)
 			continue;
-		} else if (lptr->objtype == FPGA_ACCELERATOR &&
-			   sync_afu(lptr) != FPGA_OK) {
+
+		if (resync && lptr->objtype == FPGA_ACCELERATOR &&
+		    sync_afu(lptr) != FPGA_OK)
+			continue;
+
+		// A device may vanish without its uevent reaching us.
+		if (cached && !enum_cache_node_present(lptr)) {
+			stale = true;
 			continue;
 		}
 
 		if (matches_filters(lptr, filters, num_filters)) {
 			if (*num_matches < max_tokens) {
 
-				tokens[*num_matches] = token_add(lptr->sysfspath, lptr->devpath);
-
-				if (!tokens[*num_matches]) {
+				if (xfpga_fpgaCloneToken(lptr->token,
+					&tokens[*num_matches]) != FPGA_OK) {
 					uint32_t i;
 					OPAE_ERR("Failed to allocate memory for token");
 					result = FPGA_NO_MEMORY;
 
 					for (i = 0 ; i < *num_matches ; ++i)
-						free(tokens[i]);
+						xfpga_fpgaDestroyToken(&tokens[i]);
 					*num_matches = 0;
 
-					goto out_free_trash;
+					goto out_unlock;
 				}
 
 			}
@@ -766,12 +895,11 @@ fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 		}
 	}
 
-out_free_trash:
-	for (lptr = head.next; NULL != lptr;) {
-		struct dev_list *trash = lptr;
-		lptr = lptr->next;
-		free(trash);
-	}
+out_unlock:
+	pthread_mutex_unlock(&_enum_cache_list_lock);
+
+	if (stale)
+		enum_cache_invalidate();
 
 	return result;
 }
@@ -0,0 +1,238 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "common_int.h"
+#include "enum_cache.h"
+
+#define UEVENT_BUFFER_SIZE 8192
+
+#define DEV_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+static pthread_mutex_t _enum_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static int _inotify_fd = -1;
+static int _uevent_fd = -1;
+static uint64_t _enum_cache_gen = 1;
+
+STATIC bool is_fpga_name(const char *name)
+{
+	return !strncmp(name, "dfl-", 4) ||
+	       !strncmp(name, "intel-fpga-", 11);
+}
+
+STATIC int open_inotify(void)
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (fd < 0) {
+		OPAE_DBG("inotify_init1() failed: %s", strerror(errno));
+		return -1;
+	}
+
+	// sysfs doesn't raise inotify events for kobjects that the
+	// kernel adds or removes, but the device nodes in /dev follow
+	// the FME and port devices.
+	if (inotify_add_watch(fd, FPGA_DEV_PATH, DEV_WATCH_MASK) < 0) {
+		OPAE_DBG("inotify_add_watch(%s) failed: %s",
+			 FPGA_DEV_PATH, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+STATIC int open_uevent(void)
+{
+	struct sockaddr_nl addr;
+	int fd;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		    NETLINK_KOBJECT_UEVENT);
+	if (fd < 0) {
+		OPAE_DBG("uevent socket() failed: %s", strerror(errno));
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1; // kernel events
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		OPAE_DBG("uevent bind() failed: %s", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// Returns true when any queued inotify event names an FPGA device node.
+STATIC bool drain_inotify(int fd)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+	ssize_t len;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		char *ptr = buf;
+
+		while (ptr < buf + len) {
+			struct inotify_event *e = (struct inotify_event *)ptr;
+
+			if ((e->mask & IN_Q_OVERFLOW) ||
+			    (e->len && is_fpga_name(e->name)))
+				changed = true;
+
+			ptr += sizeof(*e) + e->len;
+		}
+	}
+
+	return changed;
+}
+
+// Returns true when any queued uevent refers to an FPGA kobject.
+STATIC bool drain_uevent(int fd)
+{
+	char buf[UEVENT_BUFFER_SIZE];
+	bool changed = false;
+	ssize_t len;
+
+	while ((len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) != 0) {
+		char *ptr;
+
+		if (len < 0) {
+			// ENOBUFS means events were dropped.
+			if (errno == ENOBUFS)
+				changed = true;
+			else if (errno != EINTR)
+				break;
+			continue;
+		}
+
+		buf[len] = '\0';
+
+		// "action@devpath" followed by NUL-separated KEY=value pairs.
+		for (ptr = buf; ptr < buf + len; ptr += strlen(ptr) + 1) {
+			if (strstr(ptr, "fpga") || strstr(ptr, "dfl")) {
+				changed = true;
+				break;
+			}
+		}
+	}
+
+	return changed;
+}
+
+int enum_cache_initialize(void)
+{
+	if (pthread_mutex_lock(&_enum_cache_lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		return 1;
+	}
+
+	if (getenv("LIBOPAE_NO_ENUM_CACHE")) {
+		OPAE_DBG("enumeration cache disabled");
+	} else {
+		if (_inotify_fd < 0)
+			_inotify_fd = open_inotify();
+		if (_uevent_fd < 0)
+			_uevent_fd = open_uevent();
+	}
+
+	__atomic_add_fetch(&_enum_cache_gen, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_unlock(&_enum_cache_lock);
+	return 0;
+}
+
+void enum_cache_finalize(void)
+{
+	if (pthread_mutex_lock(&_enum_cache_lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		return;
+	}
+
+	if (_inotify_fd >= 0) {
+		close(_inotify_fd);
+		_inotify_fd = -1;
+	}
+
+	if (_uevent_fd >= 0) {
+		close(_uevent_fd);
+		_uevent_fd = -1;
+	}
+
+	__atomic_add_fetch(&_enum_cache_gen, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_unlock(&_enum_cache_lock);
+}
+
+uint64_t enum_cache_generation(void)
+{
+	bool changed;
+
+	if (pthread_mutex_lock(&_enum_cache_lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		return __atomic_add_fetch(&_enum_cache_gen, 1,
+					  __ATOMIC_SEQ_CST);
+	}
+
+	// The uevent socket is required: it is the only watcher that
+	// sees region and FME changes that don't touch /dev. inotify
+	// additionally catches device nodes renamed by udev.
+	if (_uevent_fd < 0) {
+		changed = true;
+	} else {
+		changed = drain_uevent(_uevent_fd);
+		if (_inotify_fd >= 0 && drain_inotify(_inotify_fd))
+			changed = true;
+	}
+
+	if (changed)
+		__atomic_add_fetch(&_enum_cache_gen, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_unlock(&_enum_cache_lock);
+
+	return __atomic_load_n(&_enum_cache_gen, __ATOMIC_SEQ_CST);
+}
+
+void enum_cache_invalidate(void)
+{
+	__atomic_add_fetch(&_enum_cache_gen, 1, __ATOMIC_SEQ_CST);
+}
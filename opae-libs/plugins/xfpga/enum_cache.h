@@ -0,0 +1,77 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __FPGA_ENUM_CACHE_H__
+#define __FPGA_ENUM_CACHE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Open the device change watchers used to validate the enumeration
+ * cache: an inotify watch on the device node directory and a
+ * NETLINK_KOBJECT_UEVENT socket. When neither can be opened, or
+ * when the environment variable LIBOPAE_NO_ENUM_CACHE is set, the
+ * cache is disabled and every enumeration walks sysfs.
+ *
+ * @return 0 on success (including the disabled case).
+ */
+int enum_cache_initialize(void);
+
+/**
+ * Close the watchers and mark the cache stale.
+ */
+void enum_cache_finalize(void);
+
+/**
+ * Drain pending device events and return the current cache
+ * generation. The generation changes whenever an FPGA device
+ * node or kobject is added, removed or changed, and on every
+ * call while the cache is disabled.
+ */
+uint64_t enum_cache_generation(void);
+
+/**
+ * Mark the cache stale. Used by operations in this process that
+ * change what enumeration reports without necessarily raising a
+ * device event (eg partial reconfiguration).
+ */
+void enum_cache_invalidate(void);
+
+/**
+ * Release the cached device list and its prototype tokens.
+ * Defined in enum.c, which owns the list.
+ */
+void enum_cache_flush(void);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __FPGA_ENUM_CACHE_H__
@@ -33,6 +33,7 @@
 #include "opae/manage.h"
 #include "common_int.h"
 #include "opae_drv.h"
+#include "enum_cache.h"
 
 //Assign Port to PF from Interface
 #define ASSIGN_PORT_TO_PF           0
@@ -79,6 +80,8 @@ fpga_result __XFPGA_API__ xfpga_fpgaAssignPortToInterface(fpga_handle fpga,
 		result = FPGA_INVALID_PARAM;
 	}
 
+	if (result == FPGA_OK)
+		enum_cache_invalidate();
 
 out_unlock:
 	err = pthread_mutex_unlock(&_handle->lock);
@@ -170,6 +170,50 @@ fpga_result get_afu_metric_value(fpga_handle handle,
 	return result;
 }
 
+// reads every AFU metric counter in a single pass
+fpga_result get_afu_metrics_snapshot(fpga_handle handle,
+				fpga_metric_vector *enum_vector,
+				struct fpga_metric *metrics,
+				uint64_t num_metrics)
+{
+	fpga_result result                           = FPGA_OK;
+	uint64_t index                               = 0;
+	uint64_t found                               = 0;
+	struct metric_bbb_value metric_csr;
+	struct _fpga_enum_metric *_fpga_enum_metric  = NULL;
+
+	if (handle == NULL ||
+		enum_vector == NULL ||
+		metrics == NULL) {
+		OPAE_ERR("Invalid Input Paramters");
+		return FPGA_INVALID_PARAM;
+	}
+
+	for (index = 0; index < num_metrics; index++) {
+
+		memset(&metrics[index], 0, sizeof(metrics[index]));
+
+		_fpga_enum_metric = (struct _fpga_enum_metric *)fpga_vector_get(enum_vector, index);
+		if (_fpga_enum_metric == NULL)
+			continue;
+
+		metrics[index].metric_num = _fpga_enum_metric->metric_num;
+
+		memset(&metric_csr, 0, sizeof(metric_csr));
+		result = xfpga_fpgaReadMMIO64(handle, 0, _fpga_enum_metric->mmio_offset, &metric_csr.csr);
+		if (result != FPGA_OK) {
+			OPAE_MSG("Failed to get metric %ld", _fpga_enum_metric->metric_num);
+			continue;
+		}
+
+		metrics[index].value.ivalue = metric_csr.value;
+		metrics[index].isvalid = true;
+		++found;
+	}
+
+	return found ? FPGA_OK : FPGA_NOT_FOUND;
+}
+
 fpga_result add_afu_metrics_vector(fpga_metric_vector *vector,
 				  uint64_t *metric_id,
 				  uint64_t group_value,
@@ -33,6 +33,8 @@
 #include <config.h>
 #endif // HAVE_CONFIG_H
 
+#include <time.h>
+
 #include "opae/access.h"
 #include "opae/utils.h"
 #include "common_int.h"
@@ -345,8 +347,8 @@ fpga_result __XFPGA_API__ xfpga_fpgaGetMetricsByName(fpga_handle handle,
 	if (objtype == FPGA_ACCELERATOR) {
 		// get AFU metrics
 		for (i = 0; i < num_metric_names; i++) {
-			result = parse_metric_num_name(metrics_names[i],
-							&(_handle->fpga_enum_metric_vector),
+			result = lookup_metric_num(_handle,
+							metrics_names[i],
 							&metric_num);
 			if (result != FPGA_OK) {
 				OPAE_MSG("Invalid input metrics string= %s", metrics_names[i]);
@@ -377,8 +379,8 @@ fpga_result __XFPGA_API__ xfpga_fpgaGetMetricsByName(fpga_handle handle,
 		// get FME metrics
 		for (i = 0; i < num_metric_names; i++) {
 
-			result = parse_metric_num_name(metrics_names[i],
-							&(_handle->fpga_enum_metric_vector),
+			result = lookup_metric_num(_handle,
+							metrics_names[i],
 							&metric_num);
 			if (result != FPGA_OK) {
 				OPAE_ERR("Invalid input metrics string= %s", metrics_names[i]);
@@ -420,3 +422,122 @@ out_unlock:
 	}
 	return result;
 }
+
+fpga_result __XFPGA_API__ xfpga_fpgaGetMetricsSnapshot(fpga_handle handle,
+						uint64_t max_age_usec,
+						fpga_metric *metrics,
+						uint64_t *num_metrics,
+						uint64_t *timestamp_usec)
+{
+	fpga_result result                     = FPGA_OK;
+	struct _fpga_handle *_handle           = (struct _fpga_handle *)handle;
+	int err                                = 0;
+	uint64_t i                             = 0;
+	uint64_t found                         = 0;
+	uint64_t num_enun_metrics              = 0;
+	uint64_t now                           = 0;
+	struct timespec ts;
+	fpga_objtype objtype;
+
+	if (_handle == NULL) {
+		OPAE_ERR("NULL fpga handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	result = handle_check_and_lock(_handle);
+	if (result)
+		return result;
+
+	if (_handle->fddev < 0) {
+		OPAE_ERR("Invalid handle file descriptor");
+		result = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	if (metrics == NULL ||
+		num_metrics == NULL) {
+		OPAE_ERR("Invalid Input parameters");
+		result = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	result = enum_fpga_metrics(handle);
+	if (result != FPGA_OK) {
+		OPAE_ERR("Failed to Discover Metrics");
+		result = FPGA_NOT_FOUND;
+		goto out_unlock;
+	}
+
+	result = fpga_vector_total(&(_handle->fpga_enum_metric_vector), &num_enun_metrics);
+	if (result != FPGA_OK || num_enun_metrics == 0) {
+		OPAE_MSG("No metrics found");
+		result = FPGA_NOT_FOUND;
+		goto out_unlock;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	// Serve the previous sweep if the caller accepts its age.
+	if (_handle->metric_snapshot &&
+	    max_age_usec &&
+	    now - _handle->metric_snapshot_usec <= max_age_usec)
+		goto out_copy;
+
+	if (_handle->metric_snapshot == NULL) {
+		_handle->metric_snapshot = calloc(num_enun_metrics,
+						  sizeof(struct fpga_metric));
+		if (_handle->metric_snapshot == NULL) {
+			OPAE_ERR("Failed to allocate memory");
+			result = FPGA_NO_MEMORY;
+			goto out_unlock;
+		}
+	}
+
+	result = get_fpga_object_type(handle, &objtype);
+	if (result != FPGA_OK) {
+		OPAE_ERR("Failed to get object type");
+		result = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	if (objtype == FPGA_ACCELERATOR) {
+		get_afu_metrics_snapshot(handle,
+					&(_handle->fpga_enum_metric_vector),
+					_handle->metric_snapshot,
+					num_enun_metrics);
+	} else if (objtype == FPGA_DEVICE) {
+		get_fme_metrics_snapshot(_handle,
+					_handle->metric_snapshot,
+					num_enun_metrics);
+	} else {
+		result = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	_handle->metric_snapshot_usec = now;
+
+out_copy:
+	if (*num_metrics > num_enun_metrics)
+		*num_metrics = num_enun_metrics;
+
+	memcpy(metrics, _handle->metric_snapshot,
+	       *num_metrics * sizeof(struct fpga_metric));
+
+	for (i = 0; i < *num_metrics; i++) {
+		if (metrics[i].isvalid)
+			++found;
+	}
+
+	if (timestamp_usec)
+		*timestamp_usec = _handle->metric_snapshot_usec;
+
+	result = found ? FPGA_OK : FPGA_NOT_FOUND;
+
+out_unlock:
+	err = pthread_mutex_unlock(&_handle->lock);
+	if (err) {
+		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+	}
+	return result;
+}
@@ -233,6 +233,11 @@ fpga_result get_afu_metric_value(fpga_handle handle,
 				uint64_t metric_num,
 				struct fpga_metric *fpga_metric);
 
+fpga_result get_afu_metrics_snapshot(fpga_handle handle,
+				fpga_metric_vector *enum_vector,
+				struct fpga_metric *metrics,
+				uint64_t num_metrics);
+
 fpga_result add_afu_metrics_vector(fpga_metric_vector *vector,
 				uint64_t *metric_id,
 				uint64_t group_value,
@@ -275,4 +280,16 @@ fpga_result xfpga_bmcGetSDRDetails(struct _fpga_handle *_handle,
 
 void *metrics_load_bmc_lib(void);
 
+fpga_result build_metric_name_hash(struct _fpga_handle *_handle);
+
+fpga_result lookup_metric_num(struct _fpga_handle *_handle,
+				const char *search_string,
+				uint64_t *metric_num);
+
+fpga_result get_fme_metrics_snapshot(struct _fpga_handle *_handle,
+				struct fpga_metric *metrics,
+				uint64_t num_metrics);
+
+void free_metric_snapshot(struct _fpga_handle *_handle, uint64_t num_metrics);
+
 #endif // __FPGA_METRICS_INT_H__
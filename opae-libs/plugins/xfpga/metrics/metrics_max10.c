@@ -356,6 +356,37 @@ out:
 }
 
 
+// Checks a max10 reading against the sensor type limits
+STATIC fpga_result check_max10_limits(struct _fpga_enum_metric *_fpga_enum_metric,
+					double dvalue)
+{
+	fpga_result result = FPGA_OK;
+
+	if (strstr(_fpga_enum_metric->metric_name, DFL_POWER)) {
+
+		if (dvalue  < POWER_LOW_LIMIT || dvalue  > POWER_HIGH_LIMIT)
+			result = FPGA_EXCEPTION;
+
+	} else if (strstr(_fpga_enum_metric->metric_name, DFL_VOLTAGE)) {
+
+		if (dvalue < VOLTAMP_LOW_LIMIT || dvalue > VOLTAMP_HIGH_LIMIT)
+			result = FPGA_EXCEPTION;
+
+	} else if (strstr(_fpga_enum_metric->metric_name, DFL_CURRENT)) {
+
+		if (dvalue < VOLTAMP_LOW_LIMIT || dvalue > VOLTAMP_HIGH_LIMIT)
+			result = FPGA_EXCEPTION;
+
+	} else if (strstr(_fpga_enum_metric->metric_name, DFL_TEMPERATURE)) {
+
+		if (dvalue < THERMAL_LOW_LIMIT || dvalue > THERMAL_HIGH_LIMIT)
+			result = FPGA_EXCEPTION;
+
+	}
+
+	return result;
+}
+
 fpga_result read_max10_value(struct _fpga_enum_metric *_fpga_enum_metric,
 					double *dvalue)
 {
@@ -376,28 +407,51 @@ fpga_result read_max10_value(struct _fpga_enum_metric *_fpga_enum_metric,
 
 	*dvalue = ((double)value / MILLI);
 
-	// Check for limits
-	if (strstr(_fpga_enum_metric->metric_name, DFL_POWER)) {
-
-		if (*dvalue  < POWER_LOW_LIMIT || *dvalue  > POWER_HIGH_LIMIT)
-			result = FPGA_EXCEPTION;
-
-	} else if (strstr(_fpga_enum_metric->metric_name, DFL_VOLTAGE)) {
-
-		if (*dvalue < VOLTAMP_LOW_LIMIT || *dvalue > VOLTAMP_HIGH_LIMIT)
-			result = FPGA_EXCEPTION;
+	return check_max10_limits(_fpga_enum_metric, *dvalue);
+}
 
-	} else if (strstr(_fpga_enum_metric->metric_name, DFL_CURRENT)) {
+// Reads a max10 value through a descriptor that is opened on first use
+// and then kept open, so repeated sweeps only pay for the pread().
+fpga_result read_max10_value_fd(struct _fpga_enum_metric *_fpga_enum_metric,
+					int *fd,
+					double *dvalue)
+{
+	char buf[SYSFS_PATH_MAX] = { 0, };
+	ssize_t res;
+	char *endptr = NULL;
+	uint64_t value;
 
-		if (*dvalue < VOLTAMP_LOW_LIMIT || *dvalue > VOLTAMP_HIGH_LIMIT)
-			result = FPGA_EXCEPTION;
+	if (_fpga_enum_metric == NULL ||
+		fd == NULL ||
+		dvalue == NULL) {
+		OPAE_ERR("Invalid Input Parameters");
+		return FPGA_INVALID_PARAM;
+	}
 
-	} else if (strstr(_fpga_enum_metric->metric_name, DFL_TEMPERATURE)) {
+	if (*fd < 0) {
+		*fd = open(_fpga_enum_metric->metric_sysfs, O_RDONLY | O_CLOEXEC);
+		if (*fd < 0) {
+			OPAE_MSG("Failed to open %s", _fpga_enum_metric->metric_sysfs);
+			return FPGA_NOT_FOUND;
+		}
+	}
 
-		if (*dvalue < THERMAL_LOW_LIMIT || *dvalue > THERMAL_HIGH_LIMIT)
-			result = FPGA_EXCEPTION;
+	res = eintr_pread(*fd, buf, sizeof(buf) - 1, 0);
+	if (res <= 0) {
+		OPAE_MSG("Failed to read %s", _fpga_enum_metric->metric_sysfs);
+		close(*fd);
+		*fd = -1;
+		return FPGA_EXCEPTION;
+	}
+	buf[res] = '\0';
 
+	value = strtoull(buf, &endptr, 0);
+	if (endptr == buf) {
+		OPAE_MSG("Failed to parse %s", _fpga_enum_metric->metric_sysfs);
+		return FPGA_EXCEPTION;
 	}
 
-	return result;
+	*dvalue = ((double)value / MILLI);
+
+	return check_max10_limits(_fpga_enum_metric, *dvalue);
 }
@@ -48,6 +48,10 @@ fpga_result read_sensor_sysfs_file(const char *sysfs, const char *file,
 fpga_result read_max10_value(struct _fpga_enum_metric *_fpga_enum_metric,
 				double *dvalue);
 
+fpga_result read_max10_value_fd(struct _fpga_enum_metric *_fpga_enum_metric,
+				int *fd,
+				double *dvalue);
+
 fpga_result  dfl_enum_max10_metrics_info(struct _fpga_handle *_handle,
 	fpga_metric_vector *vector,
 	uint64_t *metric_num,
@@ -34,6 +34,9 @@
 #endif // HAVE_CONFIG_H
 
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
 #include <glob.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -155,6 +158,7 @@ fpga_result add_metric_vector(fpga_metric_vector *vector,
 	fpga_enum_metric->hw_type = hw_type;
 	fpga_enum_metric->metric_num = metric_num;
 	fpga_enum_metric->mmio_offset = mmio_offset;
+	fpga_enum_metric->sensor_num = 0;
 
 	fpga_vector_push(vector, fpga_enum_metric);
 
@@ -302,6 +306,8 @@ fpga_result  enum_bmc_metrics_info(struct _fpga_handle *_handle,
 	sdr_details details;
 	bmc_sdr_handle records;
 	bmc_values_handle values;
+	struct _fpga_enum_metric *fpga_enum_metric = NULL;
+	uint64_t total = 0;
 	size_t len;
 
 	if (vector == NULL ||
@@ -368,6 +374,15 @@ fpga_result  enum_bmc_metrics_info(struct _fpga_handle *_handle,
 			return result;
 		}
 
+		// Remember the sensor number so snapshots can read
+		// the value directly instead of matching by name.
+		if (fpga_vector_total(vector, &total) == FPGA_OK && total) {
+			fpga_enum_metric = (struct _fpga_enum_metric *)
+				fpga_vector_get(vector, total - 1);
+			if (fpga_enum_metric)
+				fpga_enum_metric->sensor_num = x;
+		}
+
 		*metric_num = *metric_num + 1;
 	}
 
@@ -408,6 +423,8 @@ fpga_result free_fpga_enum_metrics_vector(struct _fpga_handle *_handle)
 		return FPGA_INVALID_PARAM;
 	}
 
+	free_metric_snapshot(_handle, num_enun_metrics);
+
 	for (i = 0; i < num_enun_metrics; i++) {
 		fpga_vector_delete(&(_handle->fpga_enum_metric_vector), i);
 	}
@@ -602,6 +619,9 @@ fpga_result enum_fpga_metrics(fpga_handle handle)
 
 	} // if Object type
 
+	if (result == FPGA_OK)
+		result = build_metric_name_hash(_handle);
+
 	if (result != FPGA_OK)
 		free_fpga_enum_metrics_vector(_handle);
 
@@ -940,3 +960,269 @@ fpga_result  clear_cached_values(fpga_handle handle)
 	_handle->num_bmc_metric = 0;
 	return result;
 }
+
+// hashes a metric search string, case-insensitively
+static uint64_t metric_name_hash_str(const char *str)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	while (*str) {
+		hash ^= (uint64_t)tolower((unsigned char)*str++);
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+// builds the "qualifier:metric" -> metric lookup table
+fpga_result build_metric_name_hash(struct _fpga_handle *_handle)
+{
+	fpga_result result                          = FPGA_OK;
+	uint64_t num_enun_metrics                   = 0;
+	uint64_t size                               = 16;
+	uint64_t i                                  = 0;
+	uint64_t pos                                = 0;
+	struct _fpga_enum_metric *fpga_enum_metric  = NULL;
+	char name[2 * FPGA_METRIC_STR_SIZE + 2]     = { 0, };
+
+	if (_handle == NULL) {
+		OPAE_ERR("Invalid handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	result = fpga_vector_total(&(_handle->fpga_enum_metric_vector), &num_enun_metrics);
+	if (result != FPGA_OK) {
+		OPAE_ERR("Failed to get metric total");
+		return result;
+	}
+
+	while (size < 2 * num_enun_metrics)
+		size <<= 1;
+
+	free(_handle->metric_name_hash);
+	_handle->metric_name_hash = calloc(size, sizeof(uint64_t));
+	if (_handle->metric_name_hash == NULL) {
+		OPAE_ERR("Failed to allocate memory");
+		_handle->metric_name_hash_size = 0;
+		return FPGA_NO_MEMORY;
+	}
+	_handle->metric_name_hash_size = size;
+
+	for (i = 0; i < num_enun_metrics; i++) {
+		fpga_enum_metric = (struct _fpga_enum_metric *)
+			fpga_vector_get(&(_handle->fpga_enum_metric_vector), i);
+		if (fpga_enum_metric == NULL)
+			continue;
+
+		snprintf(name, sizeof(name), "%s:%s",
+			 fpga_enum_metric->qualifier_name,
+			 fpga_enum_metric->metric_name);
+
+		// Linear probing; slots hold the vector index + 1.
+		pos = metric_name_hash_str(name) & (size - 1);
+		while (_handle->metric_name_hash[pos])
+			pos = (pos + 1) & (size - 1);
+
+		_handle->metric_name_hash[pos] = i + 1;
+	}
+
+	return FPGA_OK;
+}
+
+// resolves a "qualifier:metric" string to its metric number
+fpga_result lookup_metric_num(struct _fpga_handle *_handle,
+				const char *search_string,
+				uint64_t *metric_num)
+{
+	struct _fpga_enum_metric *fpga_enum_metric  = NULL;
+	const char *str                             = NULL;
+	uint64_t mask                               = 0;
+	uint64_t pos                                = 0;
+	size_t qualifier_len                        = 0;
+
+	if (_handle == NULL ||
+		search_string == NULL ||
+		metric_num == NULL) {
+		OPAE_ERR("Invalid Input Paramters");
+		return FPGA_INVALID_PARAM;
+	}
+
+	// No table (allocation failed): fall back to the linear search.
+	if (_handle->metric_name_hash == NULL)
+		return parse_metric_num_name(search_string,
+					     &(_handle->fpga_enum_metric_vector),
+					     metric_num);
+
+	str = strrchr(search_string, ':');
+	if (!str) {
+		OPAE_ERR("Invalid Input Paramters");
+		return FPGA_INVALID_PARAM;
+	}
+	qualifier_len = str - search_string;
+
+	mask = _handle->metric_name_hash_size - 1;
+	pos = metric_name_hash_str(search_string) & mask;
+
+	while (_handle->metric_name_hash[pos]) {
+		fpga_enum_metric = (struct _fpga_enum_metric *)
+			fpga_vector_get(&(_handle->fpga_enum_metric_vector),
+					_handle->metric_name_hash[pos] - 1);
+
+		if (fpga_enum_metric &&
+		    strlen(fpga_enum_metric->qualifier_name) == qualifier_len &&
+		    !strncasecmp(fpga_enum_metric->qualifier_name,
+				 search_string, qualifier_len) &&
+		    !strcasecmp(fpga_enum_metric->metric_name, str + 1)) {
+			*metric_num = fpga_enum_metric->metric_num;
+			return FPGA_OK;
+		}
+
+		pos = (pos + 1) & mask;
+	}
+
+	return FPGA_NOT_FOUND;
+}
+
+// reads every FME power & thermal metric in a single sweep
+fpga_result get_fme_metrics_snapshot(struct _fpga_handle *_handle,
+				struct fpga_metric *metrics,
+				uint64_t num_metrics)
+{
+	fpga_result result                          = FPGA_OK;
+	struct _fpga_enum_metric *fpga_enum_metric  = NULL;
+	bmc_values_handle values                    = NULL;
+	uint32_t num_sensors                        = 0;
+	uint32_t num_values                         = 0;
+	uint32_t is_valid                           = 0;
+	uint64_t found                              = 0;
+	uint64_t i                                  = 0;
+	double tmp                                  = 0;
+	bool bmc_failed                             = false;
+
+	if (_handle == NULL ||
+		metrics == NULL) {
+		OPAE_ERR("Invalid Input Paramters");
+		return FPGA_INVALID_PARAM;
+	}
+
+	for (i = 0; i < num_metrics; i++) {
+		fpga_enum_metric = (struct _fpga_enum_metric *)
+			fpga_vector_get(&(_handle->fpga_enum_metric_vector), i);
+
+		memset(&metrics[i], 0, sizeof(metrics[i]));
+		if (fpga_enum_metric == NULL)
+			continue;
+
+		metrics[i].metric_num = fpga_enum_metric->metric_num;
+
+		if ((fpga_enum_metric->metric_type != FPGA_METRIC_TYPE_POWER) &&
+		    (fpga_enum_metric->metric_type != FPGA_METRIC_TYPE_THERMAL))
+			continue;
+
+		switch (fpga_enum_metric->hw_type) {
+		case FPGA_HW_DCP_RC:
+			// One BMC read covers every sensor. The SDRs
+			// are static, so they are loaded only once.
+			if (bmc_failed)
+				continue;
+
+			if (!values) {
+				if (!_handle->bmc_sdr_records) {
+					result = xfpga_bmcLoadSDRs(_handle,
+						&_handle->bmc_sdr_records,
+						&num_sensors);
+					if (result != FPGA_OK) {
+						OPAE_MSG("Failed to load BMC SDR.");
+						_handle->bmc_sdr_records = NULL;
+						bmc_failed = true;
+						continue;
+					}
+				}
+
+				result = xfpga_bmcReadSensorValues(_handle,
+					_handle->bmc_sdr_records,
+					&values, &num_values);
+				if (result != FPGA_OK) {
+					OPAE_MSG("Failed to read BMC sensor values.");
+					values = NULL;
+					bmc_failed = true;
+					continue;
+				}
+			}
+
+			result = xfpga_bmcGetSensorReading(_handle, values,
+				fpga_enum_metric->sensor_num, &is_valid, &tmp);
+			if (result == FPGA_OK && is_valid) {
+				metrics[i].value.dvalue = tmp;
+				metrics[i].isvalid = true;
+			}
+			break;
+
+		case FPGA_HW_DCP_N3000:
+		case FPGA_HW_DCP_D5005:
+		case FPGA_HW_DCP_N5010:
+		case FPGA_HW_DCP_N5011:
+			if (!_handle->metric_fds) {
+				_handle->metric_fds = malloc(num_metrics * sizeof(int));
+				if (!_handle->metric_fds) {
+					OPAE_ERR("Failed to allocate memory");
+					result = FPGA_NO_MEMORY;
+					goto out_destroy;
+				}
+				memset(_handle->metric_fds, 0xff, num_metrics * sizeof(int));
+			}
+
+			result = read_max10_value_fd(fpga_enum_metric,
+						     &_handle->metric_fds[i],
+						     &tmp);
+			if (result == FPGA_OK) {
+				metrics[i].value.dvalue = tmp;
+				metrics[i].isvalid = true;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		if (metrics[i].isvalid)
+			++found;
+	}
+
+	result = found ? FPGA_OK : FPGA_NOT_FOUND;
+
+out_destroy:
+	if (values && xfpga_bmcDestroySensorValues(_handle, &values) != FPGA_OK)
+		OPAE_MSG("Failed to Destroy Sensor value.");
+
+	return result;
+}
+
+// releases the name table and snapshot state
+void free_metric_snapshot(struct _fpga_handle *_handle, uint64_t num_metrics)
+{
+	uint64_t i;
+
+	if (_handle->metric_fds) {
+		for (i = 0; i < num_metrics; i++) {
+			if (_handle->metric_fds[i] >= 0)
+				close(_handle->metric_fds[i]);
+		}
+		free(_handle->metric_fds);
+		_handle->metric_fds = NULL;
+	}
+
+	if (_handle->bmc_sdr_records) {
+		if (xfpga_bmcDestroySDRs(_handle, &_handle->bmc_sdr_records) != FPGA_OK)
+			OPAE_MSG("Failed to Destroy SDR.");
+		_handle->bmc_sdr_records = NULL;
+	}
+
+	free(_handle->metric_snapshot);
+	_handle->metric_snapshot = NULL;
+	_handle->metric_snapshot_usec = 0;
+
+	free(_handle->metric_name_hash);
+	_handle->metric_name_hash = NULL;
+	_handle->metric_name_hash_size = 0;
+}
@@ -87,6 +87,27 @@ out_unlock:
 	return result;
 }
 
+/*
+ * Publish base and len for cached region mmio_num. gen is odd while the
+ * entry changes, so that mmio_region_acquire() can tell when its loads
+ * straddle an update. The handle lock must be held.
+ */
+static void mmio_cache_store(struct _fpga_handle *_handle, uint32_t mmio_num,
+			     uint8_t *base, uint64_t len)
+{
+	uint64_t gen = _handle->mmio_cache[mmio_num].gen;
+
+	__atomic_store_n(&_handle->mmio_cache[mmio_num].gen, gen + 1,
+			 __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&_handle->mmio_cache[mmio_num].base, base,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&_handle->mmio_cache[mmio_num].len, len,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&_handle->mmio_cache[mmio_num].gen, gen + 2,
+			 __ATOMIC_RELEASE);
+}
+
 STATIC fpga_result map_mmio_region(fpga_handle handle, uint32_t mmio_num)
 {
 	struct _fpga_handle *_handle = (struct _fpga_handle *)handle;
@@ -133,6 +154,10 @@ STATIC fpga_result map_mmio_region(fpga_handle handle, uint32_t mmio_num)
 		}
 	}
 
+	if (mmio_num < FPGA_MMIO_CACHE_SIZE)
+		mmio_cache_store(_handle, mmio_num, (uint8_t *)addr,
+				 rinfo.size);
+
 	return FPGA_OK;
 }
 
@@ -162,121 +187,189 @@ STATIC fpga_result find_or_map_wm(fpga_handle handle, uint32_t mmio_num,
 	return FPGA_OK;
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO32(fpga_handle handle,
-					 uint32_t mmio_num,
-					 uint64_t offset,
-					 uint32_t value)
+/*
+ * Resolve the base and length of MMIO region mmio_num.
+ * The handle lock must be held.
+ */
+STATIC fpga_result mmio_region_lookup(struct _fpga_handle *_handle,
+				      uint32_t mmio_num,
+				      uint8_t **base,
+				      uint64_t *len)
 {
-
-	int err;
-	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
 	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
+	fpga_result result;
 
-	if (offset % sizeof(uint32_t) != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
+	if (mmio_num < FPGA_MMIO_CACHE_SIZE && _handle->mmio_cache[mmio_num].base) {
+		*base = _handle->mmio_cache[mmio_num].base;
+		*len = _handle->mmio_cache[mmio_num].len;
+		return FPGA_OK;
 	}
 
-	result = handle_check_and_lock(_handle);
+	result = find_or_map_wm(_handle, mmio_num, &wm);
 	if (result)
 		return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
-	if (result)
-		goto out_unlock;
+	*base = (uint8_t *)wm->offset;
+	*len = wm->len;
+	return FPGA_OK;
+}
 
-	if (offset > wm->len) {
-		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
+/*
+ * Resolve MMIO region mmio_num for an access.
+ *
+ * A handle opened with FPGA_OPEN_UNLOCKED_MMIO whose region is already
+ * mapped is served from mmio_cache without taking the handle lock.
+ * Otherwise the handle is locked, *locked is set, and the caller must
+ * unlock it (mmio_access_end) once the access is complete.
+ */
+STATIC fpga_result mmio_region_acquire(struct _fpga_handle *_handle,
+				       uint32_t mmio_num,
+				       uint8_t **base,
+				       uint64_t *len,
+				       bool *locked)
+{
+	fpga_result result;
+
+	*locked = false;
+	*base = NULL;
+
+	ASSERT_NOT_NULL(_handle);
+
+	if (_handle->magic == FPGA_HANDLE_MAGIC &&
+	    (_handle->flags & OPAE_FLAG_UNLOCKED_MMIO) &&
+	    mmio_num < FPGA_MMIO_CACHE_SIZE) {
+		uint64_t gen;
+		uint8_t *b;
+
+		// Snapshot base and len together: fall back to the
+		// locked path if the region changed in between, even
+		// when it was remapped at the same base.
+		gen = __atomic_load_n(&_handle->mmio_cache[mmio_num].gen,
+				      __ATOMIC_ACQUIRE);
+		b = __atomic_load_n(&_handle->mmio_cache[mmio_num].base,
+				    __ATOMIC_RELAXED);
+		*len = __atomic_load_n(&_handle->mmio_cache[mmio_num].len,
+				       __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (b && !(gen & 1) &&
+		    gen == __atomic_load_n(&_handle->mmio_cache[mmio_num].gen,
+					   __ATOMIC_RELAXED))
+			*base = b;
 	}
 
-	*((volatile uint32_t *) ((uint8_t *)wm->offset + offset)) = value;
+	if (*base)
+		return FPGA_OK;
 
-out_unlock:
-	err = pthread_mutex_unlock(&_handle->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
-	}
-	return result;
+	result = handle_check_and_lock(_handle);
+	if (result)
+		return result;
+	*locked = true;
+
+	return mmio_region_lookup(_handle, mmio_num, base, len);
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO32(fpga_handle handle,
-					uint32_t mmio_num,
-					uint64_t offset,
-					uint32_t *value)
+/*
+ * Validate an MMIO access of width bytes and return its address.
+ * See mmio_region_acquire() for the meaning of *locked.
+ */
+STATIC fpga_result mmio_access_begin(struct _fpga_handle *_handle,
+				     uint32_t mmio_num,
+				     uint64_t offset,
+				     uint64_t width,
+				     volatile uint8_t **addr,
+				     bool *locked)
 {
-	int err;
-	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
+	uint8_t *base = NULL;
+	uint64_t len = 0;
+	fpga_result result;
+
+	*locked = false;
 
-	if (offset % sizeof(uint32_t) != 0) {
+	if (offset % width != 0) {
 		OPAE_MSG("Misaligned MMIO access");
 		return FPGA_INVALID_PARAM;
 	}
 
-	result = handle_check_and_lock(_handle);
+	result = mmio_region_acquire(_handle, mmio_num, &base, &len, locked);
 	if (result)
 		return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
-	if (result)
-		goto out_unlock;
-
-	if (offset > wm->len) {
+	if (offset > len || width > len - offset) {
 		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		return FPGA_INVALID_PARAM;
 	}
 
-	*value = *((volatile uint32_t *) ((uint8_t *)wm->offset + offset));
+	*addr = base + offset;
+	return FPGA_OK;
+}
+
+static inline void mmio_access_end(struct _fpga_handle *_handle, bool locked)
+{
+	int err;
+
+	if (!locked)
+		return;
 
-out_unlock:
 	err = pthread_mutex_unlock(&_handle->lock);
 	if (err) {
 		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
 	}
-	return result;
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO64(fpga_handle handle,
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO32(fpga_handle handle,
 					 uint32_t mmio_num,
 					 uint64_t offset,
-					 uint64_t value)
+					 uint32_t value)
 {
-	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
+	volatile uint8_t *addr = NULL;
+	bool locked = false;
+	fpga_result result;
 
-	if (offset % sizeof(uint64_t) != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
-	}
+	result = mmio_access_begin(_handle, mmio_num, offset,
+				   sizeof(uint32_t), &addr, &locked);
+	if (result == FPGA_OK)
+		*((volatile uint32_t *)addr) = value;
 
-	result = handle_check_and_lock(_handle);
-	if (result)
-		return result;
+	mmio_access_end(_handle, locked);
+	return result;
+}
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
-	if (result)
-		goto out_unlock;
+fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO32(fpga_handle handle,
+					uint32_t mmio_num,
+					uint64_t offset,
+					uint32_t *value)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	bool locked = false;
+	fpga_result result;
 
-	if (offset > wm->len) {
-		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
-	}
+	result = mmio_access_begin(_handle, mmio_num, offset,
+				   sizeof(uint32_t), &addr, &locked);
+	if (result == FPGA_OK)
+		*value = *((volatile uint32_t *)addr);
 
-	*((volatile uint64_t *) ((uint8_t *)wm->offset + offset)) = value;
+	mmio_access_end(_handle, locked);
+	return result;
+}
 
-out_unlock:
-	err = pthread_mutex_unlock(&_handle->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
-	}
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO64(fpga_handle handle,
+					 uint32_t mmio_num,
+					 uint64_t offset,
+					 uint64_t value)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	bool locked = false;
+	fpga_result result;
+
+	result = mmio_access_begin(_handle, mmio_num, offset,
+				   sizeof(uint64_t), &addr, &locked);
+	if (result == FPGA_OK)
+		*((volatile uint64_t *)addr) = value;
+
+	mmio_access_end(_handle, locked);
 	return result;
 }
 
@@ -285,37 +378,106 @@ fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO64(fpga_handle handle,
 					uint64_t offset,
 					uint64_t *value)
 {
-	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
+	volatile uint8_t *addr = NULL;
+	bool locked = false;
+	fpga_result result;
 
-	if (offset % sizeof(uint64_t) != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
-	}
+	result = mmio_access_begin(_handle, mmio_num, offset,
+				   sizeof(uint64_t), &addr, &locked);
+	if (result == FPGA_OK)
+		*value = *((volatile uint64_t *)addr);
 
-	result = handle_check_and_lock(_handle);
+	mmio_access_end(_handle, locked);
+	return result;
+}
+
+/*
+ * Acquire region mmio_num and check every op of a batch against it,
+ * so that a batch costs one lock and one region lookup.
+ */
+STATIC fpga_result mmio_batch_begin(struct _fpga_handle *_handle,
+				    uint32_t mmio_num,
+				    const fpga_mmio_op *ops,
+				    uint32_t num_ops,
+				    uint8_t **base,
+				    bool *locked)
+{
+	uint64_t len = 0;
+	fpga_result result;
+	uint32_t i;
+
+	*locked = false;
+
+	ASSERT_NOT_NULL(ops);
+
+	result = mmio_region_acquire(_handle, mmio_num, base, &len, locked);
 	if (result)
 		return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
-	if (result)
-		goto out_unlock;
+	for (i = 0 ; i < num_ops ; ++i) {
+		if (!opae_mmio_op_valid(&ops[i], len)) {
+			OPAE_MSG("invalid MMIO op %u", i);
+			return FPGA_INVALID_PARAM;
+		}
+	}
 
-	if (offset > wm->len) {
-		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
+	return FPGA_OK;
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIOBatch(fpga_handle handle,
+					    uint32_t mmio_num,
+					    const fpga_mmio_op *ops,
+					    uint32_t num_ops)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	uint8_t *base = NULL;
+	bool locked = false;
+	fpga_result result;
+	uint32_t i;
+
+	result = mmio_batch_begin(_handle, mmio_num, ops, num_ops,
+				  &base, &locked);
+	if (result == FPGA_OK) {
+		for (i = 0 ; i < num_ops ; ++i) {
+			if (ops[i].width == sizeof(uint32_t))
+				*((volatile uint32_t *)(base + ops[i].offset)) =
+					(uint32_t)ops[i].value;
+			else
+				*((volatile uint64_t *)(base + ops[i].offset)) =
+					ops[i].value;
+		}
 	}
 
-	*value = *((volatile uint64_t *) ((uint8_t *)wm->offset + offset));
+	mmio_access_end(_handle, locked);
+	return result;
+}
 
-out_unlock:
-	err = pthread_mutex_unlock(&_handle->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+fpga_result __XFPGA_API__ xfpga_fpgaReadMMIOBatch(fpga_handle handle,
+					   uint32_t mmio_num,
+					   fpga_mmio_op *ops,
+					   uint32_t num_ops)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	uint8_t *base = NULL;
+	bool locked = false;
+	fpga_result result;
+	uint32_t i;
+
+	result = mmio_batch_begin(_handle, mmio_num, ops, num_ops,
+				  &base, &locked);
+	if (result == FPGA_OK) {
+		for (i = 0 ; i < num_ops ; ++i) {
+			if (ops[i].width == sizeof(uint32_t))
+				ops[i].value = *((volatile uint32_t *)
+						 (base + ops[i].offset));
+			else
+				ops[i].value = *((volatile uint64_t *)
+						 (base + ops[i].offset));
+		}
 	}
+
+	mmio_access_end(_handle, locked);
 	return result;
 }
 
@@ -334,7 +496,8 @@ fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO512(fpga_handle handle,
 {
 	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
+	uint8_t *base = NULL;
+	uint64_t len = 0;
 	fpga_result result = FPGA_OK;
 
 	if (offset % 64 != 0) {
@@ -351,17 +514,17 @@ fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO512(fpga_handle handle,
 		goto out_unlock;
 	}
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
+	result = mmio_region_lookup(_handle, mmio_num, &base, &len);
 	if (result)
 		goto out_unlock;
 
-	if (offset > wm->len) {
+	if (offset > len || 64 > len - offset) {
 		OPAE_MSG("offset out of bounds");
 		result = FPGA_INVALID_PARAM;
 		goto out_unlock;
 	}
 
-	copy512(value, (uint8_t *)wm->offset + offset);
+	copy512(value, base + offset);
 
 out_unlock:
 	err = pthread_mutex_unlock(&_handle->lock);
@@ -420,6 +583,9 @@ fpga_result __XFPGA_API__ xfpga_fpgaUnmapMMIO(fpga_handle handle,
 		goto out_unlock;
 	}
 
+	if (mmio_num < FPGA_MMIO_CACHE_SIZE)
+		mmio_cache_store(_handle, mmio_num, NULL, 0);
+
 	/* Unmap UAFU MMIO */
 	mmio_ptr = (void *) wm->offset;
 	if (munmap((void *) mmio_ptr, wm->len)) {
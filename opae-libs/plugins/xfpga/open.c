@@ -58,7 +58,7 @@ xfpga_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 		return FPGA_INVALID_PARAM;
 	}
 
-	if (flags & ~FPGA_OPEN_SHARED) {
+	if (flags & ~(FPGA_OPEN_SHARED | FPGA_OPEN_UNLOCKED_MMIO)) {
 		OPAE_MSG("unrecognized flags");
 		return FPGA_INVALID_PARAM;
 	}
@@ -148,6 +148,8 @@ xfpga_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 		_handle->flags |= OPAE_FLAG_HAS_MMX512;
 	}
 #endif
+	if (flags & FPGA_OPEN_UNLOCKED_MMIO)
+		_handle->flags |= OPAE_FLAG_UNLOCKED_MMIO;
 
 	// set handle return value
 	*handle = (void *)_handle;
@@ -35,6 +35,7 @@
 #include "common_int.h"
 #include "sysfs_int.h"
 #include "opae_drv.h"
+#include "enum_cache.h"
 
 int __XFPGA_API__ xfpga_plugin_initialize(void)
 {
@@ -47,11 +48,18 @@ int __XFPGA_API__ xfpga_plugin_initialize(void)
 	if (res) {
 		return res;
 	}
+
+	res = enum_cache_initialize();
+	if (res) {
+		return res;
+	}
 	return 0;
 }
 
 int __XFPGA_API__ xfpga_plugin_finalize(void)
 {
+	enum_cache_finalize();
+	enum_cache_flush();
 	sysfs_finalize();
 	return 0;
 }
@@ -82,6 +90,10 @@ int __XFPGA_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaReadMMIO32");
 	adapter->fpgaWriteMMIO512 =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaWriteMMIO512");
+	adapter->fpgaWriteMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaWriteMMIOBatch");
+	adapter->fpgaReadMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaReadMMIOBatch");
 	adapter->fpgaMapMMIO =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaMapMMIO");
 	adapter->fpgaUnmapMMIO =
@@ -161,6 +173,8 @@ int __XFPGA_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaObjectGetType");
 	adapter->fpgaObjectWrite64 =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaObjectWrite64");
+	adapter->fpgaObjectSync =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaObjectSync");
 	adapter->fpgaSetUserClock =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaSetUserClock");
 	adapter->fpgaGetUserClock =
@@ -181,6 +195,9 @@ int __XFPGA_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 	adapter->fpgaGetMetricsThresholdInfo =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaGetMetricsThresholdInfo");
 
+	adapter->fpgaGetMetricsSnapshot =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaGetMetricsSnapshot");
+
 	adapter->initialize =
 		dlsym(adapter->plugin.dl_handle, "xfpga_plugin_initialize");
 	adapter->finalize =
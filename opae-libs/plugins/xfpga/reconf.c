@@ -43,6 +43,7 @@
 #include "usrclk/user_clk_pgm_uclock.h"
 
 #include "reconf_int.h"
+#include "enum_cache.h"
 // sysfs attributes
 #define PORT_SYSFS_ERRORS     "errors/errors"
 #define PORT_SYSFS_ERR_CLEAR  "errors/clear"
@@ -406,6 +407,9 @@ out_unlock:
 		result = FPGA_RECONF_ERROR;
 	}
 
+	// The AFU ID changes with the bitstream.
+	enum_cache_invalidate();
+
 	err = pthread_mutex_unlock(&_handle->lock);
 	if (err)
 		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
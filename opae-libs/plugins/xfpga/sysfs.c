@@ -1892,6 +1892,28 @@ ssize_t eintr_read(int fd, void *buf, size_t count)
 	return total_read;
 }
 
+ssize_t eintr_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	ssize_t bytes_read = 0, total_read = 0;
+	char *ptr = buf;
+	while (total_read < (ssize_t)count) {
+		bytes_read = pread(fd, ptr + total_read, count - total_read,
+				   offset + total_read);
+
+		if (bytes_read < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return bytes_read;
+		} else if (bytes_read == 0) {
+			break;
+		} else {
+			total_read += bytes_read;
+		}
+	}
+	return total_read;
+}
+
 ssize_t eintr_write(int fd, void *buf, size_t count)
 {
 	ssize_t bytes_written = 0, total_written = 0;
@@ -2018,6 +2040,7 @@ struct _fpga_object *alloc_fpga_object(const char *sysfspath, const char *name)
 		obj->path = cstr_dup(sysfspath);
 		obj->name = cstr_dup(name);
 		obj->perm = 0;
+		obj->fd = -1;
 		obj->size = 0;
 		obj->max_size = 0;
 		obj->buffer = NULL;
@@ -2035,6 +2058,10 @@ out_err:
 fpga_result destroy_fpga_object(struct _fpga_object *obj)
 {
 	fpga_result res = FPGA_OK;
+	if (obj->fd >= 0) {
+		close(obj->fd);
+		obj->fd = -1;
+	}
 	FREE_IF(obj->path);
 	FREE_IF(obj->name);
 	FREE_IF(obj->buffer);
@@ -2144,26 +2171,92 @@ out_free:
 	return res;
 }
 
-fpga_result sync_object(fpga_object obj)
+// Read the attribute into the object's buffer. Attributes that are
+// synced after creation are being polled: they keep their fd open and
+// are re-read from offset 0, which makes sysfs regenerate the value.
+// The cached fd and the buffer are guarded by the object lock, so
+// concurrent syncs neither leak an fd nor close one that is in use.
+STATIC fpga_result read_sysfs_object(struct _fpga_object *_obj, bool keep_open)
 {
-	struct _fpga_object *_obj;
-	int fd = -1;
+	fpga_result res = FPGA_OK;
 	ssize_t bytes_read = 0;
-	ASSERT_NOT_NULL(obj);
-	_obj = (struct _fpga_object *)obj;
-	fd = open(_obj->path, _obj->perm);
-	if (fd < 0) {
-		OPAE_ERR("Error opening %s: %s", _obj->path, strerror(errno));
+	int fd;
+
+	if (pthread_mutex_lock(&_obj->lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
 		return FPGA_EXCEPTION;
 	}
-	bytes_read = eintr_read(fd, _obj->buffer, _obj->max_size);
+
+	fd = _obj->fd;
+	if (fd < 0) {
+		fd = open(_obj->path, _obj->perm | O_CLOEXEC);
+		if (fd < 0) {
+			OPAE_ERR("Error opening %s: %s", _obj->path, strerror(errno));
+			res = FPGA_EXCEPTION;
+			goto out_unlock;
+		}
+		if (keep_open)
+			_obj->fd = fd;
+	}
+	bytes_read = eintr_pread(fd, _obj->buffer, _obj->max_size, 0);
 	if (bytes_read < 0) {
+		// The attribute may have gone away with its device.
+		// Reopen on the next sync.
 		close(fd);
-		return FPGA_EXCEPTION;
+		_obj->fd = -1;
+		res = FPGA_EXCEPTION;
+		goto out_unlock;
 	}
 	_obj->size = bytes_read;
-	close(fd);
-	return FPGA_OK;
+	if (fd != _obj->fd)
+		close(fd);
+
+out_unlock:
+	if (pthread_mutex_unlock(&_obj->lock)) {
+		OPAE_ERR("pthread_mutex_unlock() failed");
+		res = FPGA_EXCEPTION;
+	}
+	return res;
+}
+
+fpga_result sync_object(fpga_object obj)
+{
+	ASSERT_NOT_NULL(obj);
+	return read_sysfs_object((struct _fpga_object *)obj, true);
+}
+
+fpga_result sync_object_group(fpga_object obj)
+{
+	struct _fpga_object *_obj;
+	fpga_result res = FPGA_OK;
+	size_t i;
+
+	ASSERT_NOT_NULL(obj);
+	_obj = (struct _fpga_object *)obj;
+
+	if (_obj->type == FPGA_SYSFS_FILE) {
+		if (_obj->perm == O_WRONLY)
+			return FPGA_OK;
+		return read_sysfs_object(_obj, true);
+	}
+
+	if (pthread_mutex_lock(&_obj->lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		return FPGA_EXCEPTION;
+	}
+
+	// Refresh every attribute, reporting the first failure.
+	for (i = 0; i < _obj->size; ++i) {
+		fpga_result r = sync_object_group(_obj->objects[i]);
+		if (r && !res)
+			res = r;
+	}
+
+	if (pthread_mutex_unlock(&_obj->lock)) {
+		OPAE_ERR("pthread_mutex_unlock() failed");
+	}
+
+	return res;
 }
 
 fpga_result make_sysfs_group(char *sysfspath, const char *name,
@@ -2396,7 +2489,7 @@ fpga_result make_sysfs_object(char *sysfspath, const char *name,
 	}
 	*object = (fpga_object)obj;
 	if (obj->perm == O_RDONLY || obj->perm == O_RDWR) {
-		return sync_object((fpga_object)obj);
+		return read_sysfs_object(obj, false);
 	}
 
 	return FPGA_OK;
@@ -123,6 +123,7 @@ fpga_result sysfs_objectid_from_path(const char *sysfspath,
 				     uint64_t *object_id);
 ssize_t eintr_read(int fd, void *buf, size_t count);
 ssize_t eintr_write(int fd, void *buf, size_t count);
+ssize_t eintr_pread(int fd, void *buf, size_t count, off_t offset);
 fpga_result cat_token_sysfs_path(char *dest, fpga_token token,
 				 const char *path);
 fpga_result cat_sysfs_path(char *dest, const char *path);
@@ -131,6 +132,7 @@ fpga_result cat_handle_sysfs_path(char *dest, fpga_handle handle,
 struct _fpga_object *alloc_fpga_object(const char *sysfspath, const char *name);
 fpga_result destroy_fpga_object(struct _fpga_object *obj);
 fpga_result sync_object(fpga_object object);
+fpga_result sync_object_group(fpga_object object);
 fpga_result make_sysfs_group(char *sysfspath, const char *name,
 			     fpga_object *object, int flags, fpga_handle handle);
 fpga_result make_sysfs_object(char *sysfspath, const char *name,
@@ -296,6 +296,11 @@ fpga_result __XFPGA_API__ xfpga_fpgaObjectWrite64(fpga_object obj,
 	if (res != FPGA_OK) {
 		return res;
 	}
+	if (pthread_mutex_lock(&_obj->lock)) {
+		OPAE_ERR("pthread_mutex_lock() failed");
+		res = FPGA_EXCEPTION;
+		goto out_unlock_handle;
+	}
 	if (_obj->max_size) {
 		memset(_obj->buffer, 0, _obj->max_size);
 	}
@@ -307,21 +312,34 @@ fpga_result __XFPGA_API__ xfpga_fpgaObjectWrite64(fpga_object obj,
 			     value);
 		_obj->size = (size_t)strlen((const char *)_obj->buffer);
 	}
-	fd = open(_obj->path, _obj->perm);
+	fd = _obj->fd;
 	if (fd < 0) {
-		OPAE_ERR("Error opening %s: %s", _obj->path, strerror(errno));
-		res = FPGA_EXCEPTION;
-		goto out_unlock;
+		fd = open(_obj->path, _obj->perm | O_CLOEXEC);
+		if (fd < 0) {
+			OPAE_ERR("Error opening %s: %s", _obj->path, strerror(errno));
+			res = FPGA_EXCEPTION;
+			goto out_unlock;
+		}
 	}
 	lseek(fd, 0, SEEK_SET);
 	bytes_written = eintr_write(fd, _obj->buffer, _obj->size);
 	if (bytes_written != _obj->size) {
 		OPAE_ERR("Did not write 64-bit value: %s", strerror(errno));
 		res = FPGA_EXCEPTION;
+		// Don't keep a cached fd that failed; reopen on next use.
+		if (fd == _obj->fd)
+			_obj->fd = -1;
+		close(fd);
+		fd = -1;
 	}
 out_unlock:
-	if (fd >= 0)
+	if (fd >= 0 && fd != _obj->fd)
 		close(fd);
+	if (pthread_mutex_unlock(&_obj->lock)) {
+		OPAE_ERR("pthread_mutex_unlock() failed");
+		res = FPGA_EXCEPTION;
+	}
+out_unlock_handle:
 	err = pthread_mutex_unlock(
 		&((struct _fpga_handle *)_obj->handle)->lock);
 	if (err) {
@@ -331,6 +349,12 @@ out_unlock:
 	return res;
 }
 
+fpga_result __XFPGA_API__ xfpga_fpgaObjectSync(fpga_object obj)
+{
+	ASSERT_NOT_NULL(obj);
+	return sync_object_group(obj);
+}
+
 fpga_result __XFPGA_API__ xfpga_fpgaObjectGetType(fpga_object obj,
 						 enum fpga_sysobject_type *type)
 {
@@ -140,6 +140,8 @@ struct _fpga_enum_metric {
 
 	uint64_t mmio_offset;                            // AFU Metric BBS mmio offset
 
+	uint32_t sensor_num;                             // BMC sensor number
+
 };
 
 
@@ -172,8 +174,25 @@ struct _fpga_handle {
 	void *bmc_handle;                                    // bmc module handle
 	struct _fpga_bmc_metric *_bmc_metric_cache_value;    // bmc cache values
 	uint64_t num_bmc_metric;                             // num of bmc values
+	uint64_t *metric_name_hash;                          // name -> metric_num + 1
+	uint64_t metric_name_hash_size;                      // hash buckets (power of 2)
+	void *bmc_sdr_records;                               // SDRs kept for snapshots
+	int *metric_fds;                                     // max10 value fds, or -1
+	struct fpga_metric *metric_snapshot;                 // last snapshot values
+	uint64_t metric_snapshot_usec;                       // last snapshot time
 #define OPAE_FLAG_HAS_MMX512 (1u << 0)
+#define OPAE_FLAG_UNLOCKED_MMIO (1u << 1)
 	uint32_t flags;
+
+	// MMIO regions mapped so far, indexed by mmio_num. Filled in
+	// when a region is mapped so that MMIO accessors can resolve
+	// the region without a mmio_root lookup.
+#define FPGA_MMIO_CACHE_SIZE 8
+	struct {
+		uint8_t *base;                               // mapped address
+		uint64_t len;                                // region length
+		uint64_t gen;                                // odd while changing
+	} mmio_cache[FPGA_MMIO_CACHE_SIZE];
 };
 
 /*
@@ -233,6 +252,7 @@ struct _fpga_object {
 	char *path;
 	char *name;
 	int perm;
+	int fd; // kept open once the object is synced
 	size_t size;
 	size_t max_size;
 	uint8_t *buffer;
@@ -52,6 +52,10 @@ fpga_result xfpga_fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
 				 uint64_t offset, uint32_t *value);
 fpga_result xfpga_fpgaWriteMMIO512(fpga_handle handle, uint32_t mmio_num,
 				  uint64_t offset, const void *value);
+fpga_result xfpga_fpgaWriteMMIOBatch(fpga_handle handle, uint32_t mmio_num,
+				    const fpga_mmio_op *ops, uint32_t num_ops);
+fpga_result xfpga_fpgaReadMMIOBatch(fpga_handle handle, uint32_t mmio_num,
+				   fpga_mmio_op *ops, uint32_t num_ops);
 fpga_result xfpga_fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
 			      uint64_t **mmio_ptr);
 fpga_result xfpga_fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num);
@@ -119,6 +123,7 @@ fpga_result xfpga_fpgaObjectRead(fpga_object obj, uint8_t *buffer,
 				 size_t offset, size_t len, int flags);
 fpga_result xfpga_fpgaObjectRead64(fpga_object obj, uint64_t *value, int flags);
 fpga_result xfpga_fpgaObjectWrite64(fpga_object obj, uint64_t value, int flags);
+fpga_result xfpga_fpgaObjectSync(fpga_object obj);
 fpga_result xfpga_fpgaSetUserClock(fpga_handle handle, uint64_t low_clk,
 				   uint64_t high_clk, int flags);
 fpga_result xfpga_fpgaGetUserClock(fpga_handle handle, uint64_t *low_clk,
@@ -145,6 +150,12 @@ fpga_result xfpga_fpgaGetMetricsThresholdInfo(fpga_handle handle,
 			metric_threshold *metric_threshold,
 			uint32_t *num_thresholds);
 
+fpga_result xfpga_fpgaGetMetricsSnapshot(fpga_handle handle,
+				    uint64_t max_age_usec,
+				    fpga_metric *metrics,
+				    uint64_t *num_metrics,
+				    uint64_t *timestamp_usec);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -24,7 +24,9 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <future>
 #include <thread>
 #include <ofs/ofs.h>
@@ -156,4 +158,95 @@ TEST(libofs, wait_for_eq_timeout)
 
   delta_usec = wait_test<uint64_t>(ofs_wait_for_eq64, false, modify_usec, timeout_usec);
   EXPECT_GE(delta_usec, timeout_usec);
-}
\ No newline at end of file
+}
+
+/**
+ * @test    wait_adaptive
+ * @brief   Tests: OFS_WAIT_FOR_EQ_ADAPTIVE, OFS_WAIT_FOR_NE_ADAPTIVE,
+ *          ofs_wait_get_stats
+ * @details Have a variable changed in a separate thread before the timeout
+ *          and wait for it with the adaptive macros, then wait on a variable
+ *          that never changes.
+ *          Verify the return status of each wait and that the statistics
+ *          counted two waits, one of which timed out.
+ * */
+TEST(libofs, wait_adaptive)
+{
+  volatile uint32_t bit = 0b101;
+  struct ofs_wait_stats stats;
+
+  ofs_wait_reset_stats();
+  std::future<void> f = std::async(std::launch::async,
+    [&bit]() {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      bit = 0b111;
+    });
+  auto begin = hrc::now();
+  EXPECT_EQ(OFS_WAIT_FOR_EQ_ADAPTIVE(bit, 0b111, 100000), 0);
+  auto end = hrc::now();
+  f.wait();
+  auto delta_usec =
+    std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+  EXPECT_GE(delta_usec, 500);
+  EXPECT_LT(delta_usec, 100000);
+
+  EXPECT_EQ(OFS_WAIT_FOR_NE_ADAPTIVE(bit, 0b111, 200), 1);
+
+  ofs_wait_get_stats(&stats);
+  EXPECT_EQ(stats.waits, 2);
+  EXPECT_EQ(stats.timeouts, 1);
+  uint64_t total = 0;
+  for (int i = 0; i < OFS_WAIT_HIST_BUCKETS; ++i) {
+    total += stats.hist[i];
+  }
+  EXPECT_EQ(total, 2);
+}
+
+/**
+ * @test    wait_policy_snapshot
+ * @brief   Tests: ofs_wait_begin, ofs_wait_set_policy
+ * @details Switch between two wait policies in one thread while another
+ *          begins waits.
+ *          Verify that every wait copied one policy or the other whole,
+ *          and that a policy set during a wait doesn't change it.
+ * */
+TEST(libofs, wait_policy_snapshot)
+{
+  struct ofs_wait_policy saved;
+  const struct ofs_wait_policy a = { 16, 2, 4 };
+  const struct ofs_wait_policy b = { 1024, 32, 512 };
+  std::atomic<bool> stop(false);
+  struct ofs_wait_state ws;
+
+  ofs_wait_get_policy(&saved);
+  ofs_wait_set_policy(&a);
+
+  std::thread setter([&]() {
+    while (!stop) {
+      ofs_wait_set_policy(&a);
+      ofs_wait_set_policy(&b);
+    }
+  });
+
+  int torn = 0;
+  for (int i = 0; i < 100000; ++i) {
+    ofs_wait_begin(&ws);
+    if (memcmp(&ws.policy, &a, sizeof(a)) &&
+        memcmp(&ws.policy, &b, sizeof(b)))
+      ++torn;
+    else if (ws.sleep_usec != ws.policy.backoff_min_usec)
+      ++torn;
+  }
+
+  stop = true;
+  setter.join();
+  EXPECT_EQ(torn, 0);
+
+  ofs_wait_set_policy(&a);
+  ofs_wait_begin(&ws);
+  ofs_wait_set_policy(&b);
+  EXPECT_EQ(0, memcmp(&ws.policy, &a, sizeof(a)));
+  ofs_wait_end(&ws, 0);
+
+  ofs_wait_set_policy(&saved);
+}
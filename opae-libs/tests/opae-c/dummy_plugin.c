@@ -152,6 +152,8 @@ int __attribute__((visibility("default"))) opae_plugin_configure(opae_api_adapte
 	adapter->fpgaWriteMMIO32 = NULL;
 	adapter->fpgaReadMMIO32 = NULL;
 	adapter->fpgaWriteMMIO512 = NULL;
+	adapter->fpgaWriteMMIOBatch = NULL;
+	adapter->fpgaReadMMIOBatch = NULL;
 	adapter->fpgaMapMMIO = NULL;
 	adapter->fpgaUnmapMMIO = NULL;
 	adapter->fpgaCloneToken = NULL;
@@ -188,12 +190,14 @@ int __attribute__((visibility("default"))) opae_plugin_configure(opae_api_adapte
 	adapter->fpgaObjectRead64 = NULL;
 	adapter->fpgaObjectGetSize = NULL;
 	adapter->fpgaObjectWrite64 = NULL;
+	adapter->fpgaObjectSync = NULL;
 	adapter->fpgaSetUserClock = NULL;
 	adapter->fpgaGetUserClock = NULL;
 	adapter->fpgaGetNumMetrics = NULL;
 	adapter->fpgaGetMetricsInfo = NULL;
 	adapter->fpgaGetMetricsByIndex = NULL;
 	adapter->fpgaGetMetricsByName = NULL;
+	adapter->fpgaGetMetricsSnapshot = NULL;
 	json_object_put(root);
 	return 0;
 }
@@ -0,0 +1,162 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <opae/fpga.h>
+
+/*
+ * Process start-up cost of libopae-c with eager and lazy plugin loading.
+ * Each sample re-executes this benchmark as a child and times it from
+ * fork() to exit. A child either exits at once ("exit": the cost paid by
+ * tools that never touch hardware) or after one fpgaEnumerate() ("enum":
+ * time to first result). The last scenario limits lazy loading to the
+ * vfio plugin class.
+ */
+
+#define DEFAULT_ITERATIONS 50
+
+static double now_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int child(const char *action)
+{
+	uint32_t num_matches = 0;
+
+	if (!strcmp(action, "enum") &&
+	    fpgaEnumerate(NULL, 0, NULL, 0, &num_matches) != FPGA_OK)
+		return 1;
+
+	return 0;
+}
+
+static int run(const char *name, const char *action,
+	       const char *eager, const char *classes,
+	       unsigned long iterations)
+{
+	char *args[] = { "startup_bench", "--child", (char *)action, NULL };
+	double *lat;
+	double total = 0.0;
+	unsigned long i;
+	pid_t pid;
+	int status;
+
+	lat = calloc(iterations, sizeof(double));
+	if (!lat)
+		return 1;
+
+	for (i = 0 ; i < iterations ; ++i) {
+		double start = now_usec();
+
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			free(lat);
+			return 1;
+		}
+
+		if (!pid) {
+			unsetenv("OPAE_EXPLICIT_INITIALIZE");
+			if (eager)
+				setenv("OPAE_EAGER_INITIALIZE", eager, 1);
+			else
+				unsetenv("OPAE_EAGER_INITIALIZE");
+			if (classes)
+				setenv("LIBOPAE_PLUGIN_CLASSES", classes, 1);
+			else
+				unsetenv("LIBOPAE_PLUGIN_CLASSES");
+			execv("/proc/self/exe", args);
+			perror("execv");
+			_exit(1);
+		}
+
+		if (waitpid(pid, &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status)) {
+			printf("%s: child failed\n", name);
+			free(lat);
+			return 1;
+		}
+
+		lat[i] = now_usec() - start;
+		total += lat[i];
+	}
+
+	qsort(lat, iterations, sizeof(double), cmp_double);
+
+	printf("%-10s %-6s %12.1f %12.1f %12.1f\n",
+	       name, action, total / iterations / 1e3,
+	       lat[iterations / 2] / 1e3,
+	       lat[(iterations * 99) / 100] / 1e3);
+
+	free(lat);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long iterations = DEFAULT_ITERATIONS;
+	int res = 0;
+
+	if (argc > 2 && !strcmp(argv[1], "--child"))
+		return child(argv[2]);
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (!iterations) {
+		printf("usage: opae_startup_bench [iterations]\n");
+		return 1;
+	}
+
+	printf("%-10s %-6s %12s %12s %12s\n",
+	       "loading", "child", "mean ms", "p50 ms", "p99 ms");
+
+	res |= run("eager", "exit", "1", NULL, iterations);
+	res |= run("lazy", "exit", NULL, NULL, iterations);
+	res |= run("eager", "enum", "1", NULL, iterations);
+	res |= run("lazy", "enum", NULL, NULL, iterations);
+	res |= run("lazy/vfio", "enum", NULL, "vfio", iterations);
+
+	return res;
+}
@@ -34,9 +34,13 @@ extern "C" {
 #include <opae/fpga.h>
 #include <uuid/uuid.h>
 #include "opae_int.h"
+#include "adapter.h"
 #include "intel-fpga.h"
 #include "fpga-dfl.h"
 
+extern bool opae_parallel_enum;
+extern opae_api_adapter_table *adapter_list;
+
 #ifdef __cplusplus
 }
 #endif
@@ -330,6 +334,213 @@ TEST_P(enum_c_p, parent) {
   EXPECT_EQ(fpgaDestroyToken(&tok), FPGA_OK);
 }
 
+/**
+ * @test       parallel_nullfilter
+ * @brief      Test: fpgaEnumerate
+ * @details    When parallel enumeration is enabled,<br>
+ *             fpgaEnumerate returns the same tokens in the same<br>
+ *             order as the sequential walk.<br>
+ */
+TEST_P(enum_c_p, parallel_nullfilter) {
+  std::array<fpga_token, 2> serial = {{nullptr, nullptr}};
+  std::array<fpga_token, 2> parallel = {{nullptr, nullptr}};
+  uint32_t serial_matches = 0;
+  uint32_t parallel_matches = 0;
+
+  ASSERT_EQ(fpgaEnumerate(nullptr, 0, serial.data(), serial.size(),
+                          &serial_matches), FPGA_OK);
+
+  opae_parallel_enum = true;
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, parallel.data(), parallel.size(),
+                          &parallel_matches), FPGA_OK);
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, nullptr, 0, &num_matches_), FPGA_OK);
+  opae_parallel_enum = false;
+
+  EXPECT_EQ(parallel_matches, serial_matches);
+  EXPECT_EQ(num_matches_, serial_matches);
+
+  for (size_t i = 0; i < serial.size() && i < serial_matches; ++i) {
+    fpga_properties sp = nullptr;
+    fpga_properties pp = nullptr;
+    fpga_objtype st, pt;
+    ASSERT_EQ(fpgaGetProperties(serial[i], &sp), FPGA_OK);
+    ASSERT_EQ(fpgaGetProperties(parallel[i], &pp), FPGA_OK);
+    EXPECT_EQ(fpgaPropertiesGetObjectType(sp, &st), FPGA_OK);
+    EXPECT_EQ(fpgaPropertiesGetObjectType(pp, &pt), FPGA_OK);
+    EXPECT_EQ(st, pt);
+    EXPECT_EQ(fpgaDestroyProperties(&sp), FPGA_OK);
+    EXPECT_EQ(fpgaDestroyProperties(&pp), FPGA_OK);
+    EXPECT_EQ(fpgaDestroyToken(&serial[i]), FPGA_OK);
+    EXPECT_EQ(fpgaDestroyToken(&parallel[i]), FPGA_OK);
+  }
+}
+
+/**
+ * @test       parallel_parent
+ * @brief      Test: fpgaEnumerate
+ * @details    When parallel enumeration is enabled and the filter<br>
+ *             holds a wrapped parent token,<br>
+ *             fpgaEnumerate unwraps it for each plugin and<br>
+ *             restores it afterwards.<br>
+ */
+TEST_P(enum_c_p, parallel_parent) {
+  EXPECT_EQ(fpgaPropertiesSetObjectType(filter_, FPGA_DEVICE), FPGA_OK);
+  EXPECT_EQ(
+      fpgaEnumerate(&filter_, 1, tokens_.data(), tokens_.size(), &num_matches_),
+      FPGA_OK);
+  ASSERT_GT(num_matches_, 0);
+
+  fpga_token tok = nullptr;
+  ASSERT_EQ(fpgaCloneToken(tokens_[0], &tok), FPGA_OK);
+
+  DestroyTokens();
+
+  ASSERT_EQ(fpgaClearProperties(filter_), FPGA_OK);
+  EXPECT_EQ(fpgaPropertiesSetParent(filter_, tok), FPGA_OK);
+
+  opae_parallel_enum = true;
+  EXPECT_EQ(
+      fpgaEnumerate(&filter_, 1, tokens_.data(), tokens_.size(), &num_matches_),
+      FPGA_OK);
+  opae_parallel_enum = false;
+  EXPECT_EQ(num_matches_, 1);
+
+  fpga_token parent = nullptr;
+  EXPECT_EQ(fpgaPropertiesGetParent(filter_, &parent), FPGA_OK);
+  EXPECT_EQ(parent, tok);
+  EXPECT_EQ(fpgaDestroyToken(&tok), FPGA_OK);
+}
+
+// Fake adapters for the parallel merge: adapter i reports
+// faux_counts[i] tokens, each the address of faux_tokens[i][j].
+static int faux_tokens[3][3];
+static uint32_t faux_counts[3] = { 2, 3, 1 };
+static fpga_result faux_results[3] = { FPGA_OK, FPGA_OK, FPGA_OK };
+static uint32_t faux_destroyed;
+
+static fpga_result faux_enumerate(uint32_t i, fpga_token *tokens,
+                                  uint32_t max_tokens, uint32_t *num_matches) {
+  if (faux_results[i] != FPGA_OK)
+    return faux_results[i];
+  for (uint32_t j = 0; tokens && j < max_tokens && j < faux_counts[i]; ++j)
+    tokens[j] = &faux_tokens[i][j];
+  *num_matches = faux_counts[i];
+  return FPGA_OK;
+}
+
+static fpga_result faux_enumerate0(const fpga_properties *, uint32_t,
+                                   fpga_token *tokens, uint32_t max_tokens,
+                                   uint32_t *num_matches) {
+  return faux_enumerate(0, tokens, max_tokens, num_matches);
+}
+
+static fpga_result faux_enumerate1(const fpga_properties *, uint32_t,
+                                   fpga_token *tokens, uint32_t max_tokens,
+                                   uint32_t *num_matches) {
+  return faux_enumerate(1, tokens, max_tokens, num_matches);
+}
+
+static fpga_result faux_enumerate2(const fpga_properties *, uint32_t,
+                                   fpga_token *tokens, uint32_t max_tokens,
+                                   uint32_t *num_matches) {
+  return faux_enumerate(2, tokens, max_tokens, num_matches);
+}
+
+static fpga_result faux_destroy_token(fpga_token *token) {
+  *token = nullptr;
+  ++faux_destroyed;
+  return FPGA_OK;
+}
+
+/**
+ * @test       parallel_adapters
+ * @brief      Test: fpgaEnumerate
+ * @details    When parallel enumeration is enabled and several<br>
+ *             adapters are registered, fpgaEnumerate merges their<br>
+ *             tokens in adapter list order, counts the matches of<br>
+ *             every adapter visited before the token array filled,<br>
+ *             destroys the tokens that did not fit, and returns<br>
+ *             FPGA_EXCEPTION when an adapter fails.<br>
+ */
+TEST_P(enum_c_p, parallel_adapters) {
+  std::array<opae_api_adapter_table, 3> faux;
+  std::array<fpga_token, 8> tokens = {{}};
+  opae_api_adapter_table *saved = adapter_list;
+
+  memset(faux.data(), 0, sizeof(faux));
+  faux[0].fpgaEnumerate = faux_enumerate0;
+  faux[1].fpgaEnumerate = faux_enumerate1;
+  faux[2].fpgaEnumerate = faux_enumerate2;
+  for (size_t i = 0; i < faux.size(); ++i) {
+    faux[i].plugin.path = (char *)"faux";
+    faux[i].fpgaDestroyToken = faux_destroy_token;
+    faux[i].next = i + 1 < faux.size() ? &faux[i + 1] : nullptr;
+  }
+  adapter_list = &faux[0];
+  opae_parallel_enum = true;
+
+  // Everything fits: 2 + 3 + 1 tokens, in adapter order.
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, tokens.data(), tokens.size(),
+                          &num_matches_), FPGA_OK);
+  EXPECT_EQ(num_matches_, 6);
+  const std::array<std::pair<size_t, size_t>, 6> order = {{
+    {0, 0}, {0, 1}, {1, 0}, {1, 1}, {1, 2}, {2, 0}
+  }};
+  for (size_t k = 0; k < order.size(); ++k) {
+    opae_wrapped_token *wt = opae_validate_wrapped_token(tokens[k]);
+    EXPECT_NE(wt, nullptr);
+    if (!wt)
+      continue;
+    EXPECT_EQ(wt->opae_token, &faux_tokens[order[k].first][order[k].second]);
+    EXPECT_EQ(wt->adapter_table, &faux[order[k].first]);
+  }
+  for (size_t k = 0; k < order.size(); ++k)
+    EXPECT_EQ(fpgaDestroyToken(&tokens[k]), FPGA_OK);
+
+  // Count only.
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, nullptr, 0, &num_matches_), FPGA_OK);
+  EXPECT_EQ(num_matches_, 6);
+
+  // Room for three: the third adapter is not counted and the
+  // tokens that did not fit are destroyed.
+  faux_destroyed = 0;
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, tokens.data(), 3, &num_matches_),
+            FPGA_OK);
+  EXPECT_EQ(num_matches_, 5);
+  EXPECT_EQ(faux_destroyed, 3);
+  for (size_t k = 0; k < 3; ++k) {
+    opae_wrapped_token *wt = opae_validate_wrapped_token(tokens[k]);
+    EXPECT_NE(wt, nullptr);
+    if (!wt)
+      continue;
+    EXPECT_EQ(wt->opae_token, &faux_tokens[order[k].first][order[k].second]);
+    EXPECT_EQ(fpgaDestroyToken(&tokens[k]), FPGA_OK);
+  }
+
+  // A failing adapter is reported; the others still return tokens.
+  faux_results[1] = FPGA_NO_DRIVER;
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, tokens.data(), tokens.size(),
+                          &num_matches_), FPGA_EXCEPTION);
+  faux_results[1] = FPGA_OK;
+  EXPECT_EQ(num_matches_, 3);
+  const std::array<std::pair<size_t, size_t>, 3> partial = {{
+    {0, 0}, {0, 1}, {2, 0}
+  }};
+  for (size_t k = 0; k < partial.size(); ++k) {
+    opae_wrapped_token *wt = opae_validate_wrapped_token(tokens[k]);
+    EXPECT_NE(wt, nullptr);
+    if (!wt)
+      continue;
+    EXPECT_EQ(wt->opae_token,
+              &faux_tokens[partial[k].first][partial[k].second]);
+    EXPECT_EQ(wt->adapter_table, &faux[partial[k].first]);
+    EXPECT_EQ(fpgaDestroyToken(&tokens[k]), FPGA_OK);
+  }
+
+  opae_parallel_enum = false;
+  adapter_list = saved;
+}
+
 TEST_P(enum_c_p, segment) {
   auto device = platform_.devices[0];
 
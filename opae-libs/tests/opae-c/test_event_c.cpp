@@ -34,6 +34,7 @@ extern "C" {
 #include <linux/ioctl.h>
 
 #include <array>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <chrono>
@@ -228,6 +229,100 @@ TEST_P(event_c_p, destroy_err) {
 			  event_handle_), FPGA_OK);
 }
 
+/**
+ * @test       event_loop
+ * @brief      Test: fpgaCreateEventLoop, fpgaEventLoopAdd,
+ *             fpgaEventLoopGetStats, fpgaEventLoopRemove,
+ *             fpgaDestroyEventLoop
+ * @details    Given a registered event handle added to an event loop,<br>
+ *             when its OS object is signaled three times,<br>
+ *             the callback observes all three signals and the loop<br>
+ *             statistics account for them.<br>
+ */
+TEST_P(event_c_p, event_loop) {
+  fpga_event_loop loop = nullptr;
+  std::atomic<uint64_t> seen(0);
+  uint64_t one = 1;
+  int fd = -1;
+
+  ASSERT_EQ(fpgaRegisterEvent(accel_, FPGA_EVENT_ERROR,
+                              event_handle_, 0), FPGA_OK);
+  ASSERT_EQ(fpgaGetOSObjectFromEventHandle(event_handle_, &fd), FPGA_OK);
+
+  ASSERT_EQ(fpgaCreateEventLoop(2, &loop), FPGA_OK);
+  auto cb = [](fpga_event_handle, uint64_t count, void *context) {
+    *reinterpret_cast<std::atomic<uint64_t>*>(context) += count;
+  };
+  EXPECT_EQ(fpgaEventLoopAdd(loop, event_handle_, cb, &seen), FPGA_OK);
+  EXPECT_EQ(fpgaEventLoopAdd(loop, event_handle_, cb, &seen), FPGA_BUSY);
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(write(fd, &one, sizeof(one)), (ssize_t)sizeof(one));
+  }
+  for (int i = 0; i < 1000 && seen < 3; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(seen, 3);
+
+  struct fpga_event_loop_stats stats;
+  EXPECT_EQ(fpgaEventLoopGetStats(loop, &stats), FPGA_OK);
+  EXPECT_EQ(stats.interrupts, 3);
+  EXPECT_EQ(stats.dispatches + stats.coalesced, 3);
+  EXPECT_GE(stats.wakeups, 1);
+
+  EXPECT_EQ(fpgaEventLoopRemove(loop, event_handle_), FPGA_OK);
+  EXPECT_EQ(fpgaEventLoopRemove(loop, event_handle_), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaDestroyEventLoop(&loop), FPGA_OK);
+  EXPECT_EQ(loop, nullptr);
+
+  EXPECT_EQ(fpgaUnregisterEvent(accel_, FPGA_EVENT_ERROR,
+			  event_handle_), FPGA_OK);
+}
+
+/**
+ * @test       event_loop_destroy_in_cb
+ * @brief      Test: fpgaDestroyEventLoop
+ * @details    When fpgaDestroyEventLoop is called from a callback<br>
+ *             running on the loop's own dispatch thread,<br>
+ *             the fn returns FPGA_BUSY and leaves the loop intact.<br>
+ */
+TEST_P(event_c_p, event_loop_destroy_in_cb) {
+  struct destroy_ctx {
+    fpga_event_loop loop;
+    std::atomic<int> result;
+  } ctx;
+  uint64_t one = 1;
+  int fd = -1;
+
+  ctx.loop = nullptr;
+  ctx.result = -1;
+
+  ASSERT_EQ(fpgaRegisterEvent(accel_, FPGA_EVENT_ERROR,
+                              event_handle_, 0), FPGA_OK);
+  ASSERT_EQ(fpgaGetOSObjectFromEventHandle(event_handle_, &fd), FPGA_OK);
+
+  ASSERT_EQ(fpgaCreateEventLoop(1, &ctx.loop), FPGA_OK);
+  auto cb = [](fpga_event_handle, uint64_t, void *context) {
+    destroy_ctx *c = reinterpret_cast<destroy_ctx*>(context);
+    fpga_event_loop l = c->loop;
+    c->result = fpgaDestroyEventLoop(&l);
+  };
+  EXPECT_EQ(fpgaEventLoopAdd(ctx.loop, event_handle_, cb, &ctx), FPGA_OK);
+
+  ASSERT_EQ(write(fd, &one, sizeof(one)), (ssize_t)sizeof(one));
+  for (int i = 0; i < 1000 && ctx.result < 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(ctx.result, FPGA_BUSY);
+
+  EXPECT_EQ(fpgaEventLoopRemove(ctx.loop, event_handle_), FPGA_OK);
+  EXPECT_EQ(fpgaDestroyEventLoop(&ctx.loop), FPGA_OK);
+  EXPECT_EQ(ctx.loop, nullptr);
+
+  EXPECT_EQ(fpgaUnregisterEvent(accel_, FPGA_EVENT_ERROR,
+			  event_handle_), FPGA_OK);
+}
+
 INSTANTIATE_TEST_CASE_P(event_c, event_c_p, 
                         ::testing::ValuesIn(test_platform::platforms({})));
 
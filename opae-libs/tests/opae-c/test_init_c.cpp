@@ -33,6 +33,7 @@ extern "C" {
 char *find_ase_cfg();
 void opae_init(void);
 void opae_release(void);
+extern bool g_log_async;
 
 #define HOME_CFG_PATHS 3
 const char *_ase_home_configs[HOME_CFG_PATHS] = {
@@ -53,6 +54,8 @@ const char *_ase_home_configs[HOME_CFG_PATHS] = {
 #include <string>
 #include <vector>
 #include <stack>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "gtest/gtest.h"
 #include "mock/test_system.h"
 
@@ -176,6 +179,104 @@ TEST(init, log_file) {
   unlink("opae_log.log");
 }
 
+/**
+ * @test       log_async
+ *
+ * @brief      When LIBOPAE_LOG_ASYNC is set, messages are queued and
+ *             written by the log thread, all of them are out after
+ *             fpgaFinalize, and runs of identical messages are cut at
+ *             LIBOPAE_LOG_RATELIMIT copies.
+ */
+TEST(init, log_async) {
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_ASYNC=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_RATELIMIT=5"));
+  opae_init();
+  testing::internal::CaptureStdout();
+
+  for (int i = 0; i < 20; ++i) {
+    opae_print(OPAE_LOG_MESSAGE, "Repeated log.\n");
+  }
+  OPAE_MSG("Message log.");
+  fpgaFinalize();
+
+  std::string log_stdout = testing::internal::GetCapturedStdout();
+
+  size_t copies = 0;
+  for (size_t pos = log_stdout.find("Repeated log.");
+       pos != std::string::npos;
+       pos = log_stdout.find("Repeated log.", pos + 1)) {
+    ++copies;
+  }
+  EXPECT_EQ(copies, 5);
+  EXPECT_TRUE(log_stdout.find("repeated 15 more times") != std::string::npos);
+  EXPECT_TRUE(log_stdout.find("Message log.") != std::string::npos);
+
+  opae_release();
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_RATELIMIT"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_ASYNC"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
+}
+
+/**
+ * @test       log_async_ratelimit_idle
+ *
+ * @brief      When a run of identical messages is cut by
+ *             LIBOPAE_LOG_RATELIMIT and the thread logs nothing else,
+ *             the log thread still writes the suppressed-copies summary.
+ */
+TEST(init, log_async_ratelimit_idle) {
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_ASYNC=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_RATELIMIT=5"));
+  opae_init();
+  testing::internal::CaptureStdout();
+
+  for (int i = 0; i < 20; ++i) {
+    opae_print(OPAE_LOG_MESSAGE, "Repeated log.\n");
+  }
+  // two idle passes of the log thread report the run
+  usleep(50000);
+  std::string log_stdout = testing::internal::GetCapturedStdout();
+
+  EXPECT_TRUE(log_stdout.find("repeated 15 more times") != std::string::npos);
+
+  opae_release();
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_RATELIMIT"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_ASYNC"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
+}
+
+/**
+ * @test       log_async_fork
+ *
+ * @brief      When a process using LIBOPAE_LOG_ASYNC forks,
+ *             the child has no log thread and logs synchronously.
+ */
+TEST(init, log_async_fork) {
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_ASYNC=1"));
+  opae_init();
+  ASSERT_TRUE(g_log_async);
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (!pid) {
+    opae_print(OPAE_LOG_MESSAGE, "Message from child.\n");
+    _exit(g_log_async ? 1 : 0);
+  }
+
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_TRUE(g_log_async);
+
+  opae_release();
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_ASYNC"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
+}
+
 /**
  * @test       find_ase_cfg
  *
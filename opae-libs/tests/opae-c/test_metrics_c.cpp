@@ -142,6 +142,25 @@ TEST_P(metrics_c_p, by_name0) {
   free(metrics);
 }
 
+/**
+ * @test       snapshot0
+ * @brief      Test: fpgaGetMetricsSnapshot
+ * @details    When fpgaGetMetricsSnapshot is called with valid params,<br>
+ *             then the fn fails because the AFU metrics BBB is not found.<br>
+ */
+TEST_P(metrics_c_p, snapshot0) {
+  uint64_t num_metrics = 4;
+  uint64_t timestamp = 0;
+  struct fpga_metric metrics[4];
+
+  EXPECT_NE(fpgaGetMetricsSnapshot(accel_,
+                                   0,
+                                   metrics,
+                                   &num_metrics,
+                                   &timestamp),
+            FPGA_OK);
+}
+
 /**
  * @test       threshold0
  * @brief      Test: fpgaGetMetricsThresholdInfo
@@ -178,6 +178,51 @@ TEST_P(mmio_c_p, mmio32) {
   EXPECT_EQ(val_written, val_read);
 }
 
+/**
+ * @test       mmio_batch
+ * @brief      Test: fpgaWriteMMIOBatch, fpgaReadMMIOBatch
+ * @details    Write a 64-bit and a 32-bit scratchpad register with one
+ *             fpgaWriteMMIOBatch call, read both back with one
+ *             fpgaReadMMIOBatch call.<br>
+ *             Values written should equal values read.<br>
+ */
+TEST_P(mmio_c_p, mmio_batch) {
+  fpga_mmio_op wr[2] = {
+    { CSR_SCRATCHPAD0, 0xdeadbeefdecafbad, sizeof(uint64_t) },
+    { CSR_SCRATCHPAD0 + 8, 0xc0cac01a, sizeof(uint32_t) }
+  };
+  fpga_mmio_op rd[2] = {
+    { CSR_SCRATCHPAD0, 0, sizeof(uint64_t) },
+    { CSR_SCRATCHPAD0 + 8, 0, sizeof(uint32_t) }
+  };
+
+  EXPECT_EQ(fpgaWriteMMIOBatch(accel_, which_mmio_, wr, 2), FPGA_OK);
+  EXPECT_EQ(fpgaReadMMIOBatch(accel_, which_mmio_, rd, 2), FPGA_OK);
+  EXPECT_EQ(wr[0].value, rd[0].value);
+  EXPECT_EQ(wr[1].value, rd[1].value);
+}
+
+/**
+ * @test       mmio_batch_neg
+ * @brief      Test: fpgaWriteMMIOBatch, fpgaReadMMIOBatch
+ * @details    When an op has an unsupported width or a misaligned
+ *             offset, or ops is NULL,<br>
+ *             the batch calls return FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(mmio_c_p, mmio_batch_neg) {
+  fpga_mmio_op bad_width = { CSR_SCRATCHPAD0, 0, 2 };
+  fpga_mmio_op misaligned = { CSR_SCRATCHPAD0 + 4, 0, sizeof(uint64_t) };
+
+  EXPECT_EQ(fpgaWriteMMIOBatch(accel_, which_mmio_, &bad_width, 1),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaReadMMIOBatch(accel_, which_mmio_, &misaligned, 1),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWriteMMIOBatch(accel_, which_mmio_, nullptr, 1),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaReadMMIOBatch(nullptr, which_mmio_, &misaligned, 1),
+            FPGA_INVALID_PARAM);
+}
+
 /**
  * @test       mmio512
  * @brief      Test: fpgaWriteMMIO512
@@ -155,6 +155,23 @@ TEST_P(object_c_p, obj_read64) {
   EXPECT_EQ(val, 1ul);
 }
 
+/**
+ * @test       obj_sync
+ * @brief      Test: fpgaObjectSync
+ * @details    When fpgaObjectSync is called with a valid object,<br>
+ *             the fn refreshes its buffered copy<br>
+ *             and returns FPGA_OK.<br>
+ */
+TEST_P(object_c_p, obj_sync) {
+  char afu_id[33];
+  EXPECT_EQ(fpgaObjectSync(handle_obj_), FPGA_OK);
+  EXPECT_EQ(fpgaObjectRead(handle_obj_, (uint8_t *) afu_id, 0,
+                           32, 0), FPGA_OK);
+  afu_id[32] = 0;
+  EXPECT_STREQ(afu_id, afu_guid_.c_str());
+  EXPECT_EQ(fpgaObjectSync(nullptr), FPGA_INVALID_PARAM);
+}
+
 /**
  * @test       obj_write64
  * @brief      Test: fpgaObjectWrite64
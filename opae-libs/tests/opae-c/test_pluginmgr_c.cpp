@@ -43,6 +43,8 @@ int opae_plugin_mgr_configure_plugin(opae_api_adapter_table *adapter,
 int process_cfg_buffer(const char *buffer, const char *filename);
 extern opae_api_adapter_table *adapter_list;
 int opae_plugin_mgr_finalize_all(void);
+uint32_t opae_plugin_mgr_parse_classes(const char *list);
+uint32_t opae_plugin_mgr_plugin_class(const char *plugin);
 }
 
 #include <config.h>
@@ -110,6 +112,47 @@ TEST(pluginmgr, config_err) {
   EXPECT_EQ(0, opae_plugin_mgr_free_adapter(at));
 }
 
+/**
+ * @test       plugin_classes
+ * @brief      Test: opae_plugin_mgr_parse_classes
+ * @details    Class lists from LIBOPAE_PLUGIN_CLASSES are parsed into
+ *             a mask, unknown names are ignored,<br>
+ *             and plugins that aren't in the platform table belong
+ *             to every class.<br>
+ */
+TEST(pluginmgr, plugin_classes) {
+  EXPECT_EQ(OPAE_PLUGIN_CLASS_VFIO, opae_plugin_mgr_parse_classes("vfio"));
+  EXPECT_EQ(OPAE_PLUGIN_CLASS_DFL | OPAE_PLUGIN_CLASS_VFIO,
+            opae_plugin_mgr_parse_classes("dfl,vfio"));
+  EXPECT_EQ(OPAE_PLUGIN_CLASS_DFL, opae_plugin_mgr_parse_classes("dfl,bogus"));
+  EXPECT_EQ(0, opae_plugin_mgr_parse_classes(""));
+
+  EXPECT_EQ(OPAE_PLUGIN_CLASS_DFL,
+            opae_plugin_mgr_plugin_class("libxfpga.so"));
+  EXPECT_EQ(OPAE_PLUGIN_CLASS_VFIO,
+            opae_plugin_mgr_plugin_class("libopae-v.so"));
+  EXPECT_EQ(OPAE_PLUGIN_CLASS_ALL,
+            opae_plugin_mgr_plugin_class("libdummy_plugin.so"));
+}
+
+/**
+ * @test       no_reload_after_finalize
+ * @brief      Test: opae_plugin_mgr_initialize_once
+ * @details    When plugins are loaded on demand and the application<br>
+ *             has called fpgaFinalize,<br>
+ *             later API calls do not load the plugins again.<br>
+ */
+TEST(pluginmgr, no_reload_after_finalize) {
+  uint32_t matches = 1;
+  opae_plugin_mgr_set_init_mode(OPAE_PLUGIN_MGR_INIT_LAZY);
+  EXPECT_EQ(FPGA_OK, fpgaFinalize());
+  EXPECT_EQ(-1, opae_plugin_mgr_initialize_once());
+  EXPECT_EQ(FPGA_OK, fpgaEnumerate(nullptr, 0, nullptr, 0, &matches));
+  EXPECT_EQ(0, matches);
+  EXPECT_EQ(0, opae_plugin_mgr_adapter_count());
+  EXPECT_EQ(nullptr, adapter_list);
+}
+
 extern "C" {
 
 static int test_plugin_initialize_called;
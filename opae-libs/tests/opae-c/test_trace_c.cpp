@@ -0,0 +1,187 @@
+// Copyright(c) 2023-2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <opae/fpga.h>
+#include "opae_int.h"
+#include "adapter.h"
+#include "api_trace.h"
+
+extern "C" {
+uint32_t trace_bucket(uint64_t nsec);
+uint64_t trace_bucket_low(uint32_t bucket);
+uint64_t trace_bucket_width(uint32_t bucket);
+}
+
+static fpga_result trace_read64(fpga_handle handle, uint32_t mmio_num,
+                                uint64_t offset, uint64_t *value) {
+  (void)handle;
+  (void)mmio_num;
+  *value = offset;
+  return offset & 1 ? FPGA_EXCEPTION : FPGA_OK;
+}
+
+class trace_c : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    memset(&adapter_, 0, sizeof(adapter_));
+    adapter_.fpgaReadMMIO64 = trace_read64;
+    adapter_.trace_id = opae_trace_plugin_id("/usr/lib/libtrace_test.so");
+    fpgaTraceReset();
+    fpgaTraceEnable(true);
+  }
+
+  virtual void TearDown() override {
+    fpgaTraceEnable(false);
+    fpgaTraceReset();
+  }
+
+  fpga_result read64(uint64_t offset) {
+    uint64_t value = 0;
+    return OPAE_TRACE_CALL(&adapter_, fpgaReadMMIO64,
+                           nullptr, 0, offset, &value);
+  }
+
+  opae_api_adapter_table adapter_;
+};
+
+/**
+ * @test       bucket
+ * @brief      Every value falls inside the bucket it maps to, and
+ *             buckets are contiguous.
+ */
+TEST_F(trace_c, bucket) {
+  for (uint64_t v = 0; v < (1ULL << 40); v = v * 3 / 2 + 1) {
+    uint32_t b = trace_bucket(v);
+    EXPECT_LE(trace_bucket_low(b), v);
+    EXPECT_GT(trace_bucket_low(b) + trace_bucket_width(b), v);
+    if (b > 0) {
+      EXPECT_EQ(trace_bucket_low(b - 1) + trace_bucket_width(b - 1),
+                trace_bucket_low(b));
+    }
+  }
+}
+
+/**
+ * @test       disabled
+ * @brief      Nothing is recorded while tracing is off.
+ */
+TEST_F(trace_c, disabled) {
+  struct fpga_trace_stats stats;
+  fpgaTraceEnable(false);
+  EXPECT_EQ(read64(0), FPGA_OK);
+  EXPECT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaReadMMIO64", &stats),
+            FPGA_NOT_FOUND);
+}
+
+/**
+ * @test       stats
+ * @brief      Calls are counted per API and plugin, failures are counted
+ *             as errors, and the percentiles are ordered.
+ */
+TEST_F(trace_c, stats) {
+  struct fpga_trace_stats stats;
+  for (uint64_t i = 0; i < 100; ++i) {
+    read64(i);
+  }
+
+  ASSERT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaReadMMIO64", &stats),
+            FPGA_OK);
+  EXPECT_EQ(stats.count, 100);
+  EXPECT_EQ(stats.errors, 50);
+  EXPECT_LE(stats.min_nsec, stats.p50_nsec);
+  EXPECT_LE(stats.p50_nsec, stats.p90_nsec);
+  EXPECT_LE(stats.p90_nsec, stats.p99_nsec);
+  EXPECT_LE(stats.p99_nsec, stats.p999_nsec);
+  EXPECT_LE(stats.p999_nsec, stats.max_nsec);
+  EXPECT_LE(stats.mean_nsec, stats.max_nsec);
+
+  ASSERT_EQ(fpgaTraceGetStats(nullptr, "fpgaReadMMIO64", &stats), FPGA_OK);
+  EXPECT_EQ(stats.count, 100);
+
+  EXPECT_EQ(fpgaTraceGetStats("libother.so", "fpgaReadMMIO64", &stats),
+            FPGA_NOT_FOUND);
+  EXPECT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaWriteMMIO64", &stats),
+            FPGA_NOT_FOUND);
+  EXPECT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaNoSuchApi", &stats),
+            FPGA_NOT_FOUND);
+  EXPECT_EQ(fpgaTraceGetStats(nullptr, nullptr, &stats), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaTraceGetStats(nullptr, "fpgaReadMMIO64", nullptr),
+            FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test       threads
+ * @brief      Calls from several threads are merged, and fpgaTraceReset
+ *             discards them.
+ */
+TEST_F(trace_c, threads) {
+  struct fpga_trace_stats stats;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([this] {
+      for (uint64_t i = 0; i < 1000; ++i) {
+        read64(i << 1);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  ASSERT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaReadMMIO64", &stats),
+            FPGA_OK);
+  EXPECT_EQ(stats.count, 4000);
+  EXPECT_EQ(stats.errors, 0);
+
+  EXPECT_EQ(fpgaTraceReset(), FPGA_OK);
+  EXPECT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaReadMMIO64", &stats),
+            FPGA_NOT_FOUND);
+
+  // Blocks of exited threads are reused and start from the new epoch.
+  read64(0);
+  ASSERT_EQ(fpgaTraceGetStats("libtrace_test.so", "fpgaReadMMIO64", &stats),
+            FPGA_OK);
+  EXPECT_EQ(stats.count, 1);
+}
+
+/**
+ * @test       dump
+ * @brief      fpgaTraceDump writes to the given stream.
+ */
+TEST_F(trace_c, dump) {
+  read64(0);
+  FILE *fp = tmpfile();
+  ASSERT_NE(fp, nullptr);
+  EXPECT_EQ(fpgaTraceDump(fp), FPGA_OK);
+  EXPECT_GT(ftell(fp), 0);
+  fclose(fp);
+  EXPECT_EQ(fpgaTraceDump(nullptr), FPGA_INVALID_PARAM);
+}
@@ -0,0 +1,156 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <opae/mem_alloc.h>
+
+/*
+ * Throughput and fragmentation of mem_alloc_get/mem_alloc_put with a
+ * growing number of live allocations. After the live set is built, each
+ * op frees a random live allocation and replaces it with a new one of a
+ * random page-multiple size between 4KB and 2MB, in the way that IOVA
+ * space is used by libopaevfio.
+ */
+
+#define DEFAULT_OPS 1000000
+#define SPACE_BASE 0x100000ULL
+#define SPACE_SIZE (1ULL << 40)
+#define PAGE 4096ULL
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_size(unsigned *seed)
+{
+	// 1..512 pages, biased toward small buffers
+	uint32_t order = rand_r(seed) % 10;
+
+	return PAGE * (1 + (rand_r(seed) % (1u << order)));
+}
+
+static int run_bench(unsigned long live, unsigned long ops)
+{
+	struct mem_alloc m;
+	struct mem_link *l;
+	uint64_t *addr;
+	uint64_t free_bytes = 0;
+	uint64_t largest = 0;
+	unsigned long blocks = 0;
+	unsigned seed = 1;
+	unsigned long i;
+	double start;
+	double elapsed;
+
+	addr = calloc(live, sizeof(uint64_t));
+	if (!addr)
+		return 1;
+
+	mem_alloc_init(&m);
+	if (mem_alloc_add_free(&m, SPACE_BASE, SPACE_SIZE)) {
+		free(addr);
+		return 1;
+	}
+
+	for (i = 0 ; i < live ; ++i) {
+		if (mem_alloc_get(&m, &addr[i], random_size(&seed)))
+			goto out_err;
+	}
+
+	start = now_sec();
+
+	for (i = 0 ; i < ops ; ++i) {
+		unsigned long j = rand_r(&seed) % live;
+
+		if (mem_alloc_put(&m, addr[j]) ||
+		    mem_alloc_get(&m, &addr[j], random_size(&seed)))
+			goto out_err;
+	}
+
+	elapsed = now_sec() - start;
+
+	for (l = m.free.next ; l != &m.free ; l = l->next) {
+		++blocks;
+		free_bytes += l->size;
+		if (l->size > largest)
+			largest = l->size;
+	}
+
+	// The tail of the space is never touched: leave it out.
+	free_bytes -= m.free.prev->size;
+	largest = 0;
+	for (l = m.free.next ; l != m.free.prev ; l = l->next) {
+		if (l->size > largest)
+			largest = l->size;
+	}
+
+	printf("%-10lu %14.2f %12lu %14.2f %10.1f%%\n",
+	       live, (2.0 * ops) / elapsed / 1e6, blocks - 1,
+	       free_bytes / (1024.0 * 1024.0),
+	       free_bytes ? 100.0 * (1.0 - (double)largest / free_bytes) : 0.0);
+
+	mem_alloc_destroy(&m);
+	free(addr);
+	return 0;
+
+out_err:
+	printf("allocation failure with %lu live\n", live);
+	mem_alloc_destroy(&m);
+	free(addr);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long max_live = 65536;
+	unsigned long ops = DEFAULT_OPS;
+	unsigned long live;
+	int res = 0;
+
+	if (argc > 1)
+		max_live = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		ops = strtoul(argv[2], NULL, 0);
+	if (!max_live || !ops) {
+		printf("usage: opaemembench [max_live] [ops]\n");
+		return 1;
+	}
+
+	printf("%-10s %14s %12s %14s %11s\n",
+	       "live", "Mops/s", "free holes", "hole MB", "frag");
+
+	for (live = 64 ; live <= max_live && !res ; live *= 4)
+		res = run_bench(live, ops);
+
+	return res;
+}
@@ -27,13 +27,17 @@
 #include <config.h>
 #endif // HAVE_CONFIG_H
 
+#include <cmath>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include <opae/mem_alloc.h>
 
 extern "C" {
-struct mem_link *mem_link_alloc(uint64_t address, uint64_t size);
-void mem_alloc_coalesce(struct mem_link *head, struct mem_link *l);
+struct mem_link *mem_link_alloc(struct mem_alloc *m,
+                                uint64_t address,
+                                uint64_t size);
 int mem_alloc_allocate_node(struct mem_alloc *m,
                             struct mem_link *node,
                             uint64_t *address,
@@ -42,6 +46,14 @@ int mem_alloc_free_node(struct mem_alloc *m,
                         struct mem_link *node);
 }
 
+static int free_blocks(struct mem_alloc *m)
+{
+  int count = 0;
+  for (struct mem_link *l = m->free.next ; l != &m->free ; l = l->next)
+    ++count;
+  return count;
+}
+
 /**
  * @test    init
  * @brief   Test: mem_alloc_init()
@@ -59,6 +71,12 @@ TEST(mem_alloc, init)
 
   EXPECT_EQ(m.allocated.prev, &m.allocated);
   EXPECT_EQ(m.allocated.next, &m.allocated);
+
+  EXPECT_EQ(m.free_by_address, nullptr);
+  EXPECT_EQ(m.allocated_by_address, nullptr);
+  EXPECT_EQ(m.class_mask, 0);
+  EXPECT_EQ(m.slabs, nullptr);
+  EXPECT_EQ(m.spare, nullptr);
 }
 
 /**
@@ -70,24 +88,13 @@ TEST(mem_alloc, init)
 TEST(mem_alloc, destroy)
 {
   struct mem_alloc m;
+  uint64_t addr = 0;
 
-  struct mem_link *free_link = (struct mem_link *)
-	  malloc(sizeof(struct mem_link));
-  struct mem_link *allocated_link = (struct mem_link *)
-	  malloc(sizeof(struct mem_link));
-
-  ASSERT_NE(free_link, nullptr);
-  ASSERT_NE(allocated_link, nullptr);
-
-  m.free.prev = free_link;
-  m.free.next = free_link;
-  free_link->prev = &m.free;
-  free_link->next = &m.free;
+  mem_alloc_init(&m);
 
-  m.allocated.prev = allocated_link;
-  m.allocated.next = allocated_link;
-  allocated_link->prev = &m.allocated;
-  allocated_link->next = &m.allocated;
+  ASSERT_EQ(mem_alloc_add_free(&m, 0, 4096), 0);
+  ASSERT_EQ(mem_alloc_get(&m, &addr, 1024), 0);
+  EXPECT_NE(m.slabs, nullptr);
 
   mem_alloc_destroy(&m);
 
@@ -96,6 +103,11 @@ TEST(mem_alloc, destroy)
 
   EXPECT_EQ(m.allocated.prev, &m.allocated);
   EXPECT_EQ(m.allocated.next, &m.allocated);
+
+  EXPECT_EQ(m.free_by_address, nullptr);
+  EXPECT_EQ(m.allocated_by_address, nullptr);
+  EXPECT_EQ(m.slabs, nullptr);
+  EXPECT_EQ(m.spare, nullptr);
 }
 
 /**
@@ -103,135 +115,141 @@ TEST(mem_alloc, destroy)
  * @brief   Test: mem_link_alloc()
  * @details mem_link_alloc() correctly<br>
  *          allocates and initializes a new<br>
- *          struct mem_link.
+ *          struct mem_link from the allocator's slab.
  */
 TEST(mem_alloc, link_alloc)
 {
+  struct mem_alloc m;
   const uint64_t addr = 1UL;
   const uint64_t size = 2UL;
-  struct mem_link *link = mem_link_alloc(addr, size);
+
+  mem_alloc_init(&m);
+
+  struct mem_link *link = mem_link_alloc(&m, addr, size);
 
   ASSERT_NE(link, nullptr);
   EXPECT_EQ(link->address, addr);
   EXPECT_EQ(link->size, size);
   EXPECT_EQ(link->prev, link);
   EXPECT_EQ(link->next, link);
+  EXPECT_NE(m.slabs, nullptr);
+  EXPECT_NE(m.spare, nullptr);
+
+  mem_alloc_destroy(&m);
+}
+
+/**
+ * @test    link_recycle
+ * @brief   Test: mem_link_alloc()
+ * @details Block descriptors released by coalescing<br>
+ *          are reused by later allocations instead<br>
+ *          of growing the slab list.
+ */
+TEST(mem_alloc, link_recycle)
+{
+  struct mem_alloc m;
+  uint64_t addr[256];
+  int i;
+
+  mem_alloc_init(&m);
+
+  ASSERT_EQ(mem_alloc_add_free(&m, 0, 256 * 4096), 0);
+
+  for (i = 0 ; i < 256 ; ++i)
+    ASSERT_EQ(mem_alloc_get(&m, &addr[i], 4096), 0);
+  for (i = 0 ; i < 256 ; ++i)
+    ASSERT_EQ(mem_alloc_put(&m, addr[i]), 0);
+
+  struct mem_slab *slabs = m.slabs;
 
-  free(link);
+  for (i = 0 ; i < 256 ; ++i)
+    ASSERT_EQ(mem_alloc_get(&m, &addr[i], 4096), 0);
+
+  EXPECT_EQ(m.slabs, slabs);
+
+  mem_alloc_destroy(&m);
 }
 
 /**
  * @test    coalesce0
- * @brief   Test: mem_alloc_coalesce()
- * @details When the l (2nd) parameter<br>
- *          is equal to the head (1st)<br>
- *          parameter, the fn simply returns.
+ * @brief   Test: mem_alloc_add_free()
+ * @details When the freed range has no adjacent<br>
+ *          free block, it is kept as a separate block.
  */
 TEST(mem_alloc, coalesce0)
 {
-  const uint64_t addr = 1UL;
-  const uint64_t size = 2UL;
-  struct mem_link *link = mem_link_alloc(addr, size);
+  struct mem_alloc m;
 
-  ASSERT_NE(link, nullptr);
-  EXPECT_EQ(link->address, addr);
-  EXPECT_EQ(link->size, size);
-  EXPECT_EQ(link->prev, link);
-  EXPECT_EQ(link->next, link);
+  mem_alloc_init(&m);
 
-  mem_alloc_coalesce(link, link);
+  ASSERT_EQ(mem_alloc_add_free(&m, 0, 1024), 0);
+  ASSERT_EQ(mem_alloc_add_free(&m, 4096, 1024), 0);
 
-  EXPECT_EQ(link->address, addr);
-  EXPECT_EQ(link->size, size);
-  EXPECT_EQ(link->prev, link);
-  EXPECT_EQ(link->next, link);
+  struct mem_link *l = m.free.next;
+
+  EXPECT_EQ(free_blocks(&m), 2);
+  EXPECT_EQ(l->address, 0);
+  EXPECT_EQ(l->size, 1024);
 
-  free(link);
+  mem_alloc_destroy(&m);
 }
 
 /**
  * @test    coalesce1
- * @brief   Test: mem_alloc_coalesce()
- * @details When the node prior to the l<br>
- *          (2nd) parameter in the list is not<br>
- *          the list head, and when the prior node<br>
- *          meets the criteria for coalescing, the fn<br>
- *          coalesces the previous node into the l node.
+ * @brief   Test: mem_alloc_add_free()
+ * @details When a freed range starts where the<br>
+ *          previous free block ends, the two<br>
+ *          are merged into one block.
  */
 TEST(mem_alloc, coalesce1)
 {
-  struct mem_link head;
-  struct mem_link *zero = mem_link_alloc(0, 1024);
-  struct mem_link *one = mem_link_alloc(1024, 1024);
-
-  ASSERT_NE(zero, nullptr);
-  ASSERT_NE(one, nullptr);
-
-  head.next = zero;
-  zero->prev = &head;
-  
-  zero->next = one;
-  one->prev = zero;
-
-  one->next = &head;
-  head.prev = one;
-
-  // head -> zero -> one
-  mem_alloc_coalesce(&head, one);
-
-  // head -> one
-  // (zero has been freed)
-  EXPECT_EQ(head.prev, one);
-  EXPECT_EQ(head.next, one);
-  EXPECT_EQ(one->prev, &head);
-  EXPECT_EQ(one->next, &head);
-  EXPECT_EQ(one->address, 0);
-  EXPECT_EQ(one->size, 2048);
-
-  free(one);
+  struct mem_alloc m;
+
+  mem_alloc_init(&m);
+
+  ASSERT_EQ(mem_alloc_add_free(&m, 0, 1024), 0);
+  ASSERT_EQ(mem_alloc_add_free(&m, 1024, 1024), 0);
+
+  struct mem_link *l = m.free.next;
+
+  EXPECT_EQ(m.free.prev, l);
+  EXPECT_EQ(l->prev, &m.free);
+  EXPECT_EQ(l->next, &m.free);
+  EXPECT_EQ(l->address, 0);
+  EXPECT_EQ(l->size, 2048);
+  EXPECT_EQ(m.class_mask, 1ULL << 11);
+
+  mem_alloc_destroy(&m);
 }
 
 /**
  * @test    coalesce2
- * @brief   Test: mem_alloc_coalesce()
- * @details When the node just after the l<br>
- *          (2nd) parameter in the list is not<br>
- *          the list head, and when the next node<br>
- *          meets the criteria for coalescing, the fn<br>
- *          coalesces l into the next node.
+ * @brief   Test: mem_alloc_add_free()
+ * @details When a freed range touches free blocks<br>
+ *          on both sides, all three are merged<br>
+ *          into one block.
  */
 TEST(mem_alloc, coalesce2)
 {
-  struct mem_link head;
-  struct mem_link *zero = mem_link_alloc(0, 1024);
-  struct mem_link *one = mem_link_alloc(1024, 1024);
-
-  ASSERT_NE(zero, nullptr);
-  ASSERT_NE(one, nullptr);
-
-  head.next = zero;
-  zero->prev = &head;
-  
-  zero->next = one;
-  one->prev = zero;
-
-  one->next = &head;
-  head.prev = one;
-
-  // head -> zero -> one
-  mem_alloc_coalesce(&head, zero);
-
-  // head -> one
-  // (zero has been freed)
- 
-  EXPECT_EQ(head.prev, one);
-  EXPECT_EQ(head.next, one);
-  EXPECT_EQ(one->prev, &head);
-  EXPECT_EQ(one->next, &head);
-  EXPECT_EQ(one->address, 0);
-  EXPECT_EQ(one->size, 2048);
-
-  free(one);
+  struct mem_alloc m;
+  uint64_t addr = 0;
+
+  mem_alloc_init(&m);
+
+  ASSERT_EQ(mem_alloc_add_free(&m, 0, 1024), 0);
+  ASSERT_EQ(mem_alloc_add_free(&m, 2048, 1024), 0);
+  EXPECT_EQ(free_blocks(&m), 2);
+
+  ASSERT_EQ(mem_alloc_add_free(&m, 1024, 1024), 0);
+  ASSERT_EQ(free_blocks(&m), 1);
+  EXPECT_EQ(m.free.next->address, 0);
+  EXPECT_EQ(m.free.next->size, 3072);
+
+  // The merged block is reachable through the size index.
+  EXPECT_EQ(mem_alloc_get(&m, &addr, 3072), 0);
+  EXPECT_EQ(addr, 0);
+
+  mem_alloc_destroy(&m);
 }
 
 /**
@@ -258,8 +276,9 @@ TEST(mem_alloc, add_free0)
   EXPECT_EQ(l->next, &allocator.free);
   EXPECT_EQ(l->address, 0);
   EXPECT_EQ(l->size, 1024);
+  EXPECT_EQ(allocator.class_mask, 1ULL << 10);
 
-  free(l);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -271,7 +290,7 @@ TEST(mem_alloc, add_free0)
 TEST(mem_alloc, add_free1)
 {
   struct mem_alloc allocator;
-  struct mem_link *l, *trash;
+  struct mem_link *l;
   const uint64_t size = 1024UL;
 
   mem_alloc_init(&allocator);
@@ -282,33 +301,22 @@ TEST(mem_alloc, add_free1)
   ASSERT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
   ASSERT_EQ(mem_alloc_add_free(&allocator, 2048, size), 0);
 
-  EXPECT_NE(allocator.free.prev, &allocator.free);
-  EXPECT_NE(allocator.free.next, &allocator.free);
-
   l = allocator.free.next;
 
   EXPECT_EQ(l->prev, &allocator.free);
   EXPECT_EQ(l->address, 0);
   EXPECT_EQ(l->size, size);
 
-  trash = l;
   l = l->next;
-  free(trash);
-
-  EXPECT_EQ(l->prev, trash);
   EXPECT_EQ(l->address, 2048);
   EXPECT_EQ(l->size, size);
 
-  trash =l;
   l = l->next;
-  free(trash);
-
-  EXPECT_EQ(l->prev, trash);
   EXPECT_EQ(l->next, &allocator.free);
   EXPECT_EQ(l->address, 4096);
   EXPECT_EQ(l->size, size);
 
-  free(l);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -320,16 +328,15 @@ TEST(mem_alloc, add_free1)
 TEST(mem_alloc, add_free2)
 {
   struct mem_alloc allocator;
-  struct mem_link *l;
   const uint64_t size = 1024UL;
 
   mem_alloc_init(&allocator);
 
   ASSERT_EQ(mem_alloc_add_free(&allocator, 4096, size), 0);
   EXPECT_NE(mem_alloc_add_free(&allocator, 4096, size), 0);
+  EXPECT_EQ(free_blocks(&allocator), 1);
 
-  l = allocator.free.next;
-  free(l);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -350,31 +357,29 @@ TEST(mem_alloc, allocate_node0)
   mem_alloc_init(&allocator);
 
   EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
-  EXPECT_EQ(mem_alloc_allocate_node(&allocator,
-                                    allocator.free.next,
-                                    &addr,
-				    size), 0);
+  l = allocator.free.next;
+  EXPECT_EQ(mem_alloc_allocate_node(&allocator, l, &addr, size), 0);
 
   EXPECT_EQ(allocator.free.prev, &allocator.free);
   EXPECT_EQ(allocator.free.next, &allocator.free);
+  EXPECT_EQ(allocator.free_by_address, nullptr);
+  EXPECT_EQ(allocator.class_mask, 0);
 
-  EXPECT_NE(allocator.allocated.prev, &allocator.allocated);
-  EXPECT_NE(allocator.allocated.next, &allocator.allocated);
-
-  l = allocator.allocated.next;
+  EXPECT_EQ(allocator.allocated.next, l);
   EXPECT_EQ(l->prev, &allocator.allocated);
   EXPECT_EQ(l->next, &allocator.allocated);
   EXPECT_EQ(l->address, 0);
   EXPECT_EQ(l->size, size);
+  EXPECT_EQ(addr, 0);
 
-  free(l);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
  * @test    allocate_node1
  * @brief   Test: mem_alloc_allocate_node()
  * @details When the given node has a size that is<br>
- *          greater or equal to the requested size,<br>
+ *          greater than the requested size,<br>
  *          that node is adjusted to account for the allocation,<br>
  *          and a new node is allocated and added to the<br>
  *          allocated list.
@@ -391,41 +396,70 @@ TEST(mem_alloc, allocate_node1)
   EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
 
   l = allocator.free.next;
-  EXPECT_EQ(mem_alloc_allocate_node(&allocator,
-                                    allocator.free.next,
-                                    &addr,
-                                    512), 0);
+  EXPECT_EQ(mem_alloc_allocate_node(&allocator, l, &addr, 512), 0);
+  EXPECT_EQ(addr, 0);
 
   EXPECT_EQ(allocator.free.prev, l);
   EXPECT_EQ(allocator.free.next, l);
-  EXPECT_EQ(l->prev, &allocator.free);
-  EXPECT_EQ(l->next, &allocator.free);
   EXPECT_EQ(l->address, 512);
   EXPECT_EQ(l->size, 512);
+  EXPECT_EQ(allocator.class_mask, 1ULL << 9);
 
-  free(l);
   l = allocator.allocated.next;
-
   EXPECT_EQ(allocator.allocated.prev, l);
-  EXPECT_EQ(allocator.allocated.next, l);
-  EXPECT_EQ(l->prev, &allocator.allocated);
-  EXPECT_EQ(l->next, &allocator.allocated);
   EXPECT_EQ(l->address, 0);
   EXPECT_EQ(l->size, 512);
 
-  free(l);
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    allocate_node2
+ * @brief   Test: mem_alloc_allocate_node()
+ * @details When the node has room for a naturally-aligned<br>
+ *          allocation, the fn carves it from the middle,<br>
+ *          leaving free blocks on both sides.
+ */
+TEST(mem_alloc, allocate_node2)
+{
+  struct mem_alloc allocator;
+  struct mem_link *l;
+  uint64_t addr = 0;
+
+  mem_alloc_init(&allocator);
+
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0x1000, 0x10000), 0);
+
+  l = allocator.free.next;
+  EXPECT_EQ(mem_alloc_allocate_node(&allocator, l, &addr, 0x4000), 0);
+  EXPECT_EQ(addr, 0x4000);
+
+  ASSERT_EQ(free_blocks(&allocator), 2);
+  l = allocator.free.next;
+  EXPECT_EQ(l->address, 0x1000);
+  EXPECT_EQ(l->size, 0x3000);
+  l = l->next;
+  EXPECT_EQ(l->address, 0x8000);
+  EXPECT_EQ(l->size, 0x9000);
+
+  EXPECT_EQ(mem_alloc_put(&allocator, addr), 0);
+  ASSERT_EQ(free_blocks(&allocator), 1);
+  EXPECT_EQ(allocator.free.next->address, 0x1000);
+  EXPECT_EQ(allocator.free.next->size, 0x10000);
+
+  mem_alloc_destroy(&allocator);
 }
 
 /**
  * @test    get0
  * @brief   Test: mem_alloc_get()
- * @details The fn allocates from the free list<br>
- *          using a first fit algorithm.
+ * @details Among equally-sized free blocks,<br>
+ *          the fn allocates from the lowest address.
  */
 TEST(mem_alloc, get0)
 {
   struct mem_alloc allocator;
-  struct mem_link *l, *trash;
+  struct mem_link *l;
   const uint64_t size = 1024UL;
   uint64_t addr = 8192;
 
@@ -444,20 +478,15 @@ TEST(mem_alloc, get0)
   EXPECT_EQ(l->address, 512);
   EXPECT_EQ(l->size, 512);
 
-  trash = l;
   l = l->next;
-  free(trash);
-
   EXPECT_EQ(l->address, 2048);
   EXPECT_EQ(l->size, size);
 
-  free(l);
   l = allocator.allocated.next;
-
   EXPECT_EQ(l->address, 0);
   EXPECT_EQ(l->size, 512);
 
-  free(l);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -480,89 +509,140 @@ TEST(mem_alloc, get1)
 
   EXPECT_NE(mem_alloc_get(&allocator, &addr, size * 2), 0);
 
-  free(allocator.free.next);
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    get2
+ * @brief   Test: mem_alloc_get()
+ * @details The fn chooses the smallest free block<br>
+ *          that satisfies the request, whether it<br>
+ *          is found in the request's size class<br>
+ *          or in a larger one.
+ */
+TEST(mem_alloc, get2)
+{
+  struct mem_alloc allocator;
+  uint64_t addr = 0;
+
+  mem_alloc_init(&allocator);
+
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0x00000, 0x8000), 0);
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0x10000, 0x3000), 0);
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0x20000, 0x2800), 0);
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0x30000, 0x4000), 0);
+
+  // 0x2800 and 0x3000 share a class; 0x3000 is the best fit.
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, 0x2c00), 0);
+  EXPECT_EQ(addr, 0x10000);
+
+  // Nothing left in class 13 fits; 0x4000 is the smallest larger block.
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, 0x3000), 0);
+  EXPECT_EQ(addr, 0x30000);
+
+  mem_alloc_destroy(&allocator);
 }
 
 /**
  * @test    free_node
  * @brief   Test: mem_alloc_free_node()
  * @details When the allocated list contains the<br>
- *          target node, that node is freed, and<br>
- *          the address and size are added back<br>
- *          to the free list in a new node.
+ *          target node, that node is moved back<br>
+ *          to the free list.
  */
 TEST(mem_alloc, free_node)
 {
   struct mem_alloc allocator;
-  const uint64_t addr = 0;
   const uint64_t size = 1024;
-  struct mem_link *node = mem_link_alloc(addr, size);
-
-  ASSERT_NE(node, nullptr);
+  uint64_t addr = 8192;
+  struct mem_link *node;
 
   mem_alloc_init(&allocator);
 
-  allocator.allocated.next = node;
-  allocator.allocated.prev = node;
-  node->prev = &allocator.allocated;
-  node->next = &allocator.allocated;
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
+  node = allocator.allocated.next;
 
   EXPECT_EQ(mem_alloc_free_node(&allocator, node), 0);
   EXPECT_EQ(allocator.allocated.prev, &allocator.allocated);
   EXPECT_EQ(allocator.allocated.next, &allocator.allocated);
+  EXPECT_EQ(allocator.allocated_by_address, nullptr);
 
-  EXPECT_NE(allocator.free.prev, &allocator.free);
-  EXPECT_NE(allocator.free.next, &allocator.free);
-
-  node = allocator.free.next;
+  EXPECT_EQ(allocator.free.next, node);
   EXPECT_EQ(node->prev, &allocator.free);
   EXPECT_EQ(node->next, &allocator.free);
-  EXPECT_EQ(node->address, addr);
+  EXPECT_EQ(node->address, 0);
   EXPECT_EQ(node->size, size);
 
-  free(node);
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    free_node_double
+ * @brief   Test: mem_alloc_free_node()
+ * @details When the block of the target node is already<br>
+ *          on the free list, the fn returns non-zero<br>
+ *          and leaves the node allocated and the free<br>
+ *          list unchanged.
+ */
+TEST(mem_alloc, free_node_double)
+{
+  struct mem_alloc allocator;
+  const uint64_t size = 1024;
+  uint64_t addr = 8192;
+  struct mem_link *node;
+
+  mem_alloc_init(&allocator);
+
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
+  node = allocator.allocated.next;
+
+  // The same range is handed back to the free list behind its back.
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  EXPECT_EQ(free_blocks(&allocator), 1);
+
+  EXPECT_EQ(mem_alloc_free_node(&allocator, node), 2);
+  EXPECT_EQ(allocator.allocated.next, node);
+  EXPECT_NE(allocator.allocated_by_address, nullptr);
+  EXPECT_EQ(free_blocks(&allocator), 1);
+  EXPECT_NE(allocator.free.next, node);
+
+  mem_alloc_destroy(&allocator);
 }
 
 /**
  * @test    put0
  * @brief   Test: mem_alloc_put()
  * @details When the allocated list contains the<br>
- *          target address, that node is freed, and<br>
- *          the address and size are added back<br>
- *          to the free list in a new node.
+ *          target address, that block is returned<br>
+ *          to the free list.
  */
 TEST(mem_alloc, put0)
 {
   struct mem_alloc allocator;
-  const uint64_t addr = 0;
   const uint64_t size = 1024;
-  struct mem_link *node = mem_link_alloc(addr, size);
-
-  ASSERT_NE(node, nullptr);
+  uint64_t addr = 8192;
+  struct mem_link *node;
 
   mem_alloc_init(&allocator);
 
-  allocator.allocated.next = node;
-  allocator.allocated.prev = node;
-  node->prev = &allocator.allocated;
-  node->next = &allocator.allocated;
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
 
   EXPECT_EQ(mem_alloc_put(&allocator, addr), 0);
 
   EXPECT_EQ(allocator.allocated.prev, &allocator.allocated);
   EXPECT_EQ(allocator.allocated.next, &allocator.allocated);
 
-  EXPECT_NE(allocator.free.prev, &allocator.free);
-  EXPECT_NE(allocator.free.next, &allocator.free);
-
   node = allocator.free.next;
 
   EXPECT_EQ(node->prev, &allocator.free);
   EXPECT_EQ(node->next, &allocator.free);
-  EXPECT_EQ(node->address, addr);
+  EXPECT_EQ(node->address, 0);
   EXPECT_EQ(node->size, size);
 
-  free(node);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -576,28 +656,70 @@ TEST(mem_alloc, put0)
 TEST(mem_alloc, put1)
 {
   struct mem_alloc allocator;
-  const uint64_t addr = 0;
   const uint64_t size = 1024;
-  struct mem_link *node = mem_link_alloc(addr, size);
-
-  ASSERT_NE(node, nullptr);
+  uint64_t addr = 8192;
 
   mem_alloc_init(&allocator);
 
-  allocator.allocated.prev = node;
-  allocator.allocated.next = node;
-  node->prev = &allocator.allocated;
-  node->next = &allocator.allocated;
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
 
   EXPECT_NE(mem_alloc_put(&allocator, 4096), 0);
 
   EXPECT_EQ(allocator.free.prev, &allocator.free);
   EXPECT_EQ(allocator.free.next, &allocator.free);
+  EXPECT_NE(allocator.allocated.next, &allocator.allocated);
 
-  EXPECT_EQ(allocator.allocated.prev, node);
-  EXPECT_EQ(allocator.allocated.next, node);
-  EXPECT_EQ(node->prev, &allocator.allocated);
-  EXPECT_EQ(node->next, &allocator.allocated);
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    stress
+ * @brief   Test: mem_alloc_get(), mem_alloc_put()
+ * @details After many interleaved allocations and frees<br>
+ *          of mixed sizes, freeing everything restores<br>
+ *          the original single free block, and the<br>
+ *          address index stays balanced.
+ */
+TEST(mem_alloc, stress)
+{
+  struct mem_alloc allocator;
+  const int count = 4096;
+  std::vector<uint64_t> live;
+  unsigned seed = 1;
+
+  mem_alloc_init(&allocator);
 
-  free(node);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0x100000, 1ULL << 32), 0);
+
+  for (int i = 0 ; i < 4 * count ; ++i) {
+    uint64_t addr;
+
+    if (live.size() < (size_t)count && (rand_r(&seed) & 1)) {
+      uint64_t size = 4096ULL << (rand_r(&seed) % 10);
+      ASSERT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
+      live.push_back(addr);
+    } else if (!live.empty()) {
+      size_t j = rand_r(&seed) % live.size();
+      ASSERT_EQ(mem_alloc_put(&allocator, live[j]), 0);
+      live[j] = live.back();
+      live.pop_back();
+    }
+  }
+
+  if (allocator.allocated_by_address) {
+    // AVL height bound: 1.44 * log2(n + 2)
+    EXPECT_LE(allocator.allocated_by_address->height,
+              1.44 * std::log2(live.size() + 2));
+  }
+
+  for (uint64_t addr : live)
+    ASSERT_EQ(mem_alloc_put(&allocator, addr), 0);
+
+  ASSERT_EQ(free_blocks(&allocator), 1);
+  EXPECT_EQ(allocator.free.next->address, 0x100000);
+  EXPECT_EQ(allocator.free.next->size, 1ULL << 32);
+  EXPECT_EQ(allocator.allocated_by_address, nullptr);
+
+  mem_alloc_destroy(&allocator);
 }
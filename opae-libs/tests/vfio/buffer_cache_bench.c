@@ -0,0 +1,127 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <opae/vfio.h>
+
+/*
+ * Compare the allocate/free rate of short-lived DMA buffers with the
+ * libopaevfio buffer cache disabled and enabled. Requires a device
+ * bound to vfio-pci and, for sizes above 4KB, configured huge pages.
+ */
+
+#define DEFAULT_ITERATIONS 10000
+#define DEFAULT_SIZE (2 * 1024 * 1024)
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run_bench(struct opae_vfio *v, size_t size,
+			unsigned long iterations, int *errors)
+{
+	double start = now_sec();
+	unsigned long i;
+
+	for (i = 0 ; i < iterations ; ++i) {
+		size_t sz = size;
+		uint8_t *buf = NULL;
+		uint64_t iova = 0;
+
+		if (opae_vfio_buffer_allocate(v, &sz, &buf, &iova)) {
+			++*errors;
+			break;
+		}
+		buf[0] = (uint8_t)i;
+		if (opae_vfio_buffer_free(v, buf))
+			++*errors;
+	}
+
+	return i / (now_sec() - start);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long iterations = DEFAULT_ITERATIONS;
+	size_t size = DEFAULT_SIZE;
+	struct opae_vfio_buffer_cache_stats stats;
+	struct opae_vfio v;
+	double uncached;
+	double cached;
+	int errors = 0;
+
+	if (argc < 2) {
+		printf("usage: vfio_buffer_cache_bench <pciaddr> "
+		       "[iterations] [size]\n");
+		return 1;
+	}
+	if (argc > 2)
+		iterations = strtoul(argv[2], NULL, 0);
+	if (argc > 3)
+		size = strtoul(argv[3], NULL, 0);
+	if (!iterations || !size) {
+		printf("iterations and size must be > 0\n");
+		return 1;
+	}
+
+	if (opae_vfio_open(&v, argv[1])) {
+		printf("failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	uncached = run_bench(&v, size, iterations, &errors);
+
+	opae_vfio_buffer_cache_enable(&v, 4, 64 * size);
+	cached = run_bench(&v, size, iterations, &errors);
+	opae_vfio_buffer_cache_stats(&v, &stats);
+
+	printf("%-10s %16s %16s %8s\n",
+	       "size", "uncached ops/s", "cached ops/s", "speedup");
+	printf("%-10zu %16.0f %16.0f %7.2fx\n", size, uncached, cached,
+	       uncached ? cached / uncached : 0.0);
+	printf("cache: %lu hits, %lu misses, %lu recycled, %lu released, "
+	       "peak %lu bytes\n",
+	       stats.hits, stats.misses, stats.recycled, stats.released,
+	       stats.peak_cached_bytes);
+
+	opae_vfio_close(&v);
+
+	if (errors)
+		printf("%d allocation errors\n", errors);
+
+	return errors ? 1 : 0;
+}
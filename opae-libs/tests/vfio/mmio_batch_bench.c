@@ -0,0 +1,191 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <opae/fpga.h>
+#include "adapter.h"
+#include "opae_int.h"
+#include "opae_vfio.h"
+#include "mock_vfio.h"
+
+/*
+ * Compare a sequence of fpgaWriteMMIO64/fpgaReadMMIO64 calls with the
+ * same sequence issued through fpgaWriteMMIOBatch/fpgaReadMMIOBatch.
+ * The calls go through the libopae-c API shell into the vfio plugin,
+ * so each op of the sequence pays for handle validation and the handle
+ * lock, whereas a batch pays once. The BAR is mocked with ordinary
+ * memory, so the numbers isolate the library overhead.
+ */
+
+#define DEFAULT_ITERATIONS 200000
+#define MAX_BATCH 64
+
+fpga_result vfio_fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
+				uint64_t offset, uint32_t *value);
+fpga_result vfio_fpgaWriteMMIO32(fpga_handle handle, uint32_t mmio_num,
+				 uint64_t offset, uint32_t value);
+fpga_result vfio_fpgaReadMMIO64(fpga_handle handle, uint32_t mmio_num,
+				uint64_t offset, uint64_t *value);
+fpga_result vfio_fpgaWriteMMIO64(fpga_handle handle, uint32_t mmio_num,
+				 uint64_t offset, uint64_t value);
+fpga_result vfio_fpgaWriteMMIOBatch(fpga_handle handle, uint32_t mmio_num,
+				    const fpga_mmio_op *ops, uint32_t num_ops);
+fpga_result vfio_fpgaReadMMIOBatch(fpga_handle handle, uint32_t mmio_num,
+				   fpga_mmio_op *ops, uint32_t num_ops);
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run_single(fpga_handle h, fpga_mmio_op *ops, uint32_t n,
+			 unsigned long iterations, int *errors)
+{
+	double start = now_sec();
+	unsigned long i;
+	uint32_t j;
+
+	for (i = 0 ; i < iterations ; ++i) {
+		for (j = 0 ; j < n ; ++j) {
+			if (fpgaWriteMMIO64(h, 0, ops[j].offset, i))
+				++*errors;
+		}
+		for (j = 0 ; j < n ; ++j) {
+			if (fpgaReadMMIO64(h, 0, ops[j].offset, &ops[j].value))
+				++*errors;
+		}
+	}
+
+	return (2.0 * n * iterations) / (now_sec() - start) / 1e6;
+}
+
+static double run_batch(fpga_handle h, fpga_mmio_op *ops, uint32_t n,
+			unsigned long iterations, int *errors)
+{
+	double start = now_sec();
+	unsigned long i;
+	uint32_t j;
+
+	for (i = 0 ; i < iterations ; ++i) {
+		for (j = 0 ; j < n ; ++j)
+			ops[j].value = i;
+		if (fpgaWriteMMIOBatch(h, 0, ops, n))
+			++*errors;
+		if (fpgaReadMMIOBatch(h, 0, ops, n))
+			++*errors;
+	}
+
+	return (2.0 * n * iterations) / (now_sec() - start) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long iterations = DEFAULT_ITERATIONS;
+	opae_api_adapter_table adapter;
+	fpga_mmio_op ops[MAX_BATCH];
+	volatile uint8_t *bar = NULL;
+	opae_wrapped_token *wtok = NULL;
+	opae_wrapped_handle *whan = NULL;
+	vfio_token token;
+	vfio_handle handle;
+	int errors = 0;
+	uint32_t n;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (!iterations) {
+		printf("usage: vfio_mmio_batch_bench [iterations]\n");
+		return 1;
+	}
+
+	if (posix_memalign((void **)&bar, 4096, MOCK_BAR_SIZE)) {
+		printf("failed to allocate mock BAR\n");
+		return 1;
+	}
+	memset((void *)bar, 0, MOCK_BAR_SIZE);
+
+	if (init_mock_handle(&handle, &token, bar, 0)) {
+		printf("failed to initialize mock handle\n");
+		free((void *)bar);
+		return 1;
+	}
+
+	memset(&adapter, 0, sizeof(adapter));
+	adapter.fpgaReadMMIO32 = vfio_fpgaReadMMIO32;
+	adapter.fpgaWriteMMIO32 = vfio_fpgaWriteMMIO32;
+	adapter.fpgaReadMMIO64 = vfio_fpgaReadMMIO64;
+	adapter.fpgaWriteMMIO64 = vfio_fpgaWriteMMIO64;
+	adapter.fpgaWriteMMIOBatch = vfio_fpgaWriteMMIOBatch;
+	adapter.fpgaReadMMIOBatch = vfio_fpgaReadMMIOBatch;
+
+	wtok = opae_allocate_wrapped_token(&token, &adapter);
+	if (wtok)
+		whan = opae_allocate_wrapped_handle(wtok, &handle, &adapter);
+	if (!whan) {
+		printf("failed to wrap mock handle\n");
+		errors = 1;
+		goto out_free;
+	}
+
+	for (n = 0 ; n < MAX_BATCH ; ++n) {
+		ops[n].offset = n * sizeof(uint64_t);
+		ops[n].value = 0;
+		ops[n].width = sizeof(uint64_t);
+	}
+
+	printf("%-8s %16s %16s %8s\n",
+	       "ops", "single Mops/s", "batch Mops/s", "speedup");
+
+	for (n = 1 ; n <= MAX_BATCH ; n *= 4) {
+		double s = run_single(whan, ops, n, iterations, &errors);
+		double b = run_batch(whan, ops, n, iterations, &errors);
+
+		printf("%-8u %16.2f %16.2f %7.2fx\n", n, s, b, s ? b / s : 0.0);
+	}
+
+	if (errors)
+		printf("%d MMIO errors\n", errors);
+
+out_free:
+	if (whan)
+		opae_destroy_wrapped_handle(whan);
+	if (wtok)
+		opae_destroy_wrapped_token(wtok);
+	pthread_mutex_destroy(&handle.lock);
+	free((void *)bar);
+
+	return errors ? 1 : 0;
+}
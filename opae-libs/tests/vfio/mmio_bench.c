@@ -0,0 +1,188 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "opae_vfio.h"
+#include "mock_vfio.h"
+
+/*
+ * Compare the throughput of vfio_fpgaReadMMIO64/vfio_fpgaWriteMMIO64
+ * with and without the handle lock (FPGA_OPEN_UNLOCKED_MMIO) as the
+ * number of threads sharing one handle grows. The BAR is mocked with
+ * ordinary memory, so the numbers isolate the library overhead.
+ */
+
+#define DEFAULT_ITERATIONS 1000000
+
+fpga_result vfio_fpgaReadMMIO64(fpga_handle handle, uint32_t mmio_num,
+				uint64_t offset, uint64_t *value);
+fpga_result vfio_fpgaWriteMMIO64(fpga_handle handle, uint32_t mmio_num,
+				 uint64_t offset, uint64_t value);
+
+struct bench_thread {
+	pthread_t id;
+	vfio_handle *handle;
+	uint64_t offset;
+	unsigned long iterations;
+	int errors;
+};
+
+static pthread_barrier_t start_barrier;
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker(void *arg)
+{
+	struct bench_thread *bt = (struct bench_thread *)arg;
+	uint64_t value = 0;
+	unsigned long i;
+
+	pthread_barrier_wait(&start_barrier);
+
+	for (i = 0 ; i < bt->iterations ; ++i) {
+		if (vfio_fpgaWriteMMIO64(bt->handle, 0, bt->offset, i))
+			++bt->errors;
+		if (vfio_fpgaReadMMIO64(bt->handle, 0, bt->offset, &value))
+			++bt->errors;
+	}
+
+	return NULL;
+}
+
+static double run_bench(vfio_handle *h, unsigned num_threads,
+			unsigned long iterations, int *errors)
+{
+	struct bench_thread *threads;
+	double start;
+	double elapsed;
+	unsigned i;
+
+	threads = calloc(num_threads, sizeof(struct bench_thread));
+	if (!threads)
+		return 0.0;
+
+	pthread_barrier_init(&start_barrier, NULL, num_threads + 1);
+
+	for (i = 0 ; i < num_threads ; ++i) {
+		threads[i].handle = h;
+		// one cache line per thread
+		threads[i].offset = (i * 64) % MOCK_BAR_SIZE;
+		threads[i].iterations = iterations;
+		pthread_create(&threads[i].id, NULL, bench_worker, &threads[i]);
+	}
+
+	start = now_sec();
+	pthread_barrier_wait(&start_barrier);
+
+	for (i = 0 ; i < num_threads ; ++i) {
+		pthread_join(threads[i].id, NULL);
+		*errors += threads[i].errors;
+	}
+
+	elapsed = now_sec() - start;
+
+	pthread_barrier_destroy(&start_barrier);
+	free(threads);
+
+	// two MMIO operations per iteration
+	return (2.0 * iterations * num_threads) / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned max_threads = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long iterations = DEFAULT_ITERATIONS;
+	volatile uint8_t *bar = NULL;
+	vfio_token locked_token;
+	vfio_token unlocked_token;
+	vfio_handle locked;
+	vfio_handle unlocked;
+	int errors = 0;
+	unsigned n;
+
+	if (argc > 1)
+		max_threads = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		iterations = strtoul(argv[2], NULL, 0);
+	if (!max_threads || !iterations) {
+		printf("usage: vfio_mmio_bench [max_threads] [iterations]\n");
+		return 1;
+	}
+
+	if (posix_memalign((void **)&bar, 4096, MOCK_BAR_SIZE)) {
+		printf("failed to allocate mock BAR\n");
+		return 1;
+	}
+	memset((void *)bar, 0, MOCK_BAR_SIZE);
+
+	if (init_mock_handle(&locked, &locked_token, bar, 0) ||
+	    init_mock_handle(&unlocked, &unlocked_token, bar,
+			     OPAE_FLAG_UNLOCKED_MMIO)) {
+		printf("failed to initialize mock handles\n");
+		free((void *)bar);
+		return 1;
+	}
+
+	printf("%-8s %16s %16s %8s\n",
+	       "threads", "locked Mops/s", "unlocked Mops/s", "speedup");
+
+	// powers of two up to max_threads, then max_threads itself
+	for (n = 1 ; n <= max_threads ;
+	     n = (n < max_threads && n * 2 > max_threads) ?
+		 max_threads : n * 2) {
+		double l = run_bench(&locked, n, iterations, &errors);
+		double u = run_bench(&unlocked, n, iterations, &errors);
+
+		printf("%-8u %16.2f %16.2f %7.2fx\n", n, l, u, l ? u / l : 0.0);
+
+		if (n == max_threads)
+			break;
+	}
+
+	pthread_mutex_destroy(&locked.lock);
+	pthread_mutex_destroy(&unlocked.lock);
+	free((void *)bar);
+
+	if (errors)
+		printf("%d MMIO errors\n", errors);
+
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef __OPAE_TESTS_MOCK_VFIO_H__
+#define __OPAE_TESTS_MOCK_VFIO_H__
+
+#include <string.h>
+#include <pthread.h>
+
+#include "opae_vfio.h"
+
+/*
+ * A vfio_token/vfio_handle pair whose single user MMIO region is backed
+ * by ordinary memory, for exercising the vfio plugin MMIO paths without
+ * a device.
+ */
+
+#define MOCK_BAR_SIZE 4096
+
+static inline int init_mock_handle(vfio_handle *h, vfio_token *t,
+				   volatile uint8_t *bar, uint32_t flags)
+{
+	pthread_mutexattr_t mattr;
+
+	memset(t, 0, sizeof(*t));
+	t->magic = VFIO_TOKEN_MAGIC;
+	t->type = FPGA_ACCELERATOR;
+	t->mmio_size = MOCK_BAR_SIZE;
+	t->user_mmio_count = 1;
+
+	memset(h, 0, sizeof(*h));
+	h->magic = VFIO_HANDLE_MAGIC;
+	h->token = t;
+	h->mmio_base = bar;
+	h->mmio_size = MOCK_BAR_SIZE;
+	h->flags = flags;
+
+	if (pthread_mutexattr_init(&mattr))
+		return 1;
+	if (pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE) ||
+	    pthread_mutex_init(&h->lock, &mattr)) {
+		pthread_mutexattr_destroy(&mattr);
+		return 1;
+	}
+	pthread_mutexattr_destroy(&mattr);
+	return 0;
+}
+
+#endif // __OPAE_TESTS_MOCK_VFIO_H__
@@ -0,0 +1,155 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <opae/vfio.h>
+
+/*
+ * Stage a set of host buffers for DMA by two devices, first with one
+ * container per device and then with both devices in one container.
+ * Reports the time to map the buffers and the number of bytes pinned.
+ * Requires two devices bound to vfio-pci and, for sizes above 4KB,
+ * configured huge pages.
+ */
+
+#define DEFAULT_BUFFERS 16
+#define DEFAULT_SIZE (2 * 1024 * 1024)
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Allocate count buffers on each of the n devices in v.
+// Returns the bytes pinned and sets *elapsed to the time taken.
+static uint64_t stage(struct opae_vfio *v[], int n, size_t size,
+		      unsigned long count, double *elapsed, int *errors)
+{
+	double start = now_sec();
+	uint64_t pinned = 0;
+	unsigned long i;
+	int d;
+
+	for (d = 0 ; d < n ; ++d) {
+		for (i = 0 ; i < count ; ++i) {
+			size_t sz = size;
+			uint8_t *buf = NULL;
+
+			if (opae_vfio_buffer_allocate(v[d], &sz, &buf, NULL)) {
+				++*errors;
+				break;
+			}
+			buf[0] = (uint8_t)i;
+			pinned += sz;
+		}
+	}
+
+	*elapsed = now_sec() - start;
+	return pinned;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long count = DEFAULT_BUFFERS;
+	size_t size = DEFAULT_SIZE;
+	struct opae_vfio card0;
+	struct opae_vfio card1;
+	struct opae_vfio *both[2] = { &card0, &card1 };
+	uint64_t separate_bytes;
+	uint64_t shared_bytes;
+	double separate_sec;
+	double shared_sec;
+	int errors = 0;
+
+	if (argc < 3) {
+		printf("usage: vfio_shared_container_bench <pciaddr0> "
+		       "<pciaddr1> [buffers] [size]\n");
+		return 1;
+	}
+	if (argc > 3)
+		count = strtoul(argv[3], NULL, 0);
+	if (argc > 4)
+		size = strtoul(argv[4], NULL, 0);
+	if (!count || !size) {
+		printf("buffers and size must be > 0\n");
+		return 1;
+	}
+
+	// One container per device: each device needs its own copy.
+	if (opae_vfio_open(&card0, argv[1])) {
+		printf("failed to open %s\n", argv[1]);
+		return 1;
+	}
+	if (opae_vfio_open(&card1, argv[2])) {
+		printf("failed to open %s\n", argv[2]);
+		opae_vfio_close(&card0);
+		return 1;
+	}
+
+	separate_bytes = stage(both, 2, size, count,
+			       &separate_sec, &errors);
+
+	opae_vfio_close(&card1);
+	opae_vfio_close(&card0);
+
+	// One shared container: a single copy is visible to both.
+	if (opae_vfio_open(&card0, argv[1])) {
+		printf("failed to open %s\n", argv[1]);
+		return 1;
+	}
+	if (opae_vfio_open_shared(&card1, &card0, argv[2], NULL)) {
+		printf("failed to open %s into the container of %s\n",
+		       argv[2], argv[1]);
+		opae_vfio_close(&card0);
+		return 1;
+	}
+
+	shared_bytes = stage(both, 1, size, count, &shared_sec, &errors);
+
+	opae_vfio_close(&card1);
+	opae_vfio_close(&card0);
+
+	printf("%-10s %16s %12s\n", "container", "pinned bytes", "map ms");
+	printf("%-10s %16lu %12.3f\n", "separate",
+	       separate_bytes, separate_sec * 1e3);
+	printf("%-10s %16lu %12.3f\n", "shared",
+	       shared_bytes, shared_sec * 1e3);
+
+	if (errors)
+		printf("%d allocation errors\n", errors);
+
+	return errors ? 1 : 0;
+}
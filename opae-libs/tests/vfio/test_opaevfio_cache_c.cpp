@@ -0,0 +1,161 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <config.h>
+#include <opae/vfio.h>
+#include <sys/mman.h>
+
+#include <cstdlib>
+#include <cstring>
+#include "gtest/gtest.h"
+
+#define SIZE_2M (2UL * 1024 * 1024)
+
+/*
+ * The device is built by hand with no container fd and no free IOVA
+ * space, so an allocation that misses the buffer cache fails instead
+ * of mapping a new buffer. Each test seeds the cache with buffers of
+ * known placement and checks which requests they serve.
+ */
+class opaevfio_cache_c : public ::testing::Test {
+ protected:
+  opaevfio_cache_c() {}
+
+  virtual void SetUp() override {
+    pthread_mutexattr_t mattr;
+
+    memset(&v_, 0, sizeof(v_));
+    v_.cont_fd = -1;
+    v_.group.group_fd = -1;
+    v_.device.device_fd = -1;
+    mem_alloc_init(&v_.iova_alloc);
+    ASSERT_EQ(mem_alloc_add_free(&v_.iova_alloc, 0x100000000, 4 * SIZE_2M),
+              0);
+
+    ASSERT_EQ(pthread_mutexattr_init(&mattr), 0);
+    ASSERT_EQ(pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE), 0);
+    ASSERT_EQ(pthread_mutex_init(&v_.lock, &mattr), 0);
+    pthread_mutexattr_destroy(&mattr);
+
+    ASSERT_EQ(opae_vfio_buffer_cache_enable(&v_, 8, 8 * SIZE_2M), 0);
+  }
+
+  virtual void TearDown() override {
+    opae_vfio_close(&v_);
+  }
+
+  // Return a 2MB buffer placed as given to the cache, as
+  // opae_vfio_buffer_free would.
+  uint8_t *cache(int numa_node, uint32_t flags, uint64_t page_size) {
+    uint8_t *buf = NULL;
+    uint64_t iova = 0;
+    struct opae_vfio_buffer *b;
+
+    EXPECT_EQ(mem_alloc_get(&v_.iova_alloc, &iova, SIZE_2M), 0);
+    buf = (uint8_t *)mmap(NULL, SIZE_2M, PROT_READ|PROT_WRITE,
+                          MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    EXPECT_NE(buf, MAP_FAILED);
+    b = (struct opae_vfio_buffer *)calloc(1, sizeof(*b));
+    EXPECT_NE(b, nullptr);
+    b->buffer_ptr = buf;
+    b->buffer_size = SIZE_2M;
+    b->buffer_iova = iova;
+    b->buffer_requested = SIZE_2M;
+    b->buffer_page_size = page_size;
+    b->buffer_numa_node = numa_node;
+    b->buffer_flags = flags;
+    b->next = v_.cont_buffers;
+    v_.cont_buffers = b;
+    EXPECT_EQ(opae_vfio_buffer_free(&v_, buf), 0);
+    return buf;
+  }
+
+  uint8_t *allocate(size_t size, uint32_t flags, int numa_node) {
+    uint8_t *buf = NULL;
+
+    if (opae_vfio_buffer_allocate_ex(&v_, &size, &buf, NULL,
+                                     flags, numa_node))
+      return NULL;
+    EXPECT_EQ(size, SIZE_2M);
+    return buf;
+  }
+
+  struct opae_vfio v_;
+};
+
+/**
+ * @test       numa_node
+ * @brief      Test: opae_vfio_buffer_allocate_ex
+ * @details    A request for a node is served only by a cached buffer<br>
+ *             on that node, a required node only by a buffer that was<br>
+ *             required on it, and a request without a node by any.<br>
+ */
+TEST_F(opaevfio_cache_c, numa_node) {
+  uint8_t *preferred = cache(1, OPAE_VFIO_BUF_NUMA_PREFERRED, SIZE_2M);
+  uint8_t *bound = cache(0, 0, SIZE_2M);
+
+  EXPECT_EQ(allocate(SIZE_2M, 0, 2), nullptr);
+  EXPECT_EQ(allocate(SIZE_2M, 0, 1), nullptr);
+  EXPECT_EQ(allocate(SIZE_2M, OPAE_VFIO_BUF_NUMA_PREFERRED, 1), preferred);
+  EXPECT_EQ(allocate(SIZE_2M, OPAE_VFIO_BUF_NUMA_PREFERRED, 0), bound);
+
+  EXPECT_EQ(opae_vfio_buffer_free(&v_, bound), 0);
+  EXPECT_EQ(allocate(SIZE_2M, 0, -1), bound);
+}
+
+/**
+ * @test       page_size
+ * @brief      Test: opae_vfio_buffer_allocate_ex
+ * @details    A request is rounded to the page size a new buffer<br>
+ *             would use, so a small request that would get a 2MB<br>
+ *             page is served by a cached 2MB buffer. A buffer that<br>
+ *             fell back to smaller pages doesn't serve a request<br>
+ *             made with OPAE_VFIO_BUF_NO_FALLBACK.<br>
+ */
+TEST_F(opaevfio_cache_c, page_size) {
+  uint8_t *small = cache(-1, 0, 4096);
+
+  EXPECT_EQ(allocate(SIZE_2M - 4096, OPAE_VFIO_BUF_NO_FALLBACK, -1), nullptr);
+  EXPECT_EQ(allocate(SIZE_2M / 2 + 1, 0, -1), small);
+}
+
+/**
+ * @test       read_only
+ * @brief      Test: opae_vfio_buffer_allocate_ex
+ * @details    A buffer the device may only read serves only<br>
+ *             OPAE_VFIO_BUF_READ_ONLY requests, and a writable<br>
+ *             buffer only the others.<br>
+ */
+TEST_F(opaevfio_cache_c, read_only) {
+  uint8_t *ro = cache(-1, OPAE_VFIO_BUF_READ_ONLY, SIZE_2M);
+
+  EXPECT_EQ(allocate(SIZE_2M, 0, -1), nullptr);
+  EXPECT_EQ(allocate(SIZE_2M, OPAE_VFIO_BUF_READ_ONLY, -1), ro);
+
+  uint8_t *rw = cache(-1, 0, SIZE_2M);
+  EXPECT_EQ(allocate(SIZE_2M, OPAE_VFIO_BUF_READ_ONLY, -1), nullptr);
+  EXPECT_EQ(allocate(SIZE_2M, 0, -1), rw);
+}
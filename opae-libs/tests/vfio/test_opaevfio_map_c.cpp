@@ -0,0 +1,105 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <config.h>
+#include <opae/vfio.h>
+
+#include <cstdlib>
+#include <cstring>
+#include "gtest/gtest.h"
+
+/*
+ * The device is built by hand with no container fd behind it, so the
+ * DMA unmap ioctl fails harmlessly and only the library's bookkeeping
+ * of caller-owned mappings is exercised.
+ */
+class opaevfio_map_c : public ::testing::Test {
+ protected:
+  opaevfio_map_c() {}
+
+  virtual void SetUp() override {
+    pthread_mutexattr_t mattr;
+
+    memset(&v_, 0, sizeof(v_));
+    v_.cont_fd = -1;
+    v_.group.group_fd = -1;
+    v_.device.device_fd = -1;
+    mem_alloc_init(&v_.iova_alloc);
+    ASSERT_EQ(mem_alloc_add_free(&v_.iova_alloc, 0x100000, 0x100000), 0);
+
+    ASSERT_EQ(pthread_mutexattr_init(&mattr), 0);
+    ASSERT_EQ(pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE), 0);
+    ASSERT_EQ(pthread_mutex_init(&v_.lock, &mattr), 0);
+    pthread_mutexattr_destroy(&mattr);
+  }
+
+  virtual void TearDown() override {
+    opae_vfio_close(&v_);
+  }
+
+  // Record a mapping of buf as opae_vfio_buffer_map would.
+  uint64_t add_mapping(uint8_t *buf, uint64_t size) {
+    uint64_t iova = 0;
+    struct opae_vfio_buffer *b;
+
+    EXPECT_EQ(mem_alloc_get(&v_.iova_alloc, &iova, size), 0);
+    b = (struct opae_vfio_buffer *)calloc(1, sizeof(*b));
+    EXPECT_NE(b, nullptr);
+    b->buffer_ptr = buf;
+    b->buffer_size = size;
+    b->buffer_iova = iova;
+    b->next = v_.cont_user_buffers;
+    v_.cont_user_buffers = b;
+    return iova;
+  }
+
+  struct opae_vfio v_;
+};
+
+/**
+ * @test       unmap_by_iova
+ * @brief      Test: opae_vfio_buffer_unmap
+ * @details    When one buffer is mapped twice, each unmap removes<br>
+ *             only the mapping at the given IOVA, and an IOVA that<br>
+ *             doesn't belong to the buffer is rejected.<br>
+ */
+TEST_F(opaevfio_map_c, unmap_by_iova) {
+  uint8_t *buf = (uint8_t *)0x7f0000000000;
+  uint64_t first = add_mapping(buf, 0x1000);
+  uint64_t second = add_mapping(buf, 0x1000);
+  ASSERT_NE(first, second);
+
+  EXPECT_NE(opae_vfio_buffer_unmap(&v_, buf, second + 0x1000), 0);
+
+  EXPECT_EQ(opae_vfio_buffer_unmap(&v_, buf, first), 0);
+  ASSERT_NE(v_.cont_user_buffers, nullptr);
+  EXPECT_EQ(v_.cont_user_buffers->buffer_iova, second);
+  EXPECT_EQ(v_.cont_user_buffers->next, nullptr);
+
+  EXPECT_NE(opae_vfio_buffer_unmap(&v_, buf, first), 0);
+  EXPECT_EQ(opae_vfio_buffer_unmap(&v_, buf, second), 0);
+  EXPECT_EQ(v_.cont_user_buffers, nullptr);
+}
@@ -0,0 +1,114 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <config.h>
+#include <opae/vfio.h>
+
+#include <cstdlib>
+#include <cstring>
+#include "gtest/gtest.h"
+
+/*
+ * Each test builds an owner and a member device by hand, with no
+ * group, device or container fds behind them, so that opae_vfio_close
+ * runs its container bookkeeping without a device bound to vfio-pci.
+ */
+class opaevfio_shared_c : public ::testing::Test {
+ protected:
+  opaevfio_shared_c() {}
+
+  virtual void SetUp() override {
+    fake_open(&owner_);
+    owner_.cont_device = strdup("/dev/vfio/vfio");
+    ASSERT_NE(owner_.cont_device, nullptr);
+
+    fake_open(&member_);
+    member_.cont_device = strdup(owner_.cont_device);
+    ASSERT_NE(member_.cont_device, nullptr);
+    member_.cont_owner = &owner_;
+    ++owner_.cont_users;
+  }
+
+  void fake_open(struct opae_vfio *v) {
+    pthread_mutexattr_t mattr;
+
+    memset(v, 0, sizeof(*v));
+    v->cont_fd = -1;
+    v->group.group_fd = -1;
+    v->device.device_fd = -1;
+    mem_alloc_init(&v->iova_alloc);
+
+    ASSERT_EQ(pthread_mutexattr_init(&mattr), 0);
+    ASSERT_EQ(pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE), 0);
+    ASSERT_EQ(pthread_mutex_init(&v->lock, &mattr), 0);
+    pthread_mutexattr_destroy(&mattr);
+  }
+
+  struct opae_vfio owner_;
+  struct opae_vfio member_;
+};
+
+/**
+ * @test       close_member_first
+ * @brief      Test: opae_vfio_close
+ * @details    Closing a member releases only the member,<br>
+ *             and the owner closes immediately afterwards.<br>
+ */
+TEST_F(opaevfio_shared_c, close_member_first) {
+  opae_vfio_close(&member_);
+  EXPECT_EQ(member_.cont_owner, nullptr);
+  EXPECT_EQ(member_.cont_device, nullptr);
+  EXPECT_EQ(owner_.cont_users, 0);
+  EXPECT_NE(owner_.cont_device, nullptr);
+
+  opae_vfio_close(&owner_);
+  EXPECT_EQ(owner_.cont_device, nullptr);
+}
+
+/**
+ * @test       close_owner_first
+ * @brief      Test: opae_vfio_close, opae_vfio_open_shared
+ * @details    Closing the owner while a member remains defers<br>
+ *             its release, and no device can join the container.<br>
+ *             Closing the last member completes the owner's close.<br>
+ */
+TEST_F(opaevfio_shared_c, close_owner_first) {
+  struct opae_vfio other;
+
+  opae_vfio_close(&owner_);
+  EXPECT_EQ(owner_.cont_close_pending, 1);
+  EXPECT_EQ(owner_.cont_users, 1);
+  EXPECT_NE(owner_.cont_device, nullptr);
+
+  EXPECT_NE(opae_vfio_open_shared(&other, &member_, "0000:00:00.0", NULL),
+            0);
+  EXPECT_EQ(owner_.cont_users, 1);
+
+  opae_vfio_close(&member_);
+  EXPECT_EQ(member_.cont_owner, nullptr);
+  EXPECT_EQ(owner_.cont_users, 0);
+  EXPECT_EQ(owner_.cont_device, nullptr);
+}
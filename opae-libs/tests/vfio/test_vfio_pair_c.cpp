@@ -0,0 +1,231 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+extern "C" {
+
+#include <pthread.h>
+// vfio_buffer has a member named virtual
+#define virtual virtual_
+#include "opae_vfio.h"
+#undef virtual
+
+vfio_pair_t *get_vfio_pair(pci_device_t *p);
+void put_vfio_pair(vfio_pair_t **pair);
+fpga_result get_handle_vfio_pair(pci_device_t *p, int flags,
+                                 vfio_pair_t **pair);
+void put_handle_vfio_pair(vfio_pair_t **pair);
+extern pci_device_t *_pci_devices;
+extern pthread_mutex_t _pair_lock;
+extern bool _pair_reaper_running;
+
+}
+
+#include <config.h>
+#include <opae/fpga.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "gtest/gtest.h"
+
+/*
+ * Each test hands the cache a device whose pair is already "open": a
+ * vfio_pair_t with no opae_vfio behind it, which close_vfio_pair() simply
+ * frees. So the cache, refcount and reaper logic run without a device.
+ */
+class vfio_pair_c : public ::testing::Test {
+ protected:
+  vfio_pair_c() {}
+
+  virtual void SetUp() override {
+    memset(&dev_, 0, sizeof(dev_));
+    strcpy(dev_.addr, "0000:00:00.0");
+    pair_ = (vfio_pair_t *)calloc(1, sizeof(vfio_pair_t));
+    ASSERT_NE(pair_, nullptr);
+    pair_->owner = &dev_;
+    dev_.pair = pair_;
+    _pci_devices = &dev_;
+  }
+
+  virtual void TearDown() override {
+    vfio_pair_cache_release();
+    EXPECT_EQ(dev_.pair, nullptr);
+    _pci_devices = nullptr;
+    EXPECT_EQ(0, unsetenv("LIBOPAE_VFIO_IDLE_MSEC"));
+    vfio_pair_cache_init();
+  }
+
+  void set_idle_msec(const char *msec) {
+    ASSERT_EQ(0, setenv("LIBOPAE_VFIO_IDLE_MSEC", msec, 1));
+    vfio_pair_cache_init();
+  }
+
+  vfio_pair_t *cached() {
+    vfio_pair_t *pair;
+    pthread_mutex_lock(&_pair_lock);
+    pair = dev_.pair;
+    pthread_mutex_unlock(&_pair_lock);
+    return pair;
+  }
+
+  pci_device_t dev_;
+  vfio_pair_t *pair_;
+};
+
+/**
+ * @test       cache_reuse
+ * @brief      Test: get_vfio_pair, put_vfio_pair
+ * @details    Each token walk of a device reuses its cached pair,<br>
+ *             counting one reference per user,<br>
+ *             and the pair stays cached while it is idle.<br>
+ */
+TEST_F(vfio_pair_c, cache_reuse) {
+  set_idle_msec("60000");
+
+  vfio_pair_t *a = get_vfio_pair(&dev_);
+  vfio_pair_t *b = get_vfio_pair(&dev_);
+  EXPECT_EQ(a, pair_);
+  EXPECT_EQ(b, pair_);
+  EXPECT_EQ(pair_->refcount, 2);
+  EXPECT_EQ(pair_->handles, 0);
+
+  put_vfio_pair(&a);
+  EXPECT_EQ(a, nullptr);
+  EXPECT_EQ(pair_->refcount, 1);
+  put_vfio_pair(&b);
+  EXPECT_EQ(pair_->refcount, 0);
+  EXPECT_EQ(cached(), pair_);
+}
+
+/**
+ * @test       open_exclusive
+ * @brief      Test: get_handle_vfio_pair, put_handle_vfio_pair
+ * @details    A handle opened without FPGA_OPEN_SHARED holds the device<br>
+ *             alone: further opens return FPGA_BUSY until it closes,<br>
+ *             while token walks still share the pair. Shared handles<br>
+ *             coexist and keep unshared opens out.<br>
+ */
+TEST_F(vfio_pair_c, open_exclusive) {
+  vfio_pair_t *h0 = nullptr;
+  vfio_pair_t *h1 = nullptr;
+  vfio_pair_t *h2 = nullptr;
+  set_idle_msec("60000");
+
+  ASSERT_EQ(get_handle_vfio_pair(&dev_, 0, &h0), FPGA_OK);
+  EXPECT_EQ(h0, pair_);
+  EXPECT_EQ(pair_->handles, 1);
+  EXPECT_TRUE(pair_->exclusive);
+  EXPECT_EQ(get_handle_vfio_pair(&dev_, 0, &h1), FPGA_BUSY);
+  EXPECT_EQ(h1, nullptr);
+  EXPECT_EQ(get_handle_vfio_pair(&dev_, FPGA_OPEN_SHARED, &h1), FPGA_BUSY);
+  EXPECT_EQ(pair_->refcount, 1);
+
+  vfio_pair_t *walk = get_vfio_pair(&dev_);
+  EXPECT_EQ(walk, pair_);
+  EXPECT_EQ(pair_->refcount, 2);
+  EXPECT_EQ(pair_->handles, 1);
+  put_vfio_pair(&walk);
+
+  put_handle_vfio_pair(&h0);
+  EXPECT_EQ(pair_->handles, 0);
+  EXPECT_FALSE(pair_->exclusive);
+
+  ASSERT_EQ(get_handle_vfio_pair(&dev_, FPGA_OPEN_SHARED, &h1), FPGA_OK);
+  ASSERT_EQ(get_handle_vfio_pair(&dev_, FPGA_OPEN_SHARED, &h2), FPGA_OK);
+  EXPECT_EQ(h1, pair_);
+  EXPECT_EQ(h2, pair_);
+  EXPECT_EQ(pair_->handles, 2);
+  EXPECT_EQ(get_handle_vfio_pair(&dev_, 0, &h0), FPGA_BUSY);
+
+  put_handle_vfio_pair(&h1);
+  put_handle_vfio_pair(&h2);
+  EXPECT_EQ(pair_->refcount, 0);
+  EXPECT_EQ(pair_->handles, 0);
+
+  // a walk alone doesn't block an unshared open
+  walk = get_vfio_pair(&dev_);
+  ASSERT_EQ(get_handle_vfio_pair(&dev_, 0, &h0), FPGA_OK);
+  put_handle_vfio_pair(&h0);
+  put_vfio_pair(&walk);
+  EXPECT_EQ(cached(), pair_);
+}
+
+/**
+ * @test       idle_reaper
+ * @brief      Test: put_vfio_pair
+ * @details    When LIBOPAE_VFIO_IDLE_MSEC is set,<br>
+ *             an unused pair is closed by the reaper thread<br>
+ *             once it has been idle that long.<br>
+ */
+TEST_F(vfio_pair_c, idle_reaper) {
+  set_idle_msec("20");
+
+  vfio_pair_t *pair = get_vfio_pair(&dev_);
+  ASSERT_EQ(pair, pair_);
+  put_vfio_pair(&pair);
+  EXPECT_TRUE(_pair_reaper_running);
+
+  for (int i = 0; i < 100 && cached(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(cached(), nullptr);
+}
+
+/**
+ * @test       idle_zero
+ * @brief      Test: put_vfio_pair
+ * @details    When LIBOPAE_VFIO_IDLE_MSEC is 0,<br>
+ *             a pair is closed as soon as its last user lets go.<br>
+ */
+TEST_F(vfio_pair_c, idle_zero) {
+  set_idle_msec("0");
+
+  vfio_pair_t *h0 = nullptr;
+  ASSERT_EQ(get_handle_vfio_pair(&dev_, 0, &h0), FPGA_OK);
+  vfio_pair_t *walk = get_vfio_pair(&dev_);
+  put_handle_vfio_pair(&h0);
+  EXPECT_EQ(cached(), pair_);
+  put_vfio_pair(&walk);
+  EXPECT_EQ(cached(), nullptr);
+}
+
+/**
+ * @test       idle_default
+ * @brief      Test: put_vfio_pair
+ * @details    When LIBOPAE_VFIO_IDLE_MSEC is not set, a pair opened<br>
+ *             only to walk the device is closed once the walk ends,<br>
+ *             and no reaper thread is started.<br>
+ */
+TEST_F(vfio_pair_c, idle_default) {
+  EXPECT_EQ(0, unsetenv("LIBOPAE_VFIO_IDLE_MSEC"));
+  vfio_pair_cache_init();
+
+  vfio_pair_t *walk = get_vfio_pair(&dev_);
+  ASSERT_EQ(walk, pair_);
+  put_vfio_pair(&walk);
+  EXPECT_EQ(cached(), nullptr);
+  EXPECT_FALSE(_pair_reaper_running);
+}
@@ -0,0 +1,182 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <opae/fpga.h>
+
+/*
+ * Latency of fpgaEnumerate() with and without the xfpga enumeration
+ * cache. The warm pass runs in this process; the cold pass re-executes
+ * the benchmark with LIBOPAE_NO_ENUM_CACHE set so that every call walks
+ * sysfs. Both passes enumerate all objects, then accelerators by state,
+ * which forces the cached AFU nodes to be re-synced.
+ */
+
+#define DEFAULT_ITERATIONS 1000
+#define MAX_TOKENS 64
+
+static double now_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int run_pass(const char *name, fpga_properties filter,
+		    unsigned long iterations)
+{
+	fpga_token tokens[MAX_TOKENS];
+	uint32_t num_matches = 0;
+	double *lat;
+	double first;
+	double total = 0.0;
+	unsigned long i;
+	uint32_t j;
+
+	lat = calloc(iterations, sizeof(double));
+	if (!lat)
+		return 1;
+
+	for (i = 0 ; i <= iterations ; ++i) {
+		double start = now_usec();
+		double elapsed;
+
+		if (fpgaEnumerate(filter ? &filter : NULL, filter ? 1 : 0,
+				  tokens, MAX_TOKENS, &num_matches) != FPGA_OK) {
+			printf("fpgaEnumerate failed\n");
+			free(lat);
+			return 1;
+		}
+
+		elapsed = now_usec() - start;
+
+		for (j = 0 ; j < num_matches && j < MAX_TOKENS ; ++j)
+			fpgaDestroyToken(&tokens[j]);
+
+		if (!i) {
+			first = elapsed;
+		} else {
+			lat[i - 1] = elapsed;
+			total += elapsed;
+		}
+	}
+
+	qsort(lat, iterations, sizeof(double), cmp_double);
+
+	printf("%-6s %-12s %8u %12.1f %12.1f %12.1f %12.1f\n",
+	       name, filter ? "accel/state" : "all", num_matches, first,
+	       total / iterations, lat[iterations / 2],
+	       lat[(iterations * 99) / 100]);
+
+	free(lat);
+	return 0;
+}
+
+static int run(const char *name, unsigned long iterations)
+{
+	fpga_properties filter = NULL;
+	int res;
+
+	res = run_pass(name, NULL, iterations);
+	if (res)
+		return res;
+
+	if (fpgaGetProperties(NULL, &filter) != FPGA_OK ||
+	    fpgaPropertiesSetObjectType(filter, FPGA_ACCELERATOR) != FPGA_OK ||
+	    fpgaPropertiesSetAcceleratorState(filter,
+			FPGA_ACCELERATOR_UNASSIGNED) != FPGA_OK) {
+		printf("failed to create filter\n");
+		if (filter)
+			fpgaDestroyProperties(&filter);
+		return 1;
+	}
+
+	res = run_pass(name, filter, iterations);
+	fpgaDestroyProperties(&filter);
+	return res;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long iterations = DEFAULT_ITERATIONS;
+	pid_t pid;
+	int status;
+	int res;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (!iterations) {
+		printf("usage: xfpga_enum_bench [iterations]\n");
+		return 1;
+	}
+
+	if (getenv("LIBOPAE_NO_ENUM_CACHE"))
+		return run("cold", iterations);
+
+	printf("%-6s %-12s %8s %12s %12s %12s %12s\n",
+	       "cache", "filter", "matches", "first us",
+	       "mean us", "p50 us", "p99 us");
+
+	res = run("warm", iterations);
+	if (res)
+		return res;
+
+	fflush(stdout);
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+
+	if (!pid) {
+		setenv("LIBOPAE_NO_ENUM_CACHE", "1", 1);
+		execv("/proc/self/exe", argv);
+		perror("execv");
+		_exit(1);
+	}
+
+	if (waitpid(pid, &status, 0) < 0 ||
+	    !WIFEXITED(status))
+		return 1;
+
+	return WEXITSTATUS(status);
+}
@@ -0,0 +1,164 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+extern "C" {
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include "enum_cache.h"
+
+bool is_fpga_name(const char *name);
+bool drain_inotify(int fd);
+bool drain_uevent(int fd);
+}
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string>
+#include "gtest/gtest.h"
+
+/**
+ * @test       is_fpga_name
+ * @brief      Test: is_fpga_name
+ * @details    Given a device node name,<br>
+ *             is_fpga_name returns true only for dfl and intel-fpga<br>
+ *             FME and port nodes.<br>
+ */
+TEST(enum_cache_c, is_fpga_name) {
+  EXPECT_TRUE(is_fpga_name("dfl-fme.0"));
+  EXPECT_TRUE(is_fpga_name("dfl-port.1"));
+  EXPECT_TRUE(is_fpga_name("intel-fpga-fme.0"));
+  EXPECT_TRUE(is_fpga_name("intel-fpga-port.0"));
+  EXPECT_FALSE(is_fpga_name("tty0"));
+  EXPECT_FALSE(is_fpga_name("vfio"));
+}
+
+/**
+ * @test       drain_uevent
+ * @brief      Test: drain_uevent
+ * @details    Given a datagram socket with queued uevent messages,<br>
+ *             drain_uevent consumes all of them and returns true<br>
+ *             only when one refers to an FPGA kobject.<br>
+ */
+TEST(enum_cache_c, drain_uevent) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sv), 0);
+
+  const char net[] = "add@/devices/virtual/net/veth0\0"
+                     "ACTION=add\0SUBSYSTEM=net";
+  const char region[] = "remove@/devices/pci0000:00/0000:00:01.0/"
+                        "fpga_region/region0\0"
+                        "ACTION=remove\0SUBSYSTEM=fpga_region";
+
+  EXPECT_FALSE(drain_uevent(sv[0]));
+
+  ASSERT_EQ(send(sv[1], net, sizeof(net), 0), (ssize_t)sizeof(net));
+  EXPECT_FALSE(drain_uevent(sv[0]));
+
+  ASSERT_EQ(send(sv[1], net, sizeof(net), 0), (ssize_t)sizeof(net));
+  ASSERT_EQ(send(sv[1], region, sizeof(region), 0), (ssize_t)sizeof(region));
+  ASSERT_EQ(send(sv[1], net, sizeof(net), 0), (ssize_t)sizeof(net));
+  EXPECT_TRUE(drain_uevent(sv[0]));
+
+  // The queue was fully drained.
+  EXPECT_FALSE(drain_uevent(sv[0]));
+
+  close(sv[0]);
+  close(sv[1]);
+}
+
+/**
+ * @test       drain_inotify
+ * @brief      Test: drain_inotify
+ * @details    Given an inotify watch on a directory,<br>
+ *             drain_inotify returns true only when an FPGA<br>
+ *             device node was created or removed there.<br>
+ */
+TEST(enum_cache_c, drain_inotify) {
+  char tmpl[] = "/tmp/enum_cache_c-XXXXXX";
+  ASSERT_NE(mkdtemp(tmpl), nullptr);
+  std::string dir(tmpl);
+
+  int fd = inotify_init1(IN_NONBLOCK);
+  ASSERT_GE(fd, 0);
+  ASSERT_GE(inotify_add_watch(fd, tmpl,
+                              IN_CREATE | IN_DELETE), 0);
+
+  EXPECT_FALSE(drain_inotify(fd));
+
+  std::string other = dir + "/ttyX";
+  int f = open(other.c_str(), O_CREAT | O_WRONLY, 0600);
+  ASSERT_GE(f, 0);
+  close(f);
+  EXPECT_FALSE(drain_inotify(fd));
+
+  std::string port = dir + "/dfl-port.0";
+  f = open(port.c_str(), O_CREAT | O_WRONLY, 0600);
+  ASSERT_GE(f, 0);
+  close(f);
+  EXPECT_TRUE(drain_inotify(fd));
+  EXPECT_FALSE(drain_inotify(fd));
+
+  EXPECT_EQ(unlink(port.c_str()), 0);
+  EXPECT_TRUE(drain_inotify(fd));
+
+  EXPECT_EQ(unlink(other.c_str()), 0);
+  EXPECT_EQ(rmdir(tmpl), 0);
+  close(fd);
+}
+
+/**
+ * @test       invalidate
+ * @brief      Test: enum_cache_invalidate
+ * @details    enum_cache_invalidate always moves the generation.<br>
+ */
+TEST(enum_cache_c, invalidate) {
+  EXPECT_EQ(enum_cache_initialize(), 0);
+  uint64_t gen = enum_cache_generation();
+  enum_cache_invalidate();
+  EXPECT_NE(enum_cache_generation(), gen);
+  enum_cache_finalize();
+}
+
+/**
+ * @test       disabled
+ * @brief      Test: enum_cache_generation
+ * @details    When LIBOPAE_NO_ENUM_CACHE is set,<br>
+ *             every call to enum_cache_generation returns<br>
+ *             a new generation.<br>
+ */
+TEST(enum_cache_c, disabled) {
+  ASSERT_EQ(setenv("LIBOPAE_NO_ENUM_CACHE", "1", 1), 0);
+  EXPECT_EQ(enum_cache_initialize(), 0);
+  uint64_t gen = enum_cache_generation();
+  EXPECT_NE(enum_cache_generation(), gen);
+  enum_cache_finalize();
+  unsetenv("LIBOPAE_NO_ENUM_CACHE");
+}
@@ -584,5 +584,56 @@ TEST_P(metrics_afu_c_p, test_afc_metric_04) {
 
   free(metric_array_search);
 }
+
+/**
+* @test    test_afc_metric_05
+* @brief   Tests: xfpga_fpgaGetMetricsSnapshot
+* @details Validates that a snapshot returns every AFU metric,
+*          indexed by metric number, and that max_age_usec
+*          controls whether the hardware is read again.
+*
+*/
+TEST_P(metrics_afu_c_p, test_afc_metric_05) {
+  create_metric_bbb_dfh();
+  create_metric_bbb_csr();
+
+  uint64_t num_metrics = 0;
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaGetNumMetrics(handle_, &num_metrics));
+  ASSERT_GT(num_metrics, 0);
+
+  std::vector<fpga_metric> metrics(num_metrics + 1);
+  uint64_t count = metrics.size();
+  uint64_t ts = 0;
+
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaGetMetricsSnapshot(handle_, 0, metrics.data(),
+                                                  &count, &ts));
+  EXPECT_EQ(count, num_metrics);
+  EXPECT_NE(ts, 0);
+  for (uint64_t i = 0; i < count; ++i) {
+    EXPECT_EQ(metrics[i].metric_num, i);
+    EXPECT_TRUE(metrics[i].isvalid);
+  }
+
+  // A generous max age serves the cached sweep.
+  uint64_t cached_ts = 0;
+  count = metrics.size();
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaGetMetricsSnapshot(handle_, UINT64_MAX,
+                                                  metrics.data(), &count,
+                                                  &cached_ts));
+  EXPECT_EQ(cached_ts, ts);
+
+  // A smaller array is filled up to its size.
+  count = 1;
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaGetMetricsSnapshot(handle_, 0, metrics.data(),
+                                                  &count, nullptr));
+  EXPECT_EQ(count, 1);
+
+  EXPECT_NE(FPGA_OK, xfpga_fpgaGetMetricsSnapshot(nullptr, 0, metrics.data(),
+                                                  &count, nullptr));
+  EXPECT_NE(FPGA_OK, xfpga_fpgaGetMetricsSnapshot(handle_, 0, nullptr,
+                                                  &count, nullptr));
+  EXPECT_NE(FPGA_OK, xfpga_fpgaGetMetricsSnapshot(handle_, 0, metrics.data(),
+                                                  nullptr, nullptr));
+}
 INSTANTIATE_TEST_CASE_P(metrics_c, metrics_afu_c_p,
                         ::testing::ValuesIn(test_platform::mock_platforms({"dcp-rc"})));
@@ -325,6 +325,48 @@ TEST_P(metrics_utils_c_p, test_metric_utils_11) {
                                            &metric_id));
 }
 
+/**
+ * @test       lookup_metric_num
+ * @brief      Tests: lookup_metric_num
+ * @details    The hashed name lookup resolves every enumerated<br>
+ *             metric, ignoring case, to the same number as the<br>
+ *             linear search in parse_metric_num_name.<br>
+ */
+TEST_P(metrics_utils_c_p, lookup_metric_num) {
+  struct _fpga_handle *_handle = (struct _fpga_handle *)handle_;
+
+  EXPECT_EQ(FPGA_OK, enum_fpga_metrics(_handle));
+  ASSERT_NE(_handle->metric_name_hash, nullptr);
+
+  uint64_t total = 0;
+  ASSERT_EQ(FPGA_OK, fpga_vector_total(&_handle->fpga_enum_metric_vector, &total));
+
+  for (uint64_t i = 0; i < total; ++i) {
+    auto m = (struct _fpga_enum_metric *)
+        fpga_vector_get(&_handle->fpga_enum_metric_vector, i);
+    std::string name = std::string(m->qualifier_name) + ":" + m->metric_name;
+    uint64_t hashed = UINT64_MAX;
+    uint64_t linear = UINT64_MAX;
+
+    EXPECT_EQ(FPGA_OK, lookup_metric_num(_handle, name.c_str(), &hashed));
+    EXPECT_EQ(FPGA_OK, parse_metric_num_name(name.c_str(),
+                                             &_handle->fpga_enum_metric_vector,
+                                             &linear));
+    EXPECT_EQ(hashed, linear);
+
+    for (auto &c : name)
+      c = toupper(c);
+    EXPECT_EQ(FPGA_OK, lookup_metric_num(_handle, name.c_str(), &hashed));
+    EXPECT_EQ(hashed, linear);
+  }
+
+  uint64_t metric_id;
+  EXPECT_EQ(FPGA_NOT_FOUND, lookup_metric_num(_handle, "no_such:metric", &metric_id));
+  EXPECT_NE(FPGA_OK, lookup_metric_num(_handle, "power_mgmt consumed", &metric_id));
+  EXPECT_NE(FPGA_OK, lookup_metric_num(_handle, nullptr, &metric_id));
+  EXPECT_NE(FPGA_OK, lookup_metric_num(_handle, "a:b", nullptr));
+}
+
 /**
  * @test       opaec
  * @brief      Tests: enum_fpga_metrics
@@ -372,6 +372,112 @@ TEST_P (mmio_c_p, test_mmio_read_write_64) {
 #endif
 }
 
+/**
+* @test       mmio_c_p
+* @brief      Test: test_mmio_cache
+* @details    Mapping an MMIO region records its base and length in the
+*             handle's mmio_cache, and xfpga_fpgaUnmapMMIO clears it.
+*             Each change moves the entry's generation on, so that an
+*             unlocked access notices a remap at the same base.
+*
+*/
+TEST_P (mmio_c_p, test_mmio_cache) {
+  struct _fpga_handle *h = (struct _fpga_handle *)handle_;
+  uint64_t* mmio_ptr = NULL;
+  uint64_t gen = h->mmio_cache[0].gen;
+
+  EXPECT_EQ(nullptr, h->mmio_cache[0].base);
+
+#ifndef BUILD_ASE
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaMapMMIO(handle_, 0, &mmio_ptr));
+  EXPECT_EQ((uint8_t *)mmio_ptr, h->mmio_cache[0].base);
+  EXPECT_EQ(0x40000, h->mmio_cache[0].len);
+  EXPECT_EQ(gen + 2, h->mmio_cache[0].gen);
+
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaUnmapMMIO(handle_, 0));
+  EXPECT_EQ(nullptr, h->mmio_cache[0].base);
+  EXPECT_EQ(0, h->mmio_cache[0].len);
+  EXPECT_EQ(gen + 4, h->mmio_cache[0].gen);
+#endif
+}
+
+/**
+* @test       mmio_c_p
+* @brief      Test: test_unlocked_read_write_64
+* @details    When the handle is opened with FPGA_OPEN_UNLOCKED_MMIO,
+*             xfpga_fpgaWriteMMIO64/xfpga_fpgaReadMMIO64 read and write
+*             the mapped region and still reject misaligned and
+*             out-of-region offsets, including offsets that wrap
+*             past the end of the address space.
+*
+*/
+TEST_P (mmio_c_p, test_unlocked_read_write_64) {
+  fpga_handle h = nullptr;
+  uint64_t value = 0;
+  uint64_t read_value = 0;
+
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaClose(handle_));
+  handle_ = nullptr;
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaOpen(tokens_[0], &h, FPGA_OPEN_UNLOCKED_MMIO));
+  EXPECT_TRUE(((struct _fpga_handle *)h)->flags & OPAE_FLAG_UNLOCKED_MMIO);
+
+  for (value = 0; value < 100; value += 10) {
+    EXPECT_EQ(FPGA_OK, xfpga_fpgaWriteMMIO64(h, 0, CSR_SCRATCHPAD0, value));
+    EXPECT_EQ(FPGA_OK, xfpga_fpgaReadMMIO64(h, 0, CSR_SCRATCHPAD0, &read_value));
+    EXPECT_EQ(read_value, value);
+  }
+
+  EXPECT_NE(FPGA_OK, xfpga_fpgaWriteMMIO64(h, 0, CSR_SCRATCHPAD0 + 1, value));
+  EXPECT_NE(FPGA_OK, xfpga_fpgaReadMMIO64(h, 0, MMIO_OUT_REGION_ADDRESS, &read_value));
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            xfpga_fpgaReadMMIO64(h, 0, 0xFFFFFFFFFFFFFFF8ULL, &read_value));
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            xfpga_fpgaWriteMMIO32(h, 0, 0xFFFFFFFFFFFFFFFCULL, 0));
+
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaClose(h));
+}
+
+/**
+* @test       mmio_c_p
+* @brief      Test: test_read_write_batch
+* @details    xfpga_fpgaWriteMMIOBatch writes every op of the batch and
+*             xfpga_fpgaReadMMIOBatch reads them back. A batch holding an
+*             out-of-region op is rejected before any op is performed.
+*
+*/
+TEST_P (mmio_c_p, test_read_write_batch) {
+  fpga_mmio_op ops[3] = {
+    { CSR_SCRATCHPAD0, 0x0123456789abcdef, sizeof(uint64_t) },
+    { CSR_SCRATCHPAD0 + 8, 0xfeedf00d, sizeof(uint32_t) },
+    { CSR_SCRATCHPAD0 + 12, 0xcafebabe, sizeof(uint32_t) }
+  };
+  fpga_mmio_op rd[3] = {
+    { CSR_SCRATCHPAD0, 0, sizeof(uint64_t) },
+    { CSR_SCRATCHPAD0 + 8, 0, sizeof(uint32_t) },
+    { CSR_SCRATCHPAD0 + 12, 0, sizeof(uint32_t) }
+  };
+  uint64_t value = 0;
+
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaWriteMMIOBatch(handle_, 0, ops, 3));
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaReadMMIOBatch(handle_, 0, rd, 3));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(ops[i].value, rd[i].value);
+  }
+
+  ops[0].value = 0;
+  ops[2].offset = MMIO_OUT_REGION_ADDRESS;
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaWriteMMIOBatch(handle_, 0, ops, 3));
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaReadMMIO64(handle_, 0, CSR_SCRATCHPAD0, &value));
+  EXPECT_EQ(0x0123456789abcdef, value);
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(handle_, 0, nullptr, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(NULL, 0, rd, 3));
+
+#ifndef BUILD_ASE
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaUnmapMMIO(handle_, 0));
+#endif
+}
+
 /**
 * @test       mmio_c_p
 * @brief      Test: test_neg_read_write_64
@@ -482,6 +588,7 @@ TEST_P (mmio_c_p, test_neg_read_write_512) {
   // Check errors for misaligned or out of boundary memory accesses
   EXPECT_NE(FPGA_OK, xfpga_fpgaWriteMMIO512(handle_, 0, CSR_SCRATCHPAD0 + 1, value));
   EXPECT_NE(FPGA_OK, xfpga_fpgaWriteMMIO512(handle_, 0, MMIO_OUT_REGION_ADDRESS, value));
+  EXPECT_NE(FPGA_OK, xfpga_fpgaWriteMMIO512(handle_, 0, 0xFFFFFFFFFFFFFFC0ULL, value));
 
 // Unmap memory range otherwise, will not accept open from same process
 #ifndef BUILD_ASE
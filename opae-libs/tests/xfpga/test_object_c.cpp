@@ -29,7 +29,11 @@
 #endif // HAVE_CONFIG_H
 
 #include <uuid/uuid.h>
+#include <fcntl.h>
+#include <dirent.h>
 #include <fstream>
+#include <thread>
+#include <vector>
 #include "gtest/gtest.h"
 #include "mock/test_system.h"
 #include "types_int.h"
@@ -275,5 +279,130 @@ TEST_P(sysobject_mock_p, xfpga_fpgaGetSize) {
   EXPECT_EQ(xfpga_fpgaDestroyObject(&object), FPGA_OK);
 }
 
+/**
+ * @test       xfpga_fpgaObjectSync
+ * @brief      Test: xfpga_fpgaObjectSync
+ * @details    When an attribute changes after its object was created,<br>
+ *             xfpga_fpgaObjectSync refreshes the buffered copy,<br>
+ *             keeping the attribute's fd open for later syncs.<br>
+ *             Syncing a container refreshes its subobjects.<br>
+ */
+TEST_P(sysobject_mock_p, xfpga_fpgaObjectSync) {
+  uint32_t num_matches = 0;
+  ASSERT_EQ(xfpga_fpgaEnumerate(&dev_filter_, 1, tokens_.data(), tokens_.size(),
+                                &num_matches),
+            FPGA_OK);
+  ASSERT_GT(num_matches, 0);
+  _fpga_token *tk = static_cast<_fpga_token *>(tokens_[0]);
+  std::string syspath(tk->sysfspath);
+  syspath += "/testdata";
+  auto fp = system_->register_file(syspath);
+  ASSERT_NE(fp, nullptr) << strerror(errno);
+  fputs("0x1234\n", fp);
+  fflush(fp);
+
+  fpga_object object;
+  ASSERT_EQ(xfpga_fpgaTokenGetObject(tokens_[0], "testdata", &object, 0),
+            FPGA_OK);
+  _fpga_object *obj = static_cast<_fpga_object *>(object);
+  EXPECT_EQ(obj->fd, -1);
+
+  uint64_t value = 0;
+  EXPECT_EQ(xfpga_fpgaObjectRead64(object, &value, 0), FPGA_OK);
+  EXPECT_EQ(value, 0x1234);
+
+  rewind(fp);
+  fputs("0x5678\n", fp);
+  fflush(fp);
+  EXPECT_EQ(xfpga_fpgaObjectSync(object), FPGA_OK);
+  EXPECT_GE(obj->fd, 0);
+  EXPECT_EQ(xfpga_fpgaObjectRead64(object, &value, 0), FPGA_OK);
+  EXPECT_EQ(value, 0x5678);
+
+  rewind(fp);
+  fputs("0x9abc\n", fp);
+  fflush(fp);
+  EXPECT_EQ(xfpga_fpgaObjectRead64(object, &value, FPGA_OBJECT_SYNC), FPGA_OK);
+  EXPECT_EQ(value, 0x9abc);
+  fclose(fp);
+  EXPECT_EQ(xfpga_fpgaDestroyObject(&object), FPGA_OK);
+
+  fpga_object group;
+  ASSERT_EQ(xfpga_fpgaTokenGetObject(tokens_[0], "errors", &group,
+                                     FPGA_OBJECT_RECURSE_ONE),
+            FPGA_OK);
+  EXPECT_EQ(xfpga_fpgaObjectSync(group), FPGA_OK);
+  _fpga_object *grp = static_cast<_fpga_object *>(group);
+  for (size_t i = 0; i < grp->size; ++i) {
+    _fpga_object *sub = static_cast<_fpga_object *>(grp->objects[i]);
+    if (sub->type == FPGA_SYSFS_FILE && sub->perm != O_WRONLY)
+      EXPECT_GE(sub->fd, 0) << sub->path;
+  }
+  EXPECT_EQ(xfpga_fpgaDestroyObject(&group), FPGA_OK);
+
+  EXPECT_EQ(xfpga_fpgaObjectSync(nullptr), FPGA_INVALID_PARAM);
+}
+
+static size_t open_fd_count() {
+  size_t count = 0;
+  DIR *dir = opendir("/proc/self/fd");
+  if (!dir)
+    return 0;
+  while (readdir(dir))
+    ++count;
+  closedir(dir);
+  return count;
+}
+
+/**
+ * @test       xfpga_fpgaObjectSync_threads
+ * @brief      Test: xfpga_fpgaObjectSync
+ * @details    When several threads sync and write the same attribute<br>
+ *             concurrently, exactly one fd is cached for it,<br>
+ *             and destroying the object releases every fd.<br>
+ */
+TEST_P(sysobject_mock_p, xfpga_fpgaObjectSync_threads) {
+  uint32_t num_matches = 0;
+  ASSERT_EQ(xfpga_fpgaEnumerate(&dev_filter_, 1, tokens_.data(), tokens_.size(),
+                                &num_matches),
+            FPGA_OK);
+  ASSERT_GT(num_matches, 0);
+  _fpga_token *tk = static_cast<_fpga_token *>(tokens_[0]);
+  std::string syspath(tk->sysfspath);
+  syspath += "/testdata";
+  auto fp = system_->register_file(syspath);
+  ASSERT_NE(fp, nullptr) << strerror(errno);
+  fputs("0x1234\n", fp);
+  fclose(fp);
+
+  ASSERT_EQ(xfpga_fpgaOpen(tokens_[0], &handle_, 0), FPGA_OK);
+  size_t before = open_fd_count();
+
+  fpga_object object;
+  ASSERT_EQ(xfpga_fpgaHandleGetObject(handle_, "testdata", &object, 0),
+            FPGA_OK);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([object, t]() {
+      for (int i = 0; i < 200; ++i) {
+        if ((i + t) % 4)
+          EXPECT_EQ(xfpga_fpgaObjectSync(object), FPGA_OK);
+        else
+          EXPECT_EQ(xfpga_fpgaObjectWrite64(object, 0x1234, 0), FPGA_OK);
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+
+  _fpga_object *obj = static_cast<_fpga_object *>(object);
+  EXPECT_GE(obj->fd, 0);
+  EXPECT_EQ(open_fd_count(), before + 1);
+
+  EXPECT_EQ(xfpga_fpgaDestroyObject(&object), FPGA_OK);
+  EXPECT_EQ(open_fd_count(), before);
+}
+
 INSTANTIATE_TEST_CASE_P(sysobject_c, sysobject_mock_p,
                         ::testing::ValuesIn(test_platform::mock_platforms({ "dfl-n3000","dfl-d5005" })));
@@ -28,6 +28,10 @@
 #include <opae/cxx/core/shared_buffer.h>
 #include <opae/cxx/core/token.h>
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
 #include "afu_test.h"
 
 namespace host_exerciser {
@@ -37,6 +41,8 @@ using opae::fpga::types::token;
 
 static const uint64_t HELPBK_TEST_TIMEOUT = 30000;
 static const uint64_t HELPBK_TEST_SLEEP_INVL = 100;
+static const uint64_t HELPBK_TEST_SPIN_USEC = 100;
+static const uint32_t HELPBK_COMPLETION_TIMEOUT_MSEC = 10000;
 static const uint64_t CL = 64;
 static const uint64_t KB = 1024;
 static const uint64_t MB = KB * 1024;
@@ -89,6 +95,14 @@ typedef enum {
 } hostexe_req_len;
 
 
+//how the host waits for test completion
+typedef enum {
+  HOSTEXE_COMPLETION_POLL = 0x0,
+  HOSTEXE_COMPLETION_HYBRID = 0x1,
+  HOSTEXE_COMPLETION_INTERRUPT = 0x2,
+  HOSTEXE_COMPLETION_DEFAULT = 0xff,
+} hostexe_completion;
+
 //he test type
 typedef enum {
   HOSTEXE_TEST_ROLLOVER = 0x0,
@@ -279,6 +293,12 @@ const std::map<std::string, uint32_t> he_req_cls_len= {
   { "cl_4", HOSTEXE_CLS_4},
 };
 
+const std::map<std::string, uint32_t> he_completion_modes = {
+  { "poll", HOSTEXE_COMPLETION_POLL},
+  { "hybrid", HOSTEXE_COMPLETION_HYBRID},
+  { "interrupt", HOSTEXE_COMPLETION_INTERRUPT},
+};
+
 const std::map<std::string, uint32_t> he_test_mode = {
   { "test_rollover", HOSTEXE_TEST_ROLLOVER},
   { "test_termination", HOSTEXE_TEST_TERMINATION}
@@ -295,6 +315,13 @@ indicating one of the following series of read/write requests:
 1: rd-rd-wr-wr
 2: rd-rd-rd-rd-wr-wr-wr-wr)desc";
 
+// Completion help
+const char *completion_help = R"desc(How to wait for test completion {poll, hybrid, interrupt}
+poll: busy-poll the DSM status
+hybrid: busy-poll for --spin-usec, then poll with growing sleeps
+interrupt: wait for the --interrupt vector (0 if not given)
+Defaults to interrupt when --interrupt is given, hybrid otherwise.)desc";
+
 //Perf counter help
 const char *perf_help = R"desc(Enable perf counters
 Set the capabilities for binary(for non-root user)
@@ -308,6 +335,9 @@ public:
   , count_(1)
   , he_interrupt_(99)
   , perf_(false)
+  , he_completion_(HOSTEXE_COMPLETION_DEFAULT)
+  , he_spin_usec_(HELPBK_TEST_SPIN_USEC)
+  , he_completion_timeout_msec_(HELPBK_COMPLETION_TIMEOUT_MSEC)
   {
     // Mode
     app_.add_option("-m,--mode", he_modes_, "host exerciser mode {lpbk,read, write, trput}")
@@ -332,6 +362,20 @@ public:
         ->transform(CLI::Range(0, 3));
 
     app_.add_option("--perf", perf_, perf_help)->default_val("false");
+
+    // Completion strategy
+    app_.add_option("--completion", he_completion_, completion_help)
+      ->transform(CLI::CheckedTransformer(he_completion_modes));
+    app_.add_option("--spin-usec", he_spin_usec_,
+        "Busy-poll budget in usec before hybrid completion sleeps")
+      ->default_val(std::to_string(HELPBK_TEST_SPIN_USEC));
+    app_.add_option("--completion-timeout", he_completion_timeout_msec_,
+        "Test completion timeout (msec)")
+      ->default_val(std::to_string(HELPBK_COMPLETION_TIMEOUT_MSEC));
+
+    // Iterations, each reports its completion latency
+    app_.add_option("-i,--iterations", count_, "Number of test iterations")
+      ->default_val("1");
   }
 
   virtual int run(CLI::App *app, test_command::ptr_t test) override
@@ -355,12 +399,30 @@ public:
       res = exit_codes::exception;
     }
 
+    report_latency();
+
     auto pass = res == exit_codes::success ? "PASS" : "FAIL";
     logger_->info("Test {}({}): {}", test->name(), count, pass);
     spdlog::drop_all();
     return res;
   }
 
+  void report_latency()
+  {
+    if (latency_usec_.empty())
+      return;
+    std::vector<double> sorted(latency_usec_);
+    std::sort(sorted.begin(), sorted.end());
+    auto pct = [&sorted](double p) {
+      size_t i = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+      return sorted[i];
+    };
+    logger_->info("completion latency over {} iteration(s) (usec): "
+                  "min {:.2f} p50 {:.2f} p90 {:.2f} p99 {:.2f} max {:.2f}",
+                  sorted.size(), sorted.front(), pct(50), pct(90), pct(99),
+                  sorted.back());
+  }
+
   template<typename T>
   inline T read(uint32_t offset) const {
     return *reinterpret_cast<T*>(handle_->mmio_ptr(offset));
@@ -457,6 +519,10 @@ public:
   uint32_t he_interleave_;
   uint32_t he_interrupt_;
   bool perf_;
+  uint32_t he_completion_;
+  uint32_t he_spin_usec_;
+  uint32_t he_completion_timeout_msec_;
+  std::vector<double> latency_usec_;
 
   std::map<uint32_t, uint32_t> limits_;
 
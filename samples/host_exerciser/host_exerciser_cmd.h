@@ -129,6 +129,50 @@ public:
         return num >> LOG2_CL;
     }
 
+    // Wait for the DSM status (or interrupt) with the selected strategy
+    // and record the latency from test start.
+    void wait_for_completion(event::ptr_t ev,
+                             std::chrono::steady_clock::time_point start)
+    {
+        using std::chrono::steady_clock;
+        volatile uint8_t* status_ptr = dsm_->c_type();
+        auto timeout = std::chrono::milliseconds(
+            host_exe_->he_completion_timeout_msec_);
+        auto spin = std::chrono::microseconds(host_exe_->he_spin_usec_);
+        auto sleep_usec = 1u;
+        uint32_t iter = 0;
+
+        switch (host_exe_->he_completion_) {
+        case HOSTEXE_COMPLETION_INTERRUPT:
+            host_exe_->interrupt_wait(ev, host_exe_->he_completion_timeout_msec_);
+            break;
+        case HOSTEXE_COMPLETION_POLL:
+            while (0 == ((*status_ptr) & 0x1)) {
+                // reading the clock is slower than the status load
+                if ((++iter & 0x3ff) == 0 &&
+                    steady_clock::now() - start > timeout)
+                    throw std::runtime_error("HE LPBK TIME OUT");
+            }
+            break;
+        default:
+            while (0 == ((*status_ptr) & 0x1)) {
+                auto elapsed = steady_clock::now() - start;
+                if (elapsed > timeout)
+                    throw std::runtime_error("HE LPBK TIME OUT");
+                if (elapsed < spin)
+                    continue;
+                usleep(sleep_usec);
+                if (sleep_usec < HELPBK_TEST_SLEEP_INVL)
+                    sleep_usec *= 2;
+            }
+            break;
+        }
+
+        auto end = steady_clock::now();
+        host_exe_->latency_usec_.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
     int parse_input_options()
     {
 
@@ -154,8 +198,18 @@ public:
               he_lpbk_cfg_.TputInterleave = host_exe_->he_interleave_;
         }
 
+        // Completion strategy, interrupt if a vector was given
+        if (host_exe_->he_completion_ == HOSTEXE_COMPLETION_DEFAULT) {
+            host_exe_->he_completion_ = host_exe_->he_interrupt_ <= 3 ?
+                HOSTEXE_COMPLETION_INTERRUPT : HOSTEXE_COMPLETION_HYBRID;
+        }
+        if (host_exe_->he_completion_ == HOSTEXE_COMPLETION_INTERRUPT &&
+            host_exe_->he_interrupt_ > 3) {
+            host_exe_->he_interrupt_ = 0;
+        }
+
         // Set Interrupt test mode
-        if (host_exe_->he_interrupt_ <= 3) {
+        if (host_exe_->he_completion_ == HOSTEXE_COMPLETION_INTERRUPT) {
             he_lpbk_cfg_.IntrTestMode = 1;
         }
 
@@ -253,34 +307,18 @@ public:
         he_lpbk_ctl_.value = 0;
         he_lpbk_ctl_.Start = 1;
         he_lpbk_ctl_.ResetL = 1;
+        auto start = std::chrono::steady_clock::now();
         d_afu->write32(HE_CTL, he_lpbk_ctl_.value);
 
         /* Wait for test completion */
-        uint32_t           timeout = HELPBK_TEST_TIMEOUT;
-        volatile uint8_t* status_ptr = dsm_->c_type();
-
-        if (he_lpbk_cfg_.IntrTestMode == 1) {
-            try {
-                d_afu->interrupt_wait(ev, 10000);
-                if (he_lpbk_cfg_.TestMode == HOST_EXEMODE_LPBK1)
-                    d_afu->compare(source_, destination_);
-             }
-             catch (std::exception &ex) {
-                    std::cout << "Exception: " << ex.what() << std::endl;
-                    host_exerciser_errors();
-                    return -1;
-             }
-        } else {
-            while (0 == ((*status_ptr) & 0x1))
-            {
-                usleep(HELPBK_TEST_SLEEP_INVL);
-                if (--timeout == 0) {
-                    std::cout << "HE LPBK TIME OUT" << std::endl;
-                    host_exerciser_errors();
-                    return -1;
-                }
-             }
-         }
+        try {
+            wait_for_completion(ev, start);
+        }
+        catch (std::exception &ex) {
+            std::cout << "Exception: " << ex.what() << std::endl;
+            host_exerciser_errors();
+            return -1;
+        }
 
         if (perf) {
             //stop performance counter
@@ -30,7 +30,9 @@
  */
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <opae/fpga.h>
 #include <errno.h>
@@ -38,7 +40,6 @@
 #include <assert.h>
 #include "fpga_dma_internal.h"
 #include "fpga_dma.h"
-#include "tbb/concurrent_queue.h"
 
 using namespace std;
 
@@ -406,20 +407,62 @@ static void dump_hw_desc(int i, msgdma_hw_desc_t *desc)
 }
 #endif
 
-static void dump_hw_desc_log(int i, msgdma_hw_desc_t *desc, ofstream &f)
+// Record a descriptor in the in-memory trace. Called only from the
+// dispatcher thread, and only while tracing is enabled.
+static void trace_hw_desc(fpga_dma_handle_t dma_h, msgdma_hw_desc_t *desc)
 {
-	UNUSED(i);
-	UNUSED(desc);
-	UNUSED(f);
-#if FPGA_DMA_DEBUG
-	f << std::setw(10) << std::to_string(desc->format)
-	<< std::setw(10) << std::to_string(desc->block_size)
-	<< std::setw(10) << std::to_string(desc->owned_by_hw)
-	<< std::setw(20) << std::hex << desc->src
-	<< std::setw(20) << std::hex << desc->dst
-	<< std::setw(20) << std::hex << desc->len
-	<< std::setw(20) << std::hex << desc->next_desc << endl;
-#endif
+	uint64_t n = dma_h->trace.count.load(std::memory_order_relaxed);
+	msgdma_trace_entry_t *e = &dma_h->trace.entries[n % FPGA_DMA_TRACE_ENTRIES];
+
+	e->format = desc->format;
+	e->block_size = desc->block_size;
+	e->owned_by_hw = desc->owned_by_hw;
+	e->src = desc->src;
+	e->dst = desc->dst;
+	e->len = desc->len;
+	e->next_desc = desc->next_desc;
+	dma_h->trace.count.store(n + 1, std::memory_order_release);
+}
+
+// Write the recorded descriptors to disp.log, oldest first
+static void dump_trace_log(fpga_dma_handle_t dma_h)
+{
+	uint64_t n = dma_h->trace.count.load(std::memory_order_acquire);
+	uint64_t i = (n > FPGA_DMA_TRACE_ENTRIES) ? n - FPGA_DMA_TRACE_ENTRIES : 0;
+	ofstream f;
+
+	if (!n)
+		return;
+
+	f.open("disp.log");
+	f << std::setw(10) << "format"
+		<< std::setw(10) << "bsize"
+		<< std::setw(10) << "own_hw"
+		<< std::setw(20) << "src"
+		<< std::setw(20) << "dst"
+		<< std::setw(20) << "len"
+		<< std::setw(20) << "next_desc\n";
+
+	for (; i < n; i++) {
+		msgdma_trace_entry_t *e = &dma_h->trace.entries[i % FPGA_DMA_TRACE_ENTRIES];
+		f << std::dec << std::setw(10) << std::to_string(e->format)
+		<< std::setw(10) << std::to_string(e->block_size)
+		<< std::setw(10) << std::to_string(e->owned_by_hw)
+		<< std::setw(20) << std::hex << e->src
+		<< std::setw(20) << std::hex << e->dst
+		<< std::setw(20) << std::hex << e->len
+		<< std::setw(20) << std::hex << e->next_desc << endl;
+	}
+	f.close();
+}
+
+// Hand a transfer to the dispatcher. The ingress ring has a single
+// producer slot, so application threads take turns here.
+static void enqueue_sw_desc(fpga_dma_handle_t dma_h, msgdma_sw_desc_t *sw_desc)
+{
+	pthread_mutex_lock(&dma_h->ingress_lock);
+	dma_h->ingress_queue.push(sw_desc);
+	pthread_mutex_unlock(&dma_h->ingress_lock);
 }
 
 // Dispatcher worker thread
@@ -440,6 +483,7 @@ static void *dispatcherWorker(void* dma_handle) {
 	msgdma_sw_desc_t *first_sw_desc;
 	msgdma_hw_descp_t *hw_descp;
 	bool is_owned_by_hw;
+	bool trace;
 	uint8_t block_size = 0;
 	uint8_t format;
 
@@ -449,86 +493,72 @@ static void *dispatcherWorker(void* dma_handle) {
 		return NULL;
 	}
 
-	// open log file for debug
-	ofstream disp_log;
-	disp_log.open ("disp.log");
-
-	disp_log << std::setw(10) << "format"
-		<< std::setw(10) << "bsize"
-		<< std::setw(10) << "own_hw"
-		<< std::setw(20) << "src"
-		<< std::setw(20) << "dst"
-		<< std::setw(20) << "len"
-		<< std::setw(20) << "next_desc\n";
-
 	debug_print("started dispatcher worker\n");
 	while (1) {
-		// wait for a valid transfer
-		while(dma_h->ingress_queue.empty());
-		if (dma_h->ingress_queue.try_pop(sw_desc[desc_count])) {
-			if (sw_desc[desc_count]->kill_worker) {
-				disp_log.close();
-				dma_h->pending_queue.push(sw_desc[desc_count]);
-				debug_print("Killing worker\n");
-				break;
-			}
+		// wait for a valid transfer; parks when the channel is idle
+		dma_h->ingress_queue.pop(sw_desc[desc_count]);
+		if (sw_desc[desc_count]->kill_worker) {
+			dma_h->pending_queue.push(sw_desc[desc_count]);
+			debug_print("Killing worker\n");
+			break;
+		}
 
-			// make a note of the first block descriptor
-			// mark it valid only after packing rest of the block
-			if (desc_count == 1)
-				first_sw_desc = sw_desc[desc_count];
-			is_owned_by_hw = (desc_count == 1)  ? false:true;
-
-			// refer prefetcher spec
-			if (desc_count == 1) {
-				if (sw_desc[desc_count]->transfer->is_last_buf)
-					format = 0x3;
-				else
-					format = 0x1;
-			} else if (desc_count == FPGA_DMA_BLOCK_SIZE || sw_desc[desc_count]->transfer->is_last_buf)
-				format = 0x2;
+		// make a note of the first block descriptor
+		// mark it valid only after packing rest of the block
+		if (desc_count == 1)
+			first_sw_desc = sw_desc[desc_count];
+		is_owned_by_hw = (desc_count == 1)  ? false:true;
+
+		// refer prefetcher spec
+		if (desc_count == 1) {
+			if (sw_desc[desc_count]->transfer->is_last_buf)
+				format = 0x3;
 			else
-				format = 0x0;
-			
-			// assign a free hardware descriptor to this transfer
-			// if a free descriptor isn't available, wait here
-			while(dma_h->free_desc.empty());
-			dma_h->free_desc.try_pop(hw_descp);
-
-			sw_desc[desc_count]->id = desc_count;
-			assign_hw_desc(sw_desc[desc_count], hw_descp, is_owned_by_hw, block_size, format);
-
-			// ready to dispatch the block
-			if ((desc_count == FPGA_DMA_BLOCK_SIZE) /* we have a full block*/ ||
-				sw_desc[desc_count]->transfer->is_last_buf /*app. requested block dispatch for this transfer*/
-				) {
-
-				first_sw_desc->hw_descp->hw_desc->block_size = desc_count - 1;
-				first_sw_desc->hw_descp->hw_desc->owned_by_hw = 1;
-
-				// push valid descriptors to completion queue
-				uint64_t k;
-				for(k=1; k <= desc_count; k++) {
-					dump_hw_desc_log(0, sw_desc[k]->hw_descp->hw_desc, disp_log);
-					if(k == desc_count)
-						sw_desc[k]->last = 1;
-					dma_h->pending_queue.push(sw_desc[k]);
-				}
+				format = 0x1;
+		} else if (desc_count == FPGA_DMA_BLOCK_SIZE || sw_desc[desc_count]->transfer->is_last_buf)
+			format = 0x2;
+		else
+			format = 0x0;
+		
+		// assign a free hardware descriptor to this transfer
+		// if a free descriptor isn't available, wait here
+		dma_h->free_desc.pop(hw_descp);
+
+		sw_desc[desc_count]->id = desc_count;
+		assign_hw_desc(sw_desc[desc_count], hw_descp, is_owned_by_hw, block_size, format);
+
+		// ready to dispatch the block
+		if ((desc_count == FPGA_DMA_BLOCK_SIZE) /* we have a full block*/ ||
+			sw_desc[desc_count]->transfer->is_last_buf /*app. requested block dispatch for this transfer*/
+			) {
+
+			first_sw_desc->hw_descp->hw_desc->block_size = desc_count - 1;
+			first_sw_desc->hw_descp->hw_desc->owned_by_hw = 1;
+
+			// push valid descriptors to completion queue
+			uint64_t k;
+			trace = dma_h->trace.enabled.load(std::memory_order_relaxed);
+			for(k=1; k <= desc_count; k++) {
+				if (trace)
+					trace_hw_desc(dma_h, sw_desc[k]->hw_descp->hw_desc);
+				if(k == desc_count)
+					sw_desc[k]->last = 1;
+				dma_h->pending_queue.push(sw_desc[k]);
+			}
 
-				// Skip invalid descriptors
-				for(k=1; k<= (FPGA_DMA_BLOCK_SIZE-desc_count); k++) {
-					msgdma_hw_descp_t *unused_hw_descp;
-					while(dma_h->free_desc.empty());
-					dma_h->free_desc.try_pop(unused_hw_descp);
-					dump_hw_desc_log(0, unused_hw_descp->hw_desc, disp_log);
-					dma_h->invalid_desc_queue.push(unused_hw_descp);
-				}
+			// Skip invalid descriptors
+			for(k=1; k<= (FPGA_DMA_BLOCK_SIZE-desc_count); k++) {
+				msgdma_hw_descp_t *unused_hw_descp;
+				dma_h->free_desc.pop(unused_hw_descp);
+				if (trace)
+					trace_hw_desc(dma_h, unused_hw_descp->hw_desc);
+				dma_h->invalid_desc_queue.push(unused_hw_descp);
+			}
 
-				// reset descriptor count
-				desc_count = 1;
-			} else
-				desc_count++;
-		}
+			// reset descriptor count
+			desc_count = 1;
+		} else
+			desc_count++;
 	}
 
 	return dma_h;
@@ -549,34 +579,46 @@ static void *completionWorker(void* dma_handle) {
 
 	debug_print("started completion worker\n");
 	while (1) {
-		while(dma_h->pending_queue.empty());
-		if (dma_h->pending_queue.try_pop(sw_desc)) {
-			if (sw_desc->kill_worker)
-				break;
-			while(sw_desc->hw_descp->hw_desc->owned_by_hw == 1);
-			sw_desc->hw_descp->hw_desc->owned_by_hw = 0;
-
-			// return hw_descp to free pool
-			dma_h->free_desc.push(sw_desc->hw_descp);
-
-			if(sw_desc->last == 1 && (sw_desc->hw_descp->hw_desc_id < (FPGA_DMA_BLOCK_SIZE - 1))) {
-				for(i = (sw_desc->hw_descp->hw_desc_id + 1) ; i < FPGA_DMA_BLOCK_SIZE ; i++) {
-					msgdma_hw_descp_t *unused_hw_descp;
-					dma_h->invalid_desc_queue.try_pop(unused_hw_descp);
-					dma_h->free_desc.push(unused_hw_descp);
-				}
+		dma_h->pending_queue.pop(sw_desc);
+		if (sw_desc->kill_worker)
+			break;
+		msgdma_hw_desc_t *hw_desc = sw_desc->hw_descp->hw_desc;
+		fpga_dma_poll([hw_desc]() { return hw_desc->owned_by_hw != 1; });
+		hw_desc->owned_by_hw = 0;
+
+		// fold this segment's status into its submission before
+		// the hardware descriptor can be reused
+		msgdma_completion_t *c = sw_desc->completion;
+		c->bytes_transferred += hw_desc->bytes_transferred;
+		if (hw_desc->eop_arrived)
+			c->eop_arrived = true;
+
+		// return hw_descp to free pool
+		dma_h->free_desc.push(sw_desc->hw_descp);
+
+		if(sw_desc->last == 1 && (sw_desc->hw_descp->hw_desc_id < (FPGA_DMA_BLOCK_SIZE - 1))) {
+			for(i = (sw_desc->hw_descp->hw_desc_id + 1) ; i < FPGA_DMA_BLOCK_SIZE ; i++) {
+				msgdma_hw_descp_t *unused_hw_descp;
+				dma_h->invalid_desc_queue.pop(unused_hw_descp);
+				dma_h->free_desc.push(unused_hw_descp);
 			}
+		}
 
-			if (sw_desc->transfer->cb) {
+		// Segments complete in submission order, so the last one
+		// completes the whole submission.
+		if (sw_desc->end_of_batch) {
+			if (c->done) {
+				// c lives on the waiter's stack; don't touch it after this
+				sem_post(c->done);
+			} else if (c->cb) {
 				fpga_dma_transfer_status_t status;
-				status.eop_arrived = sw_desc->hw_descp->hw_desc->eop_arrived;
-				status.bytes_transferred = sw_desc->hw_descp->hw_desc->bytes_transferred;
-				sw_desc->transfer->cb(sw_desc->transfer->context, status);
-				destroy_sw_desc(sw_desc);
+				status.eop_arrived = c->eop_arrived;
+				status.bytes_transferred = c->bytes_transferred;
+				c->cb(c->context, status);
 			}
-			// mark transfer complete
-			sem_post(&sw_desc->tf_status);
 		}
+
+		dma_h->free_sw_desc.push(sw_desc);
 	}
 	return dma_h;
 }
@@ -769,6 +811,13 @@ fpga_result fpgaDMAOpen(fpga_handle fpga, uint64_t dma_channel_index, fpga_dma_h
 		ON_ERR_GOTO(FPGA_EXCEPTION, out, "pthread mutex init failed");
 	}
 
+	if (pthread_mutex_init(&dma_h->ingress_lock, NULL)) {
+		ON_ERR_GOTO(FPGA_EXCEPTION, out, "pthread mutex init failed");
+	}
+
+	// Descriptor tracing can be switched on without a debug build
+	dma_h->trace.enabled = (getenv("FPGA_DMA_TRACE") != NULL);
+
 	uint64_t block_size;
 	block_size = FPGA_DMA_BLOCK_SIZE;
 	for(i = 0; i < FPGA_DMA_MAX_BLOCKS; i++) {
@@ -810,6 +859,15 @@ fpga_result fpgaDMAOpen(fpga_handle fpga, uint64_t dma_channel_index, fpga_dma_h
 		}
 	}
 
+	// populate software descriptor pool
+	dma_h->sw_desc_pool = (msgdma_sw_desc_t*)calloc(FPGA_DMA_SW_DESC_POOL_SIZE, sizeof(msgdma_sw_desc_t));
+	if (!dma_h->sw_desc_pool)
+		ON_ERR_GOTO(FPGA_NO_MEMORY, rel_buf, "Pool alloc: No memory");
+	for(i = 0; i < FPGA_DMA_SW_DESC_POOL_SIZE; i++) {
+		dma_h->sw_desc_pool[i].transfer = &dma_h->sw_desc_pool[i].xfer;
+		dma_h->free_sw_desc.push(&dma_h->sw_desc_pool[i]);
+	}
+
 	// Enable dispatcher
 	msgdma_ctrl_t ctrl;
 	ctrl = {0};
@@ -860,15 +918,16 @@ fpga_result fpgaDMAOpen(fpga_handle fpga, uint64_t dma_channel_index, fpga_dma_h
 		res = fpgaDMATransferInit(&dummy_transfer);
 		ON_ERR_GOTO(FPGA_NO_MEMORY, rel_buf, "allocating dummy transfer");
 
-		static msgdma_sw_desc* sw_desc = init_sw_desc(dummy_transfer);
+		msgdma_sw_desc_t *sw_desc = init_sw_desc(dummy_transfer);
 		if(!sw_desc)
 			ON_ERR_GOTO(FPGA_NO_MEMORY, rel_buf, "init sw desc");
 		sw_desc->kill_worker = true;
-		dma_h->ingress_queue.push(sw_desc);
+		enqueue_sw_desc(dma_h, sw_desc);
 
 		// wait workers to die
 		if (pthread_join(dma_h->ingress_id, &th_retval))
 			ON_ERR_GOTO(FPGA_EXCEPTION, rel_buf, "pthread_join for dispatcher");
+		destroy_sw_desc(sw_desc);
 	}
 
 	pthread_mutex_destroy(&dma_h->dma_mutex);
@@ -879,6 +938,9 @@ fpga_result fpgaDMAOpen(fpga_handle fpga, uint64_t dma_channel_index, fpga_dma_h
 rel_buf:
 	if(dma_h){
 		pthread_mutex_destroy(&dma_h->dma_mutex);
+		pthread_mutex_destroy(&dma_h->ingress_lock);
+		free(dma_h->sw_desc_pool);
+		dma_h->sw_desc_pool = NULL;
 	}
 	if(dummy_transfer){
 		free(dummy_transfer);
@@ -902,6 +964,7 @@ out:
 fpga_result fpgaDMAClose(fpga_dma_handle_t dma_h) {
 	msgdma_prefetcher_status_t pre_status;
 	msgdma_status_t status;
+	msgdma_sw_desc_t *sw_desc = NULL;
 	fpga_result res = FPGA_OK;
 	int i = 0;
 	if (!dma_h) {
@@ -949,7 +1012,7 @@ fpga_result fpgaDMAClose(fpga_dma_handle_t dma_h) {
 	// send a dummy transfer to kill worker threads
 	fpga_dma_transfer_t dummy_transfer;
 	fpgaDMATransferInit(&dummy_transfer);
-	static msgdma_sw_desc* sw_desc = init_sw_desc(dummy_transfer);
+	sw_desc = init_sw_desc(dummy_transfer);
 	if(!sw_desc) {
 		//TODO: kill dummy transfer?
 		fpgaDMATransferDestroy(&dummy_transfer);
@@ -957,7 +1020,7 @@ fpga_result fpgaDMAClose(fpga_dma_handle_t dma_h) {
 		return FPGA_EXCEPTION;
 	}
 	sw_desc->kill_worker = true;
-	dma_h->ingress_queue.push(sw_desc);
+	enqueue_sw_desc(dma_h, sw_desc);
 
 	// wait workers to die
 	if (pthread_join(dma_h->ingress_id, &th_retval)) {
@@ -967,7 +1030,14 @@ fpga_result fpgaDMAClose(fpga_dma_handle_t dma_h) {
 	if (pthread_join(dma_h->pending_id, &th_retval)) {
 		FPGA_DMA_ERR("pthread_join for completion worker");
 	}
+	destroy_sw_desc(sw_desc);
 	fpgaDMATransferDestroy(&dummy_transfer);
+	pthread_mutex_destroy(&dma_h->ingress_lock);
+	free(dma_h->sw_desc_pool);
+	dma_h->sw_desc_pool = NULL;
+
+	// the dispatcher has exited, so the trace is stable
+	dump_trace_log(dma_h);
 
 	// stop dispatcher
 	msgdma_ctrl_t ctrl;
@@ -1012,7 +1082,7 @@ fpga_result fpgaDMAClose(fpga_dma_handle_t dma_h) {
 out:
 	// Make sure double-close fails
 	dma_h->dma_channel = INVALID_CHANNEL;
-	free((void*)dma_h);
+	delete dma_h;
 	return res;
 }
 
@@ -1337,17 +1407,8 @@ fpga_result fpgaDMATransferCheckEopArrived(fpga_dma_transfer_t transfer, bool *e
 	return FPGA_OK;
 }
 
-fpga_result fpgaDMATransfer(fpga_dma_handle_t dma, fpga_dma_transfer_t transfer) {
-	if (!dma) {
-		FPGA_DMA_ERR("Invalid DMA handle");
-		return FPGA_INVALID_PARAM;
-	}
-
-	if (!transfer) {
-		FPGA_DMA_ERR("Invalid DMA transfer");
-		return FPGA_INVALID_PARAM;
-	}
-
+// Check that a transfer's type and control fields suit the channel
+static fpga_result check_transfer(fpga_dma_handle_t dma, fpga_dma_transfer_t transfer) {
 	if (!(transfer->transfer_type == HOST_MM_TO_FPGA_ST ||
 		transfer->transfer_type == FPGA_ST_TO_HOST_MM ||
 		transfer->transfer_type == HOST_MM_TO_FPGA_MM ||
@@ -1373,39 +1434,158 @@ fpga_result fpgaDMATransfer(fpga_dma_handle_t dma, fpga_dma_transfer_t transfer)
 		return FPGA_INVALID_PARAM;
 	}
 
+	return FPGA_OK;
+}
+
+// Check a transfer (or segment) length against the channel type
+static fpga_result check_transfer_len(fpga_dma_handle_t dma, fpga_dma_transfer_t transfer, uint64_t len) {
 	// Avalon ST does not allow signalling of partial data for non-packet transfers (transfers without SOP/EOP).
 	if (((transfer->tx_ctrl == TX_NO_PACKET && dma->ch_type == TX_ST) || 
-		(transfer->rx_ctrl == RX_NO_PACKET && dma->ch_type == RX_ST)) && ((transfer->len % 64) != 0)) {
+		(transfer->rx_ctrl == RX_NO_PACKET && dma->ch_type == RX_ST)) && ((len % 64) != 0)) {
 		FPGA_DMA_ERR("Incompatible transfer length for transfer type NO_PKT");
 		return FPGA_INVALID_PARAM;
 	}
 	// Partial data transfer is not permitted for MM TO MM transfers
-	if ((dma->ch_type == MM ) && (transfer->len % 64) != 0) {
-                FPGA_DMA_ERR("Incompatible transfer length for MM to MM transfers");
-                return FPGA_INVALID_PARAM;
-        }
+	if ((dma->ch_type == MM ) && (len % 64) != 0) {
+		FPGA_DMA_ERR("Incompatible transfer length for MM to MM transfers");
+		return FPGA_INVALID_PARAM;
+	}
+	return FPGA_OK;
+}
 
-	// create a copy of the buffer and enqueue to ingress queue
-	msgdma_sw_desc *sw_desc = init_sw_desc(transfer);
-	if (!sw_desc)
-		return FPGA_EXCEPTION;
-	dma->ingress_queue.push(sw_desc);
+// Queue `count` segments sharing the attributes of `transfer`.
+// Software descriptors come from the per-channel pool, and all
+// segments report through a single completion record. When `flush`
+// is set, the block holding the last segment is handed to hardware
+// right away.
+static fpga_result submit_segments(fpga_dma_handle_t dma, fpga_dma_transfer_t transfer,
+				   const fpga_dma_segment_t *segs, size_t count, bool flush) {
+	msgdma_completion_t sync_completion;
+	msgdma_completion_t *c;
+	msgdma_sw_desc_t *sw_desc;
+	msgdma_sw_desc_t *tail = NULL;
+	bool blocking = !transfer->cb;
+	sem_t done;
+	size_t i;
+
+	pthread_mutex_lock(&dma->ingress_lock);
+
+	if (blocking) {
+		if (sem_init(&done, 0, 0)) {
+			pthread_mutex_unlock(&dma->ingress_lock);
+			FPGA_DMA_ERR("sem_init failed");
+			return FPGA_EXCEPTION;
+		}
+		c = &sync_completion;
+		c->done = &done;
+	} else {
+		// the last descriptor carries the record for async callers
+		dma->free_sw_desc.pop(tail);
+		c = &tail->async_completion;
+		c->done = NULL;
+	}
+	c->cb = transfer->cb;
+	c->context = transfer->context;
+	c->bytes_transferred = 0;
+	c->eop_arrived = false;
+
+	for (i = 0; i < count; i++) {
+		bool last = (i == count - 1);
+
+		if (last && tail)
+			sw_desc = tail;
+		else
+			dma->free_sw_desc.pop(sw_desc);
+
+		sw_desc->xfer.src = segs[i].src;
+		sw_desc->xfer.dst = segs[i].dst;
+		sw_desc->xfer.len = segs[i].len;
+		sw_desc->xfer.transfer_type = transfer->transfer_type;
+		sw_desc->xfer.tx_ctrl = transfer->tx_ctrl;
+		sw_desc->xfer.rx_ctrl = transfer->rx_ctrl;
+		sw_desc->xfer.is_last_buf = last && flush;
+		sw_desc->kill_worker = false;
+		sw_desc->last = 0;
+		sw_desc->end_of_batch = last;
+		sw_desc->completion = c;
+
+		dma->ingress_queue.push(sw_desc);
+	}
+
+	pthread_mutex_unlock(&dma->ingress_lock);
 
 	// Blocking transfer
-	if (!sw_desc->transfer->cb) {
-		sem_wait(&sw_desc->tf_status);
+	if (blocking) {
+		sem_wait(&done);
+		sem_destroy(&done);
 		// copy over EOP and transferred bytes
-		transfer->eop_arrived = sw_desc->hw_descp->hw_desc->eop_arrived;
-		transfer->bytes_transferred = sw_desc->hw_descp->hw_desc->bytes_transferred;
-		return destroy_sw_desc(sw_desc);
-	}
-	if (sem_destroy(&sw_desc->tf_status)) {
-		FPGA_DMA_ERR("sem destroy failed\n");
-		return FPGA_EXCEPTION;
+		transfer->eop_arrived = c->eop_arrived;
+		transfer->bytes_transferred = c->bytes_transferred;
 	}
+
 	return FPGA_OK;
 }
 
+fpga_result fpgaDMATransfer(fpga_dma_handle_t dma, fpga_dma_transfer_t transfer) {
+	fpga_result res;
+
+	if (!dma) {
+		FPGA_DMA_ERR("Invalid DMA handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!transfer) {
+		FPGA_DMA_ERR("Invalid DMA transfer");
+		return FPGA_INVALID_PARAM;
+	}
+
+	res = check_transfer(dma, transfer);
+	if (res != FPGA_OK)
+		return res;
+
+	res = check_transfer_len(dma, transfer, transfer->len);
+	if (res != FPGA_OK)
+		return res;
+
+	fpga_dma_segment_t seg = { transfer->src, transfer->dst, transfer->len };
+	return submit_segments(dma, transfer, &seg, 1, transfer->is_last_buf);
+}
+
+fpga_result fpgaDMATransferVec(fpga_dma_handle_t dma, const fpga_dma_transfer_t transfer,
+			       const fpga_dma_segment_t *segs, size_t count) {
+	fpga_result res;
+	size_t i;
+
+	if (!dma) {
+		FPGA_DMA_ERR("Invalid DMA handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!transfer) {
+		FPGA_DMA_ERR("Invalid DMA transfer");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!segs || !count) {
+		FPGA_DMA_ERR("Invalid segment list");
+		return FPGA_INVALID_PARAM;
+	}
+
+	res = check_transfer(dma, transfer);
+	if (res != FPGA_OK)
+		return res;
+
+	for (i = 0; i < count; i++) {
+		res = check_transfer_len(dma, transfer, segs[i].len);
+		if (res != FPGA_OK)
+			return res;
+	}
+
+	// A blocking call has to push its last block out to complete.
+	return submit_segments(dma, transfer, segs, count,
+			       !transfer->cb || transfer->is_last_buf);
+}
+
 fpga_result fpgaDMAInvalidate(fpga_dma_handle_t dma) {
 	fpga_result res = FPGA_OK;
 	if (!dma) {
@@ -1437,3 +1617,246 @@ fpga_result fpgaDMAInvalidate(fpga_dma_handle_t dma) {
 	return res;
 }
 
+fpga_result fpgaDMASetTrace(fpga_dma_handle_t dma, bool enable) {
+	if (!dma) {
+		FPGA_DMA_ERR("Invalid DMA handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	dma->trace.enabled.store(enable, std::memory_order_relaxed);
+	return FPGA_OK;
+}
+
+fpga_result fpgaDMAStripeOpen(fpga_handle fpga, fpga_dma_channel_type_t ch_type, fpga_dma_stripe_t *stripe) {
+	fpga_result res = FPGA_OK;
+	fpga_dma_stripe_t tmp = NULL;
+	fpga_dma_channel_type_t type;
+	fpga_dma_handle_t dma_h;
+	size_t count = 0;
+	size_t i;
+
+	if (!fpga) {
+		FPGA_DMA_ERR("Invalid FPGA handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!stripe) {
+		FPGA_DMA_ERR("Invalid pointer to stripe handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	res = fpgaCountDMAChannels(fpga, &count);
+	ON_ERR_GOTO(res, out, "fpgaCountDMAChannels");
+
+	tmp = (fpga_dma_stripe_t)calloc(1, sizeof(struct fpga_dma_stripe));
+	if (!tmp)
+		ON_ERR_GOTO(FPGA_NO_MEMORY, out, "Stripe alloc: No memory");
+	tmp->ch_type = ch_type;
+	tmp->channels = (fpga_dma_handle_t*)calloc(count ? count : 1, sizeof(fpga_dma_handle_t));
+	if (!tmp->channels)
+		ON_ERR_GOTO(FPGA_NO_MEMORY, out_free, "Stripe alloc: No memory");
+
+	for (i = 0; i < count; i++) {
+		res = fpgaDMAOpen(fpga, i, &dma_h);
+		ON_ERR_GOTO(res, out_close, "fpgaDMAOpen");
+
+		res = fpgaGetDMAChannelType(dma_h, &type);
+		if (res != FPGA_OK || type != ch_type) {
+			fpgaDMAClose(dma_h);
+			ON_ERR_GOTO(res, out_close, "fpgaGetDMAChannelType");
+			continue;
+		}
+		tmp->channels[tmp->num_channels++] = dma_h;
+	}
+
+	if (!tmp->num_channels) {
+		FPGA_DMA_ERR("No DMA channel of the requested type");
+		res = FPGA_NOT_FOUND;
+		goto out_free;
+	}
+
+	debug_print("striping across %ld channels\n", tmp->num_channels);
+	*stripe = tmp;
+	return FPGA_OK;
+
+out_close:
+	for (i = 0; i < tmp->num_channels; i++)
+		fpgaDMAClose(tmp->channels[i]);
+out_free:
+	free(tmp->channels);
+	free(tmp);
+out:
+	return res;
+}
+
+fpga_result fpgaDMAStripeClose(fpga_dma_stripe_t stripe) {
+	fpga_result res = FPGA_OK;
+	fpga_result ret;
+	size_t i;
+
+	if (!stripe) {
+		FPGA_DMA_ERR("Invalid stripe handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	for (i = 0; i < stripe->num_channels; i++) {
+		ret = fpgaDMAClose(stripe->channels[i]);
+		if (ret != FPGA_OK)
+			res = ret;
+	}
+
+	free(stripe->channels);
+	free(stripe);
+	return res;
+}
+
+fpga_result fpgaDMAStripeGetChannels(fpga_dma_stripe_t stripe, size_t *count) {
+	if (!stripe) {
+		FPGA_DMA_ERR("Invalid stripe handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!count) {
+		FPGA_DMA_ERR("Invalid pointer to count");
+		return FPGA_INVALID_PARAM;
+	}
+
+	*count = stripe->num_channels;
+	return FPGA_OK;
+}
+
+// Called once per channel; the last one to finish reports the whole transfer
+static void stripe_complete(void *context, fpga_dma_transfer_status_t status) {
+	msgdma_stripe_req_t *req = (msgdma_stripe_req_t*)context;
+
+	req->bytes_transferred.fetch_add(status.bytes_transferred, std::memory_order_relaxed);
+	if (status.eop_arrived)
+		req->eop_arrived.store(true, std::memory_order_relaxed);
+
+	if (req->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	if (req->done) {
+		// blocking caller owns req and reads the totals itself
+		sem_post(req->done);
+		return;
+	}
+
+	fpga_dma_transfer_status_t total;
+	total.bytes_transferred = req->bytes_transferred.load(std::memory_order_relaxed);
+	total.eop_arrived = req->eop_arrived.load(std::memory_order_relaxed);
+	req->cb(req->context, total);
+	delete req;
+}
+
+fpga_result fpgaDMAStripeTransfer(fpga_dma_stripe_t stripe, fpga_dma_transfer_t transfer) {
+	fpga_result res = FPGA_OK;
+	fpga_dma_segment_t *segs = NULL;
+	msgdma_stripe_req_t sync_req;
+	msgdma_stripe_req_t *req;
+	struct fpga_dma_transfer attrs;
+	bool blocking;
+	sem_t done;
+	uint64_t units, max_segs, unit, len;
+	size_t active, ch, n;
+
+	if (!stripe) {
+		FPGA_DMA_ERR("Invalid stripe handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!transfer) {
+		FPGA_DMA_ERR("Invalid DMA transfer");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!transfer->len) {
+		FPGA_DMA_ERR("Invalid transfer length");
+		return FPGA_INVALID_PARAM;
+	}
+
+	// packets can't be split across channels
+	if ((stripe->ch_type == TX_ST && transfer->tx_ctrl != TX_NO_PACKET) ||
+		(stripe->ch_type == RX_ST && transfer->rx_ctrl != RX_NO_PACKET)) {
+		FPGA_DMA_ERR("Packet transfers can't be striped");
+		return FPGA_NOT_SUPPORTED;
+	}
+
+	// all channels share a type, so checking the first one covers them all
+	res = check_transfer(stripe->channels[0], transfer);
+	if (res != FPGA_OK)
+		return res;
+
+	res = check_transfer_len(stripe->channels[0], transfer, transfer->len);
+	if (res != FPGA_OK)
+		return res;
+
+	units = (transfer->len + FPGA_DMA_STRIPE_UNIT - 1) / FPGA_DMA_STRIPE_UNIT;
+	active = units < stripe->num_channels ? (size_t)units : stripe->num_channels;
+	max_segs = (units + active - 1) / active;
+
+	segs = (fpga_dma_segment_t*)malloc(max_segs * sizeof(fpga_dma_segment_t));
+	if (!segs) {
+		FPGA_DMA_ERR("Segment alloc: No memory");
+		return FPGA_NO_MEMORY;
+	}
+
+	blocking = !transfer->cb;
+	if (blocking) {
+		if (sem_init(&done, 0, 0)) {
+			free(segs);
+			FPGA_DMA_ERR("sem_init failed");
+			return FPGA_EXCEPTION;
+		}
+		req = &sync_req;
+		req->done = &done;
+	} else {
+		req = new (std::nothrow) msgdma_stripe_req_t;
+		if (!req) {
+			free(segs);
+			FPGA_DMA_ERR("Stripe request alloc: No memory");
+			return FPGA_NO_MEMORY;
+		}
+		req->done = NULL;
+	}
+	req->remaining.store(active, std::memory_order_relaxed);
+	req->bytes_transferred.store(0, std::memory_order_relaxed);
+	req->eop_arrived.store(false, std::memory_order_relaxed);
+	req->cb = transfer->cb;
+	req->context = transfer->context;
+
+	// every part reports to stripe_complete and flushes its last block
+	memset(&attrs, 0, sizeof(attrs));
+	attrs.transfer_type = transfer->transfer_type;
+	attrs.tx_ctrl = transfer->tx_ctrl;
+	attrs.rx_ctrl = transfer->rx_ctrl;
+	attrs.cb = stripe_complete;
+	attrs.context = req;
+	attrs.is_last_buf = true;
+
+	// unit u goes to channel u % active
+	for (ch = 0; ch < active; ch++) {
+		n = 0;
+		for (unit = ch; unit < units; unit += active) {
+			len = transfer->len - unit * FPGA_DMA_STRIPE_UNIT;
+			if (len > FPGA_DMA_STRIPE_UNIT)
+				len = FPGA_DMA_STRIPE_UNIT;
+			segs[n].src = transfer->src + unit * FPGA_DMA_STRIPE_UNIT;
+			segs[n].dst = transfer->dst + unit * FPGA_DMA_STRIPE_UNIT;
+			segs[n].len = len;
+			n++;
+		}
+		// attributes were checked above, so submission can't fail
+		submit_segments(stripe->channels[ch], &attrs, segs, n, true);
+	}
+	free(segs);
+
+	if (blocking) {
+		sem_wait(&done);
+		sem_destroy(&done);
+		transfer->bytes_transferred = req->bytes_transferred.load(std::memory_order_relaxed);
+		transfer->eop_arrived = req->eop_arrived.load(std::memory_order_relaxed);
+	}
+
+	return FPGA_OK;
+}
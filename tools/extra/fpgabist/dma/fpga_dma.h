@@ -316,6 +316,33 @@ fpga_result fpgaDMATransferSetLast(fpga_dma_transfer_t transfer, bool is_last_bu
 */
 fpga_result fpgaDMATransfer(fpga_dma_handle_t dma, const fpga_dma_transfer_t transfer);
 
+/**
+* fpgaDMATransferVec
+*
+* @brief                  Perform a scatter-gather DMA transfer
+*
+*                         Queues every segment as its own hardware descriptor, packed
+*                         back to back into prefetcher blocks, with one lock and no
+*                         allocation per call. The segments take their transfer type,
+*                         TX/RX control and callback from `transfer`; its src, dst and
+*                         len are ignored.
+*
+*                         Without a callback the call blocks until every segment is
+*                         done and stores the totals in `transfer`. With a callback,
+*                         the callback runs once after the last segment completes, with
+*                         the summed byte count; the final block is handed to hardware
+*                         only if `transfer` is marked as the last buffer.
+*
+* @param[dma] dma         DMA handle
+* @param[in]  transfer    Transfer attribute object
+* @param[in]  segs        Array of segments
+* @param[in]  count       Number of segments
+*
+* @returns                FPGA_OK on success, return code otherwise
+*/
+fpga_result fpgaDMATransferVec(fpga_dma_handle_t dma, const fpga_dma_transfer_t transfer,
+			       const fpga_dma_segment_t *segs, size_t count);
+
 
 /**
 * fpgaDMAInvalidate
@@ -328,6 +355,79 @@ fpga_result fpgaDMATransfer(fpga_dma_handle_t dma, const fpga_dma_transfer_t tra
 */
 fpga_result fpgaDMAInvalidate(fpga_dma_handle_t dma);
 
+/**
+* fpgaDMASetTrace
+*
+* @brief                  Enable or disable descriptor tracing on a channel
+*
+*                         While enabled, the dispatcher records every hardware descriptor
+*                         it hands to the DMA engine in an in-memory ring that keeps the
+*                         most recent 4096 descriptors. The trace is written to disp.log
+*                         when the channel is closed. Setting FPGA_DMA_TRACE in the
+*                         environment enables tracing when the channel is opened.
+*
+* @param[in]  dma         DMA handle
+* @param[in]  enable      true to record descriptors, false to stop
+* @returns                FPGA_OK on success, return code otherwise
+*/
+fpga_result fpgaDMASetTrace(fpga_dma_handle_t dma, bool enable);
+
+/**
+* fpgaDMAStripeOpen
+*
+* @brief                  Open every DMA channel of one type as a striped engine
+*
+*                         Channels of other types are left closed. Each channel
+*                         runs its own worker threads, which inherit the CPU and
+*                         memory binding of the calling thread; bind the caller
+*                         to the device's NUMA node first (see configure_numa()
+*                         in fpga_dma_test_utils.cpp) to keep them local.
+*
+* @param[in]  fpga        Handle to the FPGA AFU object obtained via fpgaOpen()
+* @param[in]  ch_type     Type of the channels to stripe across
+* @param[out] stripe      Stripe handle
+* @returns                FPGA_OK on success, FPGA_NOT_FOUND if no channel of
+*                         that type exists, return code otherwise
+*/
+fpga_result fpgaDMAStripeOpen(fpga_handle fpga, fpga_dma_channel_type_t ch_type, fpga_dma_stripe_t *stripe);
+
+/**
+* fpgaDMAStripeClose
+*
+* @brief                  Close all channels of a stripe handle
+* @param[in]  stripe      Stripe handle
+* @returns                FPGA_OK on success, return code otherwise
+*/
+fpga_result fpgaDMAStripeClose(fpga_dma_stripe_t stripe);
+
+/**
+* fpgaDMAStripeGetChannels
+*
+* @brief                  Query the number of channels in a stripe handle
+* @param[in]  stripe      Stripe handle
+* @param[out] count       Number of channels
+* @returns                FPGA_OK on success, return code otherwise
+*/
+fpga_result fpgaDMAStripeGetChannels(fpga_dma_stripe_t stripe, size_t *count);
+
+/**
+* fpgaDMAStripeTransfer
+*
+* @brief                  Perform one DMA transfer across all channels of a stripe
+*
+*                         The transfer is cut into 4 MiB units dealt round-robin to
+*                         the channels, which then run in parallel. Without a
+*                         callback the call returns when every channel is done; with
+*                         a callback, it runs once after the last channel finishes,
+*                         with the summed byte count. Packet transfers (SOP/EOP or
+*                         END_ON_EOP) can't be striped.
+*
+* @param[in]  stripe      Stripe handle
+* @param[in]  transfer    Transfer attribute object
+* @returns                FPGA_OK on success, return code otherwise
+*/
+fpga_result fpgaDMAStripeTransfer(fpga_dma_stripe_t stripe, fpga_dma_transfer_t transfer);
+
 
 #ifdef __cplusplus
 }
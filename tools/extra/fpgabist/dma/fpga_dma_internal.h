@@ -36,14 +36,13 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <semaphore.h>
-#include "tbb/concurrent_queue.h"
+#include "fpga_dma_ring.h"
 #include "x86-sse2.h"
 #include <iostream>
 #include <fstream>
 
 
 using namespace std;
-using namespace tbb;
 
 #define FPGA_DMA_ERR(msg_str) \
 		fprintf(stderr, "Error %s: %s\n", __FUNCTION__, msg_str);
@@ -324,6 +323,18 @@ typedef struct msgdma_hw_descp {
 	msgdma_hw_desc_t *hw_desc; // ptr to desc in hw chain
 } msgdma_hw_descp_t;
 
+// Completion record shared by every segment of one submission.
+// Blocking submissions keep it on the caller's stack and wait on
+// `done`; asynchronous ones keep it in their last software descriptor
+// and get `cb` called once the last segment completes.
+typedef struct msgdma_completion {
+	fpga_dma_transfer_cb cb;
+	void *context;
+	sem_t *done;
+	size_t bytes_transferred;
+	bool eop_arrived;
+} msgdma_completion_t;
+
 // Software descriptor
 typedef struct msgdma_sw_desc {
 	uint64_t id;
@@ -332,8 +343,41 @@ typedef struct msgdma_sw_desc {
 	sem_t tf_status; // When locked, the transfer in progress
 	bool kill_worker;
 	uint64_t last;
+	bool end_of_batch; // last segment of its submission
+	msgdma_completion_t *completion;
+	msgdma_completion_t async_completion;
+	struct fpga_dma_transfer xfer; // transfer points here when pooled
 } msgdma_sw_desc_t;
 
+// Depth of the worker queues; every hardware descriptor plus the
+// dummy transfer used to stop the workers fits without blocking
+#define FPGA_DMA_QUEUE_DEPTH (FPGA_DMA_MAX_BLOCKS * FPGA_DMA_BLOCK_SIZE + 1)
+
+// Preallocated software descriptors; one per hardware descriptor
+#define FPGA_DMA_SW_DESC_POOL_SIZE (FPGA_DMA_MAX_BLOCKS * FPGA_DMA_BLOCK_SIZE)
+
+// Number of most recent descriptors kept by the dispatcher trace
+#define FPGA_DMA_TRACE_ENTRIES 4096
+
+// Dispatcher trace record
+typedef struct {
+	uint8_t format;
+	uint8_t block_size;
+	uint8_t owned_by_hw;
+	uint32_t len;
+	uint64_t src;
+	uint64_t dst;
+	uint64_t next_desc;
+} msgdma_trace_entry_t;
+
+// Descriptor trace. Only the dispatcher thread writes it, so recording
+// an entry is a plain store plus a release of the count.
+typedef struct {
+	std::atomic<bool> enabled;
+	std::atomic<uint64_t> count;
+	msgdma_trace_entry_t entries[FPGA_DMA_TRACE_ENTRIES];
+} msgdma_trace_t;
+
 // DMA handle
 struct fpga_dma_handle {
 	fpga_handle fpga_h;
@@ -347,10 +391,18 @@ struct fpga_dma_handle {
 	uint64_t dma_prefetcher_base;
 	// pointer to hardware descriptor block-chain
 	msgdma_block_mem_t *block_mem;
-	concurrent_queue<struct msgdma_sw_desc*> ingress_queue;
-	concurrent_queue<struct msgdma_sw_desc*> pending_queue;	
-	concurrent_queue<struct msgdma_hw_descp*> free_desc;
-	concurrent_queue<struct msgdma_hw_descp*> invalid_desc_queue;
+	// ingress_queue has many producers, serialized by ingress_lock;
+	// the other queues are strictly one producer, one consumer
+	dma_queue<struct msgdma_sw_desc*, FPGA_DMA_QUEUE_DEPTH> ingress_queue;
+	dma_queue<struct msgdma_sw_desc*, FPGA_DMA_QUEUE_DEPTH> pending_queue;
+	dma_queue<struct msgdma_hw_descp*, FPGA_DMA_QUEUE_DEPTH> free_desc;
+	dma_queue<struct msgdma_hw_descp*, FPGA_DMA_QUEUE_DEPTH> invalid_desc_queue;
+	pthread_mutex_t ingress_lock;
+	// software descriptor pool: taken under ingress_lock, returned
+	// by the completion worker
+	msgdma_sw_desc_t *sw_desc_pool;
+	dma_queue<struct msgdma_sw_desc*, FPGA_DMA_QUEUE_DEPTH> free_sw_desc;
+	msgdma_trace_t trace;
 	// channel type
 	fpga_dma_channel_type_t ch_type;
         #define INVALID_CHANNEL (0x7fffffffffffffffULL)
@@ -363,6 +415,27 @@ struct fpga_dma_handle {
 	volatile bool terminate;
 };
 
+// Striping unit; consecutive units of a striped transfer go to
+// consecutive channels
+#define FPGA_DMA_STRIPE_UNIT (4 * 1024 * 1024)
+
+// Set of channels of one type driven as a single engine
+struct fpga_dma_stripe {
+	fpga_dma_channel_type_t ch_type;
+	size_t num_channels;
+	fpga_dma_handle_t *channels;
+};
+
+// Completion state shared by the per-channel parts of a striped transfer
+typedef struct msgdma_stripe_req {
+	std::atomic<size_t> remaining;
+	std::atomic<size_t> bytes_transferred;
+	std::atomic<bool> eop_arrived;
+	fpga_dma_transfer_cb cb;
+	void *context;
+	sem_t *done;
+} msgdma_stripe_req_t;
+
 // Prefetcher ctrl register
 typedef union {
 	uint64_t reg;
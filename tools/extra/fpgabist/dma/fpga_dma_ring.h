@@ -0,0 +1,212 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \fpga_dma_ring.h
+ * \brief Bounded single-producer/single-consumer queues for the DMA workers
+ */
+
+#ifndef __FPGA_DMA_RING_H__
+#define __FPGA_DMA_RING_H__
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Iterations a waiter spins before it parks on the futex
+#define FPGA_DMA_SPIN_COUNT 2048
+// Longest sleep between hardware status polls, in microseconds
+#define FPGA_DMA_POLL_MAX_SLEEP_US 50
+
+static inline void fpga_dma_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// Wake-up channel between a queue's producer and consumer.
+// Waiters spin for FPGA_DMA_SPIN_COUNT iterations and then sleep on
+// a futex until the other side calls notify(); an idle worker thread
+// therefore costs no CPU time.
+class dma_event {
+public:
+	dma_event() : seq_(0), waiters_(0) {}
+
+	void notify(void) {
+		seq_.fetch_add(1, std::memory_order_seq_cst);
+		if (waiters_.load(std::memory_order_seq_cst))
+			syscall(SYS_futex, &seq_, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+	}
+
+	// Wait until ready() returns true. ready() may have side
+	// effects (eg. try_pop); it is not called again once it succeeds.
+	template <typename Pred>
+	void wait(Pred ready) {
+		int i;
+		for (i = 0; i < FPGA_DMA_SPIN_COUNT; i++) {
+			if (ready())
+				return;
+			fpga_dma_cpu_relax();
+		}
+
+		while (1) {
+			uint32_t seq = seq_.load(std::memory_order_seq_cst);
+			waiters_.fetch_add(1, std::memory_order_seq_cst);
+			if (ready()) {
+				waiters_.fetch_sub(1, std::memory_order_seq_cst);
+				return;
+			}
+			// Returns at once if seq_ moved since it was sampled.
+			syscall(SYS_futex, &seq_, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+			waiters_.fetch_sub(1, std::memory_order_seq_cst);
+		}
+	}
+
+private:
+	std::atomic<uint32_t> seq_;
+	std::atomic<uint32_t> waiters_;
+};
+
+// Poll a condition that is set by hardware rather than by another
+// thread: spin first, then yield, then back off with growing sleeps.
+template <typename Pred>
+static inline void fpga_dma_poll(Pred ready)
+{
+	struct timespec ts = { 0, 1000 };
+	int i;
+
+	for (i = 0; i < FPGA_DMA_SPIN_COUNT; i++) {
+		if (ready())
+			return;
+		fpga_dma_cpu_relax();
+	}
+
+	for (i = 0; i < 16; i++) {
+		if (ready())
+			return;
+		sched_yield();
+	}
+
+	while (!ready()) {
+		nanosleep(&ts, NULL);
+		if (ts.tv_nsec < FPGA_DMA_POLL_MAX_SLEEP_US * 1000)
+			ts.tv_nsec *= 2;
+	}
+}
+
+// Bounded lock-free ring with one producer and one consumer.
+// Capacity is rounded up to a power of two.
+template <typename T, size_t N>
+class spsc_ring {
+public:
+	spsc_ring() : head_(0), tail_(0) {
+		size_t n = 1;
+		while (n < N)
+			n <<= 1;
+		mask_ = n - 1;
+		slots_ = new T[n];
+	}
+
+	~spsc_ring() {
+		delete[] slots_;
+	}
+
+	bool try_push(const T &v) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) > mask_)
+			return false;
+		slots_[tail & mask_] = v;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool try_pop(T &v) {
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return false;
+		v = slots_[head & mask_];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty(void) const {
+		return head_.load(std::memory_order_acquire) ==
+		       tail_.load(std::memory_order_acquire);
+	}
+
+private:
+	spsc_ring(const spsc_ring &);
+	spsc_ring &operator=(const spsc_ring &);
+
+	// keep the consumer and producer indices on separate cache lines
+	std::atomic<size_t> head_;
+	char pad0_[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail_;
+	char pad1_[64 - sizeof(std::atomic<size_t>)];
+	size_t mask_;
+	T *slots_;
+};
+
+// spsc_ring with blocking push/pop built on dma_event
+template <typename T, size_t N>
+class dma_queue {
+public:
+	void push(const T &v) {
+		if (!ring_.try_push(v))
+			not_full_.wait([&]() { return ring_.try_push(v); });
+		not_empty_.notify();
+	}
+
+	void pop(T &v) {
+		if (!ring_.try_pop(v))
+			not_empty_.wait([&]() { return ring_.try_pop(v); });
+		not_full_.notify();
+	}
+
+	bool try_pop(T &v) {
+		if (!ring_.try_pop(v))
+			return false;
+		not_full_.notify();
+		return true;
+	}
+
+	bool empty(void) const {
+		return ring_.empty();
+	}
+
+private:
+	spsc_ring<T, N> ring_;
+	dma_event not_empty_;
+	dma_event not_full_;
+};
+
+#endif // __FPGA_DMA_RING_H__
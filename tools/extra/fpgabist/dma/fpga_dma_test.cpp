@@ -78,7 +78,8 @@ static void printUsage()
 "            packet           Packet transfer\n"
 "         -f,--decim_factor  Optional decimation factor\n\n"
 "         Below options are only valid when -r/--direction is set to mtom:\n\n"
-"         -a,--fpga_addr      Address in FPGA local memory (hex format)\n\n"
+"         -a,--fpga_addr      Address in FPGA local memory (hex format)\n"
+"         -c,--stripe         Stripe each transfer across all memory-mapped channels\n\n"
 );
 
 	exit(1);
@@ -105,13 +106,14 @@ static void parse_args(struct config *config, int argc, char *argv[])
 			{"loopback", required_argument, 0, 'l'},
 			{"decim_factor", required_argument, 0, 'f'},
 			{"fpga_addr", required_argument, 0, 'a'},
+			{"stripe", no_argument, 0, 'c'},
       {"version", no_argument, 0, 'v'},
 			{0, 0, 0, 0}
 		};
 		char *endptr;
 		const char *tmp_optarg;
 
-		c = getopt_long(argc, argv, "hB:D:F:S:s:p:r:l:f:t:a:v", options, NULL);
+		c = getopt_long(argc, argv, "hB:D:F:S:s:p:r:l:f:t:a:cv", options, NULL);
 		if (c == -1) {
 			break;
 		}
@@ -258,6 +260,11 @@ static void parse_args(struct config *config, int argc, char *argv[])
 			debug_print("fpga local memory address = %lx\n", (uint64_t)config->fpga_addr);
 			break;
 
+		case 'c':    /* stripe across channels */
+			config->stripe = true;
+			debug_print("striping enabled\n");
+			break;
+
     case 'v':    /* version */
         cout << "fpga_dma_test " << OPAE_VERSION
              << " " << OPAE_GIT_COMMIT_HASH;
@@ -290,6 +297,7 @@ int main(int argc, char *argv[]) {
 	 	.loopback = DMA_INVAL_LOOPBACK,
 		.decim_factor = CONFIG_UNINIT,
 		.fpga_addr = CONFIG_UNINIT,
+		.stripe = false,
 	};
 
 	parse_args(&config, argc, argv);
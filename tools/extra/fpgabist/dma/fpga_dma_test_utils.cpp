@@ -605,6 +605,75 @@ out:
 	return res;
 }
 
+// Write and read back FPGA local memory using every memory-mapped channel at once
+static fpga_result stripe_test(fpga_handle afc_h, fpga_dma_stripe_t stripe, struct config *config) {
+	fpga_dma_transfer_t transfer = NULL;
+	fpga_result res = FPGA_OK;
+	struct timespec start, end;
+	double wr_time, rd_time;
+	size_t ch_count = 0;
+
+	struct buf_attrs battrs = {
+		.va = NULL,
+		.iova = 0,
+		.wsid = 0,
+		.size = 0
+	};
+
+	res = fpgaDMAStripeGetChannels(stripe, &ch_count);
+	ON_ERR_GOTO(res, out, "fpgaDMAStripeGetChannels");
+
+	battrs.size = config->data_size;
+	res = allocate_buffer(afc_h, &battrs);
+	ON_ERR_GOTO(res, out, "allocating buffer");
+
+	res = fpgaDMATransferInit(&transfer);
+	ON_ERR_GOTO(res, out, "allocating transfer");
+
+	fill_buffer((unsigned char *)battrs.va, config->data_size);
+	debug_print("filled test buffer\n");
+
+	fpgaDMATransferSetSrc(transfer, battrs.iova);
+	fpgaDMATransferSetDst(transfer, config->fpga_addr);
+	fpgaDMATransferSetLen(transfer, config->data_size);
+	fpgaDMATransferSetTransferType(transfer, HOST_MM_TO_FPGA_MM);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	res = fpgaDMAStripeTransfer(stripe, transfer);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ON_ERR_GOTO(res, free_transfer, "striped write");
+	wr_time = getTime(start, end);
+
+	// clear recieve buffer
+	memset(battrs.va, 0, battrs.size);
+	fpgaDMATransferReset(transfer);
+
+	fpgaDMATransferSetSrc(transfer, config->fpga_addr);
+	fpgaDMATransferSetDst(transfer, battrs.iova);
+	fpgaDMATransferSetLen(transfer, config->data_size);
+	fpgaDMATransferSetTransferType(transfer, FPGA_MM_TO_HOST_MM);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	res = fpgaDMAStripeTransfer(stripe, transfer);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ON_ERR_GOTO(res, free_transfer, "striped read");
+	rd_time = getTime(start, end);
+
+	res = verify_buffer((unsigned char *)battrs.va, config->data_size, 0/*decimation factor*/);
+	ON_ERR_GOTO(res, free_transfer, "buffer verify failed");
+
+	std::cout << "PASS! Striped over " << ch_count << " channels: write bandwidth = "
+		  << getBandwidth(config->data_size, wr_time) << " MB/s, read bandwidth = "
+		  << getBandwidth(config->data_size, rd_time) << " MB/s" << std::endl;
+
+free_transfer:
+	if(transfer)
+		fpgaDMATransferDestroy(&transfer);
+out:
+	if(battrs.va)
+		free_buffer(afc_h, &battrs);
+
+	return res;
+}
+
 fpga_result configure_numa(fpga_token afc_token, bool cpu_affinity, bool memory_affinity)
 {
 	fpga_result res = FPGA_OK;
@@ -737,6 +806,7 @@ fpga_result do_action(struct config *config, fpga_token afc_tok)
 	fpga_dma_handle_t dma_h = NULL;
 	fpga_dma_handle_t tx_dma_h = NULL;
 	fpga_dma_handle_t rx_dma_h = NULL;
+	fpga_dma_stripe_t stripe = NULL;
 	fpga_handle afc_h = NULL;
 	fpga_result res;
 	#ifndef USE_ASE
@@ -771,7 +841,16 @@ fpga_result do_action(struct config *config, fpga_token afc_tok)
 
 	debug_print("found %ld dma channels\n", ch_count);
 
-	if(config->direction == DMA_MTOM) {
+	if(config->direction == DMA_MTOM && config->stripe) {
+		// the channel workers inherit the NUMA binding set up by configure_numa()
+		res = fpgaDMAStripeOpen(afc_h, MM, &stripe);
+		ON_ERR_GOTO(res, out_unmap, "fpgaDMAStripeOpen");
+		debug_print("opened striped memory to memory channels\n");
+
+		res = stripe_test(afc_h, stripe, config);
+		ON_ERR_GOTO(res, out_stripe_close, "stripe test");
+		debug_print("stripe test success\n");
+	} else if(config->direction == DMA_MTOM) {
 		res = fpgaDMAOpen(afc_h, 0, &dma_h);
 		ON_ERR_GOTO(res, out_dma_close, "fpgaDMAOpen");
 		debug_print("opened memory to memory channel\n");
@@ -812,6 +891,13 @@ fpga_result do_action(struct config *config, fpga_token afc_tok)
 		}
 	}
 
+out_stripe_close:
+	if(stripe) {
+		res = fpgaDMAStripeClose(stripe);
+		ON_ERR_GOTO(res, out_unmap, "fpgaDMAStripeClose");
+		debug_print("closed striped channels\n");
+	}
+
 out_rx_close:
 	if(rx_dma_h) {
 		res = fpgaDMAClose(rx_dma_h);
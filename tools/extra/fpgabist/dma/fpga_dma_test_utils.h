@@ -99,6 +99,7 @@ struct config {
 	enum dma_loopback loopback;
 	uint16_t decim_factor;
 	uint64_t fpga_addr;
+	bool stripe;
 };
 
 typedef union {
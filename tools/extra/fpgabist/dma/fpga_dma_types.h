@@ -81,9 +81,19 @@ typedef enum {
 	MM
 } fpga_dma_channel_type_t;
 
+// One contiguous piece of a scatter-gather transfer
+typedef struct {
+	uint64_t src;
+	uint64_t dst;
+	uint64_t len;
+} fpga_dma_segment_t;
+
 // Opaque object that describes a DMA transfer
 typedef struct fpga_dma_transfer *fpga_dma_transfer_t;
 
+// Opaque object that stripes transfers across DMA channels
+typedef struct fpga_dma_stripe *fpga_dma_stripe_t;
+
 // Opaque object that describes DMA channel
 typedef struct fpga_dma_handle *fpga_dma_handle_t;
 
@@ -607,6 +607,9 @@ fpga_result fpgaDmaOpen(fpga_handle fpga, int dma_idx, fpga_dma_handle *dma_p)
 	dma_h->mmio_num = 0;
 	dma_h->mmio_offset = 0;
 	dma_h->cur_ase_page = 0xffffffffffffffffUll;
+	dma_h->pipeline_depth = 0;
+	dma_h->magic_buf = NULL;
+	dma_h->fence_buf = NULL;
 
 	// Discover DMA BBB by traversing the device feature list
 	bool end_of_list = false;
@@ -672,13 +675,26 @@ fpga_result fpgaDmaOpen(fpga_handle fpga, int dma_idx, fpga_dma_handle *dma_p)
 	res = fpgaPrepareBuffer(dma_h->fpga_h, FPGA_DMA_ALIGN_BYTES,
 				(void **)&(dma_h->magic_buf),
 				&dma_h->magic_wsid, 0);
-	ON_ERR_GOTO(res, out, "fpgaPrepareBuffer");
+	ON_ERR_GOTO(res, rel_buf, "fpgaPrepareBuffer");
 
 	res = fpgaGetIOAddress(dma_h->fpga_h, dma_h->magic_wsid,
 			       &dma_h->magic_iova);
 	ON_ERR_GOTO(res, rel_buf, "fpgaGetIOAddress");
 	memset((void *)dma_h->magic_buf, 0, FPGA_DMA_ALIGN_BYTES);
 
+	// Allocate write-fence slots for pipelined transfers
+	res = fpgaPrepareBuffer(dma_h->fpga_h,
+				FPGA_DMA_MAX_BUF * FPGA_DMA_ALIGN_BYTES,
+				(void **)&(dma_h->fence_buf),
+				&dma_h->fence_wsid, 0);
+	ON_ERR_GOTO(res, rel_buf, "fpgaPrepareBuffer");
+
+	res = fpgaGetIOAddress(dma_h->fpga_h, dma_h->fence_wsid,
+			       &dma_h->fence_iova);
+	ON_ERR_GOTO(res, rel_buf, "fpgaGetIOAddress");
+	memset((void *)dma_h->fence_buf, 0,
+	       FPGA_DMA_MAX_BUF * FPGA_DMA_ALIGN_BYTES);
+
 	// turn on global interrupts
 	msgdma_ctrl_t ctrl = {0};
 	ctrl.ct.global_intr_en_mask = 1;
@@ -703,22 +719,46 @@ fpga_result fpgaDmaOpen(fpga_handle fpga, int dma_idx, fpga_dma_handle *dma_p)
 
 	sigres = sigaction(SIGHUP, &sa, &old_action);
 	if (sigres < 0) {
-		ON_ERR_GOTO(sigres < 0, destroy_eh,
+		res = FPGA_EXCEPTION;
+		ON_ERR_GOTO(res, unreg_eh,
 			    "Error: failed to unregister signal handler.\n");
 	}
 	CsrControl = HOST_MMIO_32_ADDR(dma_h, CSR_CONTROL(dma_h));
 
 	return FPGA_OK;
 
+unreg_eh:
+	if (fpgaUnregisterEvent(dma_h->fpga_h, FPGA_EVENT_INTERRUPT, dma_h->eh) !=
+	    FPGA_OK) {
+		error_print("Error fpgaUnregisterEvent\n");
+	}
+
 destroy_eh:
-	res = fpgaDestroyEventHandle(&dma_h->eh);
-	ON_ERR_GOTO(res, rel_buf, "fpgaDestroyEventHandle");
+	if (fpgaDestroyEventHandle(&dma_h->eh) != FPGA_OK) {
+		error_print("Error fpgaDestroyEventHandle\n");
+	}
 
 rel_buf:
+	// Release whatever was prepared, as fpgaDmaClose does, without
+	// overwriting the result that brought us here.
 	for (i = 0; i < FPGA_DMA_MAX_BUF; i++) {
-		res = fpgaReleaseBuffer(dma_h->fpga_h, dma_h->dma_buf_wsid[i]);
-		ON_ERR_GOTO(res, out, "fpgaReleaseBuffer");
+		if (dma_h->dma_buf_ptr[i] &&
+		    fpgaReleaseBuffer(dma_h->fpga_h, dma_h->dma_buf_wsid[i]) !=
+			    FPGA_OK) {
+			error_print("Error fpgaReleaseBuffer\n");
+		}
+	}
+	if (dma_h->magic_buf &&
+	    fpgaReleaseBuffer(dma_h->fpga_h, dma_h->magic_wsid) != FPGA_OK) {
+		error_print("Error fpgaReleaseBuffer\n");
 	}
+	if (dma_h->fence_buf &&
+	    fpgaReleaseBuffer(dma_h->fpga_h, dma_h->fence_wsid) != FPGA_OK) {
+		error_print("Error fpgaReleaseBuffer\n");
+	}
+	*dma_p = NULL;
+	free(dma_h);
+	return res;
 out:
 	if (!dma_found)
 		free(dma_h);
@@ -1187,6 +1227,209 @@ static void _wait_magic(fpga_dma_handle dma_h)
 	*(dma_h->magic_buf) = 0x0ULL;
 }
 
+static inline volatile uint64_t *_fence_slot(fpga_dma_handle dma_h,
+					       uint64_t slot)
+{
+	return dma_h->fence_buf + slot * (FPGA_DMA_ALIGN_BYTES / QWORD_BYTES);
+}
+
+/**
+ * _issue_fence
+ *
+ * @brief                Queues a write fence for a bounce buffer slot
+ * @param[in] dma_h      Handle to the FPGA DMA object
+ * @param[in] slot       Bounce buffer slot
+ * @return fpga_result FPGA_OK on success, return code otherwise
+ *
+ * The magic number lands in the slot, and the interrupt fires, only after
+ * every descriptor queued before the fence has completed.
+ */
+static fpga_result _issue_fence(fpga_dma_handle dma_h, uint64_t slot)
+{
+	*_fence_slot(dma_h, slot) = 0x0ULL;
+
+	return _do_dma(dma_h,
+		       (dma_h->fence_iova + slot * FPGA_DMA_ALIGN_BYTES)
+			       | FPGA_DMA_WF_HOST_MASK,
+		       FPGA_DMA_WF_ROM_MAGIC_NO_MASK, 64, 1, FPGA_TO_HOST_MM,
+		       true /*intr_en */);
+}
+
+/**
+ * _wait_fence
+ *
+ * @brief                Sleeps until the write fence of a slot arrives
+ * @param[in] dma_h      Handle to the FPGA DMA object
+ * @param[in] slot       Bounce buffer slot
+ * @return fpga_result FPGA_OK on success, return code otherwise
+ *
+ * Several fences may be outstanding and their interrupts may coalesce, so
+ * the slot itself is the completion record; the interrupt only wakes us.
+ */
+static fpga_result _wait_fence(fpga_dma_handle dma_h, uint64_t slot)
+{
+	volatile uint64_t *fence = _fence_slot(dma_h, slot);
+	struct pollfd pfd = {0};
+	fpga_result res = FPGA_OK;
+	uint64_t waited_msec = 0;
+	int poll_res;
+
+	res = fpgaGetOSObjectFromEventHandle(dma_h->eh, &pfd.fd);
+	ON_ERR_GOTO(res, out, "fpgaGetOSObjectFromEventHandle failed\n");
+	pfd.events = POLLIN;
+
+	while (*fence != FPGA_DMA_WF_MAGIC_NO) {
+		if (waited_msec >= FPGA_DMA_TIMEOUT_MSEC) {
+			fprintf(stderr, "Poll(interrupt) timeout \n");
+			res = FPGA_EXCEPTION;
+			goto out;
+		}
+#ifdef CHECK_DELAYS
+		if (0 == poll(&pfd, 1, 0))
+			poll_wait_count++;
+#endif
+		poll_res = poll(&pfd, 1, FPGA_DMA_FENCE_POLL_MSEC);
+		if (poll_res > 0) {
+			uint64_t count = 0;
+			if (read(pfd.fd, &count, sizeof(count)) < 0
+			    && errno != EAGAIN) {
+				fprintf(stderr, "Error: poll failed read: %s\n",
+					strerror(errno));
+				res = FPGA_EXCEPTION;
+				goto out;
+			}
+			clear_interrupt(dma_h);
+		} else if (poll_res == 0) {
+			waited_msec += FPGA_DMA_FENCE_POLL_MSEC;
+		} else if (errno != EINTR) {
+			fprintf(stderr, "Poll error errno = %s\n",
+				strerror(errno));
+			res = FPGA_EXCEPTION;
+			goto out;
+		}
+	}
+	*fence = 0x0ULL;
+
+out:
+	return res;
+}
+
+/**
+ * _pipeline_host_to_fpga
+ *
+ * @brief                Pipelined host to FPGA copy of a 64-byte multiple
+ * @param[in] dma_h      Handle to the FPGA DMA object
+ * @param[in] dst        FPGA address, 64-byte aligned
+ * @param[in] src        Host address
+ * @param[in] count      Size in bytes, multiple of 64
+ * @param[in] type       Direction of transfer
+ * @return fpga_result FPGA_OK on success, return code otherwise
+ *
+ * Chunk k is staged in slot k % depth. The slot is reused as soon as the
+ * fence of chunk k - depth arrives, so the memcpy of chunk k + 1 runs while
+ * chunk k is still in flight.
+ */
+static fpga_result _pipeline_host_to_fpga(fpga_dma_handle dma_h, uint64_t dst,
+					  uint64_t src, uint64_t count,
+					  fpga_dma_transfer_t type)
+{
+	fpga_result res = FPGA_OK;
+	uint64_t depth = dma_h->pipeline_depth;
+	uint64_t chunks = (count + fpga_dma_buf_size - 1) / fpga_dma_buf_size;
+	uint64_t i, slot, len;
+
+	for (i = 0; i < chunks; i++) {
+		slot = i % depth;
+		len = min(fpga_dma_buf_size, count - i * fpga_dma_buf_size);
+
+		if (i >= depth) {
+			res = _wait_fence(dma_h, slot);
+			ON_ERR_GOTO(res, out, "_wait_fence");
+		}
+
+		local_memcpy(dma_h->dma_buf_ptr[slot],
+			     (void *)(src + i * fpga_dma_buf_size), len);
+		res = _do_dma(dma_h, dst + i * fpga_dma_buf_size,
+			      dma_h->dma_buf_iova[slot] | FPGA_DMA_HOST_MASK,
+			      len, i == (chunks - 1), type, false /*intr_en */);
+		ON_ERR_GOTO(res, out, "HOST_TO_FPGA_MM Transfer failed\n");
+
+		res = _issue_fence(dma_h, slot);
+		ON_ERR_GOTO(res, out, "_issue_fence");
+	}
+
+	// drain the chunks still in flight
+	for (i = chunks > depth ? chunks - depth : 0; i < chunks; i++) {
+		res = _wait_fence(dma_h, i % depth);
+		ON_ERR_GOTO(res, out, "_wait_fence");
+	}
+
+out:
+	return res;
+}
+
+/**
+ * _pipeline_fpga_to_host
+ *
+ * @brief                Pipelined FPGA to host copy of a 64-byte multiple
+ * @param[in] dma_h      Handle to the FPGA DMA object
+ * @param[in] dst        Host address
+ * @param[in] src        FPGA address, 64-byte aligned
+ * @param[in] count      Size in bytes, multiple of 64
+ * @param[in] type       Direction of transfer
+ * @return fpga_result FPGA_OK on success, return code otherwise
+ *
+ * Up to depth chunks are in flight. As soon as the fence of chunk k
+ * arrives, its slot is copied out and refilled with chunk k + depth.
+ */
+static fpga_result _pipeline_fpga_to_host(fpga_dma_handle dma_h, uint64_t dst,
+					  uint64_t src, uint64_t count,
+					  fpga_dma_transfer_t type)
+{
+	fpga_result res = FPGA_OK;
+	uint64_t depth = dma_h->pipeline_depth;
+	uint64_t chunks = (count + fpga_dma_buf_size - 1) / fpga_dma_buf_size;
+	uint64_t i, k, slot, len;
+
+	for (i = 0; i < chunks + depth; i++) {
+		// i >= depth: chunk i - depth is done with its slot
+		if (i >= depth) {
+			k = i - depth;
+			if (k >= chunks)
+				break;
+			slot = k % depth;
+			len = min(fpga_dma_buf_size,
+				  count - k * fpga_dma_buf_size);
+
+			res = _wait_fence(dma_h, slot);
+			ON_ERR_GOTO(res, out, "_wait_fence");
+			local_memcpy((void *)(dst + k * fpga_dma_buf_size),
+				     dma_h->dma_buf_ptr[slot], len);
+		}
+
+		// i < chunks: queue chunk i in the slot just drained
+		if (i < chunks) {
+			slot = i % depth;
+			len = min(fpga_dma_buf_size,
+				  count - i * fpga_dma_buf_size);
+
+			res = _do_dma(dma_h,
+				      dma_h->dma_buf_iova[slot]
+					      | FPGA_DMA_HOST_MASK,
+				      src + i * fpga_dma_buf_size, len, 1, type,
+				      false /*intr_en */);
+			ON_ERR_GOTO(res, out,
+				    "FPGA_TO_HOST_MM Transfer failed");
+
+			res = _issue_fence(dma_h, slot);
+			ON_ERR_GOTO(res, out, "_issue_fence");
+		}
+	}
+
+out:
+	return res;
+}
+
 fpga_result transferHostToFpga(fpga_dma_handle dma_h, uint64_t dst,
 			       uint64_t src, size_t count,
 			       fpga_dma_transfer_t type)
@@ -1215,7 +1458,24 @@ fpga_result transferHostToFpga(fpga_dma_handle dma_h, uint64_t dst,
 			count_left = count_left - align_bytes;
 		}
 	}
-	if (count_left) {
+	if (count_left && dma_h->pipeline_depth > 1) {
+		uint64_t dma_tx_bytes =
+			(count_left / FPGA_DMA_ALIGN_BYTES) * FPGA_DMA_ALIGN_BYTES;
+		if (dma_tx_bytes) {
+			res = _pipeline_host_to_fpga(dma_h, dst, src,
+						     dma_tx_bytes, type);
+			ON_ERR_GOTO(res, out,
+				    "HOST_TO_FPGA_MM Transfer failed\n");
+		}
+		count_left -= dma_tx_bytes;
+		if (count_left) {
+			dst += dma_tx_bytes;
+			src += dma_tx_bytes;
+			res = _ase_host_to_fpga(dma_h, &dst, &src, count_left);
+			ON_ERR_GOTO(res, out,
+				    "HOST_TO_FPGA_MM Transfer failed\n");
+		}
+	} else if (count_left) {
 		uint64_t dma_chunks = count_left / fpga_dma_buf_size;
 		count_left -= (dma_chunks * fpga_dma_buf_size);
 		debug_print("DMA TX : dma chuncks = %" PRIu64
@@ -1349,7 +1609,24 @@ fpga_result transferFpgaToHost(fpga_dma_handle dma_h, uint64_t dst,
 			count_left = count_left - align_bytes;
 		}
 	}
-	if (count_left) {
+	if (count_left && dma_h->pipeline_depth > 1) {
+		uint64_t dma_tx_bytes =
+			(count_left / FPGA_DMA_ALIGN_BYTES) * FPGA_DMA_ALIGN_BYTES;
+		if (dma_tx_bytes) {
+			res = _pipeline_fpga_to_host(dma_h, dst, src,
+						     dma_tx_bytes, type);
+			ON_ERR_GOTO(res, out,
+				    "FPGA_TO_HOST_MM Transfer failed");
+		}
+		count_left -= dma_tx_bytes;
+		if (count_left) {
+			dst += dma_tx_bytes;
+			src += dma_tx_bytes;
+			res = _ase_fpga_to_host(dma_h, &src, &dst, count_left);
+			ON_ERR_GOTO(res, out,
+				    "FPGA_TO_HOST_MM Transfer failed");
+		}
+	} else if (count_left) {
 		uint64_t dma_chunks = count_left / fpga_dma_buf_size;
 		count_left -= (dma_chunks * fpga_dma_buf_size);
 		debug_print("DMA TX : dma chunks = %" PRIu64
@@ -1596,6 +1873,18 @@ fpga_result fpgaDmaTransferSync(fpga_dma_handle dma_h, uint64_t dst,
 	return res;
 }
 
+fpga_result fpgaDmaSetPipelineDepth(fpga_dma_handle dma_h, uint32_t depth)
+{
+	if (!dma_h)
+		return FPGA_INVALID_PARAM;
+
+	if (depth > FPGA_DMA_MAX_BUF)
+		return FPGA_INVALID_PARAM;
+
+	dma_h->pipeline_depth = depth;
+	return FPGA_OK;
+}
+
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #pragma GCC diagnostic ignored "-Wunused-value"
 #define UNUSED(...) (void)(__VA_ARGS__)
@@ -1641,6 +1930,9 @@ fpga_result fpgaDmaClose(fpga_dma_handle dma_h)
 	res = fpgaReleaseBuffer(dma_h->fpga_h, dma_h->magic_wsid);
 	ON_ERR_GOTO(res, out, "fpgaReleaseBuffer");
 
+	res = fpgaReleaseBuffer(dma_h->fpga_h, dma_h->fence_wsid);
+	ON_ERR_GOTO(res, out, "fpgaReleaseBuffer");
+
 	fpgaUnregisterEvent(dma_h->fpga_h, FPGA_EVENT_INTERRUPT, dma_h->eh);
 	fpgaDestroyEventHandle(&dma_h->eh);
 
@@ -120,6 +120,23 @@ fpga_result fpgaDmaTransferAsync(fpga_dma_handle dma, uint64_t dst,
 				 fpga_dma_transfer_t type,
 				 fpga_dma_transfer_cb cb, void *context);
 
+/**
+ * fpgaDmaSetPipelineDepth
+ *
+ * @brief             Select how host <-> FPGA transfers use the bounce buffers.
+ * With a depth of 0 or 1 (the default), fpgaDmaTransferSync() uses the
+ * serialized path. With a depth of 2 to 8, it rotates through that many
+ * bounce buffers: the memcpy into or out of one buffer overlaps the DMA of
+ * the others, and each chunk completes through an interrupt-driven write
+ * fence.
+ * @param[in] dma     Handle to the FPGA DMA object
+ * @param[in] depth   Number of bounce buffers in flight
+ * @return fpga_result FPGA_OK on success, FPGA_INVALID_PARAM if depth is
+ * out of range
+ *
+ */
+fpga_result fpgaDmaSetPipelineDepth(fpga_dma_handle dma, uint32_t depth);
+
 /**
  * fpgaDmaClose
  *
@@ -159,6 +159,10 @@
 
 #define FPGA_DMA_MAX_BUF 8
 
+// Pipelined transfers wait for a chunk's write fence in slices of
+// this many milliseconds, so a coalesced interrupt can't stall them
+#define FPGA_DMA_FENCE_POLL_MSEC 1
+
 typedef struct __attribute__((__packed__)) {
 	uint64_t dfh;
 	uint64_t feature_uuid_lo;
@@ -200,6 +204,12 @@ struct _dma_handle_t {
 	uint64_t *dma_buf_ptr[FPGA_DMA_MAX_BUF];
 	uint64_t dma_buf_wsid[FPGA_DMA_MAX_BUF];
 	uint64_t dma_buf_iova[FPGA_DMA_MAX_BUF];
+	// number of rotating bounce buffers; 0 selects the serialized path
+	uint32_t pipeline_depth;
+	// one write-fence slot (a cache line) per bounce buffer
+	volatile uint64_t *fence_buf;
+	uint64_t fence_iova;
+	uint64_t fence_wsid;
 };
 
 typedef union {
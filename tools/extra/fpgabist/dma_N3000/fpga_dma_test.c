@@ -80,6 +80,7 @@ bool use_advise = false;
 bool do_not_verify = false;
 bool cpu_affinity = false;
 bool memory_affinity = false;
+uint32_t pipeline_depth = 0;
 
 /*
  * macro for checking return codes
@@ -117,7 +118,7 @@ config = {
 /*
  *  *  * Parse command line arguments
  *   *   */
-#define GETOPT_STRING ":B:D:S:s:G:mpc2nayCMv"
+#define GETOPT_STRING ":B:D:S:s:G:P:mpc2nayCMv"
 fpga_result parse_args(int argc, char *argv[])
 {
     struct option longopts[] = {
@@ -126,6 +127,7 @@ fpga_result parse_args(int argc, char *argv[])
         {"size", required_argument, NULL, 'S'},
         {"bufsize", required_argument, NULL, 's'},
         {"guid", required_argument, NULL, 'G'},
+        {"pipeline", required_argument, NULL, 'P'},
 	{"version", no_argument, NULL, 'v'},
 	{NULL, 0, NULL, 0}
     };
@@ -207,6 +209,16 @@ fpga_result parse_args(int argc, char *argv[])
             if (tmp_optarg)
                 memcpy(config.target.guid, tmp_optarg, buf_size);
             break;
+		case 'P':   /* pipeline depth */
+			if (NULL == tmp_optarg)
+				break;
+			endptr = NULL;
+			pipeline_depth = (uint32_t)strtoul(tmp_optarg, &endptr, 0);
+			if (endptr != tmp_optarg + strnlen(tmp_optarg, 16)) {
+				fprintf(stderr, "invalid pipeline depth: %s\n", tmp_optarg);
+				return FPGA_EXCEPTION;
+			}
+			break;
 		case 'm':
 			use_malloc = true;
 			break;
@@ -576,6 +588,76 @@ fpga_result ddr_sweep(fpga_dma_handle dma_h, uint64_t mem_size, uint64_t ptr_ali
 	return FPGA_OK;
 }
 
+// time one host <-> FPGA round trip of size bytes; returns 0 on success
+static int time_round_trip(fpga_dma_handle dma_h, uint64_t *buf, uint64_t size,
+			   double *h2f_sec, double *f2h_sec)
+{
+	struct timespec start, end;
+	fpga_result res;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	res = fpgaDmaTransferSync(dma_h, 0x0, (uint64_t)buf, size,
+				  HOST_TO_FPGA_MM);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ON_ERR_GOTO(res, out, "fpgaDmaTransferSync HOST_TO_FPGA_MM");
+	*h2f_sec = getTime(start, end);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	res = fpgaDmaTransferSync(dma_h, (uint64_t)buf, 0x0, size,
+				  FPGA_TO_HOST_MM);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ON_ERR_GOTO(res, out, "fpgaDmaTransferSync FPGA_TO_HOST_MM");
+	*f2h_sec = getTime(start, end);
+
+out:
+	return res != FPGA_OK;
+}
+
+// Compare the serialized path with the pipelined one at the given depth
+fpga_result pipeline_report(fpga_dma_handle dma_h, uint64_t mem_size,
+			    uint32_t depth)
+{
+	double ser_h2f = 0.0, ser_f2h = 0.0, pip_h2f = 0.0, pip_f2h = 0.0;
+	fpga_result res = FPGA_OK;
+
+	uint64_t *dma_buf_ptr = malloc_aligned(getpagesize(), mem_size);
+	if (dma_buf_ptr == NULL) {
+		printf("Unable to allocate %ld bytes of memory", mem_size);
+		return FPGA_NO_MEMORY;
+	}
+	fill_buffer((char *)dma_buf_ptr, mem_size);
+
+	fpgaDmaSetPipelineDepth(dma_h, 0);
+	if (time_round_trip(dma_h, dma_buf_ptr, mem_size, &ser_h2f, &ser_f2h)) {
+		res = FPGA_EXCEPTION;
+		goto out;
+	}
+
+	fpgaDmaSetPipelineDepth(dma_h, depth);
+	clear_buffer((char *)dma_buf_ptr, mem_size);
+	fill_buffer((char *)dma_buf_ptr, mem_size);
+	if (time_round_trip(dma_h, dma_buf_ptr, mem_size, &pip_h2f, &pip_f2h)) {
+		res = FPGA_EXCEPTION;
+		goto out;
+	}
+
+	res = verify_buffer((char *)dma_buf_ptr, mem_size);
+	ON_ERR_GOTO(res, out, "verify_buffer");
+
+#define MBPS(sec) ((double)mem_size / ((sec) * 1000 * 1000))
+	printf("Bandwidth (MB/s) for 0x%lx bytes   serialized   pipelined(%u)   speedup\n",
+	       mem_size, depth);
+	printf("  Host to FPGA                    %10.1f   %13.1f   %6.2fx\n",
+	       MBPS(ser_h2f), MBPS(pip_h2f), ser_h2f / pip_h2f);
+	printf("  FPGA to Host                    %10.1f   %13.1f   %6.2fx\n",
+	       MBPS(ser_f2h), MBPS(pip_f2h), ser_f2h / pip_f2h);
+#undef MBPS
+
+out:
+	free_aligned(dma_buf_ptr);
+	return res;
+}
+
 static void usage(void)
 {
 	printf("Usage: fpga_dma_test <use_ase = 1 (simulation only), 0 (hardware)> [options]\n");
@@ -593,6 +675,7 @@ static void usage(void)
 	printf("\t-D\tSelect DMA to test\n");
 	printf("\t-S\tSet memory test size\n");
 	printf("\t-G\tSet AFU GUID\n");
+	printf("\t-P\tPipeline depth (2-8 bounce buffers); also compares it with the serialized path\n");
 }
 
 static int check_config()
@@ -762,6 +845,11 @@ int main(int argc, char *argv[])
         ON_ERR_GOTO(res, out_dma_close, "Invaid DMA Handle");
     }
 
+	if (pipeline_depth) {
+		res = fpgaDmaSetPipelineDepth(dma_h, pipeline_depth);
+		ON_ERR_GOTO(res, out_dma_close, "fpgaDmaSetPipelineDepth");
+	}
+
 	if (use_ase)
 		count = ASE_TEST_BUF_SIZE;
 	else
@@ -865,6 +953,13 @@ int main(int argc, char *argv[])
 			res |= ddr_sweep(dma_h, config.target.size, 0, 7);
 		}
 		ON_ERR_GOTO(res, out_dma_close, "ddr_sweep");
+
+		if (pipeline_depth > 1) {
+			printf("Comparing serialized and pipelined transfers\n");
+			res = pipeline_report(dma_h, config.target.size,
+					      pipeline_depth);
+			ON_ERR_GOTO(res, out_dma_close, "pipeline_report");
+		}
 	}
 
 	free(verify_buf);